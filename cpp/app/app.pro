@@ -0,0 +1,70 @@
+TEMPLATE = app
+TARGET = Mind2Do
+
+QT += core gui widgets concurrent
+
+CONFIG += c++17
+
+# You can make your code fail to compile if it uses deprecated APIs.
+# In order to do so, uncomment the following line.
+#DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
+
+include(../core/mind2docore.pri)
+
+SOURCES += \
+    ../main.cpp \
+    ../mainwindow.cpp \
+    ../mindmapnode.cpp \
+    ../mindmapscene.cpp \
+    ../mindmapview.cpp \
+    ../filemanager.cpp \
+    ../filemanagerservices.cpp \
+    ../documentviewer.cpp \
+    ../documentviewermedia.cpp \
+    ../formattingtoolbar.cpp \
+    ../connectiontoolbar.cpp \
+    ../fileoperations.cpp \
+    ../quickjumppalette.cpp \
+    ../taskfiltercontroller.cpp \
+    ../layoutanimator.cpp \
+    ../subtreefragment.cpp \
+    ../nodecapture.cpp \
+    ../commandlinetool.cpp \
+    ../nodememory.cpp \
+    ../scenemodel.cpp \
+    ../sceneedits.cpp \
+    ../scenelayout.cpp \
+    ../viewnotifier.cpp \
+    ../memoryreportpanel.cpp
+
+HEADERS += \
+    ../mainwindow.h \
+    ../mindmapnode.h \
+    ../mindmapscene.h \
+    ../mindmapview.h \
+    ../filemanager.h \
+    ../documentviewer.h \
+    ../formattingtoolbar.h \
+    ../connectiontoolbar.h \
+    ../fileoperations.h \
+    ../quickjumppalette.h \
+    ../taskfiltercontroller.h \
+    ../layoutanimator.h \
+    ../subtreefragment.h \
+    ../commandlinetool.h \
+    ../memoryreportpanel.h
+
+FORMS += \
+    ../mainwindow.ui \
+    ../documentviewer.ui \
+    ../formattingtoolbar.ui \
+    ../connectiontoolbar.ui
+
+# Default rules for deployment.
+qnx: target.path = /tmp/$${TARGET}/bin
+else: unix:!android: target.path = /opt/$${TARGET}/bin
+!isEmpty(target.path): INSTALLS += target
+
+# Include resources
+RESOURCES += \
+    ../resources.qrc
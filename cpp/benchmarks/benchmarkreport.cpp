@@ -0,0 +1,145 @@
+#include "benchmarkreport.h"
+
+#include <QFile>
+#include <QSaveFile>
+#include <QXmlStreamReader>
+#include <QJsonDocument>
+#include <QDateTime>
+#include <QSysInfo>
+#include <QThread>
+
+bool BenchmarkReport::readTestXml(const QString &filePath, QString *error)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        *error = QString("Cannot read %1: %2").arg(filePath, file.errorString());
+        return false;
+    }
+
+    QXmlStreamReader xml(&file);
+    QString function;
+    while (!xml.atEnd()) {
+        xml.readNext();
+        if (!xml.isStartElement()) {
+            continue;
+        }
+        const QXmlStreamAttributes attributes = xml.attributes();
+        if (xml.name() == QLatin1String("TestFunction")) {
+            function = attributes.value("name").toString();
+        } else if (xml.name() == QLatin1String("BenchmarkResult")) {
+            Result result;
+            result.metric = attributes.value("metric").toString();
+            result.iterations = qMax(1, attributes.value("iterations").toInt());
+            // QtTest already writes the value per iteration
+            result.value = attributes.value("value").toDouble();
+            m_results.insert(function + "/" + attributes.value("tag").toString(), result);
+        }
+    }
+    if (xml.hasError()) {
+        *error = QString("%1: %2").arg(filePath, xml.errorString());
+        return false;
+    }
+
+    m_environment = currentEnvironment();
+    return true;
+}
+
+bool BenchmarkReport::readJson(const QString &filePath, QString *error)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        *error = QString("Cannot read %1: %2").arg(filePath, file.errorString());
+        return false;
+    }
+
+    QJsonParseError parseError;
+    const QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &parseError);
+    if (!document.isObject()) {
+        *error = QString("%1: %2").arg(filePath, parseError.errorString());
+        return false;
+    }
+
+    const QJsonObject root = document.object();
+    const QJsonObject results = root.value("results").toObject();
+    for (auto it = results.constBegin(); it != results.constEnd(); ++it) {
+        const QJsonObject json = it.value().toObject();
+        Result result;
+        result.metric = json.value("metric").toString();
+        result.value = json.value("value").toDouble();
+        result.iterations = json.value("iterations").toInt();
+        m_results.insert(it.key(), result);
+    }
+    m_environment = root;
+    m_environment.remove("results");
+    return true;
+}
+
+bool BenchmarkReport::writeJson(const QString &filePath, QString *error) const
+{
+    QJsonObject results;
+    for (auto it = m_results.constBegin(); it != m_results.constEnd(); ++it) {
+        QJsonObject json;
+        json["metric"] = it->metric;
+        json["value"] = it->value;
+        json["iterations"] = it->iterations;
+        results[it.key()] = json;
+    }
+
+    QJsonObject root = m_environment;
+    root["results"] = results;
+
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        *error = QString("Cannot write %1: %2").arg(filePath, file.errorString());
+        return false;
+    }
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Indented));
+    if (!file.commit()) {
+        *error = QString("Cannot write %1: %2").arg(filePath, file.errorString());
+        return false;
+    }
+    return true;
+}
+
+QList<BenchmarkReport::Comparison> BenchmarkReport::compare(const BenchmarkReport &baseline, double thresholdPercent) const
+{
+    QList<Comparison> comparisons;
+    for (auto it = m_results.constBegin(); it != m_results.constEnd(); ++it) {
+        auto base = baseline.m_results.constFind(it.key());
+        if (base == baseline.m_results.constEnd() || base->metric != it->metric || base->value <= 0.0) {
+            continue;
+        }
+
+        Comparison comparison;
+        comparison.key = it.key();
+        comparison.baseline = base->value;
+        comparison.current = it->value;
+        comparison.ratio = it->value / base->value;
+        comparison.regressed = comparison.ratio > 1.0 + thresholdPercent / 100.0;
+        comparisons.append(comparison);
+    }
+    return comparisons;
+}
+
+QStringList BenchmarkReport::missingFrom(const BenchmarkReport &other) const
+{
+    QStringList missing;
+    for (auto it = m_results.constBegin(); it != m_results.constEnd(); ++it) {
+        if (!other.m_results.contains(it.key())) {
+            missing.append(it.key());
+        }
+    }
+    return missing;
+}
+
+QJsonObject BenchmarkReport::currentEnvironment()
+{
+    QJsonObject environment;
+    environment["generated"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    environment["qt"] = QString(qVersion());
+    environment["host"] = QSysInfo::machineHostName();
+    environment["os"] = QSysInfo::prettyProductName();
+    environment["cpu"] = QSysInfo::currentCpuArchitecture();
+    environment["threads"] = QThread::idealThreadCount();
+    return environment;
+}
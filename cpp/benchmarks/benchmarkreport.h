@@ -0,0 +1,49 @@
+#ifndef BENCHMARKREPORT_H
+#define BENCHMARKREPORT_H
+
+#include <QString>
+#include <QStringList>
+#include <QMap>
+#include <QJsonObject>
+
+// Benchmark results keyed "<function>/<row tag>", read from QtTest's XML
+// output, written as JSON and compared against a saved baseline.
+class BenchmarkReport
+{
+public:
+    struct Result {
+        QString metric;         // "WalltimeMilliseconds", "CPUTicks", ...
+        double value = 0.0;     // per iteration
+        int iterations = 0;
+    };
+
+    struct Comparison {
+        QString key;
+        double baseline = 0.0;
+        double current = 0.0;
+        double ratio = 1.0;     // current / baseline
+        bool regressed = false;
+    };
+
+    bool readTestXml(const QString &filePath, QString *error);
+    bool readJson(const QString &filePath, QString *error);
+    bool writeJson(const QString &filePath, QString *error) const;
+
+    // Keys present in both reports with the same metric, sorted. A result
+    // more than thresholdPercent slower than the baseline is a regression.
+    QList<Comparison> compare(const BenchmarkReport &baseline, double thresholdPercent) const;
+    QStringList missingFrom(const BenchmarkReport &other) const;
+
+    const QMap<QString, Result>& results() const { return m_results; }
+    bool isEmpty() const { return m_results.isEmpty(); }
+
+private:
+    // Data
+    QMap<QString, Result> m_results;
+    QJsonObject m_environment;  // machine the results were taken on
+
+    // Methods
+    static QJsonObject currentEnvironment();
+};
+
+#endif // BENCHMARKREPORT_H
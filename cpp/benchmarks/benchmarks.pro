@@ -0,0 +1,21 @@
+# Benchmark suite: QtTest QBENCHMARKs over the core library on generated
+# maps. Links the core only; no QtWidgets.
+TEMPLATE = app
+TARGET = mind2do_bench
+
+QT += testlib
+CONFIG += console c++17
+CONFIG -= app_bundle
+
+include(../core/mind2docore.pri)
+
+SOURCES += \
+    main.cpp \
+    mapgenerator.cpp \
+    mapbenchmarks.cpp \
+    benchmarkreport.cpp
+
+HEADERS += \
+    mapgenerator.h \
+    mapbenchmarks.h \
+    benchmarkreport.h
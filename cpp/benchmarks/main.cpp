@@ -0,0 +1,151 @@
+#include "mapbenchmarks.h"
+#include "benchmarkreport.h"
+
+#include <QGuiApplication>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QtTest>
+
+// mind2do_bench [options] [QtTest arguments]
+//
+//   --sizes 1k,10k,100k    map sizes to run (1m is opt-in; it takes a while)
+//   --shapes tree,wide,deep,linked
+//   --json <file>          write the results as JSON
+//   --baseline <file>      compare with a saved JSON report; exits 1 on regressions
+//   --threshold <percent>  slowdown that counts as a regression (default 10)
+//   --update-baseline      write the results to the --baseline file instead
+//
+// Anything else (function names, -iterations, -callgrind, ...) goes to QtTest.
+
+namespace {
+
+const int EXIT_REGRESSED = 1;
+const int EXIT_USAGE = 2;
+const double DEFAULT_THRESHOLD = 10.0;
+
+int usage(const QString &message)
+{
+    QTextStream(stderr) << message << "\n";
+    return EXIT_USAGE;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    // Benchmarks paint into QImages only; never require a display.
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QGuiApplication app(argc, argv);
+
+    QString jsonPath;
+    QString baselinePath;
+    double threshold = DEFAULT_THRESHOLD;
+    bool updateBaseline = false;
+    QList<int> sizes = {1000, 10000, 100000};
+    QList<MapGenerator::Shape> shapes = MapGenerator::allShapes();
+    QStringList testArguments = {app.arguments().value(0)};
+
+    const QStringList arguments = app.arguments().mid(1);
+    for (int i = 0; i < arguments.size(); ++i) {
+        const QString argument = arguments.at(i);
+        const bool hasValue = i + 1 < arguments.size();
+        if (argument == "--json" && hasValue) {
+            jsonPath = arguments.at(++i);
+        } else if (argument == "--baseline" && hasValue) {
+            baselinePath = arguments.at(++i);
+        } else if (argument == "--threshold" && hasValue) {
+            bool ok = false;
+            threshold = arguments.at(++i).toDouble(&ok);
+            if (!ok || threshold < 0) {
+                return usage("--threshold expects a percentage");
+            }
+        } else if (argument == "--update-baseline") {
+            updateBaseline = true;
+        } else if (argument == "--sizes" && hasValue) {
+            sizes.clear();
+            for (const QString &text : arguments.at(++i).split(',', Qt::SkipEmptyParts)) {
+                const int size = MapGenerator::parseSize(text);
+                if (size <= 0) {
+                    return usage(QString("Bad size: %1").arg(text));
+                }
+                sizes.append(size);
+            }
+        } else if (argument == "--shapes" && hasValue) {
+            shapes.clear();
+            for (const QString &name : arguments.at(++i).split(',', Qt::SkipEmptyParts)) {
+                MapGenerator::Shape shape;
+                if (!MapGenerator::shapeFromName(name, &shape)) {
+                    return usage(QString("Unknown shape: %1 (tree, wide, deep, linked)").arg(name));
+                }
+                shapes.append(shape);
+            }
+        } else {
+            testArguments.append(argument);
+        }
+    }
+    if (updateBaseline && baselinePath.isEmpty()) {
+        return usage("--update-baseline needs --baseline <file>");
+    }
+    if (sizes.isEmpty() || shapes.isEmpty()) {
+        return usage("Nothing to run");
+    }
+
+    // QtTest writes XML for the report alongside the usual console output.
+    QTemporaryDir tempDir;
+    const QString xmlPath = tempDir.filePath("results.xml");
+    testArguments << "-o" << xmlPath + ",xml" << "-o" << "-,txt";
+
+    MapBenchmarks benchmarks(shapes, sizes);
+    const int testResult = QTest::qExec(&benchmarks, testArguments);
+    if (testResult != 0) {
+        return testResult;
+    }
+
+    QString error;
+    BenchmarkReport report;
+    if (!report.readTestXml(xmlPath, &error)) {
+        return usage(error);
+    }
+    if (!jsonPath.isEmpty() && !report.writeJson(jsonPath, &error)) {
+        return usage(error);
+    }
+    if (baselinePath.isEmpty()) {
+        return 0;
+    }
+    if (updateBaseline) {
+        if (!report.writeJson(baselinePath, &error)) {
+            return usage(error);
+        }
+        QTextStream(stdout) << "Baseline written to " << baselinePath << "\n";
+        return 0;
+    }
+
+    BenchmarkReport baseline;
+    if (!baseline.readJson(baselinePath, &error)) {
+        return usage(error);
+    }
+
+    QTextStream out(stdout);
+    int regressions = 0;
+    const QList<BenchmarkReport::Comparison> comparisons = report.compare(baseline, threshold);
+    for (const BenchmarkReport::Comparison &comparison : comparisons) {
+        if (comparison.regressed) {
+            ++regressions;
+        }
+        out << QString("%1 %2  %3 -> %4  (%5%)\n")
+                   .arg(comparison.regressed ? "REGRESSED" : "ok       ")
+                   .arg(comparison.key, -40)
+                   .arg(comparison.baseline, 0, 'g', 4)
+                   .arg(comparison.current, 0, 'g', 4)
+                   .arg((comparison.ratio - 1.0) * 100.0, 0, 'f', 1);
+    }
+    for (const QString &key : report.missingFrom(baseline)) {
+        out << "new       " << key << "\n";
+    }
+    out << QString("%1 of %2 benchmarks regressed by more than %3%\n")
+               .arg(regressions).arg(comparisons.size()).arg(threshold);
+
+    return regressions > 0 ? EXIT_REGRESSED : 0;
+}
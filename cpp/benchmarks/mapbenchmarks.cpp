@@ -0,0 +1,366 @@
+#include "mapbenchmarks.h"
+#include "mapdocument.h"
+#include "searchindex.h"
+#include "fuzzymatcher.h"
+#include "progresstracker.h"
+#include "spatialgrid.h"
+#include "treelayout.h"
+#include "contentbounds.h"
+#include "connectionrouter.h"
+#include "snapshotrenderer.h"
+
+#include <QtTest>
+#include <QImage>
+#include <QPainter>
+
+#include <algorithm>
+
+MapBenchmarks::MapBenchmarks(const QList<MapGenerator::Shape> &shapes, const QList<int> &sizes, QObject *parent)
+    : QObject(parent)
+    , m_shapes(shapes)
+    , m_sizes(sizes)
+{
+}
+
+void MapBenchmarks::initTestCase()
+{
+    QVERIFY(m_tempDir.isValid());
+}
+
+void MapBenchmarks::addRows(const QStringList &variants)
+{
+    QTest::addColumn<int>("shape");
+    QTest::addColumn<int>("size");
+    QTest::addColumn<QString>("variant");
+
+    const QStringList rowVariants = variants.isEmpty() ? QStringList(QString()) : variants;
+    for (MapGenerator::Shape shape : m_shapes) {
+        for (int size : m_sizes) {
+            for (const QString &variant : rowVariants) {
+                QString tag = MapGenerator::shapeName(shape) + "-" + MapGenerator::sizeName(size);
+                if (!variant.isEmpty()) {
+                    tag += "-" + variant;
+                }
+                QTest::newRow(qPrintable(tag)) << int(shape) << size << variant;
+            }
+        }
+    }
+}
+
+const PersistentNodeStore& MapBenchmarks::currentMap()
+{
+    QFETCH(int, shape);
+    QFETCH(int, size);
+
+    const QString key = QString("%1-%2").arg(shape).arg(size);
+    if (key != m_mapKey) {
+        m_map = PersistentNodeStore(); // release the previous map first
+        m_map = MapGenerator::generate(MapGenerator::Shape(shape), size);
+        m_mapKey = key;
+    }
+    return m_map;
+}
+
+// File I/O
+
+void MapBenchmarks::loadMindMap_data()
+{
+    addRows({"json", "binary"});
+}
+
+void MapBenchmarks::loadMindMap()
+{
+    QFETCH(QString, variant);
+    const PersistentNodeStore &map = currentMap();
+    const MapDocument::Format format = variant == "binary" ? MapDocument::Binary : MapDocument::Json;
+    const QString path = m_tempDir.filePath(m_mapKey + "." + (format == MapDocument::Binary ? "m2d" : "json"));
+
+    QString error;
+    if (!QFile::exists(path)) {
+        QVERIFY2(MapDocument::save(path, map, format, &error), qPrintable(error));
+    }
+
+    QBENCHMARK {
+        PersistentNodeStore loaded;
+        QVERIFY2(MapDocument::load(path, &loaded, &error), qPrintable(error));
+        QCOMPARE(loaded.size(), map.size());
+    }
+}
+
+void MapBenchmarks::saveMindMap_data()
+{
+    addRows({"json", "binary"});
+}
+
+void MapBenchmarks::saveMindMap()
+{
+    QFETCH(QString, variant);
+    const PersistentNodeStore &map = currentMap();
+    const MapDocument::Format format = variant == "binary" ? MapDocument::Binary : MapDocument::Json;
+    const QString path = m_tempDir.filePath("save-" + variant);
+
+    QString error;
+    QBENCHMARK {
+        QVERIFY2(MapDocument::save(path, map, format, &error), qPrintable(error));
+    }
+}
+
+void MapBenchmarks::autoSave_data()
+{
+    addRows();
+}
+
+void MapBenchmarks::autoSave()
+{
+    // One edit since the last autosave, then snapshot and write. The edit
+    // makes the live store copy its path away from the snapshot, as in use.
+    PersistentNodeStore live = currentMap();
+    const QString path = m_tempDir.filePath("autosave.m2d");
+    NodeRecord edited = *live.value("n0");
+    int revision = 0;
+
+    QString error;
+    QBENCHMARK {
+        edited.title = QString("edit %1").arg(++revision);
+        live.insert(edited);
+        const PersistentNodeStore snapshot = live.snapshot();
+        QVERIFY2(MapDocument::save(path, snapshot, MapDocument::Binary, &error), qPrintable(error));
+    }
+}
+
+// Editing
+
+void MapBenchmarks::createNode_data()
+{
+    addRows();
+}
+
+void MapBenchmarks::createNode()
+{
+    // The indexes a new node is registered with, populated with the map
+    PersistentNodeStore store = currentMap();
+    SearchIndex searchIndex;
+    FuzzyMatcher fuzzyMatcher;
+    SpatialGrid grid;
+    TreeLayoutEngine layout;
+    ContentBounds bounds;
+    store.forEach([&](const NodeRecordPtr &record) {
+        searchIndex.setTitle(record->id, record->title);
+        fuzzyMatcher.setTitle(record->id, record->title);
+        grid.insert(record->id, record->bounds);
+        layout.addNode(record->id, record->parentId, record->bounds.size());
+        bounds.setRect(record->id, record->bounds);
+    });
+
+    const int mapSize = store.size();
+    const QSizeF nodeSize(MapDocument::DEFAULT_NODE_WIDTH, MapDocument::DEFAULT_NODE_HEIGHT);
+    int created = 0;
+
+    QBENCHMARK {
+        for (int i = 0; i < CREATE_BATCH; ++i, ++created) {
+            NodeRecord record;
+            record.id = QString("new%1").arg(created);
+            record.parentId = QString("n%1").arg(created % mapSize);
+            record.title = MapGenerator::vocabulary().at(created % MapGenerator::vocabulary().size());
+            record.position = QPointF(-nodeSize.width() * (1 + created % 100), nodeSize.height() * (created / 100));
+            record.bounds = QRectF(record.position, nodeSize);
+
+            store.insert(record);
+            searchIndex.setTitle(record.id, record.title);
+            fuzzyMatcher.setTitle(record.id, record.title);
+            grid.insert(record.id, record.bounds);
+            layout.addNode(record.id, record.parentId, nodeSize);
+            bounds.setRect(record.id, record.bounds);
+        }
+    }
+}
+
+void MapBenchmarks::updateConnections_data()
+{
+    addRows();
+}
+
+void MapBenchmarks::updateConnections()
+{
+    // Re-route a batch of dirty connections: obstacle lookup in each
+    // corridor, the nearest-obstacle cap, then the route, as
+    // ConnectionRouter::dispatch does per edge.
+    const PersistentNodeStore &map = currentMap();
+    SpatialGrid grid;
+    map.forEach([&grid](const NodeRecordPtr &record) {
+        grid.insert(record->id, record->bounds);
+    });
+
+    QVector<QPair<QString, QString>> edges;
+    for (int i = 1; i < map.size() && edges.size() < ROUTED_EDGES; ++i) {
+        const NodeRecordPtr record = map.value(QString("n%1").arg(i));
+        if (record && !record->parentId.isEmpty()) {
+            edges.append(qMakePair(record->parentId, record->id));
+        }
+    }
+
+    qint64 elements = 0;
+    QBENCHMARK {
+        for (const QPair<QString, QString> &edge : edges) {
+            RouteRequest request;
+            request.edgeId = ConnectionRouter::edgeKey(edge.first, edge.second);
+            request.fromRect = grid.rect(edge.first);
+            request.toRect = grid.rect(edge.second);
+            request.corridor = request.fromRect.united(request.toRect)
+                                   .adjusted(-CORRIDOR_MARGIN, -CORRIDOR_MARGIN, CORRIDOR_MARGIN, CORRIDOR_MARGIN);
+            const QStringList obstacleIds = grid.query(request.corridor);
+            for (const QString &obstacleId : obstacleIds) {
+                if (obstacleId != edge.first && obstacleId != edge.second) {
+                    request.obstacles.append(grid.rect(obstacleId));
+                }
+            }
+            if (request.obstacles.size() > MAX_OBSTACLES) {
+                const QPointF middle = (request.fromRect.center() + request.toRect.center()) / 2.0;
+                std::partial_sort(request.obstacles.begin(), request.obstacles.begin() + MAX_OBSTACLES,
+                                  request.obstacles.end(), [middle](const QRectF &a, const QRectF &b) {
+                    return QLineF(a.center(), middle).length() < QLineF(b.center(), middle).length();
+                });
+                request.obstacles.resize(MAX_OBSTACLES);
+            }
+            elements += ConnectionRouter::computeRoute(request).elementCount();
+        }
+    }
+    QVERIFY(elements >= 0);
+}
+
+// Search
+
+void MapBenchmarks::search_data()
+{
+    addRows();
+}
+
+void MapBenchmarks::search()
+{
+    SearchIndex index;
+    currentMap().forEach([&index](const NodeRecordPtr &record) {
+        index.setTitle(record->id, record->title);
+        index.setDescription(record->id, record->description);
+    });
+
+    const QStringList queries = {"ship", "release budget", "mig", "quarterly report", "dash"};
+    int hits = 0;
+    QBENCHMARK {
+        for (const QString &query : queries) {
+            hits += index.search(query).size();
+        }
+    }
+    QVERIFY(hits > 0);
+}
+
+void MapBenchmarks::fuzzyMatch_data()
+{
+    addRows();
+}
+
+void MapBenchmarks::fuzzyMatch()
+{
+    FuzzyMatcher matcher;
+    currentMap().forEach([&matcher](const NodeRecordPtr &record) {
+        matcher.setTitle(record->id, record->title);
+    });
+
+    const QStringList queries = {"shprel", "qrtrp", "dbbck", "mkp"};
+    int hits = 0;
+    QBENCHMARK {
+        for (const QString &query : queries) {
+            hits += matcher.match(query).size();
+        }
+    }
+    QVERIFY(hits > 0);
+}
+
+void MapBenchmarks::progressLoad_data()
+{
+    addRows();
+}
+
+void MapBenchmarks::progressLoad()
+{
+    // Store order is hash order, so most children arrive before their
+    // parent and go through the orphan list.
+    const PersistentNodeStore &map = currentMap();
+    MapProgressStats stats;
+    QBENCHMARK {
+        ProgressTracker tracker;
+        map.forEach([&tracker](const NodeRecordPtr &record) {
+            tracker.addNode(record->id, record->parentId, record->completed);
+        });
+        stats = tracker.stats();
+    }
+    QCOMPARE(stats.totalNodes, map.size());
+}
+
+void MapBenchmarks::progressCyclicLoad()
+{
+    // A file whose parent links form a cycle: "a" waits for "b", then "b"
+    // arrives under "a". Adopting "a" would make propagate() loop forever,
+    // so it has to stay a root.
+    ProgressTracker tracker;
+    tracker.addNode("a", "b");
+    tracker.addNode("b", "a", true);
+    tracker.addNode("c", "c");
+
+    QCOMPARE(tracker.stats().totalNodes, 3);
+    QCOMPARE(tracker.stats().rootNodes, 2);
+    QCOMPARE(tracker.progress("a").totalBelow, 1);
+    QCOMPARE(tracker.progress("a").doneBelow, 1);
+    QCOMPARE(tracker.progress("b").totalBelow, 0);
+}
+
+// Layout and paint
+
+void MapBenchmarks::layout_data()
+{
+    addRows();
+}
+
+void MapBenchmarks::layout()
+{
+    TreeLayoutEngine engine;
+    currentMap().forEach([&engine](const NodeRecordPtr &record) {
+        engine.addNode(record->id, record->parentId, record->bounds.size());
+    });
+
+    int placed = 0;
+    QBENCHMARK {
+        placed = engine.layoutAll().size();
+    }
+    QCOMPARE(placed, engine.count());
+}
+
+void MapBenchmarks::paintViewport_data()
+{
+    addRows({"1x", "fit"});
+}
+
+void MapBenchmarks::paintViewport()
+{
+    // One full window of the map offscreen: at 100% around the centre,
+    // and zoomed out to fit everything.
+    QFETCH(QString, variant);
+    const SnapshotRenderer renderer(currentMap());
+    const QRectF bounds = renderer.bounds();
+    QImage image(VIEWPORT_WIDTH, VIEWPORT_HEIGHT, QImage::Format_ARGB32_Premultiplied);
+
+    QRectF area(0, 0, VIEWPORT_WIDTH, VIEWPORT_HEIGHT);
+    qreal scale = 1.0;
+    if (variant == "fit") {
+        scale = qMin(VIEWPORT_WIDTH / bounds.width(), VIEWPORT_HEIGHT / bounds.height());
+        area.setSize(area.size() / scale);
+    }
+    area.moveCenter(bounds.center());
+
+    QBENCHMARK {
+        image.fill(renderer.getBackground());
+        QPainter painter(&image);
+        painter.scale(scale, scale);
+        painter.translate(-area.topLeft());
+        renderer.render(&painter, area);
+    }
+}
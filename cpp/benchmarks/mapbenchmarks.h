@@ -0,0 +1,77 @@
+#ifndef MAPBENCHMARKS_H
+#define MAPBENCHMARKS_H
+
+#include <QObject>
+#include <QString>
+#include <QList>
+#include <QTemporaryDir>
+
+#include "mapgenerator.h"
+#include "persistentnodestore.h"
+
+// QBENCHMARK suite over the core library's hot paths. Every function is
+// data-driven over shape x size; rows are tagged "<shape>-<size>[-<variant>]"
+// (e.g. "tree-10k-json"), and the tag is the key results and baselines are
+// matched on. progressCyclicLoad is the exception: a fixed-input check for a
+// load order that used to hang, with no QBENCHMARK of its own.
+//
+// The scene itself is a QGraphicsScene and lives in the app target, so each
+// benchmark measures the core work behind the scene call it is named after.
+class MapBenchmarks : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit MapBenchmarks(const QList<MapGenerator::Shape> &shapes, const QList<int> &sizes,
+                           QObject *parent = nullptr);
+
+private slots:
+    void initTestCase();
+
+    void loadMindMap_data();
+    void loadMindMap();
+    void saveMindMap_data();
+    void saveMindMap();
+    void autoSave_data();
+    void autoSave();
+    void createNode_data();
+    void createNode();
+    void updateConnections_data();
+    void updateConnections();
+    void search_data();
+    void search();
+    void fuzzyMatch_data();
+    void fuzzyMatch();
+    void progressLoad_data();
+    void progressLoad();
+    void progressCyclicLoad();
+    void layout_data();
+    void layout();
+    void paintViewport_data();
+    void paintViewport();
+
+private:
+    // Configuration
+    QList<MapGenerator::Shape> m_shapes;
+    QList<int> m_sizes;
+
+    // Generated map for the current row; one kept at a time, since a
+    // million-node map is several hundred megabytes
+    PersistentNodeStore m_map;
+    QString m_mapKey;
+    QTemporaryDir m_tempDir;
+
+    // Methods
+    void addRows(const QStringList &variants = QStringList());
+    const PersistentNodeStore& currentMap();
+
+    // Constants
+    static const int CREATE_BATCH = 1000;       // nodes created per iteration
+    static const int ROUTED_EDGES = 200;        // edges routed per iteration
+    static const int CORRIDOR_MARGIN = 240;     // these two match ConnectionRouter
+    static const int MAX_OBSTACLES = 150;
+    static const int VIEWPORT_WIDTH = 1920;
+    static const int VIEWPORT_HEIGHT = 1080;
+};
+
+#endif // MAPBENCHMARKS_H
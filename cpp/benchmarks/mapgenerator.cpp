@@ -0,0 +1,146 @@
+#include "mapgenerator.h"
+#include "mapdocument.h"
+
+#include <QRandomGenerator>
+#include <QVector>
+#include <QtMath>
+
+PersistentNodeStore MapGenerator::generate(Shape shape, int nodeCount, quint32 seed)
+{
+    QRandomGenerator random(seed);
+    const QStringList &words = vocabulary();
+    auto idFor = [](int index) { return QString("n%1").arg(index); };
+    auto phrase = [&random, &words](int minWords, int maxWords) {
+        const int count = minWords + random.bounded(maxWords - minWords + 1);
+        QStringList picked;
+        for (int i = 0; i < count; ++i) {
+            picked.append(words.at(random.bounded(int(words.size()))));
+        }
+        return picked.join(' ');
+    };
+
+    // Parents first; every parent index is lower than its child's.
+    const int wideFanout = qMax(1, int(qSqrt(nodeCount)));
+    QVector<int> parents(nodeCount, -1);
+    for (int i = 1; i < nodeCount; ++i) {
+        switch (shape) {
+        case Tree:
+        case CrossLinked:
+            parents[i] = random.bounded(4) == 0 ? random.bounded(i) : (i - 1) / BRANCHING;
+            break;
+        case Wide:
+            parents[i] = i <= wideFanout ? 0 : 1 + random.bounded(wideFanout);
+            break;
+        case Deep:
+            parents[i] = i % CHAIN_LENGTH == 0 ? random.bounded(i) : i - 1;
+            break;
+        }
+    }
+
+    // Columns by depth, rows in order of appearance within a depth
+    QVector<int> depths(nodeCount, 0);
+    QVector<int> rowsAtDepth;
+    QVector<QStringList> children(nodeCount);
+    QVector<QPointF> positions(nodeCount);
+    for (int i = 0; i < nodeCount; ++i) {
+        if (parents.at(i) >= 0) {
+            depths[i] = depths.at(parents.at(i)) + 1;
+            children[parents.at(i)].append(idFor(i));
+        }
+        if (depths.at(i) >= rowsAtDepth.size()) {
+            rowsAtDepth.resize(depths.at(i) + 1);
+        }
+        positions[i] = QPointF(depths.at(i) * COLUMN_SPACING, rowsAtDepth[depths.at(i)]++ * ROW_SPACING);
+    }
+
+    PersistentNodeStore nodes;
+    for (int i = 0; i < nodeCount; ++i) {
+        NodeRecord record;
+        record.id = idFor(i);
+        record.parentId = parents.at(i) >= 0 ? idFor(parents.at(i)) : QString();
+        record.title = phrase(2, 4);
+        if (i % 3 == 0) {
+            record.description = phrase(8, 20);
+        }
+        record.completed = random.bounded(10) < 3;
+        record.formatting.bold = random.bounded(8) == 0;
+        record.position = positions.at(i);
+        record.bounds = QRectF(record.position, QSizeF(MapDocument::DEFAULT_NODE_WIDTH, MapDocument::DEFAULT_NODE_HEIGHT));
+        record.children = children.at(i);
+        if (shape == CrossLinked && nodeCount > 1) {
+            const int target = random.bounded(nodeCount - 1);
+            record.connections.append(idFor(target >= i ? target + 1 : target));
+        }
+        nodes.insert(record);
+    }
+    return nodes;
+}
+
+QString MapGenerator::shapeName(Shape shape)
+{
+    switch (shape) {
+    case Tree: return "tree";
+    case Wide: return "wide";
+    case Deep: return "deep";
+    case CrossLinked: return "linked";
+    }
+    return QString();
+}
+
+bool MapGenerator::shapeFromName(const QString &name, Shape *shape)
+{
+    for (Shape candidate : allShapes()) {
+        if (shapeName(candidate) == name) {
+            *shape = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+QList<MapGenerator::Shape> MapGenerator::allShapes()
+{
+    return {Tree, Wide, Deep, CrossLinked};
+}
+
+int MapGenerator::parseSize(const QString &text)
+{
+    QString digits = text.trimmed().toLower();
+    int multiplier = 1;
+    if (digits.endsWith('k')) {
+        multiplier = 1000;
+        digits.chop(1);
+    } else if (digits.endsWith('m')) {
+        multiplier = 1000000;
+        digits.chop(1);
+    }
+    bool ok = false;
+    const int value = digits.toInt(&ok);
+    return ok && value > 0 ? value * multiplier : 0;
+}
+
+QString MapGenerator::sizeName(int nodeCount)
+{
+    if (nodeCount % 1000000 == 0) {
+        return QString("%1m").arg(nodeCount / 1000000);
+    }
+    if (nodeCount % 1000 == 0) {
+        return QString("%1k").arg(nodeCount / 1000);
+    }
+    return QString::number(nodeCount);
+}
+
+const QStringList& MapGenerator::vocabulary()
+{
+    static const QStringList words = {
+        "plan", "review", "design", "ship", "release", "budget", "hire", "interview",
+        "draft", "publish", "research", "prototype", "test", "deploy", "migrate", "refactor",
+        "meeting", "roadmap", "launch", "customer", "feedback", "invoice", "contract", "travel",
+        "marketing", "campaign", "report", "quarterly", "metrics", "dashboard", "onboarding", "training",
+        "server", "database", "backup", "security", "audit", "compliance", "vendor", "support",
+        "kitchen", "garden", "groceries", "birthday", "vacation", "fitness", "reading", "writing",
+        "chapter", "outline", "sketch", "palette", "mockup", "wireframe", "sprint", "backlog",
+        "milestone", "deadline", "estimate", "priority", "blocker", "followup", "archive", "cleanup"
+    };
+    return words;
+}
@@ -0,0 +1,43 @@
+#ifndef MAPGENERATOR_H
+#define MAPGENERATOR_H
+
+#include <QString>
+#include <QStringList>
+
+#include "persistentnodestore.h"
+
+// Deterministic synthetic maps for benchmarks. The same shape, size and
+// seed always give the same ids, titles, positions and links, so results
+// are comparable across runs and machines.
+class MapGenerator
+{
+public:
+    enum Shape {
+        Tree,           // ~4 children per node, irregular
+        Wide,           // root -> sqrt(n) branches -> the rest
+        Deep,           // chains of CHAIN_LENGTH, forking from earlier nodes
+        CrossLinked     // Tree plus one connection per node
+    };
+
+    static PersistentNodeStore generate(Shape shape, int nodeCount, quint32 seed = DEFAULT_SEED);
+
+    static QString shapeName(Shape shape);
+    static bool shapeFromName(const QString &name, Shape *shape);
+    static QList<Shape> allShapes();
+
+    // "1k", "10k", "1m" -> node count; 0 if malformed
+    static int parseSize(const QString &text);
+    static QString sizeName(int nodeCount);
+
+    // Words titles are drawn from, for search benchmarks
+    static const QStringList& vocabulary();
+
+    // Constants
+    static const quint32 DEFAULT_SEED = 20240601;
+    static const int BRANCHING = 4;
+    static const int CHAIN_LENGTH = 1000;
+    static const int COLUMN_SPACING = 350;
+    static const int ROW_SPACING = 250;
+};
+
+#endif // MAPGENERATOR_H
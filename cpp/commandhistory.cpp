@@ -0,0 +1,394 @@
+#include "commandhistory.h"
+
+qint64 NodeSnapshot::memoryCost() const
+{
+    qint64 cost = sizeof(NodeSnapshot);
+    cost += (id.size() + parentId.size() + title.size() + description.size()) * sizeof(QChar);
+    cost += (formatting.highlightColor.size() + formatting.textColor.size()) * sizeof(QChar);
+    for (const MediaFile &media : mediaFiles) {
+        cost += sizeof(MediaFile);
+        cost += (media.id.size() + media.name.size() + media.filePath.size()
+                 + media.type.size() + media.contentHash.size()) * sizeof(QChar);
+    }
+    return cost;
+}
+
+// HistoryCommand
+
+HistoryCommand::HistoryCommand(const QString &text, const QString &mergeKey)
+    : m_indexed(false)
+    , m_text(text)
+    , m_mergeKey(mergeKey)
+    , m_memoryCost(sizeof(HistoryCommand) + (text.size() + mergeKey.size()) * sizeof(QChar))
+{
+}
+
+void HistoryCommand::addMove(const QString &nodeId, const QPointF &from, const QPointF &to)
+{
+    if (m_indexed) {
+        auto it = m_moveIndex.constFind(nodeId);
+        if (it != m_moveIndex.constEnd()) {
+            m_moves[it.value()].to = to;
+            return;
+        }
+        m_moveIndex.insert(nodeId, m_moves.size());
+    }
+
+    MoveDelta move;
+    move.nodeId = nodeId;
+    move.from = from;
+    move.to = to;
+    m_moves.append(move);
+    m_memoryCost += sizeof(MoveDelta) + nodeId.size() * sizeof(QChar);
+}
+
+void HistoryCommand::addProperty(const QString &nodeId, NodeProperty property, const QVariant &before, const QVariant &after)
+{
+    if (m_indexed) {
+        const QString key = propertyKey(nodeId, property);
+        auto it = m_propertyIndex.constFind(key);
+        if (it != m_propertyIndex.constEnd()) {
+            PropertyDelta &delta = m_properties[it.value()];
+            m_memoryCost += variantCost(after) - variantCost(delta.after);
+            delta.after = after;
+            return;
+        }
+        m_propertyIndex.insert(key, m_properties.size());
+    }
+
+    PropertyDelta delta;
+    delta.nodeId = nodeId;
+    delta.property = property;
+    delta.before = before;
+    delta.after = after;
+    m_properties.append(delta);
+    m_memoryCost += sizeof(PropertyDelta) + nodeId.size() * sizeof(QChar)
+                    + variantCost(before) + variantCost(after);
+}
+
+void HistoryCommand::addInsert(const NodeSnapshot &node)
+{
+    m_inserted.append(node);
+    m_memoryCost += node.memoryCost();
+}
+
+void HistoryCommand::addRemove(const NodeSnapshot &node)
+{
+    m_removed.append(node);
+    m_memoryCost += node.memoryCost();
+}
+
+void HistoryCommand::addConnect(const QString &fromId, const QString &toId)
+{
+    ConnectionDelta connection;
+    connection.fromId = fromId;
+    connection.toId = toId;
+    m_connected.append(connection);
+    m_memoryCost += sizeof(ConnectionDelta) + (fromId.size() + toId.size()) * sizeof(QChar);
+}
+
+void HistoryCommand::addDisconnect(const QString &fromId, const QString &toId)
+{
+    ConnectionDelta connection;
+    connection.fromId = fromId;
+    connection.toId = toId;
+    m_disconnected.append(connection);
+    m_memoryCost += sizeof(ConnectionDelta) + (fromId.size() + toId.size()) * sizeof(QChar);
+}
+
+void HistoryCommand::redo(HistoryTarget *target) const
+{
+    if (!m_inserted.isEmpty()) {
+        target->insertNodes(m_inserted);
+    }
+    if (!m_connected.isEmpty()) {
+        target->connectNodes(m_connected);
+    }
+    if (!m_properties.isEmpty()) {
+        target->setNodeProperties(m_properties, false);
+    }
+    if (!m_moves.isEmpty()) {
+        // Unmerged commands may hold several moves of one node; the last wins.
+        QHash<QString, QPointF> positions;
+        positions.reserve(m_moves.size());
+        for (const MoveDelta &move : m_moves) {
+            positions.insert(move.nodeId, move.to);
+        }
+        target->moveNodes(positions);
+    }
+    if (!m_disconnected.isEmpty()) {
+        target->disconnectNodes(m_disconnected);
+    }
+    if (!m_removed.isEmpty()) {
+        QStringList nodeIds;
+        nodeIds.reserve(m_removed.size());
+        for (const NodeSnapshot &node : m_removed) {
+            nodeIds.append(node.id);
+        }
+        target->removeNodes(nodeIds);
+    }
+}
+
+void HistoryCommand::undo(HistoryTarget *target) const
+{
+    if (!m_removed.isEmpty()) {
+        target->insertNodes(m_removed);
+    }
+    if (!m_disconnected.isEmpty()) {
+        target->connectNodes(m_disconnected);
+    }
+    if (!m_moves.isEmpty()) {
+        // Walk backwards so the first recorded origin of each node wins.
+        QHash<QString, QPointF> positions;
+        positions.reserve(m_moves.size());
+        for (int i = m_moves.size() - 1; i >= 0; --i) {
+            positions.insert(m_moves.at(i).nodeId, m_moves.at(i).from);
+        }
+        target->moveNodes(positions);
+    }
+    if (!m_properties.isEmpty()) {
+        QVector<PropertyDelta> reversed;
+        reversed.reserve(m_properties.size());
+        for (int i = m_properties.size() - 1; i >= 0; --i) {
+            reversed.append(m_properties.at(i));
+        }
+        target->setNodeProperties(reversed, true);
+    }
+    if (!m_connected.isEmpty()) {
+        target->disconnectNodes(m_connected);
+    }
+    if (!m_inserted.isEmpty()) {
+        QStringList nodeIds;
+        nodeIds.reserve(m_inserted.size());
+        for (const NodeSnapshot &node : m_inserted) {
+            nodeIds.append(node.id);
+        }
+        target->removeNodes(nodeIds);
+    }
+}
+
+bool HistoryCommand::isEmpty() const
+{
+    return changeCount() == 0;
+}
+
+int HistoryCommand::changeCount() const
+{
+    return m_moves.size() + m_properties.size() + m_inserted.size()
+           + m_removed.size() + m_connected.size() + m_disconnected.size();
+}
+
+bool HistoryCommand::mergeWith(const HistoryCommand &next)
+{
+    if (m_mergeKey.isEmpty() || m_mergeKey != next.m_mergeKey) {
+        return false;
+    }
+
+    // The index makes each merged delta O(1); only merge runs pay for it.
+    if (!m_indexed) {
+        rebuildMergeIndex();
+    }
+
+    for (const MoveDelta &move : next.m_moves) {
+        addMove(move.nodeId, move.from, move.to);
+    }
+    for (const PropertyDelta &delta : next.m_properties) {
+        addProperty(delta.nodeId, delta.property, delta.before, delta.after);
+    }
+    for (const NodeSnapshot &node : next.m_inserted) {
+        addInsert(node);
+    }
+    for (const NodeSnapshot &node : next.m_removed) {
+        addRemove(node);
+    }
+    for (const ConnectionDelta &connection : next.m_connected) {
+        addConnect(connection.fromId, connection.toId);
+    }
+    for (const ConnectionDelta &connection : next.m_disconnected) {
+        addDisconnect(connection.fromId, connection.toId);
+    }
+    return true;
+}
+
+QString HistoryCommand::propertyKey(const QString &nodeId, NodeProperty property)
+{
+    return nodeId + QLatin1Char('/') + QString::number(static_cast<int>(property));
+}
+
+qint64 HistoryCommand::variantCost(const QVariant &value)
+{
+    qint64 cost = sizeof(QVariant);
+    if (value.typeId() == QMetaType::QString) {
+        cost += value.toString().size() * sizeof(QChar);
+    } else if (value.metaType() == QMetaType::fromType<TextFormatting>()) {
+        const TextFormatting formatting = value.value<TextFormatting>();
+        cost += sizeof(TextFormatting)
+                + (formatting.highlightColor.size() + formatting.textColor.size()) * sizeof(QChar);
+    }
+    return cost;
+}
+
+void HistoryCommand::rebuildMergeIndex()
+{
+    m_indexed = true;
+    for (int i = 0; i < m_moves.size(); ++i) {
+        m_moveIndex.insert(m_moves.at(i).nodeId, i);
+    }
+    for (int i = 0; i < m_properties.size(); ++i) {
+        m_propertyIndex.insert(propertyKey(m_properties.at(i).nodeId, m_properties.at(i).property), i);
+    }
+}
+
+// CommandHistory
+
+CommandHistory::CommandHistory(QObject *parent)
+    : QObject(parent)
+    , m_index(0)
+    , m_cleanIndex(0)
+    , m_target(nullptr)
+    , m_sealed(true)
+    , m_applying(false)
+    , m_memoryLimit(DEFAULT_MEMORY_LIMIT)
+    , m_memoryUsed(0)
+{
+}
+
+CommandHistory::~CommandHistory()
+{
+}
+
+void CommandHistory::push(const HistoryCommand &command)
+{
+    if (m_applying || command.isEmpty()) {
+        return;
+    }
+
+    const bool wasClean = isClean();
+    truncateRedo();
+
+    // Merge into the top command unless the run was sealed, went quiet, or
+    // the top command is the saved state.
+    bool merged = false;
+    if (!m_sealed && m_index > 0 && m_cleanIndex != m_index
+        && m_lastPush.isValid() && m_lastPush.elapsed() <= MERGE_WINDOW) {
+        HistoryCommand *top = m_commands.last().data();
+        const qint64 before = top->memoryCost();
+        merged = top->mergeWith(command);
+        if (merged) {
+            m_memoryUsed += top->memoryCost() - before;
+        }
+    }
+
+    if (!merged) {
+        m_commands.append(QSharedPointer<HistoryCommand>::create(command));
+        m_memoryUsed += command.memoryCost();
+        m_index++;
+    }
+
+    m_sealed = false;
+    m_lastPush.start();
+    evict();
+    notify(wasClean);
+}
+
+void CommandHistory::seal()
+{
+    m_sealed = true;
+}
+
+void CommandHistory::undo()
+{
+    if (!canUndo() || !m_target) {
+        return;
+    }
+
+    const bool wasClean = isClean();
+    m_applying = true;
+    m_commands.at(--m_index)->undo(m_target);
+    m_applying = false;
+    m_sealed = true;
+    notify(wasClean);
+}
+
+void CommandHistory::redo()
+{
+    if (!canRedo() || !m_target) {
+        return;
+    }
+
+    const bool wasClean = isClean();
+    m_applying = true;
+    m_commands.at(m_index++)->redo(m_target);
+    m_applying = false;
+    m_sealed = true;
+    notify(wasClean);
+}
+
+QString CommandHistory::undoText() const
+{
+    return canUndo() ? m_commands.at(m_index - 1)->text() : QString();
+}
+
+QString CommandHistory::redoText() const
+{
+    return canRedo() ? m_commands.at(m_index)->text() : QString();
+}
+
+void CommandHistory::clear()
+{
+    const bool wasClean = isClean();
+    m_commands.clear();
+    m_index = 0;
+    m_cleanIndex = 0;
+    m_memoryUsed = 0;
+    m_sealed = true;
+    notify(wasClean);
+}
+
+void CommandHistory::setClean()
+{
+    const bool wasClean = isClean();
+    m_cleanIndex = m_index;
+    m_sealed = true;
+    notify(wasClean);
+}
+
+void CommandHistory::setMemoryLimit(qint64 bytes)
+{
+    const bool wasClean = isClean();
+    m_memoryLimit = bytes;
+    evict();
+    notify(wasClean);
+}
+
+void CommandHistory::truncateRedo()
+{
+    while (m_commands.size() > m_index) {
+        m_memoryUsed -= m_commands.last()->memoryCost();
+        m_commands.removeLast();
+    }
+    if (m_cleanIndex > m_index) {
+        m_cleanIndex = -1;
+    }
+}
+
+void CommandHistory::evict()
+{
+    // Oldest first, but never the command that would be undone next.
+    while (m_memoryUsed > m_memoryLimit && m_index > 1) {
+        m_memoryUsed -= m_commands.first()->memoryCost();
+        m_commands.removeFirst();
+        m_index--;
+        if (m_cleanIndex >= 0) {
+            m_cleanIndex = m_cleanIndex == 0 ? -1 : m_cleanIndex - 1;
+        }
+    }
+}
+
+void CommandHistory::notify(bool wasClean)
+{
+    emit historyChanged();
+    if (wasClean != isClean()) {
+        emit cleanChanged(isClean());
+    }
+}
@@ -0,0 +1,202 @@
+#ifndef COMMANDHISTORY_H
+#define COMMANDHISTORY_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QList>
+#include <QVector>
+#include <QPointF>
+#include <QVariant>
+#include <QElapsedTimer>
+#include <QSharedPointer>
+
+#include "nodetypes.h"
+
+class MindMapNode;
+
+Q_DECLARE_METATYPE(TextFormatting)
+
+// Everything needed to recreate a removed node. Thumbnails are left out;
+// MediaLibrary regenerates them from the file path.
+struct NodeSnapshot {
+    QString id;
+    QString parentId;
+    QString title;
+    QString description;
+    bool completed = false;
+    TextFormatting formatting;
+    QPointF position;
+    QList<MediaFile> mediaFiles;
+
+    static NodeSnapshot fromNode(const MindMapNode *node); // defined in the GUI target, nodecapture.cpp
+    qint64 memoryCost() const;
+};
+
+enum class NodeProperty {
+    Title,
+    Description,
+    Completed,
+    Formatting,
+    Parent
+};
+
+struct PropertyDelta {
+    QString nodeId;
+    NodeProperty property;
+    QVariant before;
+    QVariant after;
+};
+
+struct MoveDelta {
+    QString nodeId;
+    QPointF from;
+    QPointF to;
+};
+
+struct ConnectionDelta {
+    QString fromId;
+    QString toId;
+};
+
+// What undo/redo needs from the scene. Each call receives a whole batch so
+// the scene can update its indexes once instead of once per node.
+class HistoryTarget
+{
+public:
+    virtual ~HistoryTarget() {}
+
+    virtual void insertNodes(const QVector<NodeSnapshot> &nodes) = 0;
+    virtual void removeNodes(const QStringList &nodeIds) = 0;
+    virtual void moveNodes(const QHash<QString, QPointF> &positions) = 0;
+    virtual void setNodeProperties(const QVector<PropertyDelta> &deltas, bool useBefore) = 0;
+    virtual void connectNodes(const QVector<ConnectionDelta> &connections) = 0;
+    virtual void disconnectNodes(const QVector<ConnectionDelta> &connections) = 0;
+};
+
+// One undoable step, stored as the minimal diff: property before/after
+// values, position pairs, and snapshots only of nodes that were inserted or
+// removed. Commands with the same merge key recorded close together (one
+// drag, one run of typing) are folded into a single step.
+class HistoryCommand
+{
+public:
+    explicit HistoryCommand(const QString &text, const QString &mergeKey = QString());
+
+    // Recording
+    void addMove(const QString &nodeId, const QPointF &from, const QPointF &to);
+    void addProperty(const QString &nodeId, NodeProperty property, const QVariant &before, const QVariant &after);
+    void addInsert(const NodeSnapshot &node);
+    void addRemove(const NodeSnapshot &node);
+    void addConnect(const QString &fromId, const QString &toId);
+    void addDisconnect(const QString &fromId, const QString &toId);
+
+    // Applying; redo replays inserts, connections, properties, moves,
+    // disconnections and removals in that order, undo in reverse
+    void undo(HistoryTarget *target) const;
+    void redo(HistoryTarget *target) const;
+
+    QString text() const { return m_text; }
+    QString mergeKey() const { return m_mergeKey; }
+    bool isEmpty() const;
+    qint64 memoryCost() const { return m_memoryCost; }
+    int changeCount() const;
+
+    // Folds a later command into this one; false when the keys differ
+    bool mergeWith(const HistoryCommand &next);
+
+private:
+    // Changes
+    QVector<MoveDelta> m_moves;
+    QVector<PropertyDelta> m_properties;
+    QVector<NodeSnapshot> m_inserted;
+    QVector<NodeSnapshot> m_removed;
+    QVector<ConnectionDelta> m_connected;
+    QVector<ConnectionDelta> m_disconnected;
+
+    // Lookup for merging, built on first merge
+    QHash<QString, int> m_moveIndex;
+    QHash<QString, int> m_propertyIndex;
+    bool m_indexed;
+
+    // Metadata
+    QString m_text;
+    QString m_mergeKey;
+    qint64 m_memoryCost;
+
+    // Methods
+    static QString propertyKey(const QString &nodeId, NodeProperty property);
+    static qint64 variantCost(const QVariant &value);
+    void rebuildMergeIndex();
+};
+
+// Bounded undo/redo stack. Memory is estimated per command and the oldest
+// commands are evicted once the total passes the limit; the newest command
+// is always kept, however large.
+class CommandHistory : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit CommandHistory(QObject *parent = nullptr);
+    ~CommandHistory();
+
+    void setTarget(HistoryTarget *target) { m_target = target; }
+
+    // Recording. Nothing is recorded while a command is being applied, so
+    // the scene can record unconditionally from its mutators.
+    void push(const HistoryCommand &command);
+    void seal();  // ends the current merge run (mouse release, focus out)
+    bool isApplying() const { return m_applying; }
+
+    // Undo/redo
+    void undo();
+    void redo();
+    bool canUndo() const { return m_index > 0; }
+    bool canRedo() const { return m_index < m_commands.size(); }
+    QString undoText() const;
+    QString redoText() const;
+    void clear();
+
+    // Saved state
+    void setClean();
+    bool isClean() const { return m_cleanIndex == m_index; }
+
+    // Memory cap, in bytes
+    void setMemoryLimit(qint64 bytes);
+    qint64 getMemoryLimit() const { return m_memoryLimit; }
+    qint64 memoryUsed() const { return m_memoryUsed; }
+    int count() const { return m_commands.size(); }
+
+signals:
+    void historyChanged();
+    void cleanChanged(bool clean);
+
+private:
+    // Commands; [0, m_index) can be undone, [m_index, end) redone
+    QList<QSharedPointer<HistoryCommand>> m_commands;
+    int m_index;
+    int m_cleanIndex;  // -1 once the saved state was evicted or discarded
+    HistoryTarget *m_target;
+
+    // Merging
+    QElapsedTimer m_lastPush;
+    bool m_sealed;
+    bool m_applying;
+
+    // Memory
+    qint64 m_memoryLimit;
+    qint64 m_memoryUsed;
+
+    // Methods
+    void truncateRedo();
+    void evict();
+    void notify(bool wasClean);
+
+    // Constants
+    static const int MERGE_WINDOW = 1000; // ms between merged keystrokes
+    static const qint64 DEFAULT_MEMORY_LIMIT = 32 * 1024 * 1024;
+};
+
+#endif // COMMANDHISTORY_H
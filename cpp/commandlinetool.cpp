@@ -0,0 +1,429 @@
+#include "commandlinetool.h"
+#include "snapshotrenderer.h"
+#include "tiledimageexporter.h"
+#include "vectorexporter.h"
+#include "tracelog.h"
+
+#include <QCoreApplication>
+#include <QGuiApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QFileInfo>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QPainter>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QTextStream>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <QtMath>
+
+#include <cstring>
+#include <memory>
+
+namespace {
+
+const char *const COMMAND_NAMES[] = {"load", "validate", "stats", "convert", "export"};
+
+QString jsonLine(const QJsonObject &object)
+{
+    return QString::fromUtf8(QJsonDocument(object).toJson(QJsonDocument::Compact));
+}
+
+} // namespace
+
+bool CommandLineTool::isRequested(int argc, char *argv[])
+{
+    if (argc < 2) {
+        return false;
+    }
+    for (const char *name : COMMAND_NAMES) {
+        if (strcmp(argv[1], name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int CommandLineTool::exec(int argc, char *argv[])
+{
+    // Painting text needs a QGuiApplication for fonts; the offscreen
+    // platform gives it one without a display. Everything else runs on
+    // QCoreApplication and starts faster.
+    std::unique_ptr<QCoreApplication> app;
+    if (strcmp(argv[1], "export") == 0) {
+        if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+            qputenv("QT_QPA_PLATFORM", "offscreen");
+        }
+        app.reset(new QGuiApplication(argc, argv));
+    } else {
+        app.reset(new QCoreApplication(argc, argv));
+    }
+    app->setApplicationName("Mind2Do");
+    app->setApplicationVersion("1.0.0");
+    app->setOrganizationName("Mind2Do");
+    app->setOrganizationDomain("mind2do.com");
+    TraceLog::startFromEnvironment();
+
+    return run(app->arguments());
+}
+
+int CommandLineTool::run(const QStringList &arguments)
+{
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Process Mind2Do maps without the GUI.");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addPositionalArgument("command", "load, validate, stats, convert or export");
+    parser.addPositionalArgument("inputs", "Map files (.json, .m2d) or directories of maps", "<inputs...>");
+    QCommandLineOption outputOption({"o", "output"}, "Output file, or directory for several inputs.", "path");
+    QCommandLineOption formatOption({"f", "format"}, "convert: json or binary; export: png, tif, pdf or svg.", "format");
+    QCommandLineOption dpiOption("dpi", "Export resolution for png and tif (default 96).", "dpi", "96");
+    QCommandLineOption pagesOption("pages-across", "PDF pages across the map (default 1).", "pages", "1");
+    QCommandLineOption simplifiedOption("simplified", "Export plain boxes and lines, without text.");
+    QCommandLineOption jsonOption("json", "Print one JSON object per map.");
+    QCommandLineOption jobsOption({"j", "jobs"}, "Maps processed at once (default: one per core).", "count");
+    parser.addOptions({outputOption, formatOption, dpiOption, pagesOption, simplifiedOption, jsonOption, jobsOption});
+    parser.process(arguments);
+
+    const QStringList positional = parser.positionalArguments();
+    Options options;
+    if (positional.size() < 2 || !commandFromName(positional.first(), &options.command)) {
+        err << parser.helpText();
+        return EXIT_USAGE;
+    }
+
+    QStringList errors;
+    const QStringList inputs = expandInputs(positional.mid(1), &errors);
+    for (const QString &error : errors) {
+        err << error << Qt::endl;
+    }
+    if (inputs.isEmpty()) {
+        err << "No maps to process" << Qt::endl;
+        return EXIT_USAGE;
+    }
+
+    options.outputPath = parser.value(outputOption);
+    options.format = parser.value(formatOption).toLower();
+    options.dpi = parser.value(dpiOption).toInt();
+    options.pagesAcross = parser.value(pagesOption).toInt();
+    options.simplified = parser.isSet(simplifiedOption);
+    options.json = parser.isSet(jsonOption);
+    options.outputIsDirectory = !options.outputPath.isEmpty()
+        && (inputs.size() > 1 || QFileInfo(options.outputPath).isDir());
+
+    if (options.command == Convert) {
+        if (options.format.isEmpty()) {
+            options.format = options.outputPath.isEmpty() || options.outputIsDirectory
+                ? QString("binary")
+                : (MapDocument::formatForPath(options.outputPath) == MapDocument::Binary ? "binary" : "json");
+        }
+        if (options.format != "json" && options.format != "binary") {
+            err << "convert: --format must be json or binary" << Qt::endl;
+            return EXIT_USAGE;
+        }
+    }
+    if (options.command == Export) {
+        if (options.format.isEmpty()) {
+            options.format = options.outputPath.isEmpty() || options.outputIsDirectory
+                ? QString("png") : QFileInfo(options.outputPath).suffix().toLower();
+        }
+        if (options.format == "tiff") {
+            options.format = "tif";
+        }
+        if (!QStringList({"png", "tif", "pdf", "svg"}).contains(options.format)) {
+            err << "export: --format must be png, tif, pdf or svg" << Qt::endl;
+            return EXIT_USAGE;
+        }
+        if (options.dpi <= 0 || options.pagesAcross <= 0) {
+            err << "export: --dpi and --pages-across must be positive" << Qt::endl;
+            return EXIT_USAGE;
+        }
+    }
+    if (options.outputIsDirectory && !QDir().mkpath(options.outputPath)) {
+        err << "Cannot create output directory " << options.outputPath << Qt::endl;
+        return EXIT_FAILED;
+    }
+
+    // One map per thread; results are printed in input order as soon as
+    // each one and all before it are done.
+    QThreadPool pool;
+    const int jobs = parser.isSet(jobsOption) ? parser.value(jobsOption).toInt() : QThread::idealThreadCount();
+    pool.setMaxThreadCount(qMax(1, jobs));
+
+    // Each exporter has its own worker pool; split the cores between the
+    // maps exported at once rather than giving every one of them all cores.
+    const int concurrentMaps = qMax(1, qMin(pool.maxThreadCount(), int(inputs.size())));
+    options.exportWorkers = qMax(1, QThread::idealThreadCount() / concurrentMaps);
+
+    QElapsedTimer timer;
+    timer.start();
+    QFuture<Result> results = QtConcurrent::mapped(&pool, inputs, [options](const QString &inputPath) {
+        return process(options, inputPath);
+    });
+
+    int failed = 0;
+    for (int i = 0; i < inputs.size(); ++i) {
+        const Result result = results.resultAt(i);
+        for (const QString &line : result.output) {
+            out << line << Qt::endl;
+        }
+        for (const QString &line : result.errors) {
+            err << line << Qt::endl;
+        }
+        failed += result.ok ? 0 : 1;
+    }
+
+    if (inputs.size() > 1) {
+        err << QString("%1 map(s), %2 failed, %3 ms").arg(inputs.size()).arg(failed).arg(timer.elapsed()) << Qt::endl;
+    }
+    if (failed > 0 || !errors.isEmpty()) {
+        return EXIT_FAILED;
+    }
+    return EXIT_OK;
+}
+
+bool CommandLineTool::commandFromName(const QString &name, Command *command)
+{
+    const Command commands[] = {Load, Validate, Stats, Convert, Export};
+    for (int i = 0; i < int(sizeof(commands) / sizeof(commands[0])); ++i) {
+        if (name == QLatin1String(COMMAND_NAMES[i])) {
+            *command = commands[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+QStringList CommandLineTool::expandInputs(const QStringList &paths, QStringList *errors)
+{
+    const QString binaryPattern = QString("*.") + MapDocument::BINARY_SUFFIX;
+    QStringList inputs;
+    for (const QString &path : paths) {
+        const QFileInfo info(path);
+        if (info.isDir()) {
+            const QFileInfoList entries = QDir(path).entryInfoList({"*.json", binaryPattern},
+                                                                   QDir::Files | QDir::Readable, QDir::Name);
+            for (const QFileInfo &entry : entries) {
+                inputs.append(entry.filePath());
+            }
+        } else if (info.isFile()) {
+            inputs.append(path);
+        } else {
+            errors->append(path + ": no such file or directory");
+        }
+    }
+    return inputs;
+}
+
+CommandLineTool::Result CommandLineTool::process(const Options &options, const QString &inputPath)
+{
+    TRACE_SCOPE("CommandLineTool::process");
+    Result result;
+    PersistentNodeStore nodes;
+    QString error;
+    QStringList warnings;
+
+    QElapsedTimer timer;
+    timer.start();
+    if (!MapDocument::load(inputPath, &nodes, &error, &warnings)) {
+        result.ok = false;
+        result.errors.append(inputPath + ": " + error);
+        return result;
+    }
+    const qint64 elapsedMs = timer.elapsed();
+
+    switch (options.command) {
+    case Load:
+        describeLoad(inputPath, nodes, elapsedMs, options, &result);
+        break;
+    case Validate:
+        validateMap(inputPath, nodes, warnings, options, &result);
+        return result; // warnings are part of the report
+    case Stats:
+        describeStats(inputPath, nodes, options, &result);
+        break;
+    case Convert:
+        convertMap(inputPath, nodes, options, &result);
+        break;
+    case Export:
+        exportMap(inputPath, nodes, options, &result);
+        break;
+    }
+
+    for (const QString &warning : warnings) {
+        result.errors.append(inputPath + ": warning: " + warning);
+    }
+    return result;
+}
+
+QString CommandLineTool::outputPathFor(const Options &options, const QString &inputPath, const QString &suffix)
+{
+    const QFileInfo input(inputPath);
+    if (options.outputPath.isEmpty()) {
+        return input.dir().filePath(input.completeBaseName() + "." + suffix);
+    }
+    if (options.outputIsDirectory) {
+        return QDir(options.outputPath).filePath(input.completeBaseName() + "." + suffix);
+    }
+    return options.outputPath;
+}
+
+void CommandLineTool::describeLoad(const QString &inputPath, const PersistentNodeStore &nodes, qint64 elapsedMs,
+                                   const Options &options, Result *result)
+{
+    if (options.json) {
+        QJsonObject json;
+        json["file"] = inputPath;
+        json["nodes"] = nodes.size();
+        json["loadMs"] = double(elapsedMs);
+        result->output.append(jsonLine(json));
+    } else {
+        result->output.append(QString("%1: %2 nodes, loaded in %3 ms").arg(inputPath).arg(nodes.size()).arg(elapsedMs));
+    }
+}
+
+void CommandLineTool::validateMap(const QString &inputPath, const PersistentNodeStore &nodes,
+                                  const QStringList &warnings, const Options &options, Result *result)
+{
+    const QStringList issues = MapDocument::validate(nodes);
+    result->ok = issues.isEmpty() && warnings.isEmpty();
+
+    if (options.json) {
+        QJsonObject json;
+        json["file"] = inputPath;
+        json["valid"] = result->ok;
+        json["issues"] = QJsonArray::fromStringList(issues);
+        json["warnings"] = QJsonArray::fromStringList(warnings);
+        result->output.append(jsonLine(json));
+        return;
+    }
+
+    if (result->ok) {
+        result->output.append(inputPath + ": OK");
+        return;
+    }
+    result->output.append(QString("%1: %2 problem(s)").arg(inputPath).arg(issues.size() + warnings.size()));
+    for (const QString &problem : warnings + issues) {
+        result->output.append("  " + problem);
+    }
+}
+
+void CommandLineTool::describeStats(const QString &inputPath, const PersistentNodeStore &nodes,
+                                    const Options &options, Result *result)
+{
+    const MapDocument::Statistics stats = MapDocument::statistics(nodes);
+    if (options.json) {
+        QJsonObject json = stats.toJson();
+        json["file"] = inputPath;
+        result->output.append(jsonLine(json));
+        return;
+    }
+
+    const int percent = stats.nodes > 0 ? stats.completed * 100 / stats.nodes : 0;
+    result->output.append(QString("%1: %2 nodes in %3 tree(s), %4 completed (%5%), %6 connections, "
+                                  "%7 media files, depth %8, %9 x %10")
+                              .arg(inputPath).arg(stats.nodes).arg(stats.roots).arg(stats.completed).arg(percent)
+                              .arg(stats.connections).arg(stats.mediaFiles).arg(stats.maxDepth)
+                              .arg(qRound(stats.bounds.width())).arg(qRound(stats.bounds.height())));
+}
+
+void CommandLineTool::convertMap(const QString &inputPath, const PersistentNodeStore &nodes,
+                                 const Options &options, Result *result)
+{
+    const bool binary = options.format == "binary";
+    const QString outputPath = outputPathFor(options, inputPath, binary ? MapDocument::BINARY_SUFFIX : "json");
+    if (QFileInfo(outputPath).absoluteFilePath() == QFileInfo(inputPath).absoluteFilePath()) {
+        result->ok = false;
+        result->errors.append(inputPath + ": output would overwrite the input; pass --output");
+        return;
+    }
+
+    QString error;
+    if (!MapDocument::save(outputPath, nodes, binary ? MapDocument::Binary : MapDocument::Json, &error)) {
+        result->ok = false;
+        result->errors.append(outputPath + ": " + error);
+        return;
+    }
+    result->output.append(QString("%1 -> %2").arg(inputPath, outputPath));
+}
+
+void CommandLineTool::exportMap(const QString &inputPath, const PersistentNodeStore &nodes,
+                                const Options &options, Result *result)
+{
+    if (nodes.isEmpty()) {
+        result->ok = false;
+        result->errors.append(inputPath + ": nothing to export");
+        return;
+    }
+    const QString outputPath = outputPathFor(options, inputPath, options.format);
+    const QRectF area = MapDocument::statistics(nodes).bounds.adjusted(-EXPORT_MARGIN, -EXPORT_MARGIN,
+                                                                       EXPORT_MARGIN, EXPORT_MARGIN);
+
+    const SnapshotRenderer::Detail detail = options.simplified ? SnapshotRenderer::Simplified
+                                                               : SnapshotRenderer::FullDetail;
+    QString message;
+    bool success = false;
+    if (options.format == "png") {
+        success = writePng(nodes, area, options.dpi, outputPath, &message);
+    } else if (options.format == "tif") {
+        TiledImageExporter exporter;
+        exporter.setWorkerCount(options.exportWorkers);
+        success = exporter.writeImage(nodes, area, options.dpi, outputPath, &message);
+    } else if (options.format == "svg") {
+        VectorExporter exporter;
+        success = exporter.writeSvgFile(nodes, area, outputPath, detail, &message);
+    } else {
+        const QPageLayout layout = VectorExporter::posterLayout(area);
+        const qreal scale = VectorExporter::scaleForPagesAcross(area, layout, options.pagesAcross);
+        VectorExporter exporter;
+        exporter.setWorkerCount(options.exportWorkers);
+        success = exporter.writePdfFile(nodes, area, outputPath, layout, scale, detail, &message);
+    }
+
+    if (!success) {
+        result->ok = false;
+        result->errors.append(outputPath + ": " + message);
+        return;
+    }
+    result->output.append(QString("%1 -> %2").arg(inputPath, outputPath));
+}
+
+bool CommandLineTool::writePng(const PersistentNodeStore &nodes, const QRectF &area, int dpi,
+                               const QString &filePath, QString *message)
+{
+    // PNG needs the whole image in memory and one map is exported per job,
+    // so the cap is per job; tif streams tiles and has no such limit.
+    const QSize size = TiledImageExporter::outputSize(area, dpi);
+    if (qint64(size.width()) * size.height() > MAX_PNG_PIXELS) {
+        *message = QString("%1 x %2 px is too large for PNG (max 16 megapixels); export as tif or lower --dpi")
+                       .arg(size.width()).arg(size.height());
+        return false;
+    }
+
+    SnapshotRenderer renderer(nodes);
+    QImage image(size, QImage::Format_ARGB32_Premultiplied);
+    if (image.isNull()) {
+        *message = "Out of memory";
+        return false;
+    }
+    image.fill(renderer.getBackground());
+    {
+        const qreal scale = qreal(size.width()) / area.width();
+        QPainter painter(&image);
+        painter.scale(scale, scale);
+        painter.translate(-area.topLeft());
+        renderer.render(&painter, area);
+    }
+
+    if (!image.save(filePath, "PNG")) {
+        *message = "Cannot write PNG";
+        return false;
+    }
+    return true;
+}
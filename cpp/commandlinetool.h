@@ -0,0 +1,81 @@
+#ifndef COMMANDLINETOOL_H
+#define COMMANDLINETOOL_H
+
+#include <QString>
+#include <QStringList>
+
+#include "mapdocument.h"
+
+// Headless mode: `Mind2Do <command> [options] <files or directories>`.
+// Runs under QCoreApplication, or QGuiApplication on the offscreen
+// platform for image and PDF export, and never constructs a widget.
+// Inputs are processed in parallel, one map per thread, and reported in
+// input order.
+//
+// Commands:
+//   load      load each map and report its size and load time
+//   validate  check structure (dangling references, cycles, duplicates)
+//   stats     print node, completion, connection and depth statistics
+//   convert   rewrite maps as JSON or binary (--format json|binary)
+//   export    render maps to png, tif, pdf or svg (--format)
+class CommandLineTool
+{
+public:
+    // True if argv starts with one of the commands above. main() checks
+    // this before creating any application object.
+    static bool isRequested(int argc, char *argv[]);
+
+    // Creates the right application object and runs the command.
+    static int exec(int argc, char *argv[]);
+
+    // Constants
+    static const int EXIT_OK = 0;
+    static const int EXIT_FAILED = 1;   // a map failed to load, validate or write
+    static const int EXIT_USAGE = 2;
+
+private:
+    enum Command {
+        Load,
+        Validate,
+        Stats,
+        Convert,
+        Export
+    };
+
+    struct Options {
+        Command command = Load;
+        QString outputPath;
+        bool outputIsDirectory = false;
+        QString format;
+        int dpi = 96;
+        int pagesAcross = 1;
+        bool simplified = false;
+        bool json = false;
+        int exportWorkers = 1;  // tile/page threads per exported map
+    };
+
+    struct Result {
+        bool ok = true;
+        QStringList output;     // stdout lines
+        QStringList errors;     // stderr lines
+    };
+
+    // Methods
+    static int run(const QStringList &arguments);
+    static bool commandFromName(const QString &name, Command *command);
+    static QStringList expandInputs(const QStringList &paths, QStringList *errors);
+    static Result process(const Options &options, const QString &inputPath);
+    static QString outputPathFor(const Options &options, const QString &inputPath, const QString &suffix);
+    static void describeLoad(const QString &inputPath, const PersistentNodeStore &nodes, qint64 elapsedMs, const Options &options, Result *result);
+    static void validateMap(const QString &inputPath, const PersistentNodeStore &nodes, const QStringList &warnings, const Options &options, Result *result);
+    static void describeStats(const QString &inputPath, const PersistentNodeStore &nodes, const Options &options, Result *result);
+    static void convertMap(const QString &inputPath, const PersistentNodeStore &nodes, const Options &options, Result *result);
+    static void exportMap(const QString &inputPath, const PersistentNodeStore &nodes, const Options &options, Result *result);
+    static bool writePng(const PersistentNodeStore &nodes, const QRectF &area, int dpi, const QString &filePath, QString *message);
+
+    // Constants
+    static const int EXPORT_MARGIN = 40;            // same as the GUI's export
+    static const qint64 MAX_PNG_PIXELS = 16777216;  // 4096 x 4096, 64 MiB ARGB per job; beyond that, use tif
+};
+
+#endif // COMMANDLINETOOL_H
@@ -0,0 +1,456 @@
+#include "connectionrouter.h"
+#include "tracelog.h"
+
+#include <QThread>
+#include <QLineF>
+#include <QtMath>
+
+#include <algorithm>
+#include <limits>
+#include <queue>
+#include <utility>
+#include <vector>
+
+ConnectionRouter::ConnectionRouter(QObject *parent)
+    : QObject(parent)
+    , m_scheduleTimer(new QTimer(this))
+    , m_interactionDepth(0)
+    , m_nextGeneration(0)
+    , m_style(Rounded)
+{
+    m_scheduleTimer->setSingleShot(true);
+    m_scheduleTimer->setInterval(SCHEDULE_DELAY);
+    connect(m_scheduleTimer, &QTimer::timeout, this, &ConnectionRouter::onScheduleTimeout);
+
+    m_pool.setMaxThreadCount(qMax(1, QThread::idealThreadCount() / 2));
+}
+
+ConnectionRouter::~ConnectionRouter()
+{
+    m_scheduleTimer->stop();
+    m_pool.clear();
+    m_pool.waitForDone();
+}
+
+void ConnectionRouter::setNodeRect(const QString &nodeId, const QRectF &rect)
+{
+    const bool known = m_nodeRects.contains(nodeId);
+    const QRectF previous = m_nodeRects.rect(nodeId);
+    if (known && previous == rect) {
+        return;
+    }
+    m_nodeRects.insert(nodeId, rect);
+
+    // Edges ending here lose their route at once and draw straight until the
+    // new one arrives; edges that merely pass nearby keep their old route.
+    const QStringList attached = m_edgesByNode.value(nodeId);
+    for (const QString &edgeId : attached) {
+        updateCorridor(edgeId);
+        invalidate(edgeId, true);
+    }
+    if (known) {
+        invalidateArea(previous, nodeId);
+    }
+    invalidateArea(rect, nodeId);
+    scheduleDirty();
+}
+
+void ConnectionRouter::removeNode(const QString &nodeId)
+{
+    if (!m_nodeRects.contains(nodeId)) {
+        return;
+    }
+    const QRectF previous = m_nodeRects.rect(nodeId);
+    m_nodeRects.remove(nodeId);
+
+    const QStringList attached = m_edgesByNode.value(nodeId);
+    for (const QString &edgeId : attached) {
+        removeEdge(edgeId);
+    }
+    m_edgesByNode.remove(nodeId);
+    invalidateArea(previous, nodeId);
+    scheduleDirty();
+}
+
+void ConnectionRouter::addEdge(const QString &edgeId, const QString &fromId, const QString &toId)
+{
+    if (m_edges.contains(edgeId)) {
+        removeEdge(edgeId);
+    }
+    Edge edge;
+    edge.fromId = fromId;
+    edge.toId = toId;
+    m_edges.insert(edgeId, edge);
+    m_edgesByNode[fromId].append(edgeId);
+    m_edgesByNode[toId].append(edgeId);
+
+    updateCorridor(edgeId);
+    invalidate(edgeId, true);
+    scheduleDirty();
+}
+
+void ConnectionRouter::removeEdge(const QString &edgeId)
+{
+    auto it = m_edges.find(edgeId);
+    if (it == m_edges.end()) {
+        return;
+    }
+    m_edgesByNode[it->fromId].removeOne(edgeId);
+    m_edgesByNode[it->toId].removeOne(edgeId);
+    m_corridors.remove(edgeId);
+    m_dirty.remove(edgeId);
+    m_edges.erase(it);
+}
+
+void ConnectionRouter::clear()
+{
+    m_scheduleTimer->stop();
+    m_nodeRects.clear();
+    m_corridors.clear();
+    m_edges.clear();
+    m_edgesByNode.clear();
+    m_dirty.clear();
+}
+
+QString ConnectionRouter::edgeKey(const QString &fromId, const QString &toId)
+{
+    return fromId + "->" + toId;
+}
+
+bool ConnectionRouter::routedPath(const QString &edgeId, QPainterPath *path) const
+{
+    auto it = m_edges.constFind(edgeId);
+    if (it == m_edges.constEnd() || it->path.isEmpty()) {
+        return false;
+    }
+    if (path) {
+        *path = it->path;
+    }
+    return true;
+}
+
+void ConnectionRouter::beginInteraction()
+{
+    ++m_interactionDepth;
+    m_scheduleTimer->stop();
+}
+
+void ConnectionRouter::endInteraction()
+{
+    m_interactionDepth = qMax(0, m_interactionDepth - 1);
+    scheduleDirty();
+}
+
+void ConnectionRouter::setStyle(Style style)
+{
+    if (m_style == style) {
+        return;
+    }
+    m_style = style;
+    for (auto it = m_edges.constBegin(); it != m_edges.constEnd(); ++it) {
+        invalidate(it.key(), false);
+    }
+    scheduleDirty();
+}
+
+void ConnectionRouter::onScheduleTimeout()
+{
+    const QSet<QString> dirty = m_dirty;
+    m_dirty.clear();
+    for (const QString &edgeId : dirty) {
+        dispatch(edgeId);
+    }
+}
+
+QRectF ConnectionRouter::corridorFor(const Edge &edge) const
+{
+    if (!m_nodeRects.contains(edge.fromId) || !m_nodeRects.contains(edge.toId)) {
+        return QRectF();
+    }
+    const QRectF span = m_nodeRects.rect(edge.fromId).united(m_nodeRects.rect(edge.toId));
+    return span.adjusted(-CORRIDOR_MARGIN, -CORRIDOR_MARGIN, CORRIDOR_MARGIN, CORRIDOR_MARGIN);
+}
+
+void ConnectionRouter::updateCorridor(const QString &edgeId)
+{
+    const QRectF corridor = corridorFor(m_edges.value(edgeId));
+    if (corridor.isNull()) {
+        m_corridors.remove(edgeId);
+    } else {
+        m_corridors.insert(edgeId, corridor);
+    }
+}
+
+void ConnectionRouter::invalidate(const QString &edgeId, bool endpointMoved)
+{
+    auto it = m_edges.find(edgeId);
+    if (it == m_edges.end()) {
+        return;
+    }
+    // Any result still in flight for this edge is now stale.
+    it->generation = ++m_nextGeneration;
+    it->routed = false;
+    if (endpointMoved && !it->path.isEmpty()) {
+        it->path = QPainterPath();
+        emit routeInvalidated(edgeId);
+    }
+    m_dirty.insert(edgeId);
+}
+
+void ConnectionRouter::invalidateArea(const QRectF &area, const QString &movedNodeId)
+{
+    const QRectF inflated = area.adjusted(-OBSTACLE_MARGIN, -OBSTACLE_MARGIN, OBSTACLE_MARGIN, OBSTACLE_MARGIN);
+    const QStringList crossing = m_corridors.query(inflated);
+    for (const QString &edgeId : crossing) {
+        const Edge &edge = m_edges[edgeId];
+        if (edge.fromId != movedNodeId && edge.toId != movedNodeId) {
+            invalidate(edgeId, false);
+        }
+    }
+}
+
+void ConnectionRouter::scheduleDirty()
+{
+    if (m_interactionDepth == 0 && !m_dirty.isEmpty()) {
+        m_scheduleTimer->start();
+    }
+}
+
+void ConnectionRouter::dispatch(const QString &edgeId)
+{
+    TRACE_SCOPE("ConnectionRouter::dispatch");
+    auto it = m_edges.constFind(edgeId);
+    if (it == m_edges.constEnd() || !m_nodeRects.contains(it->fromId) || !m_nodeRects.contains(it->toId)) {
+        return;
+    }
+
+    RouteRequest request;
+    request.edgeId = edgeId;
+    request.generation = it->generation;
+    request.fromRect = m_nodeRects.rect(it->fromId);
+    request.toRect = m_nodeRects.rect(it->toId);
+    request.corridor = corridorFor(it.value());
+    request.rounded = m_style == Rounded;
+
+    // The obstacles are copied now, so the worker never reads live state.
+    const QPointF middle = (request.fromRect.center() + request.toRect.center()) / 2.0;
+    const QStringList nearby = m_nodeRects.query(request.corridor);
+    for (const QString &nodeId : nearby) {
+        if (nodeId != it->fromId && nodeId != it->toId) {
+            request.obstacles.append(m_nodeRects.rect(nodeId));
+        }
+    }
+    if (request.obstacles.size() > MAX_OBSTACLES) {
+        std::partial_sort(request.obstacles.begin(), request.obstacles.begin() + MAX_OBSTACLES,
+                          request.obstacles.end(), [middle](const QRectF &a, const QRectF &b) {
+            return QLineF(a.center(), middle).length() < QLineF(b.center(), middle).length();
+        });
+        request.obstacles.resize(MAX_OBSTACLES);
+    }
+
+    QtConcurrent::run(&m_pool, [this, request]() {
+        const QPainterPath path = computeRoute(request);
+        QMetaObject::invokeMethod(this, [this, request, path]() {
+            onRouteComputed(request.edgeId, request.generation, path);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void ConnectionRouter::onRouteComputed(const QString &edgeId, quint64 generation, const QPainterPath &path)
+{
+    auto it = m_edges.find(edgeId);
+    if (it == m_edges.end() || it->generation != generation) {
+        return;
+    }
+    it->path = path;
+    it->routed = true;
+    emit routeReady(edgeId);
+}
+
+QPainterPath ConnectionRouter::computeRoute(const RouteRequest &request)
+{
+    TRACE_SCOPE("ConnectionRouter::computeRoute");
+    const QRectF &fromRect = request.fromRect;
+    const QRectF &toRect = request.toRect;
+    if (fromRect.intersects(toRect)) {
+        return QPainterPath();
+    }
+    const QPointF start = fromRect.center();
+    const QPointF target = toRect.center();
+    const QRectF &corridor = request.corridor;
+
+    // Inflated obstacles, clipped to the corridor. One that covers an
+    // endpoint cannot be avoided and is ignored.
+    QVector<QRectF> obstacles;
+    for (const QRectF &rect : request.obstacles) {
+        const QRectF inflated = rect.adjusted(-OBSTACLE_MARGIN, -OBSTACLE_MARGIN, OBSTACLE_MARGIN, OBSTACLE_MARGIN)
+                                    .intersected(corridor);
+        if (inflated.isEmpty() || inflated.contains(start) || inflated.contains(target)) {
+            continue;
+        }
+        obstacles.append(inflated);
+    }
+
+    // Visibility grid: every obstacle edge, the corridor edges and the two
+    // centres. Between neighbouring grid lines a segment is either wholly
+    // inside an obstacle or wholly outside, so blocking is a rasterisation.
+    std::vector<double> xs = { corridor.left(), corridor.right(), start.x(), target.x() };
+    std::vector<double> ys = { corridor.top(), corridor.bottom(), start.y(), target.y() };
+    for (const QRectF &rect : std::as_const(obstacles)) {
+        xs.push_back(rect.left());
+        xs.push_back(rect.right());
+        ys.push_back(rect.top());
+        ys.push_back(rect.bottom());
+    }
+    std::sort(xs.begin(), xs.end());
+    std::sort(ys.begin(), ys.end());
+    xs.erase(std::unique(xs.begin(), xs.end()), xs.end());
+    ys.erase(std::unique(ys.begin(), ys.end()), ys.end());
+    const int columns = int(xs.size());
+    const int rows = int(ys.size());
+    auto columnOf = [&xs](double x) { return int(std::lower_bound(xs.begin(), xs.end(), x) - xs.begin()); };
+    auto rowOf = [&ys](double y) { return int(std::lower_bound(ys.begin(), ys.end(), y) - ys.begin()); };
+
+    std::vector<char> vertexBlocked(size_t(columns) * rows, 0);
+    std::vector<char> horizontalBlocked(size_t(columns) * rows, 0); // (i, j) -> (i + 1, j)
+    std::vector<char> verticalBlocked(size_t(columns) * rows, 0);   // (i, j) -> (i, j + 1)
+    for (const QRectF &rect : std::as_const(obstacles)) {
+        const int left = columnOf(rect.left());
+        const int right = columnOf(rect.right());
+        const int top = rowOf(rect.top());
+        const int bottom = rowOf(rect.bottom());
+        for (int j = top + 1; j < bottom; ++j) {
+            for (int i = left; i < right; ++i) {
+                horizontalBlocked[size_t(j) * columns + i] = 1;
+                if (i > left) {
+                    vertexBlocked[size_t(j) * columns + i] = 1;
+                }
+            }
+        }
+        for (int i = left + 1; i < right; ++i) {
+            for (int j = top; j < bottom; ++j) {
+                verticalBlocked[size_t(j) * columns + i] = 1;
+            }
+        }
+    }
+
+    // A* over (vertex, heading) so that bends can be charged.
+    const int startVertex = rowOf(start.y()) * columns + columnOf(start.x());
+    const int targetVertex = rowOf(target.y()) * columns + columnOf(target.x());
+    const int stateCount = columns * rows * 4;
+    std::vector<double> cost(stateCount, std::numeric_limits<double>::max());
+    std::vector<int> previous(stateCount, -1);
+    typedef std::pair<double, int> QueueEntry;
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> open;
+
+    auto heuristic = [&](int vertex) {
+        return qAbs(xs[vertex % columns] - target.x()) + qAbs(ys[vertex / columns] - target.y());
+    };
+    for (int heading = 0; heading < 4; ++heading) {
+        const int state = startVertex * 4 + heading;
+        cost[state] = 0.0;
+        open.push(QueueEntry(heuristic(startVertex), state));
+    }
+
+    static const int stepI[4] = { 1, -1, 0, 0 };
+    static const int stepJ[4] = { 0, 0, 1, -1 };
+    int reached = -1;
+    while (!open.empty()) {
+        const QueueEntry entry = open.top();
+        open.pop();
+        const int state = entry.second;
+        const int vertex = state / 4;
+        const int heading = state % 4;
+        if (entry.first - heuristic(vertex) > cost[state] + 1e-9) {
+            continue; // superseded entry
+        }
+        if (vertex == targetVertex) {
+            reached = state;
+            break;
+        }
+        const int i = vertex % columns;
+        const int j = vertex / columns;
+        for (int next = 0; next < 4; ++next) {
+            const int ni = i + stepI[next];
+            const int nj = j + stepJ[next];
+            if (ni < 0 || nj < 0 || ni >= columns || nj >= rows) {
+                continue;
+            }
+            const bool blocked = next < 2
+                ? horizontalBlocked[size_t(j) * columns + qMin(i, ni)]
+                : verticalBlocked[size_t(qMin(j, nj)) * columns + i];
+            const int nextVertex = nj * columns + ni;
+            if (blocked || vertexBlocked[nextVertex]) {
+                continue;
+            }
+            const double length = qAbs(xs[ni] - xs[i]) + qAbs(ys[nj] - ys[j]);
+            const double nextCost = cost[state] + length + (next != heading ? BEND_PENALTY : 0);
+            const int nextState = nextVertex * 4 + next;
+            if (nextCost < cost[nextState]) {
+                cost[nextState] = nextCost;
+                previous[nextState] = state;
+                open.push(QueueEntry(nextCost + heuristic(nextVertex), nextState));
+            }
+        }
+    }
+    if (reached < 0) {
+        return QPainterPath();
+    }
+
+    // Walk back, keeping only the corners.
+    QVector<QPointF> points;
+    for (int state = reached; state >= 0; state = previous[state]) {
+        const int vertex = state / 4;
+        const QPointF point(xs[vertex % columns], ys[vertex / columns]);
+        if (points.size() >= 2) {
+            const QPointF &a = points.at(points.size() - 2);
+            const QPointF &b = points.last();
+            // Grid coordinates come from the same arrays, so exact compares hold.
+            const bool collinear = (a.x() == b.x() && b.x() == point.x())
+                                || (a.y() == b.y() && b.y() == point.y());
+            if (collinear) {
+                points.last() = point;
+                continue;
+            }
+        }
+        if (points.isEmpty() || points.last() != point) {
+            points.append(point);
+        }
+    }
+    std::reverse(points.begin(), points.end());
+
+    // Start and end on the node borders rather than at their centres.
+    while (points.size() > 2 && fromRect.contains(points.at(1))) {
+        points.removeFirst();
+    }
+    while (points.size() > 2 && toRect.contains(points.at(points.size() - 2))) {
+        points.removeLast();
+    }
+    if (points.size() < 2) {
+        return QPainterPath();
+    }
+    auto clipToBorder = [](const QRectF &rect, const QPointF &inside, const QPointF &outside) {
+        if (inside.y() == outside.y()) {
+            return QPointF(outside.x() > inside.x() ? rect.right() : rect.left(), inside.y());
+        }
+        return QPointF(inside.x(), outside.y() > inside.y() ? rect.bottom() : rect.top());
+    };
+    points.first() = clipToBorder(fromRect, points.at(0), points.at(1));
+    points.last() = clipToBorder(toRect, points.last(), points.at(points.size() - 2));
+
+    QPainterPath path(points.first());
+    for (int k = 1; k < points.size() - 1; ++k) {
+        const QPointF &corner = points.at(k);
+        if (!request.rounded) {
+            path.lineTo(corner);
+            continue;
+        }
+        const QLineF in(corner, points.at(k - 1));
+        const QLineF out(corner, points.at(k + 1));
+        const qreal radius = qMin<qreal>(CORNER_RADIUS, qMin(in.length(), out.length()) / 2.0);
+        path.lineTo(in.pointAt(radius / in.length()));
+        path.quadTo(corner, out.pointAt(radius / out.length()));
+    }
+    path.lineTo(points.last());
+    return path;
+}
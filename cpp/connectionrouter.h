@@ -0,0 +1,121 @@
+#ifndef CONNECTIONROUTER_H
+#define CONNECTIONROUTER_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+#include <QRectF>
+#include <QPainterPath>
+#include <QTimer>
+#include <QThreadPool>
+#include <QtConcurrent>
+
+#include "spatialgrid.h"
+
+struct RouteRequest {
+    QString edgeId;
+    quint64 generation = 0;
+    QRectF fromRect;
+    QRectF toRect;
+    QRectF corridor;
+    QVector<QRectF> obstacles;
+    bool rounded = true;
+};
+
+// Background router for connection lines. Routes are orthogonal paths that
+// avoid node rectangles, found with A* over the visibility grid formed by the
+// obstacle edges inside the connection's corridor. Results are cached per
+// edge and recomputed only when an endpoint moves or a node moves in or out
+// of the corridor.
+class ConnectionRouter : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Style {
+        Orthogonal,
+        Rounded
+    };
+
+    explicit ConnectionRouter(QObject *parent = nullptr);
+    ~ConnectionRouter();
+
+    // Obstacles, mirrored from node geometry
+    void setNodeRect(const QString &nodeId, const QRectF &rect);
+    void removeNode(const QString &nodeId);
+
+    // Edges
+    void addEdge(const QString &edgeId, const QString &fromId, const QString &toId);
+    void removeEdge(const QString &edgeId);
+    void clear();
+    static QString edgeKey(const QString &fromId, const QString &toId);
+
+    // The routed path, or false when the line should be drawn straight
+    // (not routed yet, endpoint moved since, or no route exists).
+    bool routedPath(const QString &edgeId, QPainterPath *path) const;
+
+    // While an interaction is open (e.g. a drag), invalidated edges wait and
+    // are routed once it ends.
+    void beginInteraction();
+    void endInteraction();
+
+    void setStyle(Style style);
+    Style getStyle() const { return m_style; }
+
+    // Runs on a worker thread
+    static QPainterPath computeRoute(const RouteRequest &request);
+
+signals:
+    void routeReady(const QString &edgeId);
+    void routeInvalidated(const QString &edgeId);
+
+private slots:
+    void onScheduleTimeout();
+
+private:
+    struct Edge {
+        QString fromId;
+        QString toId;
+        QPainterPath path;
+        bool routed = false;     // path is current for both endpoints
+        quint64 generation = 0;  // bumped on every invalidation
+    };
+
+    // Geometry
+    SpatialGrid m_nodeRects;
+    SpatialGrid m_corridors;
+
+    // Edges
+    QHash<QString, Edge> m_edges;
+    QHash<QString, QStringList> m_edgesByNode;
+    QSet<QString> m_dirty;
+
+    // Scheduling
+    QTimer *m_scheduleTimer;
+    QThreadPool m_pool;
+    int m_interactionDepth;
+    quint64 m_nextGeneration;
+    Style m_style;
+
+    // Methods
+    QRectF corridorFor(const Edge &edge) const;
+    void updateCorridor(const QString &edgeId);
+    void invalidate(const QString &edgeId, bool endpointMoved);
+    void invalidateArea(const QRectF &area, const QString &movedNodeId);
+    void scheduleDirty();
+    void dispatch(const QString &edgeId);
+    void onRouteComputed(const QString &edgeId, quint64 generation, const QPainterPath &path);
+
+    // Constants
+    static const int OBSTACLE_MARGIN = 12;
+    static const int CORRIDOR_MARGIN = 240;
+    static const int MAX_OBSTACLES = 150;
+    static const int SCHEDULE_DELAY = 80; // ms after the last invalidation
+    static const int BEND_PENALTY = 40;
+    static const int CORNER_RADIUS = 12;
+};
+
+#endif // CONNECTIONROUTER_H
@@ -0,0 +1,109 @@
+#include "contentbounds.h"
+
+const qreal ContentBounds::SCENE_MARGIN = 200.0;
+const qreal ContentBounds::SCENE_SLACK = 1000.0;
+
+ContentBounds::ContentBounds(QObject *parent)
+    : QObject(parent)
+{
+}
+
+ContentBounds::~ContentBounds()
+{
+}
+
+void ContentBounds::setRect(const QString &nodeId, const QRectF &rect)
+{
+    auto it = m_rects.find(nodeId);
+    if (it != m_rects.end()) {
+        if (it.value() == rect) {
+            return;
+        }
+        subtract(it.value());
+        it.value() = rect;
+    } else {
+        m_rects.insert(nodeId, rect);
+    }
+    add(rect);
+    updateSceneRect();
+}
+
+void ContentBounds::remove(const QString &nodeId)
+{
+    auto it = m_rects.find(nodeId);
+    if (it == m_rects.end()) {
+        return;
+    }
+    subtract(it.value());
+    m_rects.erase(it);
+    updateSceneRect();
+}
+
+void ContentBounds::clear()
+{
+    m_rects.clear();
+    m_lefts.clear();
+    m_tops.clear();
+    m_rights.clear();
+    m_bottoms.clear();
+    updateSceneRect();
+}
+
+QRectF ContentBounds::bounds() const
+{
+    if (m_rects.isEmpty()) {
+        return QRectF();
+    }
+    return QRectF(QPointF(m_lefts.firstKey(), m_tops.firstKey()),
+                  QPointF(m_rights.lastKey(), m_bottoms.lastKey()));
+}
+
+void ContentBounds::add(const QRectF &rect)
+{
+    m_lefts[rect.left()]++;
+    m_tops[rect.top()]++;
+    m_rights[rect.right()]++;
+    m_bottoms[rect.bottom()]++;
+}
+
+void ContentBounds::subtract(const QRectF &rect)
+{
+    take(m_lefts, rect.left());
+    take(m_tops, rect.top());
+    take(m_rights, rect.right());
+    take(m_bottoms, rect.bottom());
+}
+
+void ContentBounds::take(QMap<qreal, int> &edges, qreal value)
+{
+    // Values come from the stored rect, so the lookup is exact.
+    auto it = edges.find(value);
+    if (it != edges.end() && --it.value() == 0) {
+        edges.erase(it);
+    }
+}
+
+void ContentBounds::updateSceneRect()
+{
+    const QRectF content = bounds();
+    if (content.isNull()) {
+        return;
+    }
+
+    // Grow when content comes within the margin of an edge; shrink only once
+    // the rect has more than twice the slack to spare, so a drag back and
+    // forth across one edge doesn't resize the scene every frame.
+    const QRectF required = content.adjusted(-SCENE_MARGIN, -SCENE_MARGIN, SCENE_MARGIN, SCENE_MARGIN);
+    const QRectF roomy = content.adjusted(-SCENE_SLACK, -SCENE_SLACK, SCENE_SLACK, SCENE_SLACK);
+    const qreal limit = 2 * SCENE_SLACK;
+    const bool tooSmall = !m_sceneRect.contains(required);
+    const bool tooLarge = content.left() - m_sceneRect.left() > limit
+                          || content.top() - m_sceneRect.top() > limit
+                          || m_sceneRect.right() - content.right() > limit
+                          || m_sceneRect.bottom() - content.bottom() > limit;
+
+    if (tooSmall || tooLarge) {
+        m_sceneRect = roomy;
+        emit sceneRectChanged(m_sceneRect);
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef CONTENTBOUNDS_H
+#define CONTENTBOUNDS_H
+
+#include <QObject>
+#include <QString>
+#include <QHash>
+#include <QMap>
+#include <QRectF>
+
+// Bounding rectangle of all node items, maintained as nodes are added,
+// moved, resized and removed. Each edge of the union is the extreme key of a
+// counted ordered multiset, so an update is O(log n) and bounds() is O(1).
+//
+// Also derives a scene rect that follows the content with slack on every
+// side, so the scene rect changes only when content crosses the slack and
+// QGraphicsScene never has to grow it by scanning items.
+class ContentBounds : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ContentBounds(QObject *parent = nullptr);
+    ~ContentBounds();
+
+    // Entries, mirrored from node geometry
+    void setRect(const QString &nodeId, const QRectF &rect); // inserts or moves
+    void remove(const QString &nodeId);
+    void clear();
+    int count() const { return m_rects.size(); }
+
+    // Union of all entries; null when empty
+    QRectF bounds() const;
+    QRectF sceneRect() const { return m_sceneRect; }
+
+signals:
+    void sceneRectChanged(const QRectF &rect);
+
+private:
+    // Entries and per-edge multisets (value -> number of entries at it)
+    QHash<QString, QRectF> m_rects;
+    QMap<qreal, int> m_lefts;
+    QMap<qreal, int> m_tops;
+    QMap<qreal, int> m_rights;
+    QMap<qreal, int> m_bottoms;
+
+    // Derived scene rect
+    QRectF m_sceneRect;
+
+    // Methods
+    void add(const QRectF &rect);
+    void subtract(const QRectF &rect);
+    static void take(QMap<qreal, int> &edges, qreal value);
+    void updateSceneRect();
+
+    // Constants
+    static const qreal SCENE_MARGIN;    // kept around content at least
+    static const qreal SCENE_SLACK;     // extra room added when growing
+};
+
+#endif // CONTENTBOUNDS_H
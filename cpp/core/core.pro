@@ -0,0 +1,66 @@
+# Mind2Do core: everything that doesn't need QtWidgets. Adding `widgets`
+# here, or including a widget header from these files, defeats the split.
+TEMPLATE = lib
+TARGET = mind2docore
+CONFIG += staticlib c++17
+
+QT = core gui concurrent
+
+# You can make your code fail to compile if it uses deprecated APIs.
+# In order to do so, uncomment the following line.
+#DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
+
+INCLUDEPATH += ..
+
+SOURCES += \
+    ../directoryscanner.cpp \
+    ../filepathregistry.cpp \
+    ../filetransferengine.cpp \
+    ../medialibrary.cpp \
+    ../filelauncher.cpp \
+    ../searchindex.cpp \
+    ../fuzzymatcher.cpp \
+    ../taskfilter.cpp \
+    ../progresstracker.cpp \
+    ../treelayout.cpp \
+    ../forcelayout.cpp \
+    ../spatialgrid.cpp \
+    ../connectionrouter.cpp \
+    ../commandhistory.cpp \
+    ../scenetransaction.cpp \
+    ../notificationcoalescer.cpp \
+    ../persistentnodestore.cpp \
+    ../contentbounds.cpp \
+    ../snapshotrenderer.cpp \
+    ../tiledimageexporter.cpp \
+    ../vectorexporter.cpp \
+    ../mapdocument.cpp \
+    ../tracelog.cpp \
+    ../memoryledger.cpp
+
+HEADERS += \
+    ../nodetypes.h \
+    ../directoryscanner.h \
+    ../filepathregistry.h \
+    ../filetransferengine.h \
+    ../medialibrary.h \
+    ../filelauncher.h \
+    ../searchindex.h \
+    ../fuzzymatcher.h \
+    ../taskfilter.h \
+    ../progresstracker.h \
+    ../treelayout.h \
+    ../forcelayout.h \
+    ../spatialgrid.h \
+    ../connectionrouter.h \
+    ../commandhistory.h \
+    ../scenetransaction.h \
+    ../notificationcoalescer.h \
+    ../persistentnodestore.h \
+    ../contentbounds.h \
+    ../snapshotrenderer.h \
+    ../tiledimageexporter.h \
+    ../vectorexporter.h \
+    ../mapdocument.h \
+    ../tracelog.h \
+    ../memoryledger.h
@@ -0,0 +1,17 @@
+# Include from any project that links the core library:
+#     include(<path to cpp>/core/mind2docore.pri)
+# The including project must be built after core (subdirs `depends`).
+QT *= core gui concurrent
+CONFIG *= c++17
+
+INCLUDEPATH += $$PWD/..
+DEPENDPATH += $$PWD/..
+
+MIND2DO_CORE_DIR = $$shadowed($$PWD)
+win32:CONFIG(release, debug|release): MIND2DO_CORE_DIR = $$MIND2DO_CORE_DIR/release
+else:win32:CONFIG(debug, debug|release): MIND2DO_CORE_DIR = $$MIND2DO_CORE_DIR/debug
+
+LIBS += -L$$MIND2DO_CORE_DIR -lmind2docore
+
+win32-msvc*: PRE_TARGETDEPS += $$MIND2DO_CORE_DIR/mind2docore.lib
+else: PRE_TARGETDEPS += $$MIND2DO_CORE_DIR/libmind2docore.a
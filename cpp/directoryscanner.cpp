@@ -0,0 +1,180 @@
+#include "directoryscanner.h"
+#include "tracelog.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QElapsedTimer>
+#include <QPair>
+#include <QSet>
+
+DirectoryScanner::DirectoryScanner(QObject *parent)
+    : QObject(parent)
+    , m_running(false)
+    , m_cancelled(false)
+{
+}
+
+DirectoryScanner::~DirectoryScanner()
+{
+    cancel();
+    waitForFinished();
+}
+
+bool DirectoryScanner::start(const QString &path, const DirectoryScanOptions &options)
+{
+    if (m_running.load()) {
+        return false;
+    }
+
+    QFileInfo rootInfo(path);
+    if (!rootInfo.exists() || !rootInfo.isDir()) {
+        emit scanError(path, "Directory does not exist");
+        return false;
+    }
+
+    m_rootPath = rootInfo.absoluteFilePath();
+    m_options = options;
+    m_cancelled.store(false);
+    m_running.store(true);
+
+    // The scan runs on the global thread pool; results reach the GUI thread
+    // through queued signal delivery.
+    const QString rootPath = m_rootPath;
+    m_future = QtConcurrent::run([this, rootPath, options]() {
+        runScan(rootPath, options);
+    });
+    return true;
+}
+
+void DirectoryScanner::cancel()
+{
+    m_cancelled.store(true);
+}
+
+void DirectoryScanner::waitForFinished()
+{
+    m_future.waitForFinished();
+}
+
+void DirectoryScanner::runScan(const QString &rootPath, const DirectoryScanOptions &options)
+{
+    TRACE_SCOPE("DirectoryScanner::runScan");
+    const QList<QRegularExpression> filters = compileFilters(options.nameFilters);
+    const int chunkSize = qMax(1, options.chunkSize);
+
+    QDir::Filters dirFilters = QDir::AllEntries | QDir::NoDotAndDotDot | QDir::System;
+    if (options.includeHidden) {
+        dirFilters |= QDir::Hidden;
+    }
+
+    // Depth-first walk with an explicit stack so the depth limit is cheap to
+    // enforce and each directory is listed exactly once.
+    QList<QPair<QString, int>> pending;
+    pending.append(qMakePair(rootPath, 0));
+
+    // Followed symlinks can lead back up the tree (or to one directory by
+    // two routes), so each directory is listed once by its canonical path.
+    QSet<QString> visited;
+
+    QStringList chunk;
+    chunk.reserve(chunkSize);
+    int chunkLimit = qMin(chunkSize, static_cast<int>(FIRST_CHUNK_SIZE));
+    int totalEntries = 0;
+    QElapsedTimer flushTimer;
+    flushTimer.start();
+
+    auto flush = [&]() {
+        if (chunk.isEmpty()) {
+            return;
+        }
+        totalEntries += chunk.size();
+        emit entriesFound(chunk);
+        chunk.clear();
+        chunkLimit = chunkSize;
+        flushTimer.restart();
+    };
+
+    while (!pending.isEmpty() && !m_cancelled.load()) {
+        const QPair<QString, int> current = pending.takeLast();
+        const QString &directory = current.first;
+        const int depth = current.second;
+
+        if (options.followSymlinks) {
+            const QString canonical = QFileInfo(directory).canonicalFilePath();
+            if (visited.contains(canonical)) {
+                continue;
+            }
+            visited.insert(canonical);
+        }
+
+        QDir dir(directory);
+        if (!dir.isReadable()) {
+            emit scanError(directory, "Directory is not readable");
+            continue;
+        }
+
+        QDirIterator it(directory, dirFilters);
+        while (it.hasNext()) {
+            if (m_cancelled.load()) {
+                break;
+            }
+
+            const QString entryPath = it.next();
+            const QFileInfo info = it.fileInfo();
+
+            if (info.isDir()) {
+                if (info.isSymLink() && !options.followSymlinks) {
+                    continue;
+                }
+                if (options.includeDirectories) {
+                    chunk.append(entryPath);
+                }
+                if (options.maxDepth < 0 || depth < options.maxDepth) {
+                    pending.append(qMakePair(entryPath, depth + 1));
+                }
+            } else if (options.includeFiles && matchesFilters(info.fileName(), filters)) {
+                chunk.append(entryPath);
+            }
+
+            if (chunk.size() >= chunkLimit
+                || (!chunk.isEmpty() && flushTimer.elapsed() >= FLUSH_INTERVAL_MS)) {
+                flush();
+            }
+        }
+    }
+
+    const bool cancelled = m_cancelled.load();
+    if (!cancelled) {
+        flush();
+    }
+
+    m_running.store(false);
+    emit scanFinished(totalEntries, cancelled);
+}
+
+QList<QRegularExpression> DirectoryScanner::compileFilters(const QStringList &nameFilters)
+{
+    QList<QRegularExpression> filters;
+    for (const QString &pattern : nameFilters) {
+        if (pattern.isEmpty() || pattern == "*" || pattern == "*.*") {
+            return QList<QRegularExpression>();
+        }
+        filters.append(QRegularExpression(QRegularExpression::wildcardToRegularExpression(pattern),
+                                          QRegularExpression::CaseInsensitiveOption));
+    }
+    return filters;
+}
+
+bool DirectoryScanner::matchesFilters(const QString &fileName, const QList<QRegularExpression> &filters)
+{
+    if (filters.isEmpty()) {
+        return true;
+    }
+    for (const QRegularExpression &filter : filters) {
+        if (filter.match(fileName).hasMatch()) {
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,66 @@
+#ifndef DIRECTORYSCANNER_H
+#define DIRECTORYSCANNER_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QRegularExpression>
+#include <QFuture>
+#include <QtConcurrent>
+
+#include <atomic>
+
+struct DirectoryScanOptions {
+    QStringList nameFilters;        // wildcard patterns applied to file names, e.g. "*.pdf"
+    int maxDepth = -1;              // -1 = unlimited, 0 = only the given directory
+    bool includeFiles = true;
+    bool includeDirectories = false;
+    bool includeHidden = false;
+    bool followSymlinks = false;
+    int chunkSize = 512;
+};
+
+class DirectoryScanner : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DirectoryScanner(QObject *parent = nullptr);
+    ~DirectoryScanner();
+
+    // Scan control
+    bool start(const QString &path, const DirectoryScanOptions &options = DirectoryScanOptions());
+    void cancel();
+    void waitForFinished();
+    bool isRunning() const { return m_running.load(); }
+    bool isCancelled() const { return m_cancelled.load(); }
+
+    // Scan state
+    QString getRootPath() const { return m_rootPath; }
+    DirectoryScanOptions getOptions() const { return m_options; }
+
+signals:
+    void entriesFound(const QStringList &entries);
+    void scanFinished(int totalEntries, bool cancelled);
+    void scanError(const QString &path, const QString &error);
+
+private:
+    // Scan state
+    QString m_rootPath;
+    DirectoryScanOptions m_options;
+    QFuture<void> m_future;
+    std::atomic<bool> m_running;
+    std::atomic<bool> m_cancelled;
+
+    // Methods
+    void runScan(const QString &rootPath, const DirectoryScanOptions &options);
+    static QList<QRegularExpression> compileFilters(const QStringList &nameFilters);
+    static bool matchesFilters(const QString &fileName, const QList<QRegularExpression> &filters);
+
+    // Constants
+    static const int FIRST_CHUNK_SIZE = 32;
+    static const int FLUSH_INTERVAL_MS = 16;
+};
+
+#endif // DIRECTORYSCANNER_H
@@ -48,6 +48,7 @@
 
 #include "mindmapnode.h"
 #include "filemanager.h"
+#include "medialibrary.h"
 
 class DocumentViewer : public QWidget
 {
@@ -61,6 +62,8 @@ public:
     void setSelectedNode(MindMapNode *node);
     MindMapNode* getSelectedNode() const { return m_selectedNode; }
     void clearSelection();
+    void setFileManager(FileManager *fileManager);
+    void setMediaLibrary(MediaLibrary *mediaLibrary);
 
     // File operations
     void addFilePath();
@@ -84,11 +87,14 @@ private slots:
     void onOpenLastPdfClicked();
     void onFilePathDoubleClicked(QListWidgetItem *item);
     void onContextMenuRequested(const QPoint &pos);
+    void onCurrentFilePathChanged(QListWidgetItem *current, QListWidgetItem *previous);
+    void onMediaUsageChanged(const QString &contentHash, int nodeCount);
 
 private:
     // Core components
     MindMapNode *m_selectedNode;
     FileManager *m_fileManager;
+    MediaLibrary *m_mediaLibrary = nullptr;
 
     // UI components
     QVBoxLayout *m_mainLayout;
@@ -100,12 +106,14 @@ private:
     QFrame *m_lastPdfFrame;
     QLabel *m_lastPdfLabel;
     QPushButton *m_openLastPdfButton2;
+    QLabel *m_usageLabel = nullptr; // created by setMediaLibrary()
 
     // Methods
     void setupUI();
     void setupConnections();
     void updateFilePathList();
     void updateLastPdfSection();
+    void updateUsageLabel();
     void showContextMenu(const QPoint &pos, const QString &filePathId);
     void createFilePathItem(const QString &id, const QString &path, const QString &name);
     void removeFilePathItem(const QString &id);
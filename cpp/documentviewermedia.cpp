@@ -0,0 +1,57 @@
+#include "documentviewer.h"
+
+// DocumentViewer's link to the shared media records: the "used by N nodes"
+// line under the file list. The rest of the viewer is documentviewer.cpp.
+
+void DocumentViewer::setFileManager(FileManager *fileManager)
+{
+    m_fileManager = fileManager;
+    refreshView();
+}
+
+void DocumentViewer::setMediaLibrary(MediaLibrary *mediaLibrary)
+{
+    if (m_mediaLibrary) {
+        disconnect(m_mediaLibrary, nullptr, this, nullptr);
+    }
+    m_mediaLibrary = mediaLibrary;
+
+    if (!m_usageLabel) {
+        m_usageLabel = new QLabel(this);
+        m_usageLabel->setVisible(false);
+        m_mainLayout->addWidget(m_usageLabel);
+        connect(m_filePathList, &QListWidget::currentItemChanged, this, &DocumentViewer::onCurrentFilePathChanged);
+    }
+    if (m_mediaLibrary) {
+        connect(m_mediaLibrary, &MediaLibrary::usageChanged, this, &DocumentViewer::onMediaUsageChanged);
+    }
+    updateUsageLabel();
+}
+
+void DocumentViewer::onCurrentFilePathChanged(QListWidgetItem *current, QListWidgetItem *previous)
+{
+    Q_UNUSED(current);
+    Q_UNUSED(previous);
+    updateUsageLabel();
+}
+
+void DocumentViewer::onMediaUsageChanged(const QString &contentHash, int nodeCount)
+{
+    Q_UNUSED(nodeCount);
+    QListWidgetItem *item = m_filePathList->currentItem();
+    if (item && m_mediaLibrary->getContentHashForPath(getFilePathFromItem(item)) == contentHash) {
+        updateUsageLabel();
+    }
+}
+
+void DocumentViewer::updateUsageLabel()
+{
+    if (!m_usageLabel) {
+        return;
+    }
+    QListWidgetItem *item = m_filePathList->currentItem();
+    const int nodeCount = (item && m_mediaLibrary)
+        ? m_mediaLibrary->getUsageCountForPath(getFilePathFromItem(item)) : 0;
+    m_usageLabel->setText(nodeCount == 1 ? QString("Used by 1 node") : QString("Used by %1 nodes").arg(nodeCount));
+    m_usageLabel->setVisible(nodeCount > 0);
+}
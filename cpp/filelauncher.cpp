@@ -0,0 +1,245 @@
+#include "filelauncher.h"
+#include "tracelog.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QProcess>
+#include <QStandardPaths>
+#include <QStringList>
+
+#include <utility>
+
+FileLauncher::FileLauncher(QObject *parent)
+    : QObject(parent)
+    , m_nextRequestId(1)
+    , m_timeoutTimer(nullptr)
+    , m_timeoutMs(DEFAULT_TIMEOUT_MS)
+    , m_dedupWindowMs(DEFAULT_DEDUP_WINDOW_MS)
+{
+    m_pool.setMaxThreadCount(MAX_CONCURRENT_LAUNCHES);
+
+    m_timeoutTimer = new QTimer(this);
+    m_timeoutTimer->setInterval(TIMEOUT_CHECK_INTERVAL_MS);
+    connect(m_timeoutTimer, &QTimer::timeout, this, &FileLauncher::onTimeoutCheck);
+}
+
+FileLauncher::~FileLauncher()
+{
+    m_pool.waitForDone();
+
+    const QList<quint64> pending = m_requests.keys();
+    for (quint64 requestId : pending) {
+        complete(requestId, false, "Launcher shut down");
+    }
+}
+
+quint64 FileLauncher::open(const QString &filePath, const QString &application)
+{
+    const QString key = dedupKey(filePath, application);
+
+    // A repeated open of the same file while the first is still launching
+    // joins that request instead of spawning a second viewer.
+    auto inFlight = m_inFlightByPath.constFind(key);
+    if (inFlight != m_inFlightByPath.constEnd()) {
+        return inFlight.value();
+    }
+
+    // Just after a successful launch, the repeat gets its own id and its
+    // own fileOpened, answered by the launch that already happened.
+    pruneRecent();
+    auto recent = m_recentByPath.find(key);
+    if (recent != m_recentByPath.end()) {
+        const quint64 requestId = m_nextRequestId++;
+        recent.value().joinedIds.append(requestId);
+        QMetaObject::invokeMethod(this, [this, requestId, filePath]() {
+            emit fileOpened(requestId, filePath);
+        }, Qt::QueuedConnection);
+        return requestId;
+    }
+
+    LaunchRequest request;
+    request.id = m_nextRequestId++;
+    request.filePath = filePath;
+    request.application = application;
+    request.age.start();
+    request.promise.reset(new QPromise<bool>());
+    request.promise->start();
+    request.future = request.promise->future();
+
+    const quint64 requestId = request.id;
+    m_requests.insert(requestId, request);
+    m_inFlightByPath.insert(key, requestId);
+
+    if (!m_timeoutTimer->isActive()) {
+        m_timeoutTimer->start();
+    }
+
+    if (application.isEmpty() && !QFileInfo::exists(filePath)) {
+        QMetaObject::invokeMethod(this, [this, requestId]() {
+            onLaunchFinished(requestId, false, "File does not exist");
+        }, Qt::QueuedConnection);
+        return requestId;
+    }
+
+    // A retry after a timeout waits for the launch that timed out rather
+    // than starting another one, which would open a second viewer if the
+    // first was only slow.
+    if (!m_abandonedByPath.contains(key)) {
+        startWorker(requestId, filePath, application);
+    }
+    return requestId;
+}
+
+void FileLauncher::startWorker(quint64 requestId, const QString &filePath, const QString &application)
+{
+    m_requests[requestId].hasWorker = true;
+    m_pool.start([this, requestId, filePath, application]() {
+        QString error;
+        const bool success = launch(filePath, application, error);
+        QMetaObject::invokeMethod(this, [this, requestId, success, error]() {
+            onLaunchFinished(requestId, success, error);
+        }, Qt::QueuedConnection);
+    });
+}
+
+QFuture<bool> FileLauncher::future(quint64 requestId) const
+{
+    auto it = m_requests.constFind(requestId);
+    if (it != m_requests.constEnd()) {
+        return it.value().future;
+    }
+    for (const RecentLaunch &recent : m_recentByPath) {
+        if (recent.requestId == requestId || recent.joinedIds.contains(requestId)) {
+            return recent.future;
+        }
+    }
+    return QFuture<bool>();
+}
+
+void FileLauncher::onLaunchFinished(quint64 requestId, bool success, const QString &error)
+{
+    // A launch that timed out has already been reported as failed. Its late
+    // result answers whichever retry is waiting on it, and otherwise is
+    // dropped rather than counted as a new launch.
+    for (auto it = m_abandonedByPath.begin(); it != m_abandonedByPath.end(); ++it) {
+        if (it.value() != requestId) {
+            continue;
+        }
+        const QString key = it.key();
+        m_abandonedByPath.erase(it);
+        m_pool.setMaxThreadCount(MAX_CONCURRENT_LAUNCHES + m_abandonedByPath.size());
+
+        const quint64 waitingId = m_inFlightByPath.value(key);
+        if (waitingId != 0 && !m_requests.value(waitingId).hasWorker) {
+            complete(waitingId, success, error);
+        }
+        return;
+    }
+    complete(requestId, success, error);
+}
+
+void FileLauncher::onTimeoutCheck()
+{
+    QList<quint64> expired;
+    for (auto it = m_requests.constBegin(); it != m_requests.constEnd(); ++it) {
+        if (it.value().age.elapsed() >= m_timeoutMs) {
+            expired.append(it.key());
+        }
+    }
+
+    // A launch cannot be called back, so a timed-out one is abandoned: it
+    // keeps its worker, the pool grows by one thread so it doesn't hold up
+    // other opens, and its path stays busy until it returns.
+    for (quint64 requestId : std::as_const(expired)) {
+        const LaunchRequest request = m_requests.value(requestId);
+        if (request.hasWorker) {
+            m_abandonedByPath.insert(dedupKey(request.filePath, request.application), requestId);
+            m_pool.setMaxThreadCount(MAX_CONCURRENT_LAUNCHES + m_abandonedByPath.size());
+        }
+        complete(requestId, false, QString("Launch timed out after %1 ms").arg(m_timeoutMs));
+    }
+
+    if (m_requests.isEmpty()) {
+        m_timeoutTimer->stop();
+    }
+}
+
+void FileLauncher::complete(quint64 requestId, bool success, const QString &error)
+{
+    auto it = m_requests.find(requestId);
+    if (it == m_requests.end()) {
+        return;
+    }
+    LaunchRequest request = it.value();
+    m_requests.erase(it);
+
+    const QString key = dedupKey(request.filePath, request.application);
+    if (m_inFlightByPath.value(key) == requestId) {
+        m_inFlightByPath.remove(key);
+    }
+
+    request.promise->addResult(success);
+    request.promise->finish();
+
+    if (success) {
+        RecentLaunch recent;
+        recent.requestId = requestId;
+        recent.age.start();
+        recent.future = request.future;
+        m_recentByPath.insert(key, recent);
+        emit fileOpened(requestId, request.filePath);
+    } else {
+        emit fileOpenFailed(requestId, request.filePath, error);
+    }
+}
+
+void FileLauncher::pruneRecent()
+{
+    for (auto it = m_recentByPath.begin(); it != m_recentByPath.end();) {
+        if (it.value().age.elapsed() >= m_dedupWindowMs) {
+            it = m_recentByPath.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+bool FileLauncher::launch(const QString &filePath, const QString &application, QString &error)
+{
+    TRACE_SCOPE("FileLauncher::launch");
+    QString program = application;
+    QStringList arguments;
+
+    if (program.isEmpty()) {
+#if defined(Q_OS_WIN)
+        program = "explorer.exe";
+        arguments << QDir::toNativeSeparators(QFileInfo(filePath).absoluteFilePath());
+#elif defined(Q_OS_MACOS)
+        program = "open";
+        arguments << QFileInfo(filePath).absoluteFilePath();
+#else
+        program = QStandardPaths::findExecutable("xdg-open");
+        arguments << QFileInfo(filePath).absoluteFilePath();
+#endif
+    } else {
+        arguments << QFileInfo(filePath).absoluteFilePath();
+    }
+
+    if (program.isEmpty()) {
+        error = "No application available to open the file";
+        return false;
+    }
+
+    // startDetached never waits on the child, so a slow viewer cannot hold
+    // up the queue.
+    if (!QProcess::startDetached(program, arguments)) {
+        error = "Could not start " + program;
+        return false;
+    }
+    return true;
+}
+
+QString FileLauncher::dedupKey(const QString &filePath, const QString &application)
+{
+    return application + '\n' + QDir::cleanPath(QFileInfo(filePath).absoluteFilePath());
+}
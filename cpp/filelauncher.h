@@ -0,0 +1,90 @@
+#ifndef FILELAUNCHER_H
+#define FILELAUNCHER_H
+
+#include <QObject>
+#include <QString>
+#include <QHash>
+#include <QSharedPointer>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QThreadPool>
+#include <QFuture>
+#include <QPromise>
+#include <QtConcurrent>
+
+#include <atomic>
+
+class FileLauncher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FileLauncher(QObject *parent = nullptr);
+    ~FileLauncher();
+
+    // Launch queue. Opening a file that is still launching returns that
+    // request's id; opening one that launched within the dedup window
+    // returns a new id whose fileOpened is emitted without a second launch.
+    quint64 open(const QString &filePath, const QString &application = QString());
+    QFuture<bool> future(quint64 requestId) const;
+    bool isPending(quint64 requestId) const { return m_requests.contains(requestId); }
+    int pendingCount() const { return m_requests.size(); }
+
+    // Tuning
+    void setTimeout(int milliseconds) { m_timeoutMs = milliseconds; }
+    int getTimeout() const { return m_timeoutMs; }
+    void setDedupWindow(int milliseconds) { m_dedupWindowMs = milliseconds; }
+    int getDedupWindow() const { return m_dedupWindowMs; }
+
+signals:
+    void fileOpened(quint64 requestId, const QString &filePath);
+    void fileOpenFailed(quint64 requestId, const QString &filePath, const QString &error);
+
+private slots:
+    void onLaunchFinished(quint64 requestId, bool success, const QString &error);
+    void onTimeoutCheck();
+
+private:
+    struct LaunchRequest {
+        quint64 id = 0;
+        QString filePath;
+        QString application;
+        QElapsedTimer age;
+        QSharedPointer<QPromise<bool>> promise;
+        QFuture<bool> future;
+        bool hasWorker = false;     // false while waiting on an abandoned launch
+    };
+
+    struct RecentLaunch {
+        quint64 requestId = 0;
+        QList<quint64> joinedIds;   // later opens answered by this launch
+        QElapsedTimer age;
+        QFuture<bool> future;
+    };
+
+    // Queue state
+    QHash<quint64, LaunchRequest> m_requests;
+    QHash<QString, quint64> m_inFlightByPath;
+    QHash<QString, RecentLaunch> m_recentByPath;
+    QHash<QString, quint64> m_abandonedByPath;  // timed out, worker still running
+    quint64 m_nextRequestId;
+    QThreadPool m_pool;
+    QTimer *m_timeoutTimer;
+    int m_timeoutMs;
+    int m_dedupWindowMs;
+
+    // Methods
+    void startWorker(quint64 requestId, const QString &filePath, const QString &application);
+    void complete(quint64 requestId, bool success, const QString &error);
+    void pruneRecent();
+    static bool launch(const QString &filePath, const QString &application, QString &error);
+    static QString dedupKey(const QString &filePath, const QString &application);
+
+    // Constants
+    static const int DEFAULT_TIMEOUT_MS = 10000;
+    static const int DEFAULT_DEDUP_WINDOW_MS = 1500;
+    static const int TIMEOUT_CHECK_INTERVAL_MS = 250;
+    static const int MAX_CONCURRENT_LAUNCHES = 2;
+};
+
+#endif // FILELAUNCHER_H
@@ -112,15 +112,10 @@
 #include <QOpenGLVersionFunctionsFactory>
 
 #include "mindmapnode.h"
-
-struct FilePath {
-    QString id;
-    QString path;
-    QString name;
-    QString type; // "image" or "document"
-    qint64 size;
-    qint64 lastModified;
-};
+#include "directoryscanner.h"
+#include "filepathregistry.h"
+#include "filetransferengine.h"
+#include "filelauncher.h"
 
 class FileManager : public QObject
 {
@@ -130,21 +125,32 @@ public:
     explicit FileManager(QObject *parent = nullptr);
     ~FileManager();
 
+    // Creates the background services below (filemanagerservices.cpp).
+    // MainWindow calls it once, right after construction.
+    void setupServices();
+
     // File path management
     void addFilePath(const FilePath &filePath);
     void removeFilePath(const QString &id);
     FilePath getFilePath(const QString &id) const;
+    FilePath getFilePathByPath(const QString &path) const;
+    bool hasFilePath(const QString &path) const;
     QList<FilePath> getAllFilePaths() const;
     QString getLastOpenedPdf() const { return m_lastOpenedPdf; }
     void setLastOpenedPdf(const QString &path);
 
-    // File operations
+    // File operations. Opens are queued on the FileLauncher and never block;
+    // the bool only reports whether the request was accepted, the outcome
+    // arrives through fileOpened/fileOpenFailed.
     bool openFile(const QString &filePath);
     bool openFileWithDefaultApplication(const QString &filePath);
     bool openPdfFile(const QString &filePath);
     bool openImageFile(const QString &filePath);
     bool openDocumentFile(const QString &filePath);
     bool openLastPdf();
+    quint64 requestOpen(const QString &filePath, const QString &application = QString()); // 0 if refused
+    QFuture<bool> openFuture(quint64 requestId) const;
+    FileLauncher* getLauncher() const { return m_launcher; }
 
     // File utilities
     QString getFileType(const QString &filePath) const;
@@ -182,11 +188,21 @@ public:
     // File system operations
     bool copyFile(const QString &sourcePath, const QString &destinationPath) const;
     bool moveFile(const QString &sourcePath, const QString &destinationPath) const;
+    // Background variants for large attachments; progress and completion are
+    // reported through getTransferEngine()'s signals.
+    quint64 copyFileAsync(const QString &sourcePath, const QString &destinationPath, bool overwrite = false);
+    quint64 moveFileAsync(const QString &sourcePath, const QString &destinationPath, bool overwrite = false);
+    void cancelTransfer(quint64 transferId);
+    FileTransferEngine* getTransferEngine() const { return m_transferEngine; }
     bool deleteFile(const QString &filePath) const;
     bool createDirectory(const QString &path) const;
     bool removeDirectory(const QString &path) const;
     QStringList getFilesInDirectory(const QString &path, const QStringList &filters = QStringList()) const;
     QStringList getSubdirectories(const QString &path) const;
+    // Streaming variant of the two above: entries arrive in chunks through
+    // DirectoryScanner::entriesFound while the walk runs off the GUI thread.
+    DirectoryScanner* scanDirectory(const QString &path,
+                                    const DirectoryScanOptions &options = DirectoryScanOptions());
 
     // Settings
     void saveSettings();
@@ -205,20 +221,24 @@ public:
     bool isAudioFile(const QString &filePath) const;
     bool isArchiveFile(const QString &filePath) const;
 
+    // Memory accounting: the path registry, as FileCaches. The registry is
+    // created by setupServices(), which MainWindow runs before its probe.
+    void measureMemory(MemoryLedger::Sample &sample) const { m_filePathRegistry->measureMemory(sample); }
+
 signals:
-    void fileOpened(const QString &filePath);
-    void fileOpenFailed(const QString &filePath, const QString &error);
+    void fileOpened(quint64 requestId, const QString &filePath);
+    void fileOpenFailed(quint64 requestId, const QString &filePath, const QString &error);
     void filePathAdded(const FilePath &filePath);
     void filePathRemoved(const QString &id);
     void lastPdfChanged(const QString &path);
 
 private slots:
-    void onFileOpenFinished();
-    void onFileOpenError();
+    void onFileOpenFinished(quint64 requestId, const QString &filePath);
+    void onFileOpenError(quint64 requestId, const QString &filePath, const QString &error);
 
 private:
-    // File paths storage
-    QList<FilePath> m_filePaths;
+    // File paths storage (hash-indexed, persisted through a write-behind journal)
+    FilePathRegistry *m_filePathRegistry = nullptr;
     QString m_lastOpenedPdf;
 
     // Settings
@@ -226,14 +246,14 @@ private:
 
     // File operations
     QMimeDatabase m_mimeDatabase;
-    QFutureWatcher<bool> *m_fileOpenWatcher;
+    FileLauncher *m_launcher = nullptr;
+    FileTransferEngine *m_transferEngine = nullptr;
 
     // Methods
     void setupSettings();
-    void setupFileWatcher();
-    bool openFileInternal(const QString &filePath);
+    void migrateLegacyFilePaths();
+    void setupLauncher();
     QString getDefaultApplication(const QString &mimeType) const;
-    bool launchApplication(const QString &application, const QString &filePath) const;
     void updateLastOpenedPdf(const QString &filePath);
     QString getSettingsKey(const QString &key) const;
     void setSettingsKey(const QString &key, const QVariant &value);
@@ -243,7 +263,8 @@ private:
     // Constants
     static const QString SETTINGS_GROUP_FILE_PATHS;
     static const QString SETTINGS_KEY_LAST_PDF;
-    static const QString SETTINGS_KEY_FILE_PATHS;
+    static const QString SETTINGS_KEY_FILE_PATHS;   // legacy list, read once by migrateLegacyFilePaths()
+    static const char FILE_PATH_STORE[];            // registry journal, in the app data directory
     static const qint64 MAX_FILE_SIZE = 100 * 1024 * 1024; // 100MB
     static const int THUMBNAIL_SIZE = 100;
     static const QStringList IMAGE_EXTENSIONS;
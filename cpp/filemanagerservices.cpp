@@ -0,0 +1,180 @@
+#include "filemanager.h"
+
+// FileManager's background services: the directory scanner, path registry,
+// transfer engine and launcher. Kept apart from filemanager.cpp, which
+// holds the synchronous file utilities.
+
+const char FileManager::FILE_PATH_STORE[] = "filepaths.journal";
+
+void FileManager::setupServices()
+{
+    const QString dataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QDir().mkpath(dataPath);
+    m_filePathRegistry = new FilePathRegistry(this);
+    m_filePathRegistry->setStorePath(QDir(dataPath).filePath(FILE_PATH_STORE));
+    if (!m_filePathRegistry->load()) {
+        qWarning("FileManager: could not read the file path store");
+    }
+    migrateLegacyFilePaths();
+
+    m_transferEngine = new FileTransferEngine(this);
+    setupLauncher();
+}
+
+void FileManager::setupLauncher()
+{
+    m_launcher = new FileLauncher(this);
+    connect(m_launcher, &FileLauncher::fileOpened, this, &FileManager::onFileOpenFinished);
+    connect(m_launcher, &FileLauncher::fileOpenFailed, this, &FileManager::onFileOpenError);
+}
+
+// File path management
+
+void FileManager::addFilePath(const FilePath &filePath)
+{
+    if (m_filePathRegistry->add(filePath)) {
+        emit filePathAdded(filePath);
+    }
+}
+
+void FileManager::removeFilePath(const QString &id)
+{
+    if (m_filePathRegistry->remove(id)) {
+        emit filePathRemoved(id);
+    }
+}
+
+FilePath FileManager::getFilePath(const QString &id) const
+{
+    return m_filePathRegistry->get(id);
+}
+
+FilePath FileManager::getFilePathByPath(const QString &path) const
+{
+    return m_filePathRegistry->getByPath(path);
+}
+
+bool FileManager::hasFilePath(const QString &path) const
+{
+    return m_filePathRegistry->containsPath(path);
+}
+
+QList<FilePath> FileManager::getAllFilePaths() const
+{
+    return m_filePathRegistry->getAll();
+}
+
+// Older versions kept the whole list as one JSON array in the settings and
+// rewrote it on every change. It is imported once, then dropped.
+void FileManager::migrateLegacyFilePaths()
+{
+    const QByteArray legacy = getSettingsValue(SETTINGS_KEY_FILE_PATHS).toByteArray();
+    if (legacy.isEmpty()) {
+        return;
+    }
+
+    QList<FilePath> filePaths;
+    const QJsonArray array = QJsonDocument::fromJson(legacy).array();
+    for (const QJsonValue &value : array) {
+        const QJsonObject object = value.toObject();
+        FilePath filePath;
+        filePath.id = object["id"].toString();
+        filePath.path = object["path"].toString();
+        filePath.name = object["name"].toString();
+        filePath.type = object["type"].toString();
+        filePath.size = object["size"].toVariant().toLongLong();
+        filePath.lastModified = object["lastModified"].toVariant().toLongLong();
+        filePaths.append(filePath);
+    }
+    m_filePathRegistry->importLegacy(filePaths);
+    m_filePathRegistry->flush();
+    m_settings->remove(getSettingsKey(SETTINGS_KEY_FILE_PATHS));
+}
+
+// Opening files
+
+quint64 FileManager::requestOpen(const QString &filePath, const QString &application)
+{
+    if (!fileExists(filePath)) {
+        return 0;
+    }
+    return m_launcher->open(filePath, application);
+}
+
+QFuture<bool> FileManager::openFuture(quint64 requestId) const
+{
+    return m_launcher->future(requestId);
+}
+
+bool FileManager::openFile(const QString &filePath)
+{
+    return requestOpen(filePath) != 0;
+}
+
+bool FileManager::openFileWithDefaultApplication(const QString &filePath)
+{
+    return requestOpen(filePath) != 0;
+}
+
+bool FileManager::openPdfFile(const QString &filePath)
+{
+    return requestOpen(filePath) != 0;
+}
+
+bool FileManager::openImageFile(const QString &filePath)
+{
+    return requestOpen(filePath) != 0;
+}
+
+bool FileManager::openDocumentFile(const QString &filePath)
+{
+    return requestOpen(filePath) != 0;
+}
+
+bool FileManager::openLastPdf()
+{
+    return !m_lastOpenedPdf.isEmpty() && openPdfFile(m_lastOpenedPdf);
+}
+
+void FileManager::onFileOpenFinished(quint64 requestId, const QString &filePath)
+{
+    // Only a PDF that actually opened becomes the one openLastPdf() reopens
+    if (isPdfFile(filePath)) {
+        updateLastOpenedPdf(filePath);
+    }
+    emit fileOpened(requestId, filePath);
+}
+
+void FileManager::onFileOpenError(quint64 requestId, const QString &filePath, const QString &error)
+{
+    emit fileOpenFailed(requestId, filePath, error);
+}
+
+// Background transfers
+
+quint64 FileManager::copyFileAsync(const QString &sourcePath, const QString &destinationPath, bool overwrite)
+{
+    return m_transferEngine->copyFile(sourcePath, destinationPath, overwrite);
+}
+
+quint64 FileManager::moveFileAsync(const QString &sourcePath, const QString &destinationPath, bool overwrite)
+{
+    return m_transferEngine->moveFile(sourcePath, destinationPath, overwrite);
+}
+
+void FileManager::cancelTransfer(quint64 transferId)
+{
+    m_transferEngine->cancel(transferId);
+}
+
+DirectoryScanner* FileManager::scanDirectory(const QString &path, const DirectoryScanOptions &options)
+{
+    // Started on the next event-loop pass, so the caller can connect to the
+    // scanner before any entries (or a scanError) are emitted. The caller
+    // owns the scanner and deletes it after scanFinished.
+    DirectoryScanner *scanner = new DirectoryScanner(this);
+    QTimer::singleShot(0, scanner, [scanner, path, options]() {
+        scanner->start(path, options);
+    });
+    return scanner;
+}
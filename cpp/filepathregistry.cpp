@@ -0,0 +1,354 @@
+#include "filepathregistry.h"
+#include "tracelog.h"
+
+#include <QBuffer>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+QDataStream &operator<<(QDataStream &stream, const FilePath &filePath)
+{
+    stream << filePath.id << filePath.path << filePath.name << filePath.type
+           << filePath.size << filePath.lastModified;
+    return stream;
+}
+
+QDataStream &operator>>(QDataStream &stream, FilePath &filePath)
+{
+    stream >> filePath.id >> filePath.path >> filePath.name >> filePath.type
+           >> filePath.size >> filePath.lastModified;
+    return stream;
+}
+
+FilePathRegistry::FilePathRegistry(QObject *parent)
+    : QObject(parent)
+    , m_journalRecords(0)
+    , m_flushTimer(nullptr)
+{
+    // A single writer thread keeps journal appends in submission order.
+    m_writerPool.setMaxThreadCount(1);
+
+    m_flushTimer = new QTimer(this);
+    m_flushTimer->setSingleShot(true);
+    m_flushTimer->setInterval(FLUSH_DELAY_MS);
+    connect(m_flushTimer, &QTimer::timeout, this, &FilePathRegistry::onFlushTimeout);
+
+    QString dataDir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    m_storePath = QDir(dataDir).filePath("filepaths.journal");
+}
+
+FilePathRegistry::~FilePathRegistry()
+{
+    flush();
+    m_writerPool.waitForDone();
+}
+
+bool FilePathRegistry::add(const FilePath &filePath)
+{
+    if (filePath.id.isEmpty()) {
+        return false;
+    }
+
+    const QString key = normalizePath(filePath.path);
+    const QString existingId = m_idByPath.value(key);
+    if (!existingId.isEmpty() && existingId != filePath.id) {
+        return false;
+    }
+
+    insertEntry(filePath);
+    appendRecord(RecordAdd, filePath);
+    return true;
+}
+
+bool FilePathRegistry::remove(const QString &id)
+{
+    if (!removeEntry(id)) {
+        return false;
+    }
+
+    FilePath removed;
+    removed.id = id;
+    appendRecord(RecordRemove, removed);
+    return true;
+}
+
+void FilePathRegistry::clear()
+{
+    m_entries.clear();
+    m_indexById.clear();
+    m_idByPath.clear();
+
+    // Clearing is cheaper to persist as an empty snapshot than as a run of
+    // remove records.
+    m_pendingRecords.clear();
+    m_journalRecords = 0;
+    const QString storePath = m_storePath;
+    const QByteArray snapshot = serializeSnapshot();
+    QtConcurrent::run(&m_writerPool, [this, storePath, snapshot]() {
+        if (replaceFile(storePath, snapshot)) {
+            emit persisted();
+        } else {
+            emit persistFailed("Could not write " + storePath);
+        }
+    });
+}
+
+FilePath FilePathRegistry::get(const QString &id) const
+{
+    auto it = m_indexById.constFind(id);
+    if (it == m_indexById.constEnd()) {
+        return FilePath();
+    }
+    return m_entries.at(it.value());
+}
+
+FilePath FilePathRegistry::getByPath(const QString &path) const
+{
+    return get(m_idByPath.value(normalizePath(path)));
+}
+
+QList<FilePath> FilePathRegistry::getAll() const
+{
+    return QList<FilePath>(m_entries.cbegin(), m_entries.cend());
+}
+
+void FilePathRegistry::measureMemory(MemoryLedger::Sample &sample) const
+{
+    qint64 bytes = m_entries.capacity() * qint64(sizeof(FilePath)) + m_pendingRecords.capacity();
+    for (const FilePath &filePath : m_entries) {
+        bytes += MemoryLedger::stringBytes(filePath.id) + MemoryLedger::stringBytes(filePath.path)
+                 + MemoryLedger::stringBytes(filePath.name) + MemoryLedger::stringBytes(filePath.type);
+    }
+    // m_indexById keys share the entries' id strings; m_idByPath holds
+    // normalized copies of the paths.
+    bytes += m_indexById.size() * qint64(sizeof(QString) + sizeof(int) + MemoryLedger::HASH_NODE_OVERHEAD);
+    for (auto it = m_idByPath.constBegin(); it != m_idByPath.constEnd(); ++it) {
+        bytes += 2 * sizeof(QString) + MemoryLedger::HASH_NODE_OVERHEAD + MemoryLedger::stringBytes(it.key());
+    }
+    sample.add(MemoryLedger::FileCaches, bytes, m_entries.size());
+}
+
+void FilePathRegistry::setStorePath(const QString &storePath)
+{
+    flush();
+    m_storePath = storePath;
+}
+
+bool FilePathRegistry::load()
+{
+    TRACE_SCOPE("FilePathRegistry::load");
+    m_entries.clear();
+    m_indexById.clear();
+    m_idByPath.clear();
+    m_pendingRecords.clear();
+    m_journalRecords = 0;
+
+    QFile file(m_storePath);
+    if (!file.exists()) {
+        return true;
+    }
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_15);
+
+    quint32 magic = 0;
+    quint16 version = 0;
+    stream >> magic >> version;
+    if (magic != STORE_MAGIC || version != STORE_VERSION) {
+        return false;
+    }
+
+    bool truncated = false;
+    while (!stream.atEnd()) {
+        quint8 type = 0;
+        FilePath filePath;
+        stream >> type;
+        if (type == RecordAdd) {
+            stream >> filePath;
+        } else if (type == RecordRemove) {
+            stream >> filePath.id;
+        }
+
+        // A torn tail from an interrupted append is dropped; everything
+        // before it is still valid.
+        if (stream.status() != QDataStream::Ok || (type != RecordAdd && type != RecordRemove)) {
+            truncated = true;
+            break;
+        }
+
+        if (type == RecordAdd) {
+            insertEntry(filePath);
+        } else {
+            removeEntry(filePath.id);
+        }
+        ++m_journalRecords;
+    }
+
+    if (truncated) {
+        m_journalRecords = COMPACTION_MIN_RECORDS + 2 * m_entries.size() + 1;
+        scheduleFlush();
+    }
+    return true;
+}
+
+void FilePathRegistry::flush()
+{
+    TRACE_SCOPE("FilePathRegistry::flush");
+    m_flushTimer->stop();
+
+    const QString storePath = m_storePath;
+    if (needsCompaction()) {
+        const QByteArray snapshot = serializeSnapshot();
+        m_pendingRecords.clear();
+        m_journalRecords = m_entries.size();
+        QtConcurrent::run(&m_writerPool, [this, storePath, snapshot]() {
+            if (replaceFile(storePath, snapshot)) {
+                emit persisted();
+            } else {
+                emit persistFailed("Could not write " + storePath);
+            }
+        });
+        return;
+    }
+
+    if (m_pendingRecords.isEmpty()) {
+        return;
+    }
+
+    const QByteArray records = m_pendingRecords;
+    m_pendingRecords.clear();
+    QtConcurrent::run(&m_writerPool, [this, storePath, records]() {
+        if (appendToFile(storePath, records)) {
+            emit persisted();
+        } else {
+            emit persistFailed("Could not append to " + storePath);
+        }
+    });
+}
+
+void FilePathRegistry::importLegacy(const QList<FilePath> &filePaths)
+{
+    for (const FilePath &filePath : filePaths) {
+        add(filePath);
+    }
+}
+
+void FilePathRegistry::onFlushTimeout()
+{
+    flush();
+}
+
+void FilePathRegistry::insertEntry(const FilePath &filePath)
+{
+    const QString key = normalizePath(filePath.path);
+    auto it = m_indexById.constFind(filePath.id);
+    if (it != m_indexById.constEnd()) {
+        FilePath &existing = m_entries[it.value()];
+        m_idByPath.remove(normalizePath(existing.path));
+        existing = filePath;
+    } else {
+        m_indexById.insert(filePath.id, m_entries.size());
+        m_entries.append(filePath);
+    }
+    m_idByPath.insert(key, filePath.id);
+}
+
+bool FilePathRegistry::removeEntry(const QString &id)
+{
+    auto it = m_indexById.find(id);
+    if (it == m_indexById.end()) {
+        return false;
+    }
+
+    const int index = it.value();
+    m_indexById.erase(it);
+    m_idByPath.remove(normalizePath(m_entries.at(index).path));
+
+    const int lastIndex = m_entries.size() - 1;
+    if (index != lastIndex) {
+        m_entries[index] = m_entries.at(lastIndex);
+        m_indexById[m_entries.at(index).id] = index;
+    }
+    m_entries.removeLast();
+    return true;
+}
+
+void FilePathRegistry::appendRecord(RecordType type, const FilePath &filePath)
+{
+    QDataStream stream(&m_pendingRecords, QIODevice::WriteOnly | QIODevice::Append);
+    stream.setVersion(QDataStream::Qt_5_15);
+    stream << static_cast<quint8>(type);
+    if (type == RecordAdd) {
+        stream << filePath;
+    } else {
+        stream << filePath.id;
+    }
+    ++m_journalRecords;
+    scheduleFlush();
+}
+
+void FilePathRegistry::scheduleFlush()
+{
+    // Debounce: a burst of edits collapses into one background write.
+    m_flushTimer->start();
+}
+
+bool FilePathRegistry::needsCompaction() const
+{
+    return m_journalRecords > COMPACTION_MIN_RECORDS && m_journalRecords > 2 * m_entries.size();
+}
+
+QByteArray FilePathRegistry::serializeSnapshot() const
+{
+    QByteArray snapshot;
+    QDataStream stream(&snapshot, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_15);
+    stream << STORE_MAGIC << STORE_VERSION;
+    for (const FilePath &filePath : m_entries) {
+        stream << static_cast<quint8>(RecordAdd) << filePath;
+    }
+    return snapshot;
+}
+
+QString FilePathRegistry::normalizePath(const QString &path)
+{
+    return QDir::cleanPath(QFileInfo(path).absoluteFilePath());
+}
+
+bool FilePathRegistry::appendToFile(const QString &storePath, const QByteArray &records)
+{
+    QDir().mkpath(QFileInfo(storePath).absolutePath());
+
+    QFile file(storePath);
+    const bool isNew = !file.exists() || file.size() == 0;
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        return false;
+    }
+
+    if (isNew) {
+        QDataStream header(&file);
+        header.setVersion(QDataStream::Qt_5_15);
+        header << STORE_MAGIC << STORE_VERSION;
+    }
+    return file.write(records) == records.size() && file.flush();
+}
+
+bool FilePathRegistry::replaceFile(const QString &storePath, const QByteArray &contents)
+{
+    QDir().mkpath(QFileInfo(storePath).absolutePath());
+
+    QSaveFile file(storePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    if (file.write(contents) != contents.size()) {
+        file.cancelWriting();
+        return false;
+    }
+    return file.commit();
+}
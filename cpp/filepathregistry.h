@@ -0,0 +1,103 @@
+#ifndef FILEPATHREGISTRY_H
+#define FILEPATHREGISTRY_H
+
+#include <QObject>
+#include <QString>
+#include <QList>
+#include <QVector>
+#include <QHash>
+#include <QByteArray>
+#include <QDataStream>
+#include <QTimer>
+#include <QThreadPool>
+#include <QFuture>
+#include <QtConcurrent>
+
+#include "memoryledger.h"
+
+struct FilePath {
+    QString id;
+    QString path;
+    QString name;
+    QString type; // "image" or "document"
+    qint64 size;
+    qint64 lastModified;
+};
+
+QDataStream &operator<<(QDataStream &stream, const FilePath &filePath);
+QDataStream &operator>>(QDataStream &stream, FilePath &filePath);
+
+class FilePathRegistry : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FilePathRegistry(QObject *parent = nullptr);
+    ~FilePathRegistry();
+
+    // Registry
+    bool add(const FilePath &filePath);
+    bool remove(const QString &id);
+    void clear();
+    bool contains(const QString &id) const { return m_indexById.contains(id); }
+    bool containsPath(const QString &path) const { return m_idByPath.contains(normalizePath(path)); }
+    FilePath get(const QString &id) const;
+    FilePath getByPath(const QString &path) const;
+    QList<FilePath> getAll() const;
+    int count() const { return m_entries.size(); }
+
+    // Entries, both indexes and the unflushed journal, as FileCaches
+    void measureMemory(MemoryLedger::Sample &sample) const;
+
+    // Persistence
+    void setStorePath(const QString &storePath);
+    QString getStorePath() const { return m_storePath; }
+    bool load();
+    void flush();
+    void importLegacy(const QList<FilePath> &filePaths);
+
+signals:
+    void persisted();
+    void persistFailed(const QString &error);
+
+private slots:
+    void onFlushTimeout();
+
+private:
+    enum RecordType : quint8 {
+        RecordAdd = 1,
+        RecordRemove = 2
+    };
+
+    // Index: entries are kept densely packed; removal swaps the last entry
+    // into the freed slot so both add and remove stay O(1).
+    QVector<FilePath> m_entries;
+    QHash<QString, int> m_indexById;
+    QHash<QString, QString> m_idByPath;
+
+    // Write-behind journal
+    QString m_storePath;
+    QByteArray m_pendingRecords;
+    int m_journalRecords;
+    QTimer *m_flushTimer;
+    QThreadPool m_writerPool;
+
+    // Methods
+    void insertEntry(const FilePath &filePath);
+    bool removeEntry(const QString &id);
+    void appendRecord(RecordType type, const FilePath &filePath);
+    void scheduleFlush();
+    bool needsCompaction() const;
+    QByteArray serializeSnapshot() const;
+    static QString normalizePath(const QString &path);
+    static bool appendToFile(const QString &storePath, const QByteArray &records);
+    static bool replaceFile(const QString &storePath, const QByteArray &contents);
+
+    // Constants
+    static const quint32 STORE_MAGIC = 0x4D32444A; // "M2DJ"
+    static const quint16 STORE_VERSION = 1;
+    static const int FLUSH_DELAY_MS = 750;
+    static const int COMPACTION_MIN_RECORDS = 256;
+};
+
+#endif // FILEPATHREGISTRY_H
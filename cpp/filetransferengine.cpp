@@ -0,0 +1,357 @@
+#include "filetransferengine.h"
+#include "tracelog.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QTemporaryFile>
+#include <QVector>
+
+#include <utility>
+
+#include <cstdio>
+
+#ifdef Q_OS_UNIX
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#ifdef Q_OS_WIN
+#include <windows.h>
+#endif
+#ifdef Q_OS_LINUX
+#include <stdio.h> // renameat2
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#endif
+
+FileTransferEngine::FileTransferEngine(QObject *parent)
+    : QObject(parent)
+    , m_nextTransferId(1)
+{
+    m_pool.setMaxThreadCount(DEFAULT_CONCURRENT_TRANSFERS);
+}
+
+FileTransferEngine::~FileTransferEngine()
+{
+    cancelAll();
+    waitForDone();
+}
+
+quint64 FileTransferEngine::copyFile(const QString &sourcePath, const QString &destinationPath, bool overwrite)
+{
+    FileTransfer transfer;
+    transfer.sourcePath = sourcePath;
+    transfer.destinationPath = destinationPath;
+    transfer.overwrite = overwrite;
+    return enqueue(transfer);
+}
+
+quint64 FileTransferEngine::moveFile(const QString &sourcePath, const QString &destinationPath, bool overwrite)
+{
+    FileTransfer transfer;
+    transfer.sourcePath = sourcePath;
+    transfer.destinationPath = destinationPath;
+    transfer.move = true;
+    transfer.overwrite = overwrite;
+    return enqueue(transfer);
+}
+
+void FileTransferEngine::cancel(quint64 transferId)
+{
+    QMutexLocker locker(&m_mutex);
+    auto it = m_transfers.constFind(transferId);
+    if (it != m_transfers.constEnd()) {
+        it.value()->cancelled.store(true);
+    }
+}
+
+void FileTransferEngine::cancelAll()
+{
+    QMutexLocker locker(&m_mutex);
+    for (const QSharedPointer<TransferState> &state : std::as_const(m_transfers)) {
+        state->cancelled.store(true);
+    }
+}
+
+void FileTransferEngine::waitForDone()
+{
+    m_pool.waitForDone();
+}
+
+int FileTransferEngine::activeTransferCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_transfers.size();
+}
+
+void FileTransferEngine::setMaxConcurrentTransfers(int count)
+{
+    m_pool.setMaxThreadCount(qMax(1, count));
+}
+
+quint64 FileTransferEngine::enqueue(const FileTransfer &transfer)
+{
+    QSharedPointer<TransferState> state(new TransferState);
+    state->transfer = transfer;
+    state->transfer.id = m_nextTransferId.fetch_add(1);
+
+    {
+        QMutexLocker locker(&m_mutex);
+        m_transfers.insert(state->transfer.id, state);
+    }
+
+    QtConcurrent::run(&m_pool, [this, state]() {
+        runTransfer(state);
+    });
+    return state->transfer.id;
+}
+
+void FileTransferEngine::runTransfer(const QSharedPointer<TransferState> &state)
+{
+    TRACE_SCOPE("FileTransferEngine::runTransfer");
+    const FileTransfer &transfer = state->transfer;
+    const QFileInfo sourceInfo(transfer.sourcePath);
+
+    if (!sourceInfo.exists() || !sourceInfo.isFile()) {
+        emit transferFailed(transfer.id, "Source file does not exist: " + transfer.sourcePath);
+        finishTransfer(transfer.id);
+        return;
+    }
+    if (QFileInfo::exists(transfer.destinationPath) && !transfer.overwrite) {
+        emit transferFailed(transfer.id, "Destination already exists: " + transfer.destinationPath);
+        finishTransfer(transfer.id);
+        return;
+    }
+
+    const qint64 totalBytes = sourceInfo.size();
+    emit transferStarted(transfer.id, totalBytes);
+
+    QDir().mkpath(QFileInfo(transfer.destinationPath).absolutePath());
+
+    // A move within one filesystem is a rename and never touches the data.
+    // If it fails (another filesystem) the destination is still intact.
+    if (transfer.move) {
+        if (renameInto(transfer.sourcePath, transfer.destinationPath, transfer.overwrite)) {
+            emit transferProgress(transfer.id, totalBytes, totalBytes);
+            emit transferFinished(transfer.id, transfer.destinationPath);
+            finishTransfer(transfer.id);
+            return;
+        }
+    }
+
+    // Data is written to a temporary file next to the destination, unique
+    // per transfer, and renamed over it only once complete. A cancelled or
+    // failed transfer leaves any existing destination untouched and removes
+    // its temporary file when it goes out of scope.
+    const QFileInfo destinationInfo(transfer.destinationPath);
+    QTemporaryFile partial(destinationInfo.absolutePath() + "/." + destinationInfo.fileName() + ".XXXXXX.part");
+    QString error;
+    bool ok = partial.open();
+    if (!ok) {
+        error = "Could not create temporary file: " + partial.errorString();
+    } else {
+        ok = copyContents(*state, transfer.sourcePath, partial, totalBytes, error);
+        partial.close();
+    }
+
+    if (ok && state->cancelled.load()) {
+        ok = false;
+    }
+    if (ok) {
+        partial.setPermissions(sourceInfo.permissions());
+        if (renameInto(partial.fileName(), transfer.destinationPath, transfer.overwrite)) {
+            partial.setAutoRemove(false);
+        } else {
+            error = "Could not rename into place: " + transfer.destinationPath;
+            ok = false;
+        }
+    }
+    if (!ok) {
+        if (state->cancelled.load()) {
+            emit transferCancelled(transfer.id);
+        } else {
+            emit transferFailed(transfer.id, error);
+        }
+        finishTransfer(transfer.id);
+        return;
+    }
+
+    if (transfer.move && !QFile::remove(transfer.sourcePath)) {
+        emit transferFailed(transfer.id, "Copied, but could not remove source: " + transfer.sourcePath);
+        finishTransfer(transfer.id);
+        return;
+    }
+
+    emit transferFinished(transfer.id, transfer.destinationPath);
+    finishTransfer(transfer.id);
+}
+
+bool FileTransferEngine::copyContents(TransferState &state, const QString &sourcePath, QFile &target,
+                                      qint64 totalBytes, QString &error)
+{
+    const quint64 transferId = state.transfer.id;
+
+    QFile source(sourcePath);
+    if (!source.open(QIODevice::ReadOnly)) {
+        error = "Could not open source: " + source.errorString();
+        return false;
+    }
+    const qint64 chunkSize = CHUNK_SIZE;
+    qint64 done = 0;
+    qint64 lastReported = 0;
+
+#ifdef Q_OS_LINUX
+    const int sourceFd = source.handle();
+    const int targetFd = target.handle();
+
+    // Reflink shares extents on CoW filesystems (btrfs, XFS); it is
+    // effectively instant regardless of file size.
+    if (cloneFile(sourceFd, targetFd)) {
+        reportProgress(transferId, totalBytes, totalBytes, lastReported);
+        return true;
+    }
+
+    // copy_file_range keeps the data in the kernel (and lets NFS/SMB do a
+    // server-side copy). It is issued in chunks so cancellation and progress
+    // still work.
+    while (done < totalBytes) {
+        if (state.cancelled.load()) {
+            return false;
+        }
+        const qint64 copied = copyRangeKernel(sourceFd, targetFd, qMin(chunkSize, totalBytes - done));
+        if (copied <= 0) {
+            break;
+        }
+        done += copied;
+        reportProgress(transferId, done, totalBytes, lastReported);
+    }
+    if (done == totalBytes) {
+        return true;
+    }
+
+    // Fall through to the buffered loop for whatever the kernel path did not
+    // cover (cross-device on older kernels, special filesystems).
+    if (!source.seek(done) || !target.seek(done)) {
+        error = "Could not resume buffered copy";
+        return false;
+    }
+#endif
+
+    QVector<char> buffer(static_cast<int>(chunkSize));
+    while (!source.atEnd()) {
+        if (state.cancelled.load()) {
+            return false;
+        }
+        const qint64 bytesRead = source.read(buffer.data(), buffer.size());
+        if (bytesRead < 0) {
+            error = "Read failed: " + source.errorString();
+            return false;
+        }
+        if (bytesRead == 0) {
+            break;
+        }
+        if (target.write(buffer.constData(), bytesRead) != bytesRead) {
+            error = "Write failed: " + target.errorString();
+            return false;
+        }
+        done += bytesRead;
+        reportProgress(transferId, done, totalBytes, lastReported);
+    }
+
+    if (!target.flush()) {
+        error = "Write failed: " + target.errorString();
+        return false;
+    }
+    reportProgress(transferId, totalBytes, totalBytes, lastReported);
+    return true;
+}
+
+// Renames without ever deleting the destination first: with overwrite the
+// rename replaces it atomically, so a failure leaves it as it was. Without
+// overwrite an existing destination makes it fail. Either way it is a raw
+// rename that never copies (QFile::rename would, synchronously, across
+// filesystems); a cross-device move fails here and takes the chunked copy.
+bool FileTransferEngine::renameInto(const QString &fromPath, const QString &toPath, bool overwrite) const
+{
+#if defined(Q_OS_UNIX)
+    const QByteArray from = QFile::encodeName(fromPath);
+    const QByteArray to = QFile::encodeName(toPath);
+    if (overwrite) {
+        return std::rename(from.constData(), to.constData()) == 0;
+    }
+#if defined(Q_OS_LINUX) && defined(RENAME_NOREPLACE)
+    if (::renameat2(AT_FDCWD, from.constData(), AT_FDCWD, to.constData(), RENAME_NOREPLACE) == 0) {
+        return true;
+    }
+    if (errno != EINVAL && errno != ENOSYS) {
+        return false; // EEXIST, EXDEV, ...
+    }
+#endif
+    // Without renameat2 a hard link refuses to replace just the same, and
+    // the source name is dropped once the link exists.
+    if (::link(from.constData(), to.constData()) == 0) {
+        ::unlink(from.constData());
+        return true;
+    }
+    if (errno != EPERM && errno != EOPNOTSUPP) {
+        return false;
+    }
+    // Filesystems without hard links (FAT): check, then rename.
+    if (::access(to.constData(), F_OK) == 0 || errno != ENOENT) {
+        return false;
+    }
+    return std::rename(from.constData(), to.constData()) == 0;
+#elif defined(Q_OS_WIN)
+    return ::MoveFileExW(reinterpret_cast<const wchar_t *>(QDir::toNativeSeparators(fromPath).utf16()),
+                         reinterpret_cast<const wchar_t *>(QDir::toNativeSeparators(toPath).utf16()),
+                         overwrite ? MOVEFILE_REPLACE_EXISTING : 0) != 0;
+#else
+    if (!overwrite && QFileInfo::exists(toPath)) {
+        return false;
+    }
+    return std::rename(QFile::encodeName(fromPath).constData(), QFile::encodeName(toPath).constData()) == 0;
+#endif
+}
+
+bool FileTransferEngine::cloneFile(int sourceFd, int targetFd) const
+{
+#if defined(Q_OS_LINUX) && defined(FICLONE)
+    return ::ioctl(targetFd, FICLONE, sourceFd) == 0;
+#else
+    Q_UNUSED(sourceFd);
+    Q_UNUSED(targetFd);
+    return false;
+#endif
+}
+
+qint64 FileTransferEngine::copyRangeKernel(int sourceFd, int targetFd, qint64 length) const
+{
+#ifdef Q_OS_LINUX
+    ssize_t copied;
+    do {
+        copied = ::copy_file_range(sourceFd, nullptr, targetFd, nullptr, static_cast<size_t>(length), 0);
+    } while (copied < 0 && errno == EINTR);
+    return copied;
+#else
+    Q_UNUSED(sourceFd);
+    Q_UNUSED(targetFd);
+    Q_UNUSED(length);
+    return -1;
+#endif
+}
+
+void FileTransferEngine::reportProgress(quint64 transferId, qint64 done, qint64 total, qint64 &lastReported)
+{
+    if (done - lastReported >= PROGRESS_STEP || (done == total && lastReported != total)) {
+        lastReported = done;
+        emit transferProgress(transferId, done, total);
+    }
+}
+
+void FileTransferEngine::finishTransfer(quint64 transferId)
+{
+    QMutexLocker locker(&m_mutex);
+    m_transfers.remove(transferId);
+}
@@ -0,0 +1,79 @@
+#ifndef FILETRANSFERENGINE_H
+#define FILETRANSFERENGINE_H
+
+#include <QObject>
+#include <QString>
+#include <QHash>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QThreadPool>
+#include <QFile>
+#include <QtConcurrent>
+
+#include <atomic>
+
+struct FileTransfer {
+    quint64 id = 0;
+    QString sourcePath;
+    QString destinationPath;
+    bool move = false;
+    bool overwrite = false;
+};
+
+class FileTransferEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FileTransferEngine(QObject *parent = nullptr);
+    ~FileTransferEngine();
+
+    // Transfers
+    quint64 copyFile(const QString &sourcePath, const QString &destinationPath, bool overwrite = false);
+    quint64 moveFile(const QString &sourcePath, const QString &destinationPath, bool overwrite = false);
+    void cancel(quint64 transferId);
+    void cancelAll();
+    void waitForDone();
+    int activeTransferCount() const;
+
+    // Worker pool
+    void setMaxConcurrentTransfers(int count);
+    int maxConcurrentTransfers() const { return m_pool.maxThreadCount(); }
+
+signals:
+    void transferStarted(quint64 transferId, qint64 totalBytes);
+    void transferProgress(quint64 transferId, qint64 bytesTransferred, qint64 totalBytes);
+    void transferFinished(quint64 transferId, const QString &destinationPath);
+    void transferFailed(quint64 transferId, const QString &error);
+    void transferCancelled(quint64 transferId);
+
+private:
+    struct TransferState {
+        FileTransfer transfer;
+        std::atomic<bool> cancelled { false };
+    };
+
+    // Transfer state
+    QThreadPool m_pool;
+    mutable QMutex m_mutex;
+    QHash<quint64, QSharedPointer<TransferState>> m_transfers;
+    std::atomic<quint64> m_nextTransferId;
+
+    // Methods
+    quint64 enqueue(const FileTransfer &transfer);
+    void runTransfer(const QSharedPointer<TransferState> &state);
+    bool copyContents(TransferState &state, const QString &sourcePath, QFile &target,
+                      qint64 totalBytes, QString &error);
+    bool renameInto(const QString &fromPath, const QString &toPath, bool overwrite) const;
+    bool cloneFile(int sourceFd, int targetFd) const;
+    qint64 copyRangeKernel(int sourceFd, int targetFd, qint64 length) const;
+    void reportProgress(quint64 transferId, qint64 done, qint64 total, qint64 &lastReported);
+    void finishTransfer(quint64 transferId);
+
+    // Constants
+    static const int DEFAULT_CONCURRENT_TRANSFERS = 3;
+    static const qint64 CHUNK_SIZE = 8 * 1024 * 1024; // 8MB
+    static const qint64 PROGRESS_STEP = 16 * 1024 * 1024; // 16MB between progress signals
+};
+
+#endif // FILETRANSFERENGINE_H
@@ -0,0 +1,396 @@
+#include "forcelayout.h"
+
+#include <QMutexLocker>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QtMath>
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+const double ForceLayoutSimulation::COOLING_FACTOR = 0.985;
+const double ForceLayoutSimulation::MIN_TEMPERATURE = 0.5;
+const double ForceLayoutSimulation::GRAVITY = 0.02;
+
+ForceLayoutSimulation::ForceLayoutSimulation(QObject *parent)
+    : QObject(parent)
+    , m_frameTaken(true)
+    , m_running(false)
+    , m_stopRequested(false)
+    , m_iteration(0)
+    , m_idealLength(350.0)
+    , m_theta(0.9)
+{
+    m_driverPool.setMaxThreadCount(1);
+    m_workerPool.setMaxThreadCount(qMax(1, QThread::idealThreadCount()));
+}
+
+ForceLayoutSimulation::~ForceLayoutSimulation()
+{
+    stop();
+    waitForFinished();
+    m_workerPool.waitForDone();
+}
+
+void ForceLayoutSimulation::setGraph(const QStringList &nodeIds, const QVector<QPointF> &positions,
+                                     const QVector<QPair<QString, QString>> &edges)
+{
+    stop();
+    waitForFinished();
+
+    const int count = nodeIds.size();
+    m_nodeIds = nodeIds;
+    m_indexById.clear();
+    m_indexById.reserve(count);
+    m_x.resize(count);
+    m_y.resize(count);
+    m_forceX.fill(0.0, count);
+    m_forceY.fill(0.0, count);
+    m_pinned.fill(0, count);
+    for (int i = 0; i < count; ++i) {
+        m_indexById.insert(nodeIds.at(i), i);
+        const QPointF position = positions.value(i);
+        m_x[i] = position.x();
+        m_y[i] = position.y();
+    }
+
+    // Undirected adjacency in compressed rows, so each node can sum its own
+    // spring forces without touching anyone else's accumulator.
+    QVector<QPair<int, int>> resolved;
+    resolved.reserve(edges.size());
+    QVector<int> degree(count, 0);
+    for (const QPair<QString, QString> &edge : edges) {
+        const int a = m_indexById.value(edge.first, -1);
+        const int b = m_indexById.value(edge.second, -1);
+        if (a < 0 || b < 0 || a == b) {
+            continue;
+        }
+        resolved.append(qMakePair(a, b));
+        degree[a]++;
+        degree[b]++;
+    }
+    m_adjacencyOffsets.resize(count + 1);
+    m_adjacencyOffsets[0] = 0;
+    for (int i = 0; i < count; ++i) {
+        m_adjacencyOffsets[i + 1] = m_adjacencyOffsets.at(i) + degree.at(i);
+    }
+    m_adjacency.resize(m_adjacencyOffsets.at(count));
+    QVector<int> fill = m_adjacencyOffsets;
+    for (const QPair<int, int> &edge : std::as_const(resolved)) {
+        m_adjacency[fill[edge.first]++] = edge.second;
+        m_adjacency[fill[edge.second]++] = edge.first;
+    }
+
+    QMutexLocker locker(&m_sharedMutex);
+    m_published = positions;
+    m_frameTaken = true;
+}
+
+void ForceLayoutSimulation::start()
+{
+    if (m_running.load() || m_nodeIds.isEmpty()) {
+        return;
+    }
+    m_stopRequested = false;
+    m_running = true;
+    m_iteration = 0;
+    m_future = QtConcurrent::run(&m_driverPool, [this]() { run(); });
+}
+
+void ForceLayoutSimulation::stop()
+{
+    m_stopRequested = true;
+}
+
+void ForceLayoutSimulation::waitForFinished()
+{
+    m_future.waitForFinished();
+}
+
+void ForceLayoutSimulation::pinNode(const QString &nodeId, const QPointF &position)
+{
+    QMutexLocker locker(&m_sharedMutex);
+    m_pendingUnpins.removeAll(nodeId);
+    m_pendingPins.insert(nodeId, position);
+}
+
+void ForceLayoutSimulation::unpinNode(const QString &nodeId)
+{
+    QMutexLocker locker(&m_sharedMutex);
+    m_pendingPins.remove(nodeId);
+    m_pendingUnpins.append(nodeId);
+}
+
+QHash<QString, QPointF> ForceLayoutSimulation::takePositions()
+{
+    QMutexLocker locker(&m_sharedMutex);
+    QHash<QString, QPointF> positions;
+    positions.reserve(m_published.size());
+    for (int i = 0; i < m_published.size() && i < m_nodeIds.size(); ++i) {
+        positions.insert(m_nodeIds.at(i), m_published.at(i));
+    }
+    m_frameTaken = true;
+    return positions;
+}
+
+void ForceLayoutSimulation::run()
+{
+    QElapsedTimer frameTimer;
+    frameTimer.start();
+
+    // Start hot enough to untangle a map laid out by hand, then cool
+    // geometrically; stop once nothing moves more than a fraction of a pixel.
+    double temperature = m_idealLength * 4.0;
+    bool converged = false;
+    int iterations = 0;
+    while (!m_stopRequested.load() && iterations < MAX_ITERATIONS) {
+        applyPins();
+        const double maxDisplacement = step(temperature);
+        m_iteration = ++iterations;
+        temperature *= COOLING_FACTOR;
+
+        if (frameTimer.elapsed() >= FRAME_INTERVAL) {
+            publish();
+            frameTimer.restart();
+        }
+        if (maxDisplacement < MIN_TEMPERATURE || temperature < MIN_TEMPERATURE) {
+            converged = true;
+            break;
+        }
+    }
+
+    publish();
+    m_running = false;
+    emit finished(iterations, converged);
+}
+
+double ForceLayoutSimulation::step(double temperature)
+{
+    const int count = m_nodeIds.size();
+    buildQuadtree();
+
+    QVector<int> chunkStarts;
+    for (int begin = 0; begin < count; begin += CHUNK_SIZE) {
+        chunkStarts.append(begin);
+    }
+    const int chunkSize = CHUNK_SIZE;
+    QtConcurrent::blockingMap(&m_workerPool, chunkStarts, [this, count, chunkSize](int begin) {
+        computeForces(begin, qMin(begin + chunkSize, count));
+    });
+
+    // Each node moves along its net force, by at most the temperature.
+    double maxDisplacement = 0.0;
+    for (int i = 0; i < count; ++i) {
+        if (m_pinned.at(i)) {
+            continue;
+        }
+        const double fx = m_forceX.at(i);
+        const double fy = m_forceY.at(i);
+        const double length = qSqrt(fx * fx + fy * fy);
+        if (length <= 0.0) {
+            continue;
+        }
+        const double displacement = qMin(length, temperature);
+        m_x[i] += fx / length * displacement;
+        m_y[i] += fy / length * displacement;
+        maxDisplacement = qMax(maxDisplacement, displacement);
+    }
+    return maxDisplacement;
+}
+
+void ForceLayoutSimulation::buildQuadtree()
+{
+    const int count = m_nodeIds.size();
+    m_order.resize(count);
+    for (int i = 0; i < count; ++i) {
+        m_order[i] = i;
+    }
+
+    double minX = std::numeric_limits<double>::max();
+    double minY = std::numeric_limits<double>::max();
+    double maxX = std::numeric_limits<double>::lowest();
+    double maxY = std::numeric_limits<double>::lowest();
+    for (int i = 0; i < count; ++i) {
+        minX = qMin(minX, m_x.at(i));
+        minY = qMin(minY, m_y.at(i));
+        maxX = qMax(maxX, m_x.at(i));
+        maxY = qMax(maxY, m_y.at(i));
+    }
+
+    Cell root;
+    root.centerX = (minX + maxX) / 2.0;
+    root.centerY = (minY + maxY) / 2.0;
+    root.half = qMax(maxX - minX, maxY - minY) / 2.0 + 1.0;
+    m_cells.clear();
+    m_cells.reserve(count / 2 + 1);
+    m_cells.append(root);
+    buildCell(0, 0, count, 0);
+}
+
+void ForceLayoutSimulation::buildCell(int cellIndex, int begin, int end, int depth)
+{
+    double sumX = 0.0;
+    double sumY = 0.0;
+    for (int i = begin; i < end; ++i) {
+        sumX += m_x.at(m_order.at(i));
+        sumY += m_y.at(m_order.at(i));
+    }
+    const int mass = end - begin;
+    {
+        Cell &cell = m_cells[cellIndex];
+        cell.mass = mass;
+        cell.massX = mass > 0 ? sumX / mass : cell.centerX;
+        cell.massY = mass > 0 ? sumY / mass : cell.centerY;
+        cell.begin = begin;
+        cell.end = end;
+    }
+    if (mass <= LEAF_SIZE || depth >= MAX_DEPTH) {
+        return;
+    }
+
+    // Partition the body range in place into the four quadrants.
+    const double centerX = m_cells.at(cellIndex).centerX;
+    const double centerY = m_cells.at(cellIndex).centerY;
+    const double quarter = m_cells.at(cellIndex).half / 2.0;
+    int *first = m_order.data() + begin;
+    int *last = m_order.data() + end;
+    int *middle = std::partition(first, last, [this, centerY](int i) { return m_y.at(i) < centerY; });
+    int *topSplit = std::partition(first, middle, [this, centerX](int i) { return m_x.at(i) < centerX; });
+    int *bottomSplit = std::partition(middle, last, [this, centerX](int i) { return m_x.at(i) < centerX; });
+    const int bounds[5] = {
+        begin,
+        begin + int(topSplit - first),
+        begin + int(middle - first),
+        begin + int(bottomSplit - first),
+        end
+    };
+
+    const int firstChild = m_cells.size();
+    m_cells[cellIndex].firstChild = firstChild;
+    for (int q = 0; q < 4; ++q) {
+        Cell child;
+        child.centerX = centerX + ((q & 1) ? quarter : -quarter);
+        child.centerY = centerY + ((q & 2) ? quarter : -quarter);
+        child.half = quarter;
+        m_cells.append(child);
+    }
+    for (int q = 0; q < 4; ++q) {
+        buildCell(firstChild + q, bounds[q], bounds[q + 1], depth + 1);
+    }
+}
+
+void ForceLayoutSimulation::computeForces(int begin, int end)
+{
+    const double k = m_idealLength;
+    const double k2 = k * k;
+    const double theta2 = m_theta * m_theta;
+    const double gravityX = m_cells.isEmpty() ? 0.0 : m_cells.first().massX;
+    const double gravityY = m_cells.isEmpty() ? 0.0 : m_cells.first().massY;
+
+    int stack[4 * MAX_DEPTH + 8];
+    for (int i = begin; i < end; ++i) {
+        const double xi = m_x.at(i);
+        const double yi = m_y.at(i);
+        double fx = 0.0;
+        double fy = 0.0;
+
+        // Repulsion, k^2 / d. Distant cells act as a single body at their
+        // centre of mass when size / distance < theta.
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0) {
+            const Cell &cell = m_cells.at(stack[--top]);
+            if (cell.mass == 0) {
+                continue;
+            }
+            const double dx = xi - cell.massX;
+            const double dy = yi - cell.massY;
+            const double d2 = dx * dx + dy * dy;
+            if (cell.firstChild < 0) {
+                for (int b = cell.begin; b < cell.end; ++b) {
+                    const int j = m_order.at(b);
+                    if (j == i) {
+                        continue;
+                    }
+                    double bx = xi - m_x.at(j);
+                    double by = yi - m_y.at(j);
+                    double bd2 = bx * bx + by * by;
+                    if (bd2 < 1e-4) {
+                        // Coincident nodes: push apart along a stable direction.
+                        bx = i < j ? -0.01 : 0.01;
+                        by = 0.0;
+                        bd2 = 1e-4;
+                    }
+                    fx += bx * k2 / bd2;
+                    fy += by * k2 / bd2;
+                }
+            } else if (4.0 * cell.half * cell.half < theta2 * d2) {
+                fx += dx * k2 * cell.mass / d2;
+                fy += dy * k2 * cell.mass / d2;
+            } else {
+                for (int q = 0; q < 4; ++q) {
+                    stack[top++] = cell.firstChild + q;
+                }
+            }
+        }
+
+        // Attraction along connections, d^2 / k.
+        for (int e = m_adjacencyOffsets.at(i); e < m_adjacencyOffsets.at(i + 1); ++e) {
+            const int j = m_adjacency.at(e);
+            const double dx = m_x.at(j) - xi;
+            const double dy = m_y.at(j) - yi;
+            const double d = qSqrt(dx * dx + dy * dy);
+            fx += dx * d / k;
+            fy += dy * d / k;
+        }
+
+        // Weak pull to the centre keeps disconnected parts from drifting off.
+        fx -= GRAVITY * (xi - gravityX);
+        fy -= GRAVITY * (yi - gravityY);
+
+        m_forceX[i] = fx;
+        m_forceY[i] = fy;
+    }
+}
+
+void ForceLayoutSimulation::applyPins()
+{
+    QMutexLocker locker(&m_sharedMutex);
+    for (auto it = m_pendingPins.constBegin(); it != m_pendingPins.constEnd(); ++it) {
+        const int index = m_indexById.value(it.key(), -1);
+        if (index >= 0) {
+            m_x[index] = it.value().x();
+            m_y[index] = it.value().y();
+            m_pinned[index] = 1;
+        }
+    }
+    for (const QString &nodeId : std::as_const(m_pendingUnpins)) {
+        const int index = m_indexById.value(nodeId, -1);
+        if (index >= 0) {
+            m_pinned[index] = 0;
+        }
+    }
+    m_pendingPins.clear();
+    m_pendingUnpins.clear();
+}
+
+void ForceLayoutSimulation::publish()
+{
+    bool notify = false;
+    {
+        QMutexLocker locker(&m_sharedMutex);
+        const int count = m_nodeIds.size();
+        m_published.resize(count);
+        for (int i = 0; i < count; ++i) {
+            m_published[i] = QPointF(m_x.at(i), m_y.at(i));
+        }
+        // Only signal again once the GUI took the previous frame, so a slow
+        // consumer sees the newest positions instead of a queue of old ones.
+        notify = m_frameTaken;
+        m_frameTaken = false;
+    }
+    if (notify) {
+        emit positionsReady();
+    }
+}
@@ -0,0 +1,127 @@
+#ifndef FORCELAYOUT_H
+#define FORCELAYOUT_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QVector>
+#include <QPair>
+#include <QPointF>
+#include <QMutex>
+#include <QThreadPool>
+#include <QFuture>
+#include <QtConcurrent>
+
+#include <atomic>
+
+// Force-directed layout for maps whose cross-links don't fit a tree.
+// Fruchterman-Reingold forces; repulsion is approximated with Barnes-Hut on
+// a quadtree rebuilt every iteration, and the per-node force pass is split
+// across a worker pool. The simulation runs off the GUI thread and
+// publishes position snapshots at most once per frame.
+class ForceLayoutSimulation : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ForceLayoutSimulation(QObject *parent = nullptr);
+    ~ForceLayoutSimulation();
+
+    // Graph; edges are pairs of node ids. Replaces any previous graph and
+    // stops a running simulation first.
+    void setGraph(const QStringList &nodeIds, const QVector<QPointF> &positions,
+                  const QVector<QPair<QString, QString>> &edges);
+
+    // Control
+    void start();
+    void stop();
+    void waitForFinished();
+    bool isRunning() const { return m_running.load(); }
+
+    // Held nodes keep the given position (e.g. while the user drags them)
+    void pinNode(const QString &nodeId, const QPointF &position);
+    void unpinNode(const QString &nodeId);
+
+    // Latest published frame; call from the positionsReady handler
+    QHash<QString, QPointF> takePositions();
+    int iteration() const { return m_iteration.load(); }
+
+    // Tuning
+    void setIdealEdgeLength(qreal length) { m_idealLength = length; }
+    qreal getIdealEdgeLength() const { return m_idealLength; }
+    void setTheta(qreal theta) { m_theta = theta; }
+    qreal getTheta() const { return m_theta; }
+
+signals:
+    void positionsReady();
+    void finished(int iterations, bool converged);
+
+private:
+    struct Cell {
+        double centerX = 0.0;   // geometric centre and half-size of the square
+        double centerY = 0.0;
+        double half = 0.0;
+        double massX = 0.0;     // centre of mass
+        double massY = 0.0;
+        int mass = 0;
+        int firstChild = -1;    // four consecutive cells, or -1 for a leaf
+        int begin = 0;          // leaf bodies: m_order[begin, end)
+        int end = 0;
+    };
+
+    // Graph, owned by the simulation thread while it runs
+    QStringList m_nodeIds;
+    QHash<QString, int> m_indexById;
+    QVector<double> m_x;
+    QVector<double> m_y;
+    QVector<double> m_forceX;
+    QVector<double> m_forceY;
+    QVector<int> m_adjacencyOffsets;   // CSR adjacency
+    QVector<int> m_adjacency;
+    QVector<char> m_pinned;
+
+    // Quadtree, rebuilt every iteration
+    QVector<Cell> m_cells;
+    QVector<int> m_order;
+
+    // Publishing and pins, shared with the GUI thread
+    QMutex m_sharedMutex;
+    QVector<QPointF> m_published;
+    bool m_frameTaken;
+    QHash<QString, QPointF> m_pendingPins;
+    QStringList m_pendingUnpins;
+
+    // Threads
+    QThreadPool m_driverPool;
+    QThreadPool m_workerPool;
+    QFuture<void> m_future;
+    std::atomic<bool> m_running;
+    std::atomic<bool> m_stopRequested;
+    std::atomic<int> m_iteration;
+
+    // Tuning
+    qreal m_idealLength;
+    qreal m_theta;
+
+    // Methods
+    void run();
+    double step(double temperature);
+    void buildQuadtree();
+    void buildCell(int cellIndex, int begin, int end, int depth);
+    void computeForces(int begin, int end);
+    void applyPins();
+    void publish();
+
+    // Constants
+    static const int LEAF_SIZE = 8;
+    static const int MAX_DEPTH = 24;
+    static const int CHUNK_SIZE = 1024;
+    static const int MAX_ITERATIONS = 2000;
+    static const int FRAME_INTERVAL = 16; // ~60 FPS, matches the view update rate
+    static const double COOLING_FACTOR;
+    static const double MIN_TEMPERATURE;
+    static const double GRAVITY;
+};
+
+#endif // FORCELAYOUT_H
@@ -0,0 +1,426 @@
+#include "fuzzymatcher.h"
+
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <numeric>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MIND2DO_FUZZY_SSE2
+#endif
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define MIND2DO_FUZZY_AVX2
+#endif
+
+namespace {
+
+const int SCORE_MATCH = 16;
+const int BONUS_BOUNDARY = 8;
+const int BONUS_FIRST_CHAR = 8;
+const int BONUS_CONSECUTIVE = 4;
+const int PENALTY_GAP_START = 3;
+const int PENALTY_GAP_EXTENSION = 1;
+const int MAX_LEADING_PENALTY = 8;
+
+int filterScalar(const quint64 *masks, int begin, int end, quint64 queryMask, int *out)
+{
+    int found = 0;
+    for (int i = begin; i < end; ++i) {
+        if ((masks[i] & queryMask) == queryMask) {
+            out[found++] = i;
+        }
+    }
+    return found;
+}
+
+#ifdef MIND2DO_FUZZY_SSE2
+int filterSse2(const quint64 *masks, int count, quint64 queryMask, int *out)
+{
+    // SSE2 has no 64-bit compare, so compare 32-bit halves and require both
+    // halves of a lane to match.
+    const __m128i query = _mm_set1_epi64x(static_cast<long long>(queryMask));
+    int found = 0;
+    int i = 0;
+    for (; i + 2 <= count; i += 2) {
+        const __m128i m = _mm_loadu_si128(reinterpret_cast<const __m128i *>(masks + i));
+        const int bits = _mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(m, query), query));
+        if ((bits & 0x00FF) == 0x00FF) {
+            out[found++] = i;
+        }
+        if ((bits & 0xFF00) == 0xFF00) {
+            out[found++] = i + 1;
+        }
+    }
+    return found + filterScalar(masks, i, count, queryMask, out + found);
+}
+#endif
+
+#ifdef MIND2DO_FUZZY_AVX2
+__attribute__((target("avx2")))
+int filterAvx2(const quint64 *masks, int count, quint64 queryMask, int *out)
+{
+    const __m256i query = _mm256_set1_epi64x(static_cast<long long>(queryMask));
+    int found = 0;
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m256i m = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(masks + i));
+        const __m256i eq = _mm256_cmpeq_epi64(_mm256_and_si256(m, query), query);
+        int bits = _mm256_movemask_pd(_mm256_castsi256_pd(eq));
+        while (bits) {
+            out[found++] = i + __builtin_ctz(static_cast<unsigned>(bits));
+            bits &= bits - 1;
+        }
+    }
+    return found + filterScalar(masks, i, count, queryMask, out + found);
+}
+#endif
+
+} // namespace
+
+FuzzyMatcher::FuzzyMatcher()
+    : m_deadCount(0)
+    , m_holeChars(0)
+    , m_lastCandidatesValid(false)
+{
+}
+
+void FuzzyMatcher::setTitle(const QString &nodeId, const QString &title)
+{
+    const QString folded = title.toCaseFolded();
+    invalidateCandidates();
+
+    auto it = m_indexById.constFind(nodeId);
+    if (it != m_indexById.constEnd()) {
+        const int index = it.value();
+        // Shorter or equal titles are rewritten in place; longer ones move
+        // to the end of the buffer. Either way the chars given up are
+        // counted as holes, and the buffer is compacted once they dominate.
+        if (folded.size() <= m_lengths.at(index)) {
+            std::copy(folded.cbegin(), folded.cend(), m_buffer.begin() + m_offsets.at(index));
+            m_holeChars += m_lengths.at(index) - folded.size();
+        } else {
+            m_holeChars += m_lengths.at(index);
+            m_offsets[index] = m_buffer.size();
+            m_buffer.append(QVector<QChar>(folded.cbegin(), folded.cend()));
+        }
+        m_lengths[index] = folded.size();
+        m_masks[index] = characterMask(folded);
+        compactIfFragmented();
+        return;
+    }
+
+    m_indexById.insert(nodeId, m_nodeIds.size());
+    m_nodeIds.append(nodeId);
+    m_offsets.append(m_buffer.size());
+    m_lengths.append(folded.size());
+    m_masks.append(characterMask(folded));
+    m_buffer.append(QVector<QChar>(folded.cbegin(), folded.cend()));
+}
+
+void FuzzyMatcher::removeNode(const QString &nodeId)
+{
+    auto it = m_indexById.find(nodeId);
+    if (it == m_indexById.end()) {
+        return;
+    }
+
+    // Dead slots keep a zero mask, which no non-empty query can pass.
+    const int index = it.value();
+    m_indexById.erase(it);
+    m_nodeIds[index].clear();
+    m_holeChars += m_lengths.at(index);
+    m_lengths[index] = 0;
+    m_masks[index] = 0;
+    ++m_deadCount;
+    invalidateCandidates();
+
+    if (m_deadCount > 1024 && m_deadCount > m_nodeIds.size() / 2) {
+        compact();
+    } else {
+        compactIfFragmented();
+    }
+}
+
+void FuzzyMatcher::clear()
+{
+    m_buffer.clear();
+    m_offsets.clear();
+    m_lengths.clear();
+    m_masks.clear();
+    m_nodeIds.clear();
+    m_indexById.clear();
+    m_deadCount = 0;
+    m_holeChars = 0;
+    invalidateCandidates();
+}
+
+QList<FuzzyMatch> FuzzyMatcher::match(const QString &query, int limit)
+{
+    QList<FuzzyMatch> results;
+    if (limit <= 0) {
+        return results;
+    }
+
+    QString folded = query.toCaseFolded();
+    folded.remove(QChar(' '));
+
+    if (folded.isEmpty()) {
+        invalidateCandidates();
+        for (int i = 0; i < m_nodeIds.size() && results.size() < limit; ++i) {
+            if (!m_nodeIds.at(i).isEmpty()) {
+                FuzzyMatch match;
+                match.nodeId = m_nodeIds.at(i);
+                results.append(match);
+            }
+        }
+        return results;
+    }
+
+    const quint64 queryMask = characterMask(folded);
+    const QVector<int> candidates = m_lastCandidatesValid && !m_lastQuery.isEmpty() && folded.startsWith(m_lastQuery)
+        ? prefilterSubset(queryMask, m_lastCandidates)
+        : prefilter(queryMask);
+    const QVector<QChar> queryChars(folded.cbegin(), folded.cend());
+
+    QVector<ScoredIndex> scored;
+    if (candidates.size() < PARALLEL_THRESHOLD) {
+        scoreRange(candidates, 0, candidates.size(), queryChars, scored);
+    } else {
+        // Each chunk scores into its own vector; only the merge is serial.
+        QVector<QPair<int, int>> chunks;
+        for (int begin = 0; begin < candidates.size(); begin += PARALLEL_CHUNK) {
+            chunks.append(qMakePair(begin, qMin(begin + PARALLEL_CHUNK, candidates.size())));
+        }
+        QVector<QVector<ScoredIndex>> partial(chunks.size());
+        QVector<int> chunkIndices(chunks.size());
+        std::iota(chunkIndices.begin(), chunkIndices.end(), 0);
+        QtConcurrent::blockingMap(chunkIndices, [&](int chunk) {
+            scoreRange(candidates, chunks.at(chunk).first, chunks.at(chunk).second, queryChars, partial[chunk]);
+        });
+        for (const QVector<ScoredIndex> &part : std::as_const(partial)) {
+            scored += part;
+        }
+    }
+
+    m_lastQuery = folded;
+    m_lastCandidates.clear();
+    m_lastCandidates.reserve(scored.size());
+    for (const ScoredIndex &entry : std::as_const(scored)) {
+        m_lastCandidates.append(entry.index);
+    }
+    std::sort(m_lastCandidates.begin(), m_lastCandidates.end());
+    m_lastCandidatesValid = true;
+
+    const int count = qMin(limit, scored.size());
+    std::partial_sort(scored.begin(), scored.begin() + count, scored.end(),
+                      [this](const ScoredIndex &a, const ScoredIndex &b) {
+        if (a.score != b.score) {
+            return a.score > b.score;
+        }
+        if (m_lengths.at(a.index) != m_lengths.at(b.index)) {
+            return m_lengths.at(a.index) < m_lengths.at(b.index);
+        }
+        return a.index < b.index;
+    });
+
+    results.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        FuzzyMatch match;
+        match.nodeId = m_nodeIds.at(scored.at(i).index);
+        match.score = scored.at(i).score;
+        results.append(match);
+    }
+    return results;
+}
+
+quint64 FuzzyMatcher::characterMask(const QString &foldedText)
+{
+    quint64 mask = 0;
+    for (const QChar c : foldedText) {
+        const ushort u = c.unicode();
+        if (u >= 'a' && u <= 'z') {
+            mask |= quint64(1) << (u - 'a');
+        } else if (u >= '0' && u <= '9') {
+            mask |= quint64(1) << (26 + u - '0');
+        } else if (!c.isSpace()) {
+            mask |= quint64(1) << (36 + u % 28);
+        }
+    }
+    return mask;
+}
+
+bool FuzzyMatcher::hasAvx2()
+{
+#ifdef MIND2DO_FUZZY_AVX2
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+#else
+    return false;
+#endif
+}
+
+void FuzzyMatcher::compact()
+{
+    QVector<QChar> buffer;
+    QVector<int> offsets;
+    QVector<int> lengths;
+    QVector<quint64> masks;
+    QStringList nodeIds;
+    buffer.reserve(m_buffer.size() - m_holeChars);
+
+    m_indexById.clear();
+    for (int i = 0; i < m_nodeIds.size(); ++i) {
+        if (m_nodeIds.at(i).isEmpty()) {
+            continue;
+        }
+        m_indexById.insert(m_nodeIds.at(i), nodeIds.size());
+        nodeIds.append(m_nodeIds.at(i));
+        offsets.append(buffer.size());
+        lengths.append(m_lengths.at(i));
+        masks.append(m_masks.at(i));
+        buffer.append(m_buffer.mid(m_offsets.at(i), m_lengths.at(i)));
+    }
+
+    m_buffer.swap(buffer);
+    m_offsets.swap(offsets);
+    m_lengths.swap(lengths);
+    m_masks.swap(masks);
+    m_nodeIds.swap(nodeIds);
+    m_deadCount = 0;
+    m_holeChars = 0;
+    invalidateCandidates();
+}
+
+void FuzzyMatcher::compactIfFragmented()
+{
+    // Renames that keep growing titles would otherwise grow the buffer
+    // without bound while the node count stays the same.
+    if (m_holeChars > MIN_COMPACT_HOLES && m_holeChars > m_buffer.size() / 2) {
+        compact();
+    }
+}
+
+void FuzzyMatcher::invalidateCandidates()
+{
+    m_lastCandidatesValid = false;
+    m_lastCandidates.clear();
+    m_lastQuery.clear();
+}
+
+QVector<int> FuzzyMatcher::prefilter(quint64 queryMask) const
+{
+    const int count = m_masks.size();
+    QVector<int> candidates(count);
+    int found;
+
+#ifdef MIND2DO_FUZZY_AVX2
+    if (hasAvx2()) {
+        found = filterAvx2(m_masks.constData(), count, queryMask, candidates.data());
+    } else
+#endif
+    {
+#ifdef MIND2DO_FUZZY_SSE2
+        found = filterSse2(m_masks.constData(), count, queryMask, candidates.data());
+#else
+        found = filterScalar(m_masks.constData(), 0, count, queryMask, candidates.data());
+#endif
+    }
+
+    candidates.resize(found);
+    return candidates;
+}
+
+QVector<int> FuzzyMatcher::prefilterSubset(quint64 queryMask, const QVector<int> &subset) const
+{
+    QVector<int> candidates;
+    candidates.reserve(subset.size());
+    for (int index : subset) {
+        if ((m_masks.at(index) & queryMask) == queryMask) {
+            candidates.append(index);
+        }
+    }
+    return candidates;
+}
+
+void FuzzyMatcher::scoreRange(const QVector<int> &candidates, int begin, int end, const QVector<QChar> &query,
+                              QVector<ScoredIndex> &out) const
+{
+    for (int i = begin; i < end; ++i) {
+        const int index = candidates.at(i);
+        const int score = scoreTitle(index, query);
+        if (score > 0) {
+            const ScoredIndex entry = { score, index };
+            out.append(entry);
+        }
+    }
+}
+
+int FuzzyMatcher::scoreTitle(int index, const QVector<QChar> &query) const
+{
+    const QChar *title = m_buffer.constData() + m_offsets.at(index);
+    const int length = m_lengths.at(index);
+    const int queryLength = query.size();
+    if (queryLength > length) {
+        return 0;
+    }
+
+    // Forward pass: earliest position where the whole query has been seen.
+    int q = 0;
+    int end = -1;
+    for (int i = 0; i < length; ++i) {
+        if (title[i] == query.at(q) && ++q == queryLength) {
+            end = i;
+            break;
+        }
+    }
+    if (end < 0) {
+        return 0;
+    }
+
+    // Backward pass: tightest window ending there.
+    q = queryLength - 1;
+    int start = end;
+    for (int i = end; i >= 0; --i) {
+        if (title[i] == query.at(q)) {
+            if (q == 0) {
+                start = i;
+                break;
+            }
+            --q;
+        }
+    }
+
+    int score = 0;
+    int previousMatch = -2;
+    bool inGap = false;
+    q = 0;
+    for (int i = start; i <= end && q < queryLength; ++i) {
+        if (title[i] != query.at(q)) {
+            score -= inGap ? PENALTY_GAP_EXTENSION : PENALTY_GAP_START;
+            inGap = true;
+            continue;
+        }
+
+        int charScore = SCORE_MATCH;
+        if (i == 0 || !title[i - 1].isLetterOrNumber()) {
+            charScore += BONUS_BOUNDARY;
+            if (q == 0) {
+                charScore += BONUS_FIRST_CHAR;
+            }
+        }
+        if (previousMatch == i - 1) {
+            charScore += BONUS_CONSECUTIVE;
+        }
+        score += charScore;
+        previousMatch = i;
+        inGap = false;
+        ++q;
+    }
+
+    score -= qMin(start, MAX_LEADING_PENALTY);
+    return qMax(score, 1);
+}
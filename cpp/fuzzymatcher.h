@@ -0,0 +1,75 @@
+#ifndef FUZZYMATCHER_H
+#define FUZZYMATCHER_H
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QList>
+#include <QVector>
+
+struct FuzzyMatch {
+    QString nodeId;
+    int score = 0;
+};
+
+class FuzzyMatcher
+{
+public:
+    FuzzyMatcher();
+
+    // Titles
+    void setTitle(const QString &nodeId, const QString &title);
+    void removeNode(const QString &nodeId);
+    void clear();
+    int count() const { return m_indexById.size(); }
+
+    // Matching. Query characters must appear in order in the title
+    // (subsequence); results are ranked by word-boundary, consecutive-run and
+    // gap scoring.
+    QList<FuzzyMatch> match(const QString &query, int limit = DEFAULT_LIMIT);
+
+    static quint64 characterMask(const QString &foldedText);
+    static bool hasAvx2();
+
+    // Constants
+    static const int DEFAULT_LIMIT = 50;
+
+private:
+    struct ScoredIndex {
+        int score;
+        int index;
+    };
+
+    // Contiguous case-folded storage: title i is m_buffer[m_offsets[i], +m_lengths[i])
+    QVector<QChar> m_buffer;
+    QVector<int> m_offsets;
+    QVector<int> m_lengths;
+    QVector<quint64> m_masks;
+    QStringList m_nodeIds;
+    QHash<QString, int> m_indexById;
+    int m_deadCount;
+    int m_holeChars;    // buffer chars no live title uses
+
+    // Incremental narrowing: when the new query extends the previous one,
+    // only the previous survivors need to be examined.
+    QString m_lastQuery;
+    QVector<int> m_lastCandidates;
+    bool m_lastCandidatesValid;
+
+    // Methods
+    void compact();
+    void compactIfFragmented();
+    void invalidateCandidates();
+    QVector<int> prefilter(quint64 queryMask) const;
+    QVector<int> prefilterSubset(quint64 queryMask, const QVector<int> &subset) const;
+    void scoreRange(const QVector<int> &candidates, int begin, int end, const QVector<QChar> &query,
+                    QVector<ScoredIndex> &out) const;
+    int scoreTitle(int index, const QVector<QChar> &query) const;
+
+    // Constants
+    static const int PARALLEL_THRESHOLD = 20000;
+    static const int PARALLEL_CHUNK = 8192;
+    static const int MIN_COMPACT_HOLES = 64 * 1024; // chars
+};
+
+#endif // FUZZYMATCHER_H
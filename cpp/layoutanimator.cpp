@@ -0,0 +1,84 @@
+#include "layoutanimator.h"
+
+#include <QEasingCurve>
+
+LayoutAnimator::LayoutAnimator(QObject *parent)
+    : QObject(parent)
+    , m_animation(new QVariantAnimation(this))
+    , m_duration(ANIMATION_DURATION)
+{
+    m_animation->setStartValue(0.0);
+    m_animation->setEndValue(1.0);
+    m_animation->setDuration(m_duration);
+    m_animation->setEasingCurve(QEasingCurve::OutCubic);
+
+    connect(m_animation, &QVariantAnimation::valueChanged, this, &LayoutAnimator::onValueChanged);
+    connect(m_animation, &QVariantAnimation::finished, this, &LayoutAnimator::onAnimationFinished);
+}
+
+LayoutAnimator::~LayoutAnimator()
+{
+}
+
+void LayoutAnimator::animateTo(const QHash<QGraphicsItem*, QPointF> &targets)
+{
+    m_animation->stop();
+
+    // Items still moving from an interrupted batch restart from where they
+    // are, whether or not they have a new target; otherwise the next frame
+    // would snap them back to their old start.
+    for (auto it = m_moves.begin(); it != m_moves.end(); ++it) {
+        it->from = it.key()->pos();
+    }
+    for (auto it = targets.constBegin(); it != targets.constEnd(); ++it) {
+        Move &move = m_moves[it.key()];
+        move.from = it.key()->pos();
+        move.to = it.value();
+    }
+
+    if (m_moves.size() > MAX_ANIMATED_ITEMS || m_duration <= 0) {
+        finish();
+        return;
+    }
+    m_animation->start();
+}
+
+void LayoutAnimator::finish()
+{
+    m_animation->stop();
+    for (auto it = m_moves.constBegin(); it != m_moves.constEnd(); ++it) {
+        it.key()->setPos(it.value().to);
+    }
+    m_moves.clear();
+    emit finished();
+}
+
+void LayoutAnimator::forgetItem(QGraphicsItem *item)
+{
+    m_moves.remove(item);
+}
+
+bool LayoutAnimator::isRunning() const
+{
+    return m_animation->state() == QAbstractAnimation::Running;
+}
+
+void LayoutAnimator::setDuration(int msecs)
+{
+    m_duration = msecs;
+    m_animation->setDuration(qMax(1, msecs));
+}
+
+void LayoutAnimator::onValueChanged(const QVariant &value)
+{
+    const qreal t = value.toReal();
+    for (auto it = m_moves.constBegin(); it != m_moves.constEnd(); ++it) {
+        const Move &move = it.value();
+        it.key()->setPos(move.from + (move.to - move.from) * t);
+    }
+}
+
+void LayoutAnimator::onAnimationFinished()
+{
+    finish();
+}
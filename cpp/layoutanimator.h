@@ -0,0 +1,53 @@
+#ifndef LAYOUTANIMATOR_H
+#define LAYOUTANIMATOR_H
+
+#include <QObject>
+#include <QGraphicsItem>
+#include <QVariantAnimation>
+#include <QHash>
+#include <QPointF>
+
+// Moves a batch of items to new positions with one shared animation, so a
+// relayout costs one timer and one setPos per moved item per frame no
+// matter how many items move.
+class LayoutAnimator : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit LayoutAnimator(QObject *parent = nullptr);
+    ~LayoutAnimator();
+
+    // Starts from wherever the items are now, including mid-animation
+    void animateTo(const QHash<QGraphicsItem*, QPointF> &targets);
+    void finish();
+    void forgetItem(QGraphicsItem *item);
+    bool isRunning() const;
+
+    void setDuration(int msecs);
+    int getDuration() const { return m_duration; }
+
+signals:
+    void finished();
+
+private slots:
+    void onValueChanged(const QVariant &value);
+    void onAnimationFinished();
+
+private:
+    struct Move {
+        QPointF from;
+        QPointF to;
+    };
+
+    // Animation state
+    QVariantAnimation *m_animation;
+    QHash<QGraphicsItem*, Move> m_moves;
+    int m_duration;
+
+    // Constants
+    static const int ANIMATION_DURATION = 250;
+    static const int MAX_ANIMATED_ITEMS = 2000; // larger batches are applied at once
+};
+
+#endif // LAYOUTANIMATOR_H
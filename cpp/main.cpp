@@ -1,10 +1,18 @@
 #include "mainwindow.h"
+#include "commandlinetool.h"
+#include "tracelog.h"
 
 #include <QApplication>
 #include <QStyleFactory>
 
 int main(int argc, char *argv[])
 {
+    // Headless commands (load, validate, stats, convert, export) never
+    // create a QApplication or any widget.
+    if (CommandLineTool::isRequested(argc, argv)) {
+        return CommandLineTool::exec(argc, argv);
+    }
+    
     QApplication a(argc, argv);
     
     // Set application properties
@@ -12,6 +20,7 @@ int main(int argc, char *argv[])
     a.setApplicationVersion("1.0.0");
     a.setOrganizationName("Mind2Do");
     a.setOrganizationDomain("mind2do.com");
+    TraceLog::startFromEnvironment();
     
     // Set application style
     a.setStyle(QStyleFactory::create("Fusion"));
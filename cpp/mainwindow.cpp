@@ -7,8 +7,12 @@
 #include "formattingtoolbar.h"
 #include "connectiontoolbar.h"
 #include "fileoperations.h"
+#include "quickjumppalette.h"
+#include "tracelog.h"
 
 #include <QApplication>
+#include <QClipboard>
+#include <QInputDialog>
 #include <QMenuBar>
 #include <QStatusBar>
 #include <QToolBar>
@@ -70,10 +74,12 @@ MainWindow::MainWindow(QWidget *parent)
     , m_formattingToolbar(nullptr)
     , m_connectionToolbar(nullptr)
     , m_fileOperations(nullptr)
+    , m_memoryReportPanel(nullptr)
     , m_documentViewerDock(nullptr)
     , m_formattingToolbarDock(nullptr)
     , m_connectionToolbarDock(nullptr)
     , m_fileOperationsDock(nullptr)
+    , m_memoryReportDock(nullptr)
     , m_fileMenu(nullptr)
     , m_editMenu(nullptr)
     , m_viewMenu(nullptr)
@@ -90,6 +96,7 @@ MainWindow::MainWindow(QWidget *parent)
     , m_connectionToolBar(nullptr)
     , m_formattingToolBar(nullptr)
     , m_mediaToolBar(nullptr)
+    , m_searchToolBar(nullptr)
     , m_newAction(nullptr)
     , m_openAction(nullptr)
     , m_saveAction(nullptr)
@@ -105,6 +112,8 @@ MainWindow::MainWindow(QWidget *parent)
     , m_deleteAction(nullptr)
     , m_selectAllAction(nullptr)
     , m_deselectAllAction(nullptr)
+    , m_findAction(nullptr)
+    , m_goToNodeAction(nullptr)
     , m_zoomInAction(nullptr)
     , m_zoomOutAction(nullptr)
     , m_resetZoomAction(nullptr)
@@ -113,6 +122,10 @@ MainWindow::MainWindow(QWidget *parent)
     , m_toggleGridAction(nullptr)
     , m_toggleAntialiasingAction(nullptr)
     , m_toggleOpenGLRenderingAction(nullptr)
+    , m_incompleteFilterAction(nullptr)
+    , m_autoLayoutAction(nullptr)
+    , m_radialLayoutAction(nullptr)
+    , m_forceLayoutAction(nullptr)
     , m_createNodeAction(nullptr)
     , m_deleteNodeAction(nullptr)
     , m_duplicateNodeAction(nullptr)
@@ -132,15 +145,24 @@ MainWindow::MainWindow(QWidget *parent)
     , m_aboutAction(nullptr)
     , m_helpAction(nullptr)
     , m_preferencesAction(nullptr)
+    , m_recordTraceAction(nullptr)
+    , m_saveTraceAction(nullptr)
     , m_statusBar(nullptr)
     , m_statusLabel(nullptr)
     , m_zoomLabel(nullptr)
     , m_nodeCountLabel(nullptr)
     , m_progressBar(nullptr)
+    , m_searchEdit(nullptr)
+    , m_searchResultIndex(-1)
+    , m_searchTruncated(false)
+    , m_quickJumpPalette(nullptr)
+    , m_imageExporter(nullptr)
+    , m_vectorExporter(nullptr)
     , m_settings(nullptr)
     , m_currentFilePath()
     , m_isModified(false)
     , m_autoSaveTimer(nullptr)
+    , m_memoryBudgetTimer(nullptr)
 {
     setupUI();
     setupActions();
@@ -150,6 +172,7 @@ MainWindow::MainWindow(QWidget *parent)
     setupStatusBar();
     setupConnections();
     setupAutoSave();
+    setupMemoryAccounting();
     loadSettings();
     
     setWindowTitle("Mind2Do - Mind Mapping Application");
@@ -167,12 +190,15 @@ void MainWindow::setupUI()
 {
     // Create core components
     m_fileManager = new FileManager(this);
+    m_fileManager->setupServices();
     m_scene = new MindMapScene(this);
     m_view = new MindMapView(this);
+    m_view->setupNotifier();
     
     // Set up the view
     m_view->setScene(m_scene);
     m_scene->setView(m_view);
+    m_scene->setupModel();
     
     // Set central widget
     setCentralWidget(m_view);
@@ -182,6 +208,7 @@ void MainWindow::setupUI()
     m_formattingToolbar = new FormattingToolbar(this);
     m_connectionToolbar = new ConnectionToolbar(this);
     m_fileOperations = new FileOperations(this);
+    m_memoryReportPanel = new MemoryReportPanel(this);
     
     // Set up file operations
     m_fileOperations->setScene(m_scene);
@@ -189,6 +216,15 @@ void MainWindow::setupUI()
     
     // Set up document viewer
     m_documentViewer->setFileManager(m_fileManager);
+    m_documentViewer->setMediaLibrary(m_scene->getMediaLibrary());
+    
+    // Set up quick jump palette
+    m_quickJumpPalette = new QuickJumpPalette(this);
+    m_quickJumpPalette->setScene(m_scene);
+    
+    // Background exporter
+    m_imageExporter = new TiledImageExporter(this);
+    m_vectorExporter = new VectorExporter(this);
 }
 
 void MainWindow::setupActions()
@@ -210,10 +246,45 @@ void MainWindow::setupActions()
     m_saveAsAction->setShortcut(QKeySequence::SaveAs);
     m_saveAsAction->setStatusTip("Save the mind map with a new name");
     
+    m_exportAction = new QAction("&Export...", this);
+    m_exportAction->setShortcut(QKeySequence("Ctrl+E"));
+    m_exportAction->setStatusTip("Export the mind map as an image, PDF or SVG");
+    
     m_exitAction = new QAction("E&xit", this);
     m_exitAction->setShortcut(QKeySequence::Quit);
     m_exitAction->setStatusTip("Exit the application");
     
+    // Edit actions
+    m_undoAction = new QAction("&Undo", this);
+    m_undoAction->setShortcut(QKeySequence::Undo);
+    m_undoAction->setStatusTip("Undo the last change");
+    m_undoAction->setEnabled(false);
+    
+    m_redoAction = new QAction("&Redo", this);
+    m_redoAction->setShortcut(QKeySequence::Redo);
+    m_redoAction->setStatusTip("Redo the last undone change");
+    m_redoAction->setEnabled(false);
+    
+    m_cutAction = new QAction("Cu&t", this);
+    m_cutAction->setShortcut(QKeySequence::Cut);
+    m_cutAction->setStatusTip("Move the selected branches to the clipboard");
+    
+    m_copyAction = new QAction("&Copy", this);
+    m_copyAction->setShortcut(QKeySequence::Copy);
+    m_copyAction->setStatusTip("Copy the selected branches, with media and links");
+    
+    m_pasteAction = new QAction("&Paste", this);
+    m_pasteAction->setShortcut(QKeySequence::Paste);
+    m_pasteAction->setStatusTip("Paste branches under the selected node");
+    
+    m_findAction = new QAction("&Find Node...", this);
+    m_findAction->setShortcut(QKeySequence::Find);
+    m_findAction->setStatusTip("Search node titles, descriptions and attachments");
+    
+    m_goToNodeAction = new QAction("&Go to Node...", this);
+    m_goToNodeAction->setShortcut(QKeySequence("Ctrl+P"));
+    m_goToNodeAction->setStatusTip("Jump to a node by fuzzy title match");
+    
     // View actions
     m_zoomInAction = new QAction("Zoom &In", this);
     m_zoomInAction->setShortcut(QKeySequence::ZoomIn);
@@ -227,6 +298,18 @@ void MainWindow::setupActions()
     m_resetZoomAction->setShortcut(QKeySequence("Ctrl+0"));
     m_resetZoomAction->setStatusTip("Reset zoom to 100%");
     
+    m_fitInViewAction = new QAction("&Fit to Window", this);
+    m_fitInViewAction->setShortcut(QKeySequence("Ctrl+9"));
+    m_fitInViewAction->setStatusTip("Zoom to show the whole map");
+    
+    m_centerOnContentAction = new QAction("&Center on Content", this);
+    m_centerOnContentAction->setShortcut(QKeySequence("Ctrl+Shift+C"));
+    m_centerOnContentAction->setStatusTip("Scroll the map into the middle of the window");
+    
+    m_incompleteFilterAction = new QAction("Show &Incomplete Only", this);
+    m_incompleteFilterAction->setCheckable(true);
+    m_incompleteFilterAction->setStatusTip("Dim completed tasks");
+    
     // Node actions
     m_createNodeAction = new QAction("&Add Node", this);
     m_createNodeAction->setShortcut(QKeySequence("Ctrl+N"));
@@ -235,6 +318,31 @@ void MainWindow::setupActions()
     m_deleteNodeAction = new QAction("&Delete Node", this);
     m_deleteNodeAction->setShortcut(QKeySequence::Delete);
     m_deleteNodeAction->setStatusTip("Delete the selected node");
+    
+    m_duplicateNodeAction = new QAction("D&uplicate Branch", this);
+    m_duplicateNodeAction->setShortcut(QKeySequence("Ctrl+D"));
+    m_duplicateNodeAction->setStatusTip("Duplicate the selected node and its subtree");
+    
+    m_autoLayoutAction = new QAction("Auto &Layout", this);
+    m_autoLayoutAction->setShortcut(QKeySequence("Ctrl+L"));
+    m_autoLayoutAction->setStatusTip("Arrange all nodes as a tidy tree");
+    
+    m_radialLayoutAction = new QAction("&Radial Layout", this);
+    m_radialLayoutAction->setCheckable(true);
+    m_radialLayoutAction->setStatusTip("Arrange the tree in rings around the root");
+    
+    m_forceLayoutAction = new QAction("&Force-Directed Layout", this);
+    m_forceLayoutAction->setCheckable(true);
+    m_forceLayoutAction->setStatusTip("Arrange nodes by their connections; toggle again to stop");
+    
+    // Diagnostics
+    m_recordTraceAction = new QAction("&Record Performance Trace", this);
+    m_recordTraceAction->setCheckable(true);
+    m_recordTraceAction->setChecked(TraceLog::isEnabled());
+    m_recordTraceAction->setStatusTip("Record timings of saving, loading, painting and file work");
+    
+    m_saveTraceAction = new QAction("Save Performance &Trace...", this);
+    m_saveTraceAction->setStatusTip("Save the recorded timings for chrome://tracing or Perfetto");
 }
 
 void MainWindow::setupMenus()
@@ -246,22 +354,48 @@ void MainWindow::setupMenus()
     m_fileMenu->addAction(m_saveAction);
     m_fileMenu->addAction(m_saveAsAction);
     m_fileMenu->addSeparator();
+    m_fileMenu->addAction(m_exportAction);
+    m_fileMenu->addSeparator();
     m_fileMenu->addAction(m_exitAction);
     
+    // Edit menu
+    m_editMenu = menuBar()->addMenu("&Edit");
+    m_editMenu->addAction(m_undoAction);
+    m_editMenu->addAction(m_redoAction);
+    m_editMenu->addSeparator();
+    m_editMenu->addAction(m_cutAction);
+    m_editMenu->addAction(m_copyAction);
+    m_editMenu->addAction(m_pasteAction);
+    m_editMenu->addSeparator();
+    m_editMenu->addAction(m_findAction);
+    m_editMenu->addAction(m_goToNodeAction);
+    
     // View menu
     m_viewMenu = menuBar()->addMenu("&View");
     m_viewMenu->addAction(m_zoomInAction);
     m_viewMenu->addAction(m_zoomOutAction);
     m_viewMenu->addAction(m_resetZoomAction);
+    m_viewMenu->addAction(m_fitInViewAction);
+    m_viewMenu->addAction(m_centerOnContentAction);
+    m_viewMenu->addSeparator();
+    m_viewMenu->addAction(m_incompleteFilterAction);
     
     // Node menu
     m_nodeMenu = menuBar()->addMenu("&Node");
     m_nodeMenu->addAction(m_createNodeAction);
     m_nodeMenu->addAction(m_deleteNodeAction);
+    m_nodeMenu->addAction(m_duplicateNodeAction);
+    m_nodeMenu->addSeparator();
+    m_nodeMenu->addAction(m_autoLayoutAction);
+    m_nodeMenu->addAction(m_radialLayoutAction);
+    m_nodeMenu->addAction(m_forceLayoutAction);
     
     // Help menu
     m_helpMenu = menuBar()->addMenu("&Help");
     m_aboutAction = new QAction("&About", this);
+    m_helpMenu->addAction(m_recordTraceAction);
+    m_helpMenu->addAction(m_saveTraceAction);
+    m_helpMenu->addSeparator();
     m_helpMenu->addAction(m_aboutAction);
 }
 
@@ -283,6 +417,14 @@ void MainWindow::setupToolbars()
     m_nodeToolBar = addToolBar("Node");
     m_nodeToolBar->addAction(m_createNodeAction);
     m_nodeToolBar->addAction(m_deleteNodeAction);
+    
+    // Search toolbar
+    m_searchToolBar = addToolBar("Search");
+    m_searchEdit = new QLineEdit();
+    m_searchEdit->setPlaceholderText("Search nodes...");
+    m_searchEdit->setClearButtonEnabled(true);
+    m_searchEdit->setMaximumWidth(260);
+    m_searchToolBar->addWidget(m_searchEdit);
 }
 
 void MainWindow::setupDockWidgets()
@@ -306,6 +448,15 @@ void MainWindow::setupDockWidgets()
     m_fileOperationsDock = new QDockWidget("File Operations", this);
     m_fileOperationsDock->setWidget(m_fileOperations);
     addDockWidget(Qt::LeftDockWidgetArea, m_fileOperationsDock);
+    
+    // Memory report dock, behind the document viewer until asked for
+    m_memoryReportDock = new QDockWidget("Memory", this);
+    m_memoryReportDock->setWidget(m_memoryReportPanel);
+    addDockWidget(Qt::RightDockWidgetArea, m_memoryReportDock);
+    tabifyDockWidget(m_documentViewerDock, m_memoryReportDock);
+    m_documentViewerDock->raise();
+    m_viewMenu->addSeparator();
+    m_viewMenu->addAction(m_memoryReportDock->toggleViewAction());
 }
 
 void MainWindow::setupStatusBar()
@@ -331,30 +482,88 @@ void MainWindow::setupConnections()
     connect(m_openAction, &QAction::triggered, this, &MainWindow::onOpenMindMap);
     connect(m_saveAction, &QAction::triggered, this, &MainWindow::onSaveMindMap);
     connect(m_saveAsAction, &QAction::triggered, this, &MainWindow::onSaveMindMapAs);
+    connect(m_exportAction, &QAction::triggered, this, &MainWindow::onExportMindMap);
+    connect(m_imageExporter, &TiledImageExporter::progress, this, &MainWindow::onExportProgress);
+    connect(m_imageExporter, &TiledImageExporter::finished, this, &MainWindow::onExportFinished);
+    connect(m_vectorExporter, &VectorExporter::progress, this, &MainWindow::onExportProgress);
+    connect(m_vectorExporter, &VectorExporter::finished, this, &MainWindow::onExportFinished);
     connect(m_exitAction, &QAction::triggered, this, &QWidget::close);
     
+    // Edit actions
+    connect(m_undoAction, &QAction::triggered, this, &MainWindow::onUndo);
+    connect(m_redoAction, &QAction::triggered, this, &MainWindow::onRedo);
+    connect(m_cutAction, &QAction::triggered, this, &MainWindow::onCut);
+    connect(m_copyAction, &QAction::triggered, this, &MainWindow::onCopy);
+    connect(m_pasteAction, &QAction::triggered, this, &MainWindow::onPaste);
+    connect(m_scene->getCommandHistory(), &CommandHistory::historyChanged, this, &MainWindow::updateActions);
+    connect(m_scene->getCommandHistory(), &CommandHistory::cleanChanged, this, [this](bool clean) {
+        m_isModified = !clean;
+        updateWindowTitle();
+    });
+    
     // View actions
     connect(m_zoomInAction, &QAction::triggered, this, &MainWindow::onZoomIn);
     connect(m_zoomOutAction, &QAction::triggered, this, &MainWindow::onZoomOut);
     connect(m_resetZoomAction, &QAction::triggered, this, &MainWindow::onResetZoom);
+    connect(m_fitInViewAction, &QAction::triggered, this, &MainWindow::onFitInView);
+    connect(m_centerOnContentAction, &QAction::triggered, this, &MainWindow::onCenterOnContent);
+    connect(m_incompleteFilterAction, &QAction::toggled, this, &MainWindow::onToggleIncompleteFilter);
+    connect(m_autoLayoutAction, &QAction::triggered, this, &MainWindow::onAutoLayout);
+    connect(m_radialLayoutAction, &QAction::toggled, this, &MainWindow::onToggleRadialLayout);
+    connect(m_forceLayoutAction, &QAction::toggled, this, &MainWindow::onToggleForceLayout);
+    connect(m_scene->getForceLayout(), &ForceLayoutSimulation::finished, this, &MainWindow::onForceLayoutFinished);
     
     // Node actions
     connect(m_createNodeAction, &QAction::triggered, this, &MainWindow::onCreateNode);
     connect(m_deleteNodeAction, &QAction::triggered, this, &MainWindow::onDeleteNode);
+    connect(m_duplicateNodeAction, &QAction::triggered, this, &MainWindow::duplicateNode);
     
     // Scene signals
     connect(m_scene, &MindMapScene::nodeSelected, this, &MainWindow::onNodeSelected);
     connect(m_scene, &MindMapScene::nodeDeselected, this, &MainWindow::onNodeDeselected);
     connect(m_scene, &MindMapScene::nodeCreated, this, &MainWindow::onNodeCreated);
     connect(m_scene, &MindMapScene::nodeDeleted, this, &MainWindow::onNodeDeleted);
-    connect(m_scene, &MindMapScene::nodeMoved, this, &MainWindow::onNodeMoved);
+    connect(m_scene, &MindMapScene::sceneChanged, this, &MainWindow::onSceneChanged);
+    connect(m_scene->getProgressTracker(), &ProgressTracker::statsChanged, this, &MainWindow::updateStatusBar);
+    
+    // The toolbar edits the selected node directly; have the scene re-read it
+    connect(m_formattingToolbar, &FormattingToolbar::formattingChanged, this, [this]() {
+        for (MindMapNode *node : m_scene->getSelectedNodes()) {
+            m_scene->refreshNode(node);
+        }
+    });
+    
+    // Moves and scrolls arrive at most once per frame, as one batch
+    NotificationCoalescer *notifier = m_view->getNotifier();
+    connect(m_scene, &MindMapScene::nodeMoved, notifier, [notifier](MindMapNode *node, const QPointF &position) {
+        notifier->nodeMoved(node->getId(), position);
+    });
+    connect(m_scene, &MindMapScene::nodeDeleted, notifier, [notifier](MindMapNode *node) {
+        notifier->forgetNode(node->getId());
+    });
+    connect(m_view, &MindMapView::viewportChanged, notifier, &NotificationCoalescer::viewportChanged);
+    connect(notifier, &NotificationCoalescer::nodesMoved, this, &MainWindow::onNodesMoved);
+    connect(notifier, &NotificationCoalescer::viewportSettled, this, &MainWindow::onViewportChanged);
     
     // View signals
     connect(m_view, &MindMapView::zoomChanged, this, &MainWindow::onZoomChanged);
-    connect(m_view, &MindMapView::viewportChanged, this, &MainWindow::onViewportChanged);
+    
+    // Search
+    connect(m_findAction, &QAction::triggered, this, &MainWindow::onFind);
+    connect(m_searchEdit, &QLineEdit::textChanged, this, &MainWindow::onSearchTextChanged);
+    connect(m_searchEdit, &QLineEdit::returnPressed, this, &MainWindow::onSearchNext);
+    connect(m_goToNodeAction, &QAction::triggered, this, &MainWindow::onGoToNode);
+    connect(m_quickJumpPalette, &QuickJumpPalette::nodeChosen, this, &MainWindow::onQuickJumpNodeChosen);
+    
+    // Memory report
+    connect(m_memoryReportPanel, &MemoryReportPanel::overBudget, this, [this](const QStringList &categories) {
+        m_statusLabel->setText("Over memory budget: " + categories.join(", "));
+    });
     
     // Help actions
     connect(m_aboutAction, &QAction::triggered, this, &MainWindow::onAbout);
+    connect(m_recordTraceAction, &QAction::toggled, this, &MainWindow::onToggleTraceRecording);
+    connect(m_saveTraceAction, &QAction::triggered, this, &MainWindow::onSaveTrace);
 }
 
 void MainWindow::setupAutoSave()
@@ -364,6 +573,48 @@ void MainWindow::setupAutoSave()
     m_autoSaveTimer->start(5000); // 5 seconds
 }
 
+void MainWindow::setupMemoryAccounting()
+{
+    // One walk of the scene per report. The media library goes first, so
+    // thumbnails it shares with nodes count once, as the cache.
+    MemoryLedger::addProbe(this, [this](MemoryLedger::Sample &sample) {
+        m_scene->getMediaLibrary()->measureMemory(sample);
+        m_fileManager->measureMemory(sample);
+        for (MindMapNode *node : m_scene->getAllNodes()) {
+            node->measureMemory(sample);
+        }
+        for (ConnectionLine *line : m_scene->getConnections()) {
+            sample.add(MemoryLedger::Connections, sizeof(ConnectionLine)
+                       + line->getRoutedPath().elementCount() * qint64(sizeof(QPainterPath::Element)));
+        }
+        const CommandHistory *history = m_scene->getCommandHistory();
+        sample.add(MemoryLedger::UndoHistory, history->memoryUsed(), history->count());
+    });
+    
+    // The dock checks budgets on every refresh while it is open; this
+    // catches growth while it is closed.
+    m_memoryBudgetTimer = new QTimer(this);
+    connect(m_memoryBudgetTimer, &QTimer::timeout, this, &MainWindow::onCheckMemoryBudgets);
+    m_memoryBudgetTimer->start(MEMORY_BUDGET_CHECK_INTERVAL);
+}
+
+void MainWindow::onCheckMemoryBudgets()
+{
+    if (m_memoryReportDock->isVisible()) {
+        return;
+    }
+    
+    QStringList overBudget;
+    for (const MemoryLedger::Usage &usage : MemoryLedger::report()) {
+        if (usage.isOverBudget()) {
+            overBudget.append(usage.name);
+        }
+    }
+    if (!overBudget.isEmpty()) {
+        m_statusLabel->setText("Over memory budget: " + overBudget.join(", "));
+    }
+}
+
 void MainWindow::saveSettings()
 {
     if (!m_settings) {
@@ -400,6 +651,13 @@ void MainWindow::loadSettings()
     
     bool openGLRendering = m_settings->value("openGLRendering", false).toBool();
     m_view->setOpenGLRendering(openGLRendering);
+    
+    // Memory budgets in MB, e.g. memoryBudget/thumbnailCache=64
+    for (int i = 0; i < MemoryLedger::CategoryCount; ++i) {
+        const MemoryLedger::Category category = MemoryLedger::Category(i);
+        const qint64 megabytes = m_settings->value("memoryBudget/" + MemoryLedger::categoryKey(category), 0).toLongLong();
+        MemoryLedger::setBudget(category, megabytes * 1024 * 1024);
+    }
 }
 
 // File slots
@@ -418,6 +676,8 @@ void MainWindow::onNewMindMap()
     }
     
     m_scene->clearScene();
+    m_scene->syncModel();
+    m_scene->getCommandHistory()->clear();
     m_currentFilePath.clear();
     m_isModified = false;
     updateWindowTitle();
@@ -430,7 +690,9 @@ void MainWindow::onOpenMindMap()
         m_currentFilePath, "Mind Map Files (*.json);;All Files (*.*)");
     
     if (!filePath.isEmpty()) {
+        TRACE_SCOPE("loadMindMap");
         m_scene->loadMindMap(filePath);
+        m_scene->getCommandHistory()->clear();
         m_currentFilePath = filePath;
         m_isModified = false;
         updateWindowTitle();
@@ -443,7 +705,9 @@ void MainWindow::onSaveMindMap()
     if (m_currentFilePath.isEmpty()) {
         onSaveMindMapAs();
     } else {
+        TRACE_SCOPE("saveMindMap");
         m_scene->saveMindMap(m_currentFilePath);
+        m_scene->getCommandHistory()->setClean();
         m_isModified = false;
         updateWindowTitle();
         m_statusLabel->setText("Mind map saved");
@@ -456,7 +720,9 @@ void MainWindow::onSaveMindMapAs()
         m_currentFilePath, "Mind Map Files (*.json);;All Files (*.*)");
     
     if (!filePath.isEmpty()) {
+        TRACE_SCOPE("saveMindMap");
         m_scene->saveMindMap(filePath);
+        m_scene->getCommandHistory()->setClean();
         m_currentFilePath = filePath;
         m_isModified = false;
         updateWindowTitle();
@@ -464,6 +730,180 @@ void MainWindow::onSaveMindMapAs()
     }
 }
 
+void MainWindow::onExportMindMap()
+{
+    const QString filePath = QFileDialog::getSaveFileName(this, "Export Mind Map", QString(),
+        "TIFF Image, any size (*.tif *.tiff);;PDF Document (*.pdf);;SVG Image (*.svg);;PNG Image (*.png)");
+    if (filePath.isEmpty()) {
+        return;
+    }
+
+    const QRectF area = m_scene->contentRect().adjusted(-EXPORT_MARGIN, -EXPORT_MARGIN, EXPORT_MARGIN, EXPORT_MARGIN);
+    if (m_scene->contentRect().isNull()) {
+        m_statusLabel->setText("Nothing to export");
+        return;
+    }
+
+    if (m_imageExporter->isRunning() || m_vectorExporter->isRunning()) {
+        m_statusLabel->setText("An export is already running");
+        return;
+    }
+
+    const QString suffix = QFileInfo(filePath).suffix().toLower();
+    if (suffix == "pdf" || suffix == "svg") {
+        exportVector(filePath, area);
+        return;
+    }
+    if (suffix != "tif" && suffix != "tiff") {
+        m_scene->exportToImage(filePath);
+        m_statusLabel->setText("Exported: " + QFileInfo(filePath).fileName());
+        return;
+    }
+
+    // TIFF is written tile by tile in the background from a snapshot, so
+    // resolution is bounded by disk space only and editing can continue.
+    bool ok = false;
+    const int dpi = QInputDialog::getInt(this, "Export Resolution", "Dots per inch:",
+                                         DEFAULT_EXPORT_DPI, 72, 1200, 1, &ok);
+    if (!ok) {
+        return;
+    }
+    if (!m_imageExporter->start(m_scene->snapshotNodes(), area, dpi, filePath)) {
+        m_statusLabel->setText("An export is already running");
+        return;
+    }
+
+    const QSize size = TiledImageExporter::outputSize(area, dpi);
+    m_progressBar->setRange(0, 0);
+    m_progressBar->setVisible(true);
+    m_statusLabel->setText(QString("Exporting %1 x %2 px...").arg(size.width()).arg(size.height()));
+}
+
+void MainWindow::exportVector(const QString &filePath, const QRectF &area)
+{
+    // Large maps default to simplified geometry; both stay available.
+    const QStringList details = {"Full detail", "Simplified (boxes and lines only)"};
+    const PersistentNodeStore nodes = m_scene->snapshotNodes();
+    const int nodeCount = nodes.size();
+    bool ok = false;
+    const QString detailChoice = QInputDialog::getItem(this, "Export Detail", "Node detail:", details,
+                                                       nodeCount > SIMPLIFIED_EXPORT_NODES ? 1 : 0, false, &ok);
+    if (!ok) {
+        return;
+    }
+    const SnapshotRenderer::Detail detail = detailChoice == details.first()
+        ? SnapshotRenderer::FullDetail : SnapshotRenderer::Simplified;
+
+    bool started = false;
+    if (QFileInfo(filePath).suffix().toLower() == "svg") {
+        started = m_vectorExporter->exportSvg(nodes, area, filePath, detail);
+    } else {
+        // Poster layout: the map is scaled to span N pages across and as
+        // many pages down as that takes.
+        const int pagesAcross = QInputDialog::getInt(this, "PDF Pages", "Pages across:",
+                                                     1, 1, MAX_PDF_PAGES_ACROSS, 1, &ok);
+        if (!ok) {
+            return;
+        }
+        const QPageLayout layout = VectorExporter::posterLayout(area);
+        const qreal scale = VectorExporter::scaleForPagesAcross(area, layout, pagesAcross);
+        started = m_vectorExporter->exportPdf(nodes, area, filePath, layout, scale, detail);
+    }
+
+    if (!started) {
+        m_statusLabel->setText("An export is already running");
+        return;
+    }
+    m_progressBar->setRange(0, 0);
+    m_progressBar->setVisible(true);
+    m_statusLabel->setText("Exporting " + QFileInfo(filePath).fileName() + "...");
+}
+
+void MainWindow::onExportProgress(int done, int total)
+{
+    m_progressBar->setRange(0, total);
+    m_progressBar->setValue(done);
+}
+
+void MainWindow::onExportFinished(bool success, const QString &message)
+{
+    m_progressBar->setVisible(false);
+    m_statusLabel->setText(success ? message : "Export failed: " + message);
+}
+
+// Edit slots
+void MainWindow::onUndo()
+{
+    CommandHistory *history = m_scene->getCommandHistory();
+    if (history->canUndo()) {
+        const QString text = history->undoText();
+        {
+            // One sceneChanged() and one repaint for the whole step. The
+            // history applies the step itself, so nothing is recorded.
+            SceneTransactionGuard transaction(m_scene->getTransaction(), text, false);
+            history->undo();
+        }
+        m_statusLabel->setText("Undid " + text);
+    }
+}
+
+void MainWindow::onRedo()
+{
+    CommandHistory *history = m_scene->getCommandHistory();
+    if (history->canRedo()) {
+        const QString text = history->redoText();
+        {
+            // One sceneChanged() and one repaint for the whole step. The
+            // history applies the step itself, so nothing is recorded.
+            SceneTransactionGuard transaction(m_scene->getTransaction(), text, false);
+            history->redo();
+        }
+        m_statusLabel->setText("Redid " + text);
+    }
+}
+
+void MainWindow::onCut()
+{
+    const QStringList rootIds = selectedNodeIds();
+    if (rootIds.isEmpty()) {
+        return;
+    }
+    onCopy();
+    removeBranches(rootIds, "Cut");
+}
+
+void MainWindow::onCopy()
+{
+    const QStringList rootIds = selectedNodeIds();
+    if (rootIds.isEmpty()) {
+        return;
+    }
+    const SubtreeFragment fragment = SubtreeFragment::capture(m_scene, rootIds);
+    QApplication::clipboard()->setMimeData(fragment.toMimeData());
+    m_statusLabel->setText(QString("Copied %1 nodes").arg(fragment.count()));
+}
+
+void MainWindow::onPaste()
+{
+    SubtreeFragment fragment;
+    if (!SubtreeFragment::fromMimeData(QApplication::clipboard()->mimeData(), &fragment)) {
+        m_statusLabel->setText("Nothing to paste");
+        return;
+    }
+
+    // Under the selected node, or at the centre of the view
+    const QList<MindMapNode*> selectedNodes = m_scene->getSelectedNodes();
+    if (!selectedNodes.isEmpty()) {
+        MindMapNode *parent = selectedNodes.first();
+        pasteFragment(fragment, parent->getId(),
+                      parent->getPosition() + QPointF(PASTE_OFFSET, parent->boundingRect().height() + PASTE_OFFSET),
+                      "Paste");
+    } else {
+        const QPointF center = m_view->QGraphicsView::mapToScene(m_view->viewport()->rect().center());
+        pasteFragment(fragment, QString(), center, "Paste");
+    }
+}
+
 // View slots
 void MainWindow::onZoomIn()
 {
@@ -480,6 +920,63 @@ void MainWindow::onResetZoom()
     m_view->resetZoom();
 }
 
+void MainWindow::onFitInView()
+{
+    m_view->fitInView();
+}
+
+void MainWindow::onCenterOnContent()
+{
+    m_view->centerOnContent();
+}
+
+void MainWindow::onToggleIncompleteFilter(bool enabled)
+{
+    if (enabled) {
+        TaskFilterQuery query;
+        query.completed = TaskFilterQuery::No;
+        m_scene->getTaskFilter()->apply(query, TaskFilterController::DimNonMatching);
+        m_statusLabel->setText(QString("%1 incomplete tasks").arg(m_scene->getTaskFilter()->matchCount()));
+    } else {
+        m_scene->getTaskFilter()->clearFilter();
+        m_statusLabel->setText("Filter cleared");
+    }
+}
+
+void MainWindow::onAutoLayout()
+{
+    m_scene->autoLayout();
+    const TreeLayoutEngine *layout = m_scene->getTreeLayout();
+    m_statusLabel->setText(QString("Laid out %1 nodes in %2 ms")
+        .arg(layout->lastVisitedCount())
+        .arg(layout->lastLayoutNsecs() / 1000000.0, 0, 'f', 1));
+}
+
+void MainWindow::onToggleRadialLayout(bool enabled)
+{
+    m_scene->setLayoutStyle(enabled ? TreeLayoutEngine::Radial : TreeLayoutEngine::LeftRight);
+    m_scene->autoLayout();
+}
+
+void MainWindow::onToggleForceLayout(bool enabled)
+{
+    if (enabled) {
+        m_scene->startForceLayout();
+        m_statusLabel->setText("Force-directed layout running...");
+    } else {
+        m_scene->stopForceLayout();
+    }
+}
+
+void MainWindow::onForceLayoutFinished(int iterations, bool converged)
+{
+    QSignalBlocker blocker(m_forceLayoutAction);
+    m_forceLayoutAction->setChecked(false);
+    m_statusLabel->setText(QString("Force-directed layout %1 after %2 iterations")
+        .arg(converged ? "settled" : "stopped")
+        .arg(iterations));
+}
+
 // Node slots
 void MainWindow::onCreateNode()
 {
@@ -499,6 +996,12 @@ void MainWindow::onNodeSelected(MindMapNode *node)
 {
     m_documentViewer->setSelectedNode(node);
     m_formattingToolbar->setSelectedNode(node);
+    if (node) {
+        const NodeProgress progress = node->getProgress();
+        if (progress.hasSubtasks()) {
+            m_statusLabel->setText(progress.label());
+        }
+    }
     updateStatusBar();
 }
 
@@ -523,10 +1026,104 @@ void MainWindow::onNodeDeleted(MindMapNode *node)
     updateStatusBar();
 }
 
-void MainWindow::onNodeMoved(MindMapNode *node, const QPointF &position)
+void MainWindow::onNodesMoved(const QHash<QString, QPointF> &positions)
+{
+    m_isModified = true;
+    updateWindowTitle();
+    if (positions.size() > 1) {
+        m_statusLabel->setText(QString("Moved %1 nodes").arg(positions.size()));
+    }
+}
+
+void MainWindow::onSceneChanged(const SceneChangeSet &changes)
 {
+    // One delivery per transaction, however many nodes it touched
     m_isModified = true;
     updateWindowTitle();
+    updateStatusBar();
+    if (changes.size() > 1) {
+        m_statusLabel->setText(QString("%1 nodes added, %2 removed, %3 changed")
+            .arg(changes.createdNodes.size())
+            .arg(changes.deletedNodes.size())
+            .arg(changes.modifiedNodes.size()));
+    }
+}
+
+void MainWindow::duplicateNode()
+{
+    const QStringList rootIds = selectedNodeIds();
+    if (rootIds.isEmpty()) {
+        return;
+    }
+    MindMapNode *first = m_scene->getNode(rootIds.first());
+    const SubtreeFragment fragment = SubtreeFragment::capture(m_scene, rootIds);
+    pasteFragment(fragment, first->getParentId(), first->getPosition() + QPointF(PASTE_OFFSET, PASTE_OFFSET), "Duplicate");
+}
+
+// Search slots
+void MainWindow::onFind()
+{
+    m_searchToolBar->show();
+    m_searchEdit->setFocus();
+    m_searchEdit->selectAll();
+}
+
+void MainWindow::onSearchTextChanged(const QString &text)
+{
+    m_searchResults = m_scene->getSearchIndex()->search(text, SearchIndex::DEFAULT_LIMIT, &m_searchTruncated);
+    m_searchResultIndex = -1;
+    
+    if (text.trimmed().isEmpty()) {
+        m_statusLabel->setText("Ready");
+    } else if (m_searchResults.isEmpty()) {
+        m_statusLabel->setText("No matches");
+    } else {
+        jumpToSearchResult(0);
+    }
+}
+
+void MainWindow::onSearchNext()
+{
+    if (m_searchResults.isEmpty()) {
+        return;
+    }
+    jumpToSearchResult((m_searchResultIndex + 1) % m_searchResults.size());
+}
+
+void MainWindow::onGoToNode()
+{
+    m_quickJumpPalette->popup();
+}
+
+void MainWindow::onQuickJumpNodeChosen(const QString &nodeId)
+{
+    MindMapNode *node = m_scene->getNode(nodeId);
+    if (node) {
+        focusNode(node);
+    }
+}
+
+void MainWindow::jumpToSearchResult(int index)
+{
+    MindMapNode *node = m_scene->getNode(m_searchResults.at(index).nodeId);
+    if (!node) {
+        return;
+    }
+    
+    m_searchResultIndex = index;
+    focusNode(node);
+    QString status = QString("Match %1 of %2").arg(index + 1).arg(m_searchResults.size());
+    if (m_searchTruncated) {
+        status += " (only the most common completions; type more to narrow)";
+    }
+    m_statusLabel->setText(status);
+}
+
+void MainWindow::focusNode(MindMapNode *node)
+{
+    m_scene->clearSelection();
+    m_scene->selectNode(node);
+    m_view->centerOn(node->sceneBoundingRect().center());
 }
 
 // Status slots
@@ -543,6 +1140,7 @@ void MainWindow::onViewportChanged()
 void MainWindow::onAutoSaveTimeout()
 {
     if (m_isModified) {
+        TRACE_SCOPE("autoSave");
         m_scene->autoSave();
         m_statusLabel->setText("Auto-saved");
     }
@@ -564,6 +1162,32 @@ void MainWindow::onAbout()
         "Built with Qt 6.x and C++17");
 }
 
+void MainWindow::onToggleTraceRecording(bool enabled)
+{
+    // Each recording starts from an empty trace
+    if (enabled && !TraceLog::isEnabled()) {
+        TraceLog::clear();
+    }
+    TraceLog::setEnabled(enabled);
+    m_statusLabel->setText(enabled ? "Recording performance trace" : "Performance trace stopped");
+}
+
+void MainWindow::onSaveTrace()
+{
+    const QString filePath = QFileDialog::getSaveFileName(this, "Save Performance Trace",
+        "mind2do-trace.json", "Trace Files (*.json)");
+    if (filePath.isEmpty()) {
+        return;
+    }
+    
+    QString error;
+    if (TraceLog::writeChromeTrace(filePath, &error)) {
+        m_statusLabel->setText("Trace saved: " + QFileInfo(filePath).fileName());
+    } else {
+        QMessageBox::warning(this, "Save Performance Trace", error);
+    }
+}
+
 void MainWindow::updateWindowTitle()
 {
     QString title = "Mind2Do";
@@ -576,10 +1200,125 @@ void MainWindow::updateWindowTitle()
     setWindowTitle(title);
 }
 
+QStringList MainWindow::selectedNodeIds() const
+{
+    QList<MindMapNode*> nodes = m_scene->getMultiSelectedNodes();
+    if (nodes.isEmpty()) {
+        nodes = m_scene->getSelectedNodes();
+    }
+    QStringList nodeIds;
+    nodeIds.reserve(nodes.size());
+    for (MindMapNode *node : nodes) {
+        nodeIds.append(node->getId());
+    }
+    return nodeIds;
+}
+
+void MainWindow::pasteFragment(const SubtreeFragment &fragment, const QString &parentId, const QPointF &anchor, const QString &text)
+{
+    if (fragment.isEmpty()) {
+        return;
+    }
+
+    // Fresh ids in one pass, then one batched insert: a single sceneChanged()
+    // and a single undo step however large the branch is.
+    QVector<NodeSnapshot> nodes;
+    QVector<ConnectionDelta> links;
+    fragment.instantiate(parentId, anchor, &nodes, &links);
+
+    SceneTransaction *transaction = m_scene->getTransaction();
+    SceneTransactionGuard guard(transaction, text);
+    m_scene->insertNodes(nodes);
+    m_scene->connectNodes(links);
+
+    HistoryCommand *command = transaction->historyCommand();
+    for (const NodeSnapshot &node : nodes) {
+        command->addInsert(node);
+    }
+    for (const ConnectionDelta &link : links) {
+        command->addConnect(link.fromId, link.toId);
+    }
+    m_statusLabel->setText(QString("%1: %2 nodes").arg(text).arg(nodes.size()));
+}
+
+void MainWindow::removeBranches(const QStringList &rootIds, const QString &text)
+{
+    // Preorder snapshots, so undo re-inserts parents before their children
+    QVector<NodeSnapshot> removed;
+    QVector<ConnectionDelta> links;
+    QSet<QString> seen;
+    QStringList stack;
+    for (int i = rootIds.size() - 1; i >= 0; --i) {
+        stack.append(rootIds.at(i));
+    }
+    while (!stack.isEmpty()) {
+        const QString nodeId = stack.takeLast();
+        MindMapNode *node = m_scene->getNode(nodeId);
+        if (!node || seen.contains(nodeId)) {
+            continue;
+        }
+        seen.insert(nodeId);
+        removed.append(NodeSnapshot::fromNode(node));
+        for (const QString &targetId : node->getConnections()) {
+            ConnectionDelta link;
+            link.fromId = nodeId;
+            link.toId = targetId;
+            links.append(link);
+        }
+        const QStringList children = node->getChildren();
+        for (int i = children.size() - 1; i >= 0; --i) {
+            stack.append(children.at(i));
+        }
+    }
+    
+    // Cross-links from nodes that survive into the removed branches. Only
+    // sources store connections, so this takes one pass over the rest.
+    const QList<MindMapNode*> allNodes = m_scene->getAllNodes();
+    for (MindMapNode *node : allNodes) {
+        if (seen.contains(node->getId())) {
+            continue;
+        }
+        for (const QString &targetId : node->getConnections()) {
+            if (seen.contains(targetId)) {
+                ConnectionDelta link;
+                link.fromId = node->getId();
+                link.toId = targetId;
+                links.append(link);
+            }
+        }
+    }
+
+    SceneTransaction *transaction = m_scene->getTransaction();
+    SceneTransactionGuard guard(transaction, text);
+    HistoryCommand *command = transaction->historyCommand();
+    for (const ConnectionDelta &link : links) {
+        command->addDisconnect(link.fromId, link.toId);
+    }
+    for (const NodeSnapshot &node : removed) {
+        command->addRemove(node);
+    }
+    m_scene->disconnectNodes(links);
+    m_scene->removeNodes(QStringList(seen.begin(), seen.end()));
+}
+
+void MainWindow::updateActions()
+{
+    const CommandHistory *history = m_scene->getCommandHistory();
+    m_undoAction->setEnabled(history->canUndo());
+    m_undoAction->setText(history->canUndo() ? "&Undo " + history->undoText() : "&Undo");
+    m_redoAction->setEnabled(history->canRedo());
+    m_redoAction->setText(history->canRedo() ? "&Redo " + history->redoText() : "&Redo");
+}
+
 void MainWindow::updateStatusBar()
 {
-    int nodeCount = m_scene->getAllNodes().size();
-    m_nodeCountLabel->setText(QString("Nodes: %1").arg(nodeCount));
+    // Counters are maintained incrementally; no walk over the nodes here.
+    const MapProgressStats stats = m_scene->getProgressStats();
+    m_nodeCountLabel->setText(QString("Nodes: %1 | Done: %2/%3 (%4%)")
+        .arg(stats.totalNodes)
+        .arg(stats.completedNodes)
+        .arg(stats.totalNodes)
+        .arg(qRound(stats.ratio() * 100)));
 }
 
 void MainWindow::closeEvent(QCloseEvent *event)
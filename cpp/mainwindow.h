@@ -66,6 +66,11 @@
 #include "formattingtoolbar.h"
 #include "connectiontoolbar.h"
 #include "fileoperations.h"
+#include "quickjumppalette.h"
+#include "subtreefragment.h"
+#include "tiledimageexporter.h"
+#include "vectorexporter.h"
+#include "memoryreportpanel.h"
 
 QT_BEGIN_NAMESPACE
 class QAction;
@@ -207,6 +212,8 @@ private slots:
     void onSaveMindMap();
     void onSaveMindMapAs();
     void onExportMindMap();
+    void onExportProgress(int done, int total);
+    void onExportFinished(bool success, const QString &message);
     void onImportMindMap();
     void onRecentFile();
 
@@ -229,6 +236,11 @@ private slots:
     void onToggleGrid();
     void onToggleAntialiasing();
     void onToggleOpenGLRendering();
+    void onToggleIncompleteFilter(bool enabled);
+    void onAutoLayout();
+    void onToggleRadialLayout(bool enabled);
+    void onToggleForceLayout(bool enabled);
+    void onForceLayoutFinished(int iterations, bool converged);
 
     // Node slots
     void onCreateNode();
@@ -238,7 +250,8 @@ private slots:
     void onNodeDeselected(MindMapNode *node);
     void onNodeCreated(MindMapNode *node);
     void onNodeDeleted(MindMapNode *node);
-    void onNodeMoved(MindMapNode *node, const QPointF &position);
+    void onNodesMoved(const QHash<QString, QPointF> &positions);
+    void onSceneChanged(const SceneChangeSet &changes);
 
     // Connection slots
     void onCreateConnection();
@@ -261,13 +274,23 @@ private slots:
     void onRemoveMedia();
     void onOpenMedia();
 
+    // Search slots
+    void onFind();
+    void onSearchTextChanged(const QString &text);
+    void onSearchNext();
+    void onGoToNode();
+    void onQuickJumpNodeChosen(const QString &nodeId);
+
     // Help slots
     void onAbout();
     void onHelp();
     void onPreferences();
+    void onToggleTraceRecording(bool enabled);
+    void onSaveTrace();
 
     // Auto-save slots
     void onAutoSaveTimeout();
+    void onCheckMemoryBudgets();
     void onMindMapSaved();
     void onMindMapLoaded();
 
@@ -287,12 +310,14 @@ private:
     FormattingToolbar *m_formattingToolbar;
     ConnectionToolbar *m_connectionToolbar;
     FileOperations *m_fileOperations;
+    MemoryReportPanel *m_memoryReportPanel;
 
     // UI components
     QDockWidget *m_documentViewerDock;
     QDockWidget *m_formattingToolbarDock;
     QDockWidget *m_connectionToolbarDock;
     QDockWidget *m_fileOperationsDock;
+    QDockWidget *m_memoryReportDock;
 
     // Menus
     QMenu *m_fileMenu;
@@ -313,6 +338,7 @@ private:
     QToolBar *m_connectionToolBar;
     QToolBar *m_formattingToolBar;
     QToolBar *m_mediaToolBar;
+    QToolBar *m_searchToolBar;
 
     // Actions
     QAction *m_newAction;
@@ -331,6 +357,8 @@ private:
     QAction *m_deleteAction;
     QAction *m_selectAllAction;
     QAction *m_deselectAllAction;
+    QAction *m_findAction;
+    QAction *m_goToNodeAction;
 
     QAction *m_zoomInAction;
     QAction *m_zoomOutAction;
@@ -340,6 +368,10 @@ private:
     QAction *m_toggleGridAction;
     QAction *m_toggleAntialiasingAction;
     QAction *m_toggleOpenGLRenderingAction;
+    QAction *m_incompleteFilterAction;
+    QAction *m_autoLayoutAction;
+    QAction *m_radialLayoutAction;
+    QAction *m_forceLayoutAction;
 
     QAction *m_createNodeAction;
     QAction *m_deleteNodeAction;
@@ -364,6 +396,8 @@ private:
     QAction *m_aboutAction;
     QAction *m_helpAction;
     QAction *m_preferencesAction;
+    QAction *m_recordTraceAction;
+    QAction *m_saveTraceAction;
 
     // Status bar
     QStatusBar *m_statusBar;
@@ -372,6 +406,17 @@ private:
     QLabel *m_nodeCountLabel;
     QProgressBar *m_progressBar;
 
+    // Search
+    QLineEdit *m_searchEdit;
+    QList<SearchResult> m_searchResults;
+    int m_searchResultIndex;
+    bool m_searchTruncated;
+    QuickJumpPalette *m_quickJumpPalette;
+
+    // Export
+    TiledImageExporter *m_imageExporter;
+    VectorExporter *m_vectorExporter;
+
     // Settings
     QSettings *m_settings;
     QStringList m_recentFiles;
@@ -381,6 +426,9 @@ private:
     // Auto-save
     QTimer *m_autoSaveTimer;
 
+    // Memory budgets, checked whether or not the report dock is open
+    QTimer *m_memoryBudgetTimer;
+
     // Methods
     void setupActions();
     void setupMenus();
@@ -394,6 +442,13 @@ private:
     void saveSettings();
     void loadSettings();
     void setupAutoSave();
+    void setupMemoryAccounting();
+    void jumpToSearchResult(int index);
+    void focusNode(MindMapNode *node);
+    QStringList selectedNodeIds() const;
+    void pasteFragment(const SubtreeFragment &fragment, const QString &parentId, const QPointF &anchor, const QString &text);
+    void removeBranches(const QStringList &rootIds, const QString &text);
+    void exportVector(const QString &filePath, const QRectF &area);
     void updateActions();
     void updateMenus();
     void updateToolbars();
@@ -412,6 +467,12 @@ private:
     // Constants
     static const int MAX_RECENT_FILES = 10;
     static const int AUTO_SAVE_INTERVAL = 5000; // 5 seconds
+    static const int MEMORY_BUDGET_CHECK_INTERVAL = 60000; // 1 minute
+    static const int PASTE_OFFSET = 40; // pasted and duplicated branches sit this far from their source
+    static const int EXPORT_MARGIN = 40;
+    static const int DEFAULT_EXPORT_DPI = 300;
+    static const int SIMPLIFIED_EXPORT_NODES = 5000; // vector exports above this default to simplified detail
+    static const int MAX_PDF_PAGES_ACROSS = 20;
     static const QString SETTINGS_GROUP_MAIN_WINDOW;
     static const QString SETTINGS_KEY_GEOMETRY;
     static const QString SETTINGS_KEY_STATE;
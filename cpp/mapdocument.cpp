@@ -0,0 +1,511 @@
+#include "mapdocument.h"
+#include "tracelog.h"
+#include "memoryledger.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QJsonArray>
+#include <QJsonParseError>
+#include <QHash>
+#include <QUrl>
+#include <QVector>
+
+#include <algorithm>
+
+const char MapDocument::BINARY_SUFFIX[] = "m2d";
+
+namespace {
+
+// Store order follows qHash, which is seeded per process; files list nodes
+// by id instead, so saving the same map twice gives the same bytes.
+QVector<NodeRecordPtr> recordsById(const PersistentNodeStore &nodes)
+{
+    QVector<NodeRecordPtr> records;
+    records.reserve(nodes.size());
+    nodes.forEach([&records](const NodeRecordPtr &record) {
+        records.append(record);
+    });
+    std::sort(records.begin(), records.end(), [](const NodeRecordPtr &a, const NodeRecordPtr &b) {
+        return a->id < b->id;
+    });
+    return records;
+}
+
+void writeString(QDataStream &stream, const QString &value)
+{
+    stream << value.toUtf8();
+}
+
+QString readString(QDataStream &stream)
+{
+    QByteArray bytes;
+    stream >> bytes;
+    return QString::fromUtf8(bytes);
+}
+
+void writeStrings(QDataStream &stream, const QStringList &values)
+{
+    stream << quint32(values.size());
+    for (const QString &value : values) {
+        writeString(stream, value);
+    }
+}
+
+QStringList readStrings(QDataStream &stream)
+{
+    quint32 count = 0;
+    stream >> count;
+    QStringList values;
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        values.append(readString(stream));
+    }
+    return values;
+}
+
+QStringList toStringList(const QJsonArray &array)
+{
+    QStringList values;
+    values.reserve(array.size());
+    for (const QJsonValue &value : array) {
+        values.append(value.toString());
+    }
+    return values;
+}
+
+enum NodeFlag {
+    FlagCompleted = 0x01,
+    FlagBold = 0x02,
+    FlagItalic = 0x04,
+    FlagUnderline = 0x08,
+    FlagStrikethrough = 0x10
+};
+
+} // namespace
+
+QJsonObject MapDocument::Statistics::toJson() const
+{
+    QJsonObject json;
+    json["nodes"] = nodes;
+    json["roots"] = roots;
+    json["completed"] = completed;
+    json["connections"] = connections;
+    json["mediaFiles"] = mediaFiles;
+    json["maxDepth"] = maxDepth;
+    json["width"] = bounds.width();
+    json["height"] = bounds.height();
+    return json;
+}
+
+// Files
+
+bool MapDocument::load(const QString &filePath, PersistentNodeStore *nodes, QString *error, QStringList *warnings)
+{
+    TRACE_SCOPE("MapDocument::load");
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        *error = file.errorString();
+        return false;
+    }
+    const QByteArray data = file.readAll();
+    const MemoryCharge buffer(MemoryLedger::LoadBuffers, data.size());
+
+    // Sniff the magic rather than trusting the suffix
+    QDataStream stream(data);
+    quint32 magic = 0;
+    stream >> magic;
+    if (magic == MAGIC) {
+        return fromBinary(data, nodes, error, warnings);
+    }
+    return fromJson(data, nodes, error, warnings);
+}
+
+bool MapDocument::save(const QString &filePath, const PersistentNodeStore &nodes, Format format, QString *error)
+{
+    TRACE_SCOPE("MapDocument::save");
+    // QSaveFile so a failed write never truncates an existing map
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        *error = file.errorString();
+        return false;
+    }
+    const QByteArray data = format == Binary ? toBinary(nodes) : toJson(nodes);
+    if (file.write(data) != data.size() || !file.commit()) {
+        *error = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+MapDocument::Format MapDocument::formatForPath(const QString &filePath)
+{
+    return QFileInfo(filePath).suffix().compare(BINARY_SUFFIX, Qt::CaseInsensitive) == 0 ? Binary : Json;
+}
+
+// JSON, the web app's schema
+
+QByteArray MapDocument::toJson(const PersistentNodeStore &nodes)
+{
+    QJsonArray array;
+    const QVector<NodeRecordPtr> records = recordsById(nodes);
+    for (const NodeRecordPtr &record : records) {
+        array.append(recordToJson(*record));
+    }
+
+    QJsonObject root;
+    root["version"] = "1.0";
+    root["nodes"] = array;
+    return QJsonDocument(root).toJson(QJsonDocument::Compact);
+}
+
+bool MapDocument::fromJson(const QByteArray &data, PersistentNodeStore *nodes, QString *error, QStringList *warnings)
+{
+    QJsonParseError parseError;
+    const QJsonDocument document = QJsonDocument::fromJson(data, &parseError);
+    if (document.isNull()) {
+        *error = "Invalid JSON: " + parseError.errorString();
+        return false;
+    }
+    if (!document.isArray() && !document.object().value("nodes").isArray()) {
+        *error = "Not a mind map: no \"nodes\" array";
+        return false;
+    }
+
+    const QJsonArray array = document.isArray() ? document.array() : document.object().value("nodes").toArray();
+    PersistentNodeStore result;
+    for (const QJsonValue &value : array) {
+        insertUnique(&result, recordFromJson(value.toObject()), warnings);
+    }
+    *nodes = result;
+    return true;
+}
+
+QJsonObject MapDocument::recordToJson(const NodeRecord &record)
+{
+    QJsonArray media;
+    for (const MediaFile &file : record.mediaFiles) {
+        media.append(mediaToJson(file));
+    }
+
+    QJsonObject json;
+    json["id"] = record.id;
+    json["title"] = record.title;
+    json["description"] = record.description;
+    json["x"] = record.position.x();
+    json["y"] = record.position.y();
+    json["width"] = record.bounds.width();
+    json["height"] = record.bounds.height();
+    json["completed"] = record.completed;
+    json["parentId"] = record.parentId.isEmpty() ? QJsonValue() : QJsonValue(record.parentId);
+    json["children"] = QJsonArray::fromStringList(record.children);
+    json["connections"] = QJsonArray::fromStringList(record.connections);
+    json["media"] = media;
+    json["formatting"] = formattingToJson(record.formatting);
+    return json;
+}
+
+NodeRecord MapDocument::recordFromJson(const QJsonObject &json)
+{
+    NodeRecord record;
+    record.id = json.value("id").toString();
+    record.parentId = json.value("parentId").toString();
+    record.title = json.value("title").toString();
+    record.description = json.value("description").toString();
+    record.completed = json.value("completed").toBool();
+    record.formatting = formattingFromJson(json.value("formatting").toObject());
+    record.position = QPointF(json.value("x").toDouble(), json.value("y").toDouble());
+    record.bounds = QRectF(record.position, QSizeF(json.value("width").toDouble(DEFAULT_NODE_WIDTH),
+                                                   json.value("height").toDouble(DEFAULT_NODE_HEIGHT)));
+    record.children = toStringList(json.value("children").toArray());
+    record.connections = toStringList(json.value("connections").toArray());
+    for (const QJsonValue &media : json.value("media").toArray()) {
+        record.mediaFiles.append(mediaFromJson(media.toObject()));
+    }
+    return record;
+}
+
+QJsonObject MapDocument::formattingToJson(const TextFormatting &formatting)
+{
+    QJsonObject json;
+    json["bold"] = formatting.bold;
+    json["italic"] = formatting.italic;
+    json["underline"] = formatting.underline;
+    json["strikethrough"] = formatting.strikethrough;
+    json["highlight"] = formatting.highlightColor;
+    json["textColor"] = formatting.textColor;
+    return json;
+}
+
+TextFormatting MapDocument::formattingFromJson(const QJsonObject &json)
+{
+    TextFormatting formatting;
+    formatting.bold = json.value("bold").toBool();
+    formatting.italic = json.value("italic").toBool();
+    formatting.underline = json.value("underline").toBool();
+    formatting.strikethrough = json.value("strikethrough").toBool();
+    formatting.highlightColor = json.value("highlight").toString("none");
+    formatting.textColor = json.value("textColor").toString("default");
+    return formatting;
+}
+
+QJsonObject MapDocument::mediaToJson(const MediaFile &media)
+{
+    QJsonObject json;
+    if (!media.id.isEmpty()) {
+        json["id"] = media.id;
+    }
+    json["type"] = media.type;
+    json["name"] = media.name;
+    json["url"] = QUrl::fromLocalFile(media.filePath).toString();
+    json["filePath"] = media.filePath;
+    json["size"] = double(media.size);
+    json["lastModified"] = double(media.lastModified);
+    if (!media.contentHash.isEmpty()) {
+        json["contentHash"] = media.contentHash;
+    }
+    return json;
+}
+
+MediaFile MapDocument::mediaFromJson(const QJsonObject &json)
+{
+    MediaFile media;
+    media.id = json.value("id").toString();
+    media.name = json.value("name").toString();
+    media.filePath = json.value("filePath").toString();
+    if (media.filePath.isEmpty()) {
+        media.filePath = QUrl(json.value("url").toString()).toLocalFile();
+    }
+    media.type = json.value("type").toString();
+    media.size = qint64(json.value("size").toDouble());
+    media.lastModified = qint64(json.value("lastModified").toDouble());
+    media.contentHash = json.value("contentHash").toString();
+    return media;
+}
+
+// Binary
+
+QByteArray MapDocument::toBinary(const PersistentNodeStore &nodes)
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_6_0);
+
+    stream << MAGIC << FORMAT_VERSION << quint32(nodes.size());
+    const QVector<NodeRecordPtr> records = recordsById(nodes);
+    for (const NodeRecordPtr &record : records) {
+        quint8 flags = 0;
+        if (record->completed) flags |= FlagCompleted;
+        if (record->formatting.bold) flags |= FlagBold;
+        if (record->formatting.italic) flags |= FlagItalic;
+        if (record->formatting.underline) flags |= FlagUnderline;
+        if (record->formatting.strikethrough) flags |= FlagStrikethrough;
+
+        writeString(stream, record->id);
+        writeString(stream, record->parentId);
+        stream << flags << record->position.x() << record->position.y()
+               << record->bounds.width() << record->bounds.height();
+        writeString(stream, record->title);
+        writeString(stream, record->description);
+        writeString(stream, record->formatting.highlightColor);
+        writeString(stream, record->formatting.textColor);
+        writeStrings(stream, record->children);
+        writeStrings(stream, record->connections);
+
+        stream << quint32(record->mediaFiles.size());
+        for (const MediaFile &media : record->mediaFiles) {
+            writeString(stream, media.id);
+            writeString(stream, media.name);
+            writeString(stream, media.filePath);
+            writeString(stream, media.type);
+            writeString(stream, media.contentHash);
+            stream << qint64(media.size) << qint64(media.lastModified);
+        }
+    }
+    return data;
+}
+
+bool MapDocument::fromBinary(const QByteArray &data, PersistentNodeStore *nodes, QString *error, QStringList *warnings)
+{
+    QDataStream stream(data);
+    stream.setVersion(QDataStream::Qt_6_0);
+
+    quint32 magic = 0;
+    quint16 version = 0;
+    quint32 nodeCount = 0;
+    stream >> magic >> version >> nodeCount;
+    if (stream.status() != QDataStream::Ok || magic != MAGIC) {
+        *error = "Not a binary mind map";
+        return false;
+    }
+    if (version > FORMAT_VERSION) {
+        *error = QString("Binary map version %1 is newer than this build supports").arg(version);
+        return false;
+    }
+
+    PersistentNodeStore result;
+    for (quint32 i = 0; i < nodeCount && stream.status() == QDataStream::Ok; ++i) {
+        NodeRecord record;
+        quint8 flags = 0;
+        double x = 0.0;
+        double y = 0.0;
+        double width = 0.0;
+        double height = 0.0;
+        record.id = readString(stream);
+        record.parentId = readString(stream);
+        stream >> flags >> x >> y >> width >> height;
+        record.completed = flags & FlagCompleted;
+        record.formatting.bold = flags & FlagBold;
+        record.formatting.italic = flags & FlagItalic;
+        record.formatting.underline = flags & FlagUnderline;
+        record.formatting.strikethrough = flags & FlagStrikethrough;
+        record.position = QPointF(x, y);
+        record.bounds = QRectF(record.position, QSizeF(width, height));
+        record.title = readString(stream);
+        record.description = readString(stream);
+        record.formatting.highlightColor = readString(stream);
+        record.formatting.textColor = readString(stream);
+        record.children = readStrings(stream);
+        record.connections = readStrings(stream);
+
+        quint32 mediaCount = 0;
+        stream >> mediaCount;
+        for (quint32 m = 0; m < mediaCount && stream.status() == QDataStream::Ok; ++m) {
+            MediaFile media;
+            qint64 size = 0;
+            qint64 lastModified = 0;
+            media.id = readString(stream);
+            media.name = readString(stream);
+            media.filePath = readString(stream);
+            media.type = readString(stream);
+            media.contentHash = readString(stream);
+            stream >> size >> lastModified;
+            media.size = size;
+            media.lastModified = lastModified;
+            record.mediaFiles.append(media);
+        }
+        if (stream.status() == QDataStream::Ok) {
+            insertUnique(&result, record, warnings);
+        }
+    }
+
+    if (stream.status() != QDataStream::Ok) {
+        *error = "Binary map is truncated or corrupt";
+        return false;
+    }
+    *nodes = result;
+    return true;
+}
+
+void MapDocument::insertUnique(PersistentNodeStore *nodes, const NodeRecord &record, QStringList *warnings)
+{
+    if (record.id.isEmpty()) {
+        if (warnings) {
+            warnings->append(QString("Skipped a node without an id (\"%1\")").arg(record.title));
+        }
+        return;
+    }
+    if (nodes->contains(record.id)) {
+        if (warnings) {
+            warnings->append(QString("Duplicate node id %1; kept the first").arg(record.id));
+        }
+        return;
+    }
+    nodes->insert(record);
+}
+
+// Checks
+
+QStringList MapDocument::validate(const PersistentNodeStore &nodes)
+{
+    QStringList issues;
+
+    nodes.forEach([&nodes, &issues](const NodeRecordPtr &record) {
+        if (!record->parentId.isEmpty()) {
+            const NodeRecordPtr parent = nodes.value(record->parentId);
+            if (!parent) {
+                issues.append(QString("%1: parent %2 does not exist").arg(record->id, record->parentId));
+            } else if (!parent->children.contains(record->id)) {
+                issues.append(QString("%1: not listed among the children of its parent %2").arg(record->id, record->parentId));
+            }
+        }
+        for (const QString &childId : record->children) {
+            const NodeRecordPtr child = nodes.value(childId);
+            if (!child) {
+                issues.append(QString("%1: child %2 does not exist").arg(record->id, childId));
+            } else if (child->parentId != record->id) {
+                issues.append(QString("%1: lists %2 as a child, but its parent is \"%3\"").arg(record->id, childId, child->parentId));
+            }
+        }
+        for (const QString &targetId : record->connections) {
+            if (targetId == record->id) {
+                issues.append(QString("%1: connected to itself").arg(record->id));
+            } else if (!nodes.contains(targetId)) {
+                issues.append(QString("%1: connection to missing node %2").arg(record->id, targetId));
+            }
+        }
+    });
+
+    // Parent cycles: walk each chain once, marking nodes as finished.
+    enum State { InProgress = 1, Finished = 2 };
+    QHash<QString, int> state;
+    state.reserve(nodes.size());
+    nodes.forEach([&nodes, &issues, &state](const NodeRecordPtr &record) {
+        QStringList chain;
+        QString id = record->id;
+        while (!id.isEmpty() && state.value(id) == 0) {
+            state.insert(id, InProgress);
+            chain.append(id);
+            const NodeRecordPtr node = nodes.value(id);
+            id = node ? node->parentId : QString();
+        }
+        if (!id.isEmpty() && state.value(id) == InProgress) {
+            issues.append(QString("%1: parent chain forms a cycle").arg(id));
+        }
+        for (const QString &visited : chain) {
+            state.insert(visited, Finished);
+        }
+    });
+
+    return issues;
+}
+
+MapDocument::Statistics MapDocument::statistics(const PersistentNodeStore &nodes)
+{
+    Statistics stats;
+    QHash<QString, int> depths;
+    depths.reserve(nodes.size());
+
+    nodes.forEach([&nodes, &stats, &depths](const NodeRecordPtr &record) {
+        stats.nodes++;
+        stats.completed += record->completed ? 1 : 0;
+        stats.connections += record->connections.size();
+        stats.mediaFiles += record->mediaFiles.size();
+        stats.bounds = stats.bounds.united(record->bounds);
+        if (record->parentId.isEmpty() || !nodes.contains(record->parentId)) {
+            stats.roots++;
+        }
+
+        // Depth by walking up to the first node with a known depth; the
+        // step limit keeps a corrupt (cyclic) map from looping.
+        QStringList chain;
+        QString id = record->id;
+        int base = -1;
+        while (!id.isEmpty() && chain.size() <= nodes.size()) {
+            auto known = depths.constFind(id);
+            if (known != depths.constEnd()) {
+                base = known.value();
+                break;
+            }
+            chain.append(id);
+            const NodeRecordPtr node = nodes.value(id);
+            id = node ? node->parentId : QString();
+        }
+        for (int i = chain.size() - 1; i >= 0; --i) {
+            depths.insert(chain.at(i), ++base);
+        }
+        stats.maxDepth = qMax(stats.maxDepth, base);
+    });
+
+    return stats;
+}
@@ -0,0 +1,77 @@
+#ifndef MAPDOCUMENT_H
+#define MAPDOCUMENT_H
+
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QRectF>
+#include <QJsonObject>
+#include <QJsonDocument>
+
+#include "persistentnodestore.h"
+
+// Whole-map file I/O without a scene: reads and writes maps straight to
+// and from a PersistentNodeStore, so tools (the command-line mode,
+// benchmarks) can process maps with no widgets and on any thread.
+//
+// Two formats: JSON in the web app's schema ({"version", "nodes": [...]}),
+// and a compact binary form that loads several times faster.
+class MapDocument
+{
+public:
+    enum Format {
+        Json,
+        Binary
+    };
+
+    struct Statistics {
+        int nodes = 0;
+        int roots = 0;
+        int completed = 0;
+        int connections = 0;
+        int mediaFiles = 0;
+        int maxDepth = 0;
+        QRectF bounds;
+
+        QJsonObject toJson() const;
+    };
+
+    // Loading detects the format from the content. Problems that don't stop
+    // the load (duplicate ids, for instance) are appended to warnings.
+    static bool load(const QString &filePath, PersistentNodeStore *nodes,
+                     QString *error, QStringList *warnings = nullptr);
+    static bool save(const QString &filePath, const PersistentNodeStore &nodes, Format format, QString *error);
+    static Format formatForPath(const QString &filePath);
+
+    static QByteArray toJson(const PersistentNodeStore &nodes);
+    static bool fromJson(const QByteArray &data, PersistentNodeStore *nodes, QString *error, QStringList *warnings);
+    static QByteArray toBinary(const PersistentNodeStore &nodes);
+    static bool fromBinary(const QByteArray &data, PersistentNodeStore *nodes, QString *error, QStringList *warnings);
+
+    // Structural checks: dangling parents, children and connections,
+    // parent/child lists that disagree, parent cycles. Empty if valid.
+    static QStringList validate(const PersistentNodeStore &nodes);
+    static Statistics statistics(const PersistentNodeStore &nodes);
+
+    // Field codecs shared with SubtreeFragment
+    static QJsonObject formattingToJson(const TextFormatting &formatting);
+    static TextFormatting formattingFromJson(const QJsonObject &json);
+    static QJsonObject mediaToJson(const MediaFile &media);
+    static MediaFile mediaFromJson(const QJsonObject &json);
+
+    // Constants
+    static const char BINARY_SUFFIX[];
+    static const int DEFAULT_NODE_WIDTH = 300;   // MindMapNode's default card size
+    static const int DEFAULT_NODE_HEIGHT = 200;
+
+private:
+    static QJsonObject recordToJson(const NodeRecord &record);
+    static NodeRecord recordFromJson(const QJsonObject &json);
+    static void insertUnique(PersistentNodeStore *nodes, const NodeRecord &record, QStringList *warnings);
+
+    // Constants
+    static const quint32 MAGIC = 0x4D32444D; // "M2DM"
+    static const quint16 FORMAT_VERSION = 1;
+};
+
+#endif // MAPDOCUMENT_H
@@ -0,0 +1,535 @@
+#include "medialibrary.h"
+#include "tracelog.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QtEndian>
+#include <QVector>
+
+#include <cstring>
+#include <utility>
+
+namespace {
+
+// Streaming XXH64. Non-cryptographic, but fast enough that hashing is bound by
+// disk bandwidth rather than CPU, and well distributed for dedup keys.
+class ContentHasher
+{
+public:
+    explicit ContentHasher(quint64 seed = 0)
+        : m_v1(seed + PRIME1 + PRIME2)
+        , m_v2(seed + PRIME2)
+        , m_v3(seed)
+        , m_v4(seed - PRIME1)
+        , m_seed(seed)
+        , m_totalLength(0)
+        , m_bufferSize(0)
+    {
+    }
+
+    void update(const char *data, qint64 length)
+    {
+        const uchar *p = reinterpret_cast<const uchar *>(data);
+        const uchar *end = p + length;
+        m_totalLength += static_cast<quint64>(length);
+
+        if (m_bufferSize + length < 32) {
+            std::memcpy(m_buffer + m_bufferSize, p, static_cast<size_t>(length));
+            m_bufferSize += static_cast<int>(length);
+            return;
+        }
+
+        if (m_bufferSize > 0) {
+            const int fill = 32 - m_bufferSize;
+            std::memcpy(m_buffer + m_bufferSize, p, static_cast<size_t>(fill));
+            consumeStripe(m_buffer);
+            p += fill;
+            m_bufferSize = 0;
+        }
+
+        while (end - p >= 32) {
+            consumeStripe(p);
+            p += 32;
+        }
+
+        m_bufferSize = static_cast<int>(end - p);
+        if (m_bufferSize > 0) {
+            std::memcpy(m_buffer, p, static_cast<size_t>(m_bufferSize));
+        }
+    }
+
+    quint64 digest() const
+    {
+        quint64 h;
+        if (m_totalLength >= 32) {
+            h = rotl(m_v1, 1) + rotl(m_v2, 7) + rotl(m_v3, 12) + rotl(m_v4, 18);
+            h = mergeRound(h, m_v1);
+            h = mergeRound(h, m_v2);
+            h = mergeRound(h, m_v3);
+            h = mergeRound(h, m_v4);
+        } else {
+            h = m_seed + PRIME5;
+        }
+        h += m_totalLength;
+
+        const uchar *p = m_buffer;
+        const uchar *end = m_buffer + m_bufferSize;
+        while (end - p >= 8) {
+            h ^= round(0, read64(p));
+            h = rotl(h, 27) * PRIME1 + PRIME4;
+            p += 8;
+        }
+        if (end - p >= 4) {
+            h ^= static_cast<quint64>(read32(p)) * PRIME1;
+            h = rotl(h, 23) * PRIME2 + PRIME3;
+            p += 4;
+        }
+        while (p < end) {
+            h ^= static_cast<quint64>(*p) * PRIME5;
+            h = rotl(h, 11) * PRIME1;
+            ++p;
+        }
+
+        h ^= h >> 33;
+        h *= PRIME2;
+        h ^= h >> 29;
+        h *= PRIME3;
+        h ^= h >> 32;
+        return h;
+    }
+
+private:
+    static constexpr quint64 PRIME1 = 0x9E3779B185EBCA87ULL;
+    static constexpr quint64 PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+    static constexpr quint64 PRIME3 = 0x165667B19E3779F9ULL;
+    static constexpr quint64 PRIME4 = 0x85EBCA77C2B2AE63ULL;
+    static constexpr quint64 PRIME5 = 0x27D4EB2F165667C5ULL;
+
+    quint64 m_v1;
+    quint64 m_v2;
+    quint64 m_v3;
+    quint64 m_v4;
+    quint64 m_seed;
+    quint64 m_totalLength;
+    uchar m_buffer[32];
+    int m_bufferSize;
+
+    static quint64 rotl(quint64 value, int bits) { return (value << bits) | (value >> (64 - bits)); }
+
+    static quint64 round(quint64 acc, quint64 input)
+    {
+        acc += input * PRIME2;
+        acc = rotl(acc, 31);
+        return acc * PRIME1;
+    }
+
+    static quint64 mergeRound(quint64 acc, quint64 value)
+    {
+        acc ^= round(0, value);
+        return acc * PRIME1 + PRIME4;
+    }
+
+    static quint64 read64(const uchar *p)
+    {
+        quint64 value;
+        std::memcpy(&value, p, sizeof(value));
+        return qFromLittleEndian(value);
+    }
+
+    static quint32 read32(const uchar *p)
+    {
+        quint32 value;
+        std::memcpy(&value, p, sizeof(value));
+        return qFromLittleEndian(value);
+    }
+
+    void consumeStripe(const uchar *p)
+    {
+        m_v1 = round(m_v1, read64(p));
+        m_v2 = round(m_v2, read64(p + 8));
+        m_v3 = round(m_v3, read64(p + 16));
+        m_v4 = round(m_v4, read64(p + 24));
+    }
+};
+
+} // namespace
+
+MediaLibrary::MediaLibrary(QObject *parent)
+    : QObject(parent)
+    , m_watcher(nullptr)
+{
+    m_watcher = new QFileSystemWatcher(this);
+    connect(m_watcher, &QFileSystemWatcher::fileChanged, this, &MediaLibrary::onWatchedFileChanged);
+}
+
+MediaLibrary::~MediaLibrary()
+{
+    for (QFutureWatcher<MediaHashResult> *watcher : std::as_const(m_hashWatchers)) {
+        watcher->disconnect(this);
+        watcher->waitForFinished();
+    }
+}
+
+void MediaLibrary::attach(const QString &nodeId, const QString &mediaId, const QString &filePath, const QString &type)
+{
+    const QString key = attachmentKey(nodeId, mediaId);
+    const QString path = canonicalPath(filePath);
+
+    if (m_hashByAttachment.contains(key) || m_pendingByAttachment.contains(key)) {
+        if (m_pathByAttachment.value(key) == path) {
+            return;
+        }
+        unbindAttachment(key);
+    }
+
+    m_pathByAttachment.insert(key, path);
+    m_typeByAttachment.insert(key, type);
+
+    // Re-attaching a path we already hashed skips the read entirely as long
+    // as size and modification time still match the record.
+    const QString knownHash = m_hashByPath.value(path);
+    if (!knownHash.isEmpty()) {
+        const MediaRecord &record = m_records[knownHash];
+        const QFileInfo info(path);
+        if (info.size() == record.size && info.lastModified().toMSecsSinceEpoch() == record.lastModified) {
+            MediaHashResult result;
+            result.attachmentKey = key;
+            result.filePath = path;
+            result.contentHash = knownHash;
+            result.size = record.size;
+            result.lastModified = record.lastModified;
+            bindAttachment(key, result);
+            return;
+        }
+    }
+
+    startHash(key, path, type == "image");
+}
+
+void MediaLibrary::detach(const QString &nodeId, const QString &mediaId)
+{
+    unbindAttachment(attachmentKey(nodeId, mediaId));
+}
+
+void MediaLibrary::detachNode(const QString &nodeId)
+{
+    const QString prefix = nodeId + '/';
+    QStringList keys;
+    for (auto it = m_pathByAttachment.constBegin(); it != m_pathByAttachment.constEnd(); ++it) {
+        if (it.key().startsWith(prefix)) {
+            keys.append(it.key());
+        }
+    }
+    for (const QString &key : std::as_const(keys)) {
+        unbindAttachment(key);
+    }
+}
+
+void MediaLibrary::clear()
+{
+    const QStringList watched = m_watcher->files();
+    if (!watched.isEmpty()) {
+        m_watcher->removePaths(watched);
+    }
+    m_records.clear();
+    m_hashByAttachment.clear();
+    m_hashByPath.clear();
+    m_pathByAttachment.clear();
+    m_typeByAttachment.clear();
+    m_pendingByAttachment.clear();
+}
+
+QString MediaLibrary::getContentHash(const QString &nodeId, const QString &mediaId) const
+{
+    return m_hashByAttachment.value(attachmentKey(nodeId, mediaId));
+}
+
+QString MediaLibrary::getContentHashForPath(const QString &filePath) const
+{
+    return m_hashByPath.value(canonicalPath(filePath));
+}
+
+QPixmap MediaLibrary::getThumbnail(const QString &contentHash) const
+{
+    auto it = m_records.constFind(contentHash);
+    return it != m_records.constEnd() ? it.value().thumbnail : QPixmap();
+}
+
+void MediaLibrary::measureMemory(MemoryLedger::Sample &sample) const
+{
+    for (const MediaRecord &record : m_records) {
+        qint64 bytes = sizeof(MediaRecord) + MemoryLedger::HASH_NODE_OVERHEAD
+                       + MemoryLedger::stringBytes(record.contentHash) + MemoryLedger::stringBytes(record.filePath)
+                       + MemoryLedger::stringBytes(record.name) + MemoryLedger::stringBytes(record.type);
+        for (const QString &path : record.paths) {
+            bytes += sizeof(QString) + MemoryLedger::HASH_NODE_OVERHEAD + MemoryLedger::stringBytes(path);
+        }
+        for (const QString &attachment : record.attachments) {
+            bytes += sizeof(QString) + MemoryLedger::HASH_NODE_OVERHEAD + MemoryLedger::stringBytes(attachment);
+        }
+        sample.add(MemoryLedger::ThumbnailCache, bytes);
+        sample.addPixmap(MemoryLedger::ThumbnailCache, record.thumbnail);
+    }
+
+    // Lookup tables: key and value strings per entry
+    for (const QHash<QString, QString> *table : {&m_hashByAttachment, &m_hashByPath, &m_pathByAttachment,
+                                                 &m_typeByAttachment, &m_pendingByAttachment}) {
+        qint64 bytes = 0;
+        for (auto it = table->constBegin(); it != table->constEnd(); ++it) {
+            bytes += 2 * sizeof(QString) + MemoryLedger::HASH_NODE_OVERHEAD
+                     + MemoryLedger::stringBytes(it.key()) + MemoryLedger::stringBytes(it.value());
+        }
+        sample.add(MemoryLedger::ThumbnailCache, bytes, 0);
+    }
+}
+
+int MediaLibrary::getUsageCount(const QString &contentHash) const
+{
+    auto it = m_records.constFind(contentHash);
+    return it != m_records.constEnd() ? it.value().attachments.size() : 0;
+}
+
+int MediaLibrary::getNodeUsageCount(const QString &contentHash) const
+{
+    return getNodesUsing(contentHash).size();
+}
+
+int MediaLibrary::getUsageCountForPath(const QString &filePath) const
+{
+    return getNodeUsageCount(getContentHashForPath(filePath));
+}
+
+QStringList MediaLibrary::getNodesUsing(const QString &contentHash) const
+{
+    QSet<QString> nodeIds;
+    auto it = m_records.constFind(contentHash);
+    if (it != m_records.constEnd()) {
+        for (const QString &key : it.value().attachments) {
+            nodeIds.insert(nodeIdFromKey(key));
+        }
+    }
+    return QStringList(nodeIds.cbegin(), nodeIds.cend());
+}
+
+QString MediaLibrary::hashFile(const QString &filePath, QString *error)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) {
+            *error = file.errorString();
+        }
+        return QString();
+    }
+
+    ContentHasher hasher;
+    const qint64 size = file.size();
+
+    // Mapping avoids copying the bytes through a userspace buffer; files the
+    // platform refuses to map (pipes, some network shares) are read in chunks.
+    if (size > 0) {
+        if (uchar *mapped = file.map(0, size)) {
+            hasher.update(reinterpret_cast<const char *>(mapped), size);
+            file.unmap(mapped);
+            return QString::number(hasher.digest(), 16).rightJustified(16, '0')
+                + '-' + QString::number(size, 16);
+        }
+    }
+
+    QVector<char> buffer(static_cast<int>(HASH_CHUNK_SIZE));
+    qint64 total = 0;
+    while (!file.atEnd()) {
+        const qint64 bytesRead = file.read(buffer.data(), buffer.size());
+        if (bytesRead < 0) {
+            if (error) {
+                *error = file.errorString();
+            }
+            return QString();
+        }
+        if (bytesRead == 0) {
+            break;
+        }
+        hasher.update(buffer.constData(), bytesRead);
+        total += bytesRead;
+    }
+    return QString::number(hasher.digest(), 16).rightJustified(16, '0')
+        + '-' + QString::number(total, 16);
+}
+
+quint64 MediaLibrary::hashBytes(const char *data, qint64 length, quint64 seed)
+{
+    ContentHasher hasher(seed);
+    hasher.update(data, length);
+    return hasher.digest();
+}
+
+void MediaLibrary::onHashFinished()
+{
+    auto *watcher = static_cast<QFutureWatcher<MediaHashResult>*>(sender());
+    m_hashWatchers.remove(watcher);
+    watcher->deleteLater();
+
+    const MediaHashResult result = watcher->result();
+
+    // Drop results for attachments that were removed or repointed meanwhile.
+    if (m_pendingByAttachment.value(result.attachmentKey) != result.filePath) {
+        return;
+    }
+    m_pendingByAttachment.remove(result.attachmentKey);
+
+    if (result.contentHash.isEmpty()) {
+        m_pathByAttachment.remove(result.attachmentKey);
+        m_typeByAttachment.remove(result.attachmentKey);
+        emit mediaFailed(nodeIdFromKey(result.attachmentKey), mediaIdFromKey(result.attachmentKey), result.error);
+        return;
+    }
+
+    bindAttachment(result.attachmentKey, result);
+}
+
+void MediaLibrary::onWatchedFileChanged(const QString &filePath)
+{
+    const QString path = canonicalPath(filePath);
+
+    // The content behind this path changed, so every attachment that points
+    // at it has to be re-hashed and may move to a different record.
+    QStringList affected;
+    for (auto it = m_pathByAttachment.constBegin(); it != m_pathByAttachment.constEnd(); ++it) {
+        if (it.value() == path && m_hashByAttachment.contains(it.key())) {
+            affected.append(it.key());
+        }
+    }
+
+    for (const QString &key : std::as_const(affected)) {
+        const QString type = m_typeByAttachment.value(key);
+        unbindAttachment(key);
+        if (QFileInfo::exists(path)) {
+            m_pathByAttachment.insert(key, path);
+            m_typeByAttachment.insert(key, type);
+            startHash(key, path, type == "image");
+        }
+    }
+    m_hashByPath.remove(path);
+}
+
+void MediaLibrary::startHash(const QString &attachmentKey, const QString &filePath, bool wantThumbnail)
+{
+    m_pendingByAttachment.insert(attachmentKey, filePath);
+
+    auto *watcher = new QFutureWatcher<MediaHashResult>(this);
+    connect(watcher, &QFutureWatcher<MediaHashResult>::finished, this, &MediaLibrary::onHashFinished);
+    m_hashWatchers.insert(watcher);
+    watcher->setFuture(QtConcurrent::run(&MediaLibrary::computeHash, attachmentKey, filePath, wantThumbnail));
+}
+
+void MediaLibrary::bindAttachment(const QString &attachmentKey, const MediaHashResult &result)
+{
+    TRACE_SCOPE("MediaLibrary::bindAttachment");
+    const QString &hash = result.contentHash;
+    auto it = m_records.find(hash);
+    if (it == m_records.end()) {
+        MediaRecord record;
+        record.contentHash = hash;
+        record.filePath = result.filePath;
+        record.name = QFileInfo(result.filePath).fileName();
+        record.type = m_typeByAttachment.value(attachmentKey);
+        record.size = result.size;
+        record.lastModified = result.lastModified;
+        if (!result.thumbnail.isNull()) {
+            record.thumbnail = QPixmap::fromImage(result.thumbnail);
+        }
+        it = m_records.insert(hash, record);
+    } else if (it.value().thumbnail.isNull() && !result.thumbnail.isNull()) {
+        it.value().thumbnail = QPixmap::fromImage(result.thumbnail);
+    }
+
+    // Every path holding this content is watched, not just the first, so
+    // an edit through any of them re-hashes the attachments that use it.
+    // Re-adding is a no-op for a watched path and restores the watch after
+    // an editor replaced the file.
+    it.value().paths.insert(result.filePath);
+    m_watcher->addPath(result.filePath);
+    it.value().attachments.insert(attachmentKey);
+    m_hashByPath.insert(result.filePath, hash);
+    m_hashByAttachment.insert(attachmentKey, hash);
+
+    emit mediaResolved(nodeIdFromKey(attachmentKey), mediaIdFromKey(attachmentKey), hash);
+    emit usageChanged(hash, getNodeUsageCount(hash));
+}
+
+void MediaLibrary::unbindAttachment(const QString &attachmentKey)
+{
+    m_pendingByAttachment.remove(attachmentKey);
+    m_pathByAttachment.remove(attachmentKey);
+    m_typeByAttachment.remove(attachmentKey);
+
+    const QString hash = m_hashByAttachment.take(attachmentKey);
+    auto it = m_records.find(hash);
+    if (hash.isEmpty() || it == m_records.end()) {
+        return;
+    }
+
+    it.value().attachments.remove(attachmentKey);
+    if (!it.value().attachments.isEmpty()) {
+        emit usageChanged(hash, getNodeUsageCount(hash));
+        return;
+    }
+
+    // A path that now maps to other content belongs to that record and
+    // stays watched for it.
+    for (const QString &path : std::as_const(it.value().paths)) {
+        if (m_hashByPath.value(path) == hash) {
+            m_hashByPath.remove(path);
+            m_watcher->removePath(path);
+        }
+    }
+    m_records.erase(it);
+    emit usageChanged(hash, 0);
+    emit recordRemoved(hash);
+}
+
+MediaHashResult MediaLibrary::computeHash(const QString &attachmentKey, const QString &filePath, bool wantThumbnail)
+{
+    TRACE_SCOPE("MediaLibrary::computeHash");
+    MediaHashResult result;
+    result.attachmentKey = attachmentKey;
+    result.filePath = filePath;
+
+    const QFileInfo info(filePath);
+    result.size = info.size();
+    result.lastModified = info.lastModified().toMSecsSinceEpoch();
+    result.contentHash = hashFile(filePath, &result.error);
+
+    // QImage is safe off the GUI thread; the pixmap is made on bind.
+    if (wantThumbnail && !result.contentHash.isEmpty()) {
+        TRACE_SCOPE("MediaLibrary::thumbnail");
+        QImageReader reader(filePath);
+        const QSize imageSize = reader.size();
+        if (imageSize.isValid()) {
+            reader.setScaledSize(imageSize.scaled(THUMBNAIL_SIZE, THUMBNAIL_SIZE, Qt::KeepAspectRatio));
+        }
+        result.thumbnail = reader.read();
+    }
+    return result;
+}
+
+QString MediaLibrary::attachmentKey(const QString &nodeId, const QString &mediaId)
+{
+    return nodeId + '/' + mediaId;
+}
+
+QString MediaLibrary::nodeIdFromKey(const QString &attachmentKey)
+{
+    return attachmentKey.section('/', 0, 0);
+}
+
+QString MediaLibrary::mediaIdFromKey(const QString &attachmentKey)
+{
+    return attachmentKey.section('/', 1);
+}
+
+QString MediaLibrary::canonicalPath(const QString &filePath)
+{
+    return QDir::cleanPath(QFileInfo(filePath).absoluteFilePath());
+}
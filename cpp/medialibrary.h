@@ -0,0 +1,111 @@
+#ifndef MEDIALIBRARY_H
+#define MEDIALIBRARY_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QSet>
+#include <QImage>
+#include <QPixmap>
+#include <QSize>
+#include <QFileSystemWatcher>
+#include <QFutureWatcher>
+#include <QtConcurrent>
+
+#include "memoryledger.h"
+
+struct MediaRecord {
+    QString contentHash;
+    QString filePath;   // first path the content was seen at
+    QString name;
+    QString type;       // "image" or "document"
+    qint64 size = 0;
+    qint64 lastModified = 0;
+    QPixmap thumbnail;
+    QSet<QString> paths;       // every canonical path seen with this content; all watched
+    QSet<QString> attachments; // "nodeId/mediaId" keys sharing this content
+};
+
+struct MediaHashResult {
+    QString attachmentKey;
+    QString filePath;
+    QString contentHash;
+    qint64 size = 0;
+    qint64 lastModified = 0;
+    QImage thumbnail;
+    QString error;
+};
+
+class MediaLibrary : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit MediaLibrary(QObject *parent = nullptr);
+    ~MediaLibrary();
+
+    // Attachment tracking
+    void attach(const QString &nodeId, const QString &mediaId, const QString &filePath, const QString &type);
+    void detach(const QString &nodeId, const QString &mediaId);
+    void detachNode(const QString &nodeId);
+    void clear();
+
+    // Lookup
+    QString getContentHash(const QString &nodeId, const QString &mediaId) const;
+    QString getContentHashForPath(const QString &filePath) const;
+    bool hasRecord(const QString &contentHash) const { return m_records.contains(contentHash); }
+    MediaRecord getRecord(const QString &contentHash) const { return m_records.value(contentHash); }
+    QPixmap getThumbnail(const QString &contentHash) const;
+    int getUsageCount(const QString &contentHash) const;
+    int getNodeUsageCount(const QString &contentHash) const;
+    int getUsageCountForPath(const QString &filePath) const;
+    QStringList getNodesUsing(const QString &contentHash) const;
+    int recordCount() const { return m_records.size(); }
+
+    // Records, thumbnails and lookup tables, as ThumbnailCache
+    void measureMemory(MemoryLedger::Sample &sample) const;
+
+    // Hashing
+    static QString hashFile(const QString &filePath, QString *error = nullptr);
+    static quint64 hashBytes(const char *data, qint64 length, quint64 seed = 0);
+
+signals:
+    void mediaResolved(const QString &nodeId, const QString &mediaId, const QString &contentHash);
+    void mediaFailed(const QString &nodeId, const QString &mediaId, const QString &error);
+    void usageChanged(const QString &contentHash, int nodeCount);
+    void recordRemoved(const QString &contentHash);
+
+private slots:
+    void onHashFinished();
+    void onWatchedFileChanged(const QString &filePath);
+
+private:
+    // Records
+    QHash<QString, MediaRecord> m_records;          // content hash -> record
+    QHash<QString, QString> m_hashByAttachment;     // "nodeId/mediaId" -> content hash
+    QHash<QString, QString> m_hashByPath;           // canonical path -> content hash
+    QHash<QString, QString> m_pathByAttachment;     // "nodeId/mediaId" -> canonical path
+    QHash<QString, QString> m_typeByAttachment;
+    QHash<QString, QString> m_pendingByAttachment;  // "nodeId/mediaId" -> path being hashed
+
+    // Background work
+    QFileSystemWatcher *m_watcher;
+    QSet<QFutureWatcher<MediaHashResult>*> m_hashWatchers;
+
+    // Methods
+    void startHash(const QString &attachmentKey, const QString &filePath, bool wantThumbnail);
+    void bindAttachment(const QString &attachmentKey, const MediaHashResult &result);
+    void unbindAttachment(const QString &attachmentKey);
+    static MediaHashResult computeHash(const QString &attachmentKey, const QString &filePath, bool wantThumbnail);
+    static QString attachmentKey(const QString &nodeId, const QString &mediaId);
+    static QString nodeIdFromKey(const QString &attachmentKey);
+    static QString mediaIdFromKey(const QString &attachmentKey);
+    static QString canonicalPath(const QString &filePath);
+
+    // Constants
+    static const int THUMBNAIL_SIZE = 100;
+    static const qint64 HASH_CHUNK_SIZE = 4 * 1024 * 1024; // 4MB
+};
+
+#endif // MEDIALIBRARY_H
@@ -0,0 +1,191 @@
+#include "memoryledger.h"
+
+#include <QTextDocument>
+
+std::atomic<qint64> MemoryLedger::s_bytes[MemoryLedger::CategoryCount] = {};
+std::atomic<qint64> MemoryLedger::s_objects[MemoryLedger::CategoryCount] = {};
+std::atomic<qint64> MemoryLedger::s_peaks[MemoryLedger::CategoryCount] = {};
+std::atomic<qint64> MemoryLedger::s_budgets[MemoryLedger::CategoryCount] = {};
+QList<MemoryLedger::ProbeEntry> MemoryLedger::s_probes;
+
+void MemoryLedger::Sample::add(Category category, qint64 bytes, qint64 objects)
+{
+    m_measures[category].bytes += bytes;
+    m_measures[category].objects += objects;
+}
+
+void MemoryLedger::Sample::addPixmap(Category category, const QPixmap &pixmap)
+{
+    if (pixmap.isNull() || m_seenPixmaps.contains(pixmap.cacheKey())) {
+        return;
+    }
+    m_seenPixmaps.insert(pixmap.cacheKey());
+    add(category, pixmapBytes(pixmap));
+}
+
+void MemoryLedger::charge(Category category, qint64 bytes, qint64 objects)
+{
+    const qint64 total = s_bytes[category].fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    s_objects[category].fetch_add(objects, std::memory_order_relaxed);
+    raisePeak(category, total);
+}
+
+void MemoryLedger::release(Category category, qint64 bytes, qint64 objects)
+{
+    s_bytes[category].fetch_sub(bytes, std::memory_order_relaxed);
+    s_objects[category].fetch_sub(objects, std::memory_order_relaxed);
+}
+
+void MemoryLedger::raisePeak(Category category, qint64 bytes)
+{
+    qint64 peak = s_peaks[category].load(std::memory_order_relaxed);
+    while (bytes > peak && !s_peaks[category].compare_exchange_weak(peak, bytes, std::memory_order_relaxed)) {
+    }
+}
+
+void MemoryLedger::addProbe(QObject *owner, const Probe &probe)
+{
+    ProbeEntry entry;
+    entry.owner = owner;
+    entry.probe = probe;
+    s_probes.append(entry);
+}
+
+QList<MemoryLedger::Usage> MemoryLedger::report()
+{
+    // Probes whose owner has gone are dropped here rather than from a
+    // destroyed() connection, so the ledger needs no QObject of its own.
+    Sample sample;
+    for (int i = s_probes.size() - 1; i >= 0; --i) {
+        if (!s_probes.at(i).owner) {
+            s_probes.removeAt(i);
+        }
+    }
+    for (const ProbeEntry &entry : s_probes) {
+        entry.probe(sample);
+    }
+
+    QList<Usage> usages;
+    for (int i = 0; i < CategoryCount; ++i) {
+        const Category category = Category(i);
+        const Measure measured = sample.measure(category);
+
+        Usage usage;
+        usage.category = category;
+        usage.name = categoryName(category);
+        usage.bytes = s_bytes[i].load(std::memory_order_relaxed) + measured.bytes;
+        usage.objects = s_objects[i].load(std::memory_order_relaxed) + measured.objects;
+        raisePeak(category, usage.bytes);
+        usage.peakBytes = s_peaks[i].load(std::memory_order_relaxed);
+        usage.budget = s_budgets[i].load(std::memory_order_relaxed);
+        usages.append(usage);
+    }
+    return usages;
+}
+
+void MemoryLedger::resetPeaks()
+{
+    for (int i = 0; i < CategoryCount; ++i) {
+        s_peaks[i].store(s_bytes[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+}
+
+void MemoryLedger::setBudget(Category category, qint64 bytes)
+{
+    s_budgets[category].store(qMax<qint64>(0, bytes), std::memory_order_relaxed);
+}
+
+qint64 MemoryLedger::budget(Category category)
+{
+    return s_budgets[category].load(std::memory_order_relaxed);
+}
+
+QString MemoryLedger::categoryName(Category category)
+{
+    switch (category) {
+    case Nodes:
+        return "Nodes";
+    case NodeWidgets:
+        return "Node widgets";
+    case TextDocuments:
+        return "Text documents";
+    case Connections:
+        return "Connections";
+    case MediaPixmaps:
+        return "Media pixmaps";
+    case ThumbnailCache:
+        return "Thumbnail cache";
+    case FileCaches:
+        return "File caches";
+    case LoadBuffers:
+        return "Load buffers";
+    case UndoHistory:
+        return "Undo history";
+    case CategoryCount:
+        break;
+    }
+    return QString();
+}
+
+QString MemoryLedger::categoryKey(Category category)
+{
+    switch (category) {
+    case Nodes:
+        return "nodes";
+    case NodeWidgets:
+        return "nodeWidgets";
+    case TextDocuments:
+        return "textDocuments";
+    case Connections:
+        return "connections";
+    case MediaPixmaps:
+        return "mediaPixmaps";
+    case ThumbnailCache:
+        return "thumbnailCache";
+    case FileCaches:
+        return "fileCaches";
+    case LoadBuffers:
+        return "loadBuffers";
+    case UndoHistory:
+        return "undoHistory";
+    case CategoryCount:
+        break;
+    }
+    return QString();
+}
+
+qint64 MemoryLedger::pixmapBytes(const QPixmap &pixmap)
+{
+    if (pixmap.isNull()) {
+        return 0;
+    }
+    return qint64(pixmap.width()) * pixmap.height() * pixmap.depth() / 8;
+}
+
+qint64 MemoryLedger::imageBytes(const QImage &image)
+{
+    return image.sizeInBytes();
+}
+
+qint64 MemoryLedger::stringBytes(const QString &text)
+{
+    return text.capacity() * qint64(sizeof(QChar));
+}
+
+qint64 MemoryLedger::stringListBytes(const QStringList &list)
+{
+    qint64 bytes = list.capacity() * qint64(sizeof(QString));
+    for (const QString &text : list) {
+        bytes += stringBytes(text);
+    }
+    return bytes;
+}
+
+qint64 MemoryLedger::documentBytes(const QTextDocument *document)
+{
+    if (!document) {
+        return 0;
+    }
+    return qint64(sizeof(QTextDocument)) + document->characterCount() * qint64(sizeof(QChar))
+           + qint64(document->blockCount()) * TEXT_BLOCK_OVERHEAD;
+}
@@ -0,0 +1,149 @@
+#ifndef MEMORYLEDGER_H
+#define MEMORYLEDGER_H
+
+#include <QObject>
+#include <QPointer>
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QSet>
+#include <QPixmap>
+#include <QImage>
+
+#include <atomic>
+#include <functional>
+
+class QTextDocument;
+
+// Per-subsystem memory accounting. Figures come from two kinds of hook:
+//
+// - Counters: code that owns a short-lived allocation charges it while it
+//   exists (MemoryCharge does this for a scope). Thread-safe, and the peak
+//   is kept, so transient buffers such as file loads still show up.
+// - Probes: state that is cheaper to measure on demand than to track per
+//   mutation (scene items, caches, undo history). A probe fills a Sample
+//   each time a report is taken, on the GUI thread.
+//
+// Sizes are estimates of heap use by the objects themselves, not RSS: Qt's
+// private data is approximated, and implicitly shared pixmaps are counted
+// once per report, in the category that measures them first.
+class MemoryLedger
+{
+public:
+    enum Category {
+        Nodes,              // MindMapNode items and their properties
+        NodeWidgets,        // proxies and the widgets embedded in nodes
+        TextDocuments,      // description QTextDocuments
+        Connections,        // ConnectionLine items and routed paths
+        MediaPixmaps,       // thumbnails held by nodes' MediaFiles
+        ThumbnailCache,     // MediaLibrary's shared thumbnails and records
+        FileCaches,         // FileManager's path registry and journal
+        LoadBuffers,        // file contents while a map or store loads
+        UndoHistory,        // CommandHistory's retained commands
+        CategoryCount
+    };
+
+    struct Measure {
+        qint64 bytes = 0;
+        qint64 objects = 0;
+    };
+
+    // Filled by probes; one per report
+    class Sample
+    {
+    public:
+        void add(Category category, qint64 bytes, qint64 objects = 1);
+        // Counts a pixmap's pixels once, however many copies share them
+        void addPixmap(Category category, const QPixmap &pixmap);
+        Measure measure(Category category) const { return m_measures[category]; }
+
+    private:
+        Measure m_measures[CategoryCount];
+        QSet<qint64> m_seenPixmaps;
+    };
+
+    typedef std::function<void(Sample &sample)> Probe;
+
+    struct Usage {
+        Category category = Nodes;
+        QString name;
+        qint64 bytes = 0;
+        qint64 objects = 0;
+        qint64 peakBytes = 0;
+        qint64 budget = 0;      // 0 = none
+        bool isOverBudget() const { return budget > 0 && bytes > budget; }
+    };
+
+    // Counters
+    static void charge(Category category, qint64 bytes, qint64 objects = 1);
+    static void release(Category category, qint64 bytes, qint64 objects = 1);
+
+    // Probes run until their owner is destroyed. GUI thread only.
+    static void addProbe(QObject *owner, const Probe &probe);
+
+    // Runs the probes and returns every category. GUI thread only.
+    static QList<Usage> report();
+    static void resetPeaks();
+
+    // Budgets, in bytes; 0 removes
+    static void setBudget(Category category, qint64 bytes);
+    static qint64 budget(Category category);
+
+    static QString categoryName(Category category);
+    static QString categoryKey(Category category);  // stable, for settings
+
+    // Estimators
+    static qint64 pixmapBytes(const QPixmap &pixmap);
+    static qint64 imageBytes(const QImage &image);
+    static qint64 stringBytes(const QString &text);
+    static qint64 stringListBytes(const QStringList &list);
+    static qint64 documentBytes(const QTextDocument *document);
+
+    // Constants
+    static const int TEXT_BLOCK_OVERHEAD = 256;     // block data, format and layout per paragraph
+    static const int WIDGET_OVERHEAD = 1024;        // QWidget private data, palette, font, style state
+    static const int HASH_NODE_OVERHEAD = 16;       // per QHash/QSet entry, beyond key and value
+
+private:
+    struct ProbeEntry {
+        QPointer<QObject> owner;
+        Probe probe;
+    };
+
+    // Methods
+    static void raisePeak(Category category, qint64 bytes);
+
+    static std::atomic<qint64> s_bytes[CategoryCount];
+    static std::atomic<qint64> s_objects[CategoryCount];
+    static std::atomic<qint64> s_peaks[CategoryCount];
+    static std::atomic<qint64> s_budgets[CategoryCount];
+    static QList<ProbeEntry> s_probes;
+};
+
+// Charges a category for as long as it lives
+class MemoryCharge
+{
+public:
+    MemoryCharge(MemoryLedger::Category category, qint64 bytes, qint64 objects = 1)
+        : m_category(category)
+        , m_bytes(bytes)
+        , m_objects(objects)
+    {
+        MemoryLedger::charge(m_category, m_bytes, m_objects);
+    }
+
+    ~MemoryCharge()
+    {
+        MemoryLedger::release(m_category, m_bytes, m_objects);
+    }
+
+    MemoryCharge(const MemoryCharge &) = delete;
+    MemoryCharge& operator=(const MemoryCharge &) = delete;
+
+private:
+    MemoryLedger::Category m_category;
+    qint64 m_bytes;
+    qint64 m_objects;
+};
+
+#endif // MEMORYLEDGER_H
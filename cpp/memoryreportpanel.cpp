@@ -0,0 +1,117 @@
+#include "memoryreportpanel.h"
+
+#include <QHeaderView>
+#include <QLocale>
+
+MemoryReportPanel::MemoryReportPanel(QWidget *parent)
+    : QWidget(parent)
+    , m_mainLayout(nullptr)
+    , m_table(nullptr)
+    , m_totalLabel(nullptr)
+    , m_refreshButton(nullptr)
+    , m_resetPeaksButton(nullptr)
+    , m_refreshTimer(nullptr)
+{
+    setupUI();
+    setupConnections();
+}
+
+MemoryReportPanel::~MemoryReportPanel()
+{
+}
+
+void MemoryReportPanel::setupUI()
+{
+    m_mainLayout = new QVBoxLayout(this);
+
+    m_table = new QTableWidget(MemoryLedger::CategoryCount, 5, this);
+    m_table->setHorizontalHeaderLabels({"Subsystem", "Size", "Objects", "Peak", "Budget"});
+    m_table->verticalHeader()->hide();
+    m_table->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+    m_table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_table->setSelectionMode(QAbstractItemView::NoSelection);
+    m_mainLayout->addWidget(m_table);
+
+    QHBoxLayout *footerLayout = new QHBoxLayout();
+    m_totalLabel = new QLabel(this);
+    m_refreshButton = new QPushButton("Refresh", this);
+    m_resetPeaksButton = new QPushButton("Reset Peaks", this);
+    footerLayout->addWidget(m_totalLabel, 1);
+    footerLayout->addWidget(m_refreshButton);
+    footerLayout->addWidget(m_resetPeaksButton);
+    m_mainLayout->addLayout(footerLayout);
+
+    m_refreshTimer = new QTimer(this);
+    m_refreshTimer->setInterval(REFRESH_INTERVAL);
+}
+
+void MemoryReportPanel::setupConnections()
+{
+    connect(m_refreshTimer, &QTimer::timeout, this, &MemoryReportPanel::refresh);
+    connect(m_refreshButton, &QPushButton::clicked, this, &MemoryReportPanel::refresh);
+    connect(m_resetPeaksButton, &QPushButton::clicked, this, &MemoryReportPanel::onResetPeaks);
+}
+
+void MemoryReportPanel::refresh()
+{
+    const QList<MemoryLedger::Usage> usages = MemoryLedger::report();
+    qint64 total = 0;
+    QStringList overBudgetNames;
+
+    for (int row = 0; row < usages.size(); ++row) {
+        const MemoryLedger::Usage &usage = usages.at(row);
+        total += usage.bytes;
+
+        const QStringList cells = {
+            usage.name,
+            formatBytes(usage.bytes),
+            QLocale().toString(usage.objects),
+            formatBytes(usage.peakBytes),
+            usage.budget > 0 ? formatBytes(usage.budget) : QString("-")
+        };
+        for (int column = 0; column < cells.size(); ++column) {
+            QTableWidgetItem *item = m_table->item(row, column);
+            if (!item) {
+                item = new QTableWidgetItem();
+                if (column > 0) {
+                    item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+                }
+                m_table->setItem(row, column, item);
+            }
+            item->setText(cells.at(column));
+            item->setForeground(usage.isOverBudget() ? QBrush(Qt::red) : QBrush());
+        }
+        if (usage.isOverBudget()) {
+            overBudgetNames.append(usage.name);
+        }
+    }
+
+    m_totalLabel->setText("Total: " + formatBytes(total));
+    if (!overBudgetNames.isEmpty()) {
+        emit overBudget(overBudgetNames);
+    }
+}
+
+void MemoryReportPanel::showEvent(QShowEvent *event)
+{
+    QWidget::showEvent(event);
+    refresh();
+    m_refreshTimer->start();
+}
+
+void MemoryReportPanel::hideEvent(QHideEvent *event)
+{
+    m_refreshTimer->stop();
+    QWidget::hideEvent(event);
+}
+
+void MemoryReportPanel::onResetPeaks()
+{
+    MemoryLedger::resetPeaks();
+    refresh();
+}
+
+QString MemoryReportPanel::formatBytes(qint64 bytes)
+{
+    return QLocale().formattedDataSize(bytes, 1);
+}
@@ -0,0 +1,59 @@
+#ifndef MEMORYREPORTPANEL_H
+#define MEMORYREPORTPANEL_H
+
+#include <QWidget>
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QTableWidget>
+#include <QLabel>
+#include <QPushButton>
+#include <QTimer>
+
+#include "memoryledger.h"
+
+// Dockable view of MemoryLedger::report(): size, object count, peak and
+// budget per subsystem. Refreshes on a timer while visible only, since a
+// report walks every scene item.
+class MemoryReportPanel : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit MemoryReportPanel(QWidget *parent = nullptr);
+    ~MemoryReportPanel();
+
+public slots:
+    void refresh();
+
+signals:
+    // Emitted on each refresh with the categories over budget, if any
+    void overBudget(const QStringList &categories);
+
+protected:
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
+
+private slots:
+    void onResetPeaks();
+
+private:
+    // UI components
+    QVBoxLayout *m_mainLayout;
+    QTableWidget *m_table;
+    QLabel *m_totalLabel;
+    QPushButton *m_refreshButton;
+    QPushButton *m_resetPeaksButton;
+
+    // Refresh
+    QTimer *m_refreshTimer;
+
+    // Methods
+    void setupUI();
+    void setupConnections();
+    static QString formatBytes(qint64 bytes);
+
+    // Constants
+    static const int REFRESH_INTERVAL = 2000; // ms
+};
+
+#endif // MEMORYREPORTPANEL_H
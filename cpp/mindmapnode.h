@@ -40,28 +40,13 @@
 #include <QMimeDatabase>
 #include <QMimeType>
 
+#include "nodetypes.h"
+#include "progresstracker.h"
+#include "memoryledger.h"
+
 class MindMapScene;
 class FileManager;
 
-struct MediaFile {
-    QString id;
-    QString name;
-    QString filePath;
-    QString type; // "image" or "document"
-    qint64 size;
-    qint64 lastModified;
-    QPixmap thumbnail;
-};
-
-struct TextFormatting {
-    bool bold = false;
-    bool italic = false;
-    bool underline = false;
-    bool strikethrough = false;
-    QString highlightColor = "none";
-    QString textColor = "default";
-};
-
 class MindMapNode : public QGraphicsItem
 {
     Q_OBJECT
@@ -87,8 +72,12 @@ public:
     QStringList getChildren() const { return m_children; }
     QStringList getConnections() const { return m_connections; }
     QString getParentId() const { return m_parentId; }
+    NodeProgress getProgress() const; // "k of n subtasks done", from the scene's ProgressTracker
 
-    // Node setters
+    // Node setters. These don't notify the scene: it re-reads a node after
+    // edits made through the scene, and code that calls them directly must
+    // follow up with MindMapScene::refreshNode(). The scene's indexes are
+    // updated from whatever fields the re-read finds changed.
     void setTitle(const QString &title);
     void setDescription(const QString &description);
     void setCompleted(bool completed);
@@ -114,6 +103,11 @@ public:
     void createChildNode();
     void deleteNode();
 
+    // Memory accounting: the item as Nodes, its proxies and widgets as
+    // NodeWidgets, the description document as TextDocuments and media
+    // thumbnails as MediaPixmaps
+    void measureMemory(MemoryLedger::Sample &sample) const;
+
 protected:
     // Mouse events
     void mousePressEvent(QGraphicsSceneMouseEvent *event) override;
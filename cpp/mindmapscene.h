@@ -34,9 +34,23 @@
 #include <QTextStream>
 #include <QDateTime>
 #include <QUuid>
+#include <QSet>
 
 #include "mindmapnode.h"
 #include "filemanager.h"
+#include "medialibrary.h"
+#include "searchindex.h"
+#include "fuzzymatcher.h"
+#include "taskfiltercontroller.h"
+#include "progresstracker.h"
+#include "treelayout.h"
+#include "layoutanimator.h"
+#include "forcelayout.h"
+#include "connectionrouter.h"
+#include "commandhistory.h"
+#include "scenetransaction.h"
+#include "persistentnodestore.h"
+#include "contentbounds.h"
 
 class MindMapView;
 class ConnectionLine;
@@ -48,7 +62,7 @@ struct MindMapData {
     QList<MindMapNode*> nodes;
 };
 
-class MindMapScene : public QGraphicsScene
+class MindMapScene : public QGraphicsScene, public HistoryTarget
 {
     Q_OBJECT
 
@@ -56,6 +70,11 @@ public:
     explicit MindMapScene(QObject *parent = nullptr);
     ~MindMapScene();
 
+    // Creates the model services below and hooks them to the scene's node
+    // signals (scenemodel.cpp). MainWindow calls it once, right after
+    // construction.
+    void setupModel();
+
     // Scene management
     void clearScene();
     void addNode(MindMapNode *node);
@@ -77,6 +96,7 @@ public:
     void removeConnection(MindMapNode *fromNode, MindMapNode *toNode);
     void updateConnections();
     QList<ConnectionLine*> getConnections() const;
+    ConnectionRouter* getConnectionRouter() const { return m_connectionRouter; }
 
     // Zoom and pan
     void setZoom(qreal zoom);
@@ -84,6 +104,11 @@ public:
     void centerOnContent();
     void resetZoom();
 
+    // Union of node rects, kept current on add/move/remove; O(1). Also drives
+    // setSceneRect() so the scene rect follows content without item scans.
+    QRectF contentRect() const { return m_contentBounds->bounds(); }
+    ContentBounds* getContentBounds() const { return m_contentBounds; }
+
     // File operations
     void saveMindMap(const QString &filePath);
     void loadMindMap(const QString &filePath);
@@ -93,7 +118,7 @@ public:
     // Node operations
     MindMapNode* createNode(const QString &parentId = QString(), const QPointF &position = QPointF());
     void deleteNode(MindMapNode *node);
-    void duplicateNode(MindMapNode *node);
+    void duplicateNode(MindMapNode *node); // via SubtreeFragment::capture()/instantiate()
 
     // View reference
     void setView(MindMapView *view) { m_view = view; }
@@ -102,6 +127,73 @@ public:
     // File manager
     FileManager* getFileManager() const { return m_fileManager; }
 
+    // Shared media records (one hash and thumbnail per unique content);
+    // attachments follow the nodes' media lists
+    MediaLibrary* getMediaLibrary() const { return m_mediaLibrary; }
+
+    // Search
+    SearchIndex* getSearchIndex() { return &m_searchIndex; }
+    FuzzyMatcher* getFuzzyMatcher() { return &m_fuzzyMatcher; }
+
+    // Structured task filters (completion, colours, attachments, depth, subtree)
+    TaskFilterIndex* getTaskFilterIndex() const { return m_taskFilterIndex; }
+    TaskFilterController* getTaskFilter() const { return m_taskFilter; }
+
+    // Subtree completion counters and whole-map statistics
+    ProgressTracker* getProgressTracker() const { return m_progressTracker; }
+    MapProgressStats getProgressStats() const { return m_progressTracker->stats(); }
+
+    // Automatic layout. New children and resized nodes relayout only the
+    // affected subtree; results are applied as one animated batch move.
+    void autoLayout();
+    void setLayoutStyle(TreeLayoutEngine::Style style);
+    TreeLayoutEngine::Style getLayoutStyle() const { return m_treeLayout.getStyle(); }
+    TreeLayoutEngine* getTreeLayout() { return &m_treeLayout; }
+
+    // Force-directed layout over nodes and cross-link connections. Runs in the
+    // background; each published frame is applied in onForceLayoutFrame().
+    void startForceLayout();
+    void stopForceLayout();
+    bool isForceLayoutRunning() const { return m_forceLayout->isRunning(); }
+    ForceLayoutSimulation* getForceLayout() const { return m_forceLayout; }
+
+    // Model state as a persistent map, kept in step with the nodes. Node
+    // setters don't notify the scene, so a node is re-read after scene input
+    // on it, after its node and connection signals, and on refreshNode();
+    // re-reads are batched once per event-loop pass and only changed fields
+    // go on to the model. Snapshots are O(1) and may be read on worker
+    // threads (autosave, export, search) while editing continues on the
+    // live store.
+    const PersistentNodeStore& getNodeStore() const { return m_nodeStore; }
+    PersistentNodeStore snapshotNodes(); // applies pending re-reads first
+    void refreshNode(MindMapNode *node);
+    void syncModel(); // re-reads every node, e.g. after load or clear
+
+    // Bulk mutation. Between begin and commit, node and connection signals
+    // are replaced by one sceneChanged(), index updates are flushed once, the
+    // views repaint once, and the whole batch becomes a single undo step.
+    // Steps sharing a mergeKey (one drag, one run of typing) merge further.
+    void beginTransaction(const QString &text = QString(), const QString &mergeKey = QString());
+    void commitTransaction();
+    bool inTransaction() const { return m_transaction->isOpen(); }
+    SceneTransaction* getTransaction() const { return m_transaction; }
+
+    // Undo/redo. Mutators record minimal diffs into the history; drags and
+    // title/description typing merge until the mouse is released or the
+    // editor loses focus.
+    CommandHistory* getCommandHistory() const { return m_commandHistory; }
+
+    // HistoryTarget interface: the batched path used by undo/redo, paste,
+    // cut and duplicate; each call runs inside a transaction
+    void insertNodes(const QVector<NodeSnapshot> &nodes) override;
+    void removeNodes(const QStringList &nodeIds) override;
+    void moveNodes(const QHash<QString, QPointF> &positions) override;
+    void setNodeProperties(const QVector<PropertyDelta> &deltas, bool useBefore) override;
+    void connectNodes(const QVector<ConnectionDelta> &connections) override;
+    void disconnectNodes(const QVector<ConnectionDelta> &connections) override;
+
+    QList<MindMapNode*> findNodes(const QString &query, int limit = SearchIndex::DEFAULT_LIMIT);
+
 signals:
     void nodeSelected(MindMapNode *node);
     void nodeDeselected(MindMapNode *node);
@@ -110,12 +202,14 @@ signals:
     void nodeMoved(MindMapNode *node, const QPointF &position);
     void connectionCreated(MindMapNode *fromNode, MindMapNode *toNode);
     void connectionRemoved(MindMapNode *fromNode, MindMapNode *toNode);
+    void sceneChanged(const SceneChangeSet &changes);
     void mindMapSaved();
     void mindMapLoaded();
     void autoSaveCompleted();
 
 protected:
     // Scene events
+    bool event(QEvent *event) override; // queues re-reads after node edits
     void mousePressEvent(QGraphicsSceneMouseEvent *event) override;
     void mouseMoveEvent(QGraphicsSceneMouseEvent *event) override;
     void mouseReleaseEvent(QGraphicsSceneMouseEvent *event) override;
@@ -126,6 +220,12 @@ private slots:
     void onAutoSaveTimeout();
     void onNodeSelectionChanged();
     void onNodePositionChanged();
+    void onLayoutAnimationFinished();
+    void onForceLayoutFrame();
+    void onRouteReady(const QString &edgeId);
+    void onRouteInvalidated(const QString &edgeId);
+    void onTransactionFlush(const SceneChangeSet &changes);
+    void onTransactionCommitted(const SceneChangeSet &changes);
 
 private:
     // Core data
@@ -133,6 +233,31 @@ private:
     QList<ConnectionLine*> m_connections;
     MindMapView *m_view;
     FileManager *m_fileManager;
+    MediaLibrary *m_mediaLibrary = nullptr;
+    SearchIndex m_searchIndex;
+    FuzzyMatcher m_fuzzyMatcher;
+    TaskFilterIndex *m_taskFilterIndex = nullptr;
+    TaskFilterController *m_taskFilter = nullptr;
+    ProgressTracker *m_progressTracker = nullptr;
+    PersistentNodeStore m_nodeStore;
+    ContentBounds *m_contentBounds = nullptr;
+    QSet<QString> m_pendingNodeIds; // re-read on the next m_syncTimer tick
+    QTimer *m_syncTimer = nullptr; // null until setupModel()
+
+    // Layout
+    TreeLayoutEngine m_treeLayout;
+    LayoutAnimator *m_layoutAnimator = nullptr;
+    QSet<QString> m_animatedNodeIds; // re-read when the animator finishes
+    ForceLayoutSimulation *m_forceLayout = nullptr;
+
+    // Connection routing; node geometry is mirrored into the router, which
+    // also serves as the node spatial index for corridor queries
+    ConnectionRouter *m_connectionRouter = nullptr;
+
+    // Bulk mutation and undo/redo
+    SceneTransaction *m_transaction = nullptr;
+    CommandHistory *m_commandHistory = nullptr;
+    QHash<QString, QPointF> m_dragOrigins; // positions at mouse press
 
     // Selection state
     MindMapNode *m_selectedNode;
@@ -156,13 +281,22 @@ private:
     void drawConnections();
     void clearConnections();
     QString generateNodeId() const;
-    QPointF calculateChildPosition(MindMapNode *parentNode) const;
+    void applyLayout(const QHash<QString, QPointF> &positions);
     void saveNodeToJson(QJsonObject &json, MindMapNode *node);
     MindMapNode* loadNodeFromJson(const QJsonObject &json);
     void saveToSettings();
     void loadFromSettings();
     QString getDefaultSavePath() const;
     void createConnectionLine(MindMapNode *fromNode, MindMapNode *toNode);
+    ConnectionLine* connectionForEdge(const QString &edgeId) const;
+    void scheduleRefresh(const QString &nodeId);
+    void flushPendingNodes();
+    void updateRecord(const QString &nodeId);
+    void forgetRecord(const QString &nodeId);
+    void indexRecord(const NodeRecordPtr &previous, const NodeRecord &record);
+    void unindexRecord(const NodeRecord &record);
+    void updateAttachments(const QList<MediaFile> &previous, const NodeRecord &record);
+    void updateEdges(const QStringList &previous, const NodeRecord &record);
 
     // Constants
     static const int AUTO_SAVE_INTERVAL = 5000; // 5 seconds
@@ -186,6 +320,14 @@ public:
     void updatePosition();
     MindMapNode* getFromNode() const { return m_fromNode; }
     MindMapNode* getToNode() const { return m_toNode; }
+    QString getEdgeId() const;
+
+    // Routed path from the ConnectionRouter; without one the line is drawn
+    // straight between calculateEndPoints()
+    void setRoutedPath(const QPainterPath &path);
+    void clearRoutedPath();
+    bool hasRoutedPath() const { return !m_routedPath.isEmpty(); }
+    const QPainterPath& getRoutedPath() const { return m_routedPath; }
 
 private:
     MindMapNode *m_fromNode;
@@ -197,6 +339,7 @@ private:
     int m_lineWidth;
     QColor m_lineColor;
     Qt::PenStyle m_lineStyle;
+    QPainterPath m_routedPath;
 
     void calculateEndPoints();
     QPointF getNodeConnectionPoint(MindMapNode *node, const QPointF &direction) const;
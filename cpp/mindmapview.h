@@ -108,6 +108,7 @@
 #include "mindmapscene.h"
 #include "mindmapnode.h"
 #include "filemanager.h"
+#include "notificationcoalescer.h"
 
 class MindMapScene;
 class MindMapNode;
@@ -130,8 +131,9 @@ public:
     void zoomIn();
     void zoomOut();
     void resetZoom();
-    void centerOnContent();
+    void centerOnContent(); // both use MindMapScene::contentRect(), no item walk
     void fitInView();
+    void centerOn(const QPointF &pos);
 
     // Pan mode
     void setPanMode(bool enabled);
@@ -159,11 +161,19 @@ public:
     void setOpenGLRendering(bool enabled);
     bool isOpenGLRendering() const { return m_openGLRendering; }
 
-    // Export
+    // Export (PDF and SVG hand a node snapshot to a VectorExporter and
+    // return at once; large maps should use MainWindow's export instead)
     void exportToImage(const QString &filePath);
     void exportToPdf(const QString &filePath);
     void exportToSvg(const QString &filePath);
 
+    // Per-frame batched nodeMoved/viewportChanged, flushed on the update
+    // tick; listeners that don't need every event should connect here.
+    // setupNotifier() creates it (viewnotifier.cpp); MainWindow calls it
+    // once, right after construction.
+    void setupNotifier();
+    NotificationCoalescer* getNotifier() const { return m_notifier; }
+
 signals:
     void zoomChanged(qreal zoom);
     void viewportChanged();
@@ -236,6 +246,7 @@ private:
     // Performance
     QTimer *m_updateTimer;
     bool m_updatePending;
+    NotificationCoalescer *m_notifier = nullptr; // created with UPDATE_INTERVAL
 
     // Methods
     void setupView();
@@ -252,7 +263,6 @@ private:
     QPoint mapFromScene(const QPointF &pos) const;
     QRectF getVisibleRect() const;
     void ensureVisible(const QRectF &rect);
-    void centerOn(const QPointF &pos);
     void fitInView(const QRectF &rect);
     void scaleView(qreal scaleFactor);
     void translateView(const QPointF &delta);
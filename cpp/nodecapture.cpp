@@ -0,0 +1,44 @@
+#include "commandhistory.h"
+#include "persistentnodestore.h"
+#include "mindmapnode.h"
+
+// Value captures of a live MindMapNode. The value types live in the core
+// library, which cannot see QGraphicsItem, so their factories from a node
+// are compiled into the GUI target.
+
+NodeSnapshot NodeSnapshot::fromNode(const MindMapNode *node)
+{
+    NodeSnapshot snapshot;
+    snapshot.id = node->getId();
+    snapshot.parentId = node->getParentId();
+    snapshot.title = node->getTitle();
+    snapshot.description = node->getDescription();
+    snapshot.completed = node->isCompleted();
+    snapshot.formatting = node->getFormatting();
+    snapshot.position = node->getPosition();
+    snapshot.mediaFiles = node->getMediaFiles();
+    for (MediaFile &media : snapshot.mediaFiles) {
+        media.thumbnail = QPixmap();
+    }
+    return snapshot;
+}
+
+NodeRecord NodeRecord::fromNode(const MindMapNode *node)
+{
+    NodeRecord record;
+    record.id = node->getId();
+    record.parentId = node->getParentId();
+    record.title = node->getTitle();
+    record.description = node->getDescription();
+    record.completed = node->isCompleted();
+    record.formatting = node->getFormatting();
+    record.position = node->getPosition();
+    record.bounds = node->sceneBoundingRect();
+    record.mediaFiles = node->getMediaFiles();
+    for (MediaFile &media : record.mediaFiles) {
+        media.thumbnail = QPixmap();
+    }
+    record.children = node->getChildren();
+    record.connections = node->getConnections();
+    return record;
+}
@@ -0,0 +1,55 @@
+#include "mindmapnode.h"
+#include "memoryledger.h"
+
+#include <QTextDocument>
+
+// Memory estimates for the node items. Everything here is read on the GUI
+// thread when a memory report is taken; nothing is tracked per mutation.
+
+namespace {
+
+// A proxy, the widget it embeds and, if the proxy caches its rendering,
+// that cache.
+qint64 proxyBytes(const QGraphicsProxyWidget *proxy)
+{
+    qint64 bytes = sizeof(QGraphicsProxyWidget) + MemoryLedger::WIDGET_OVERHEAD;
+    if (proxy->cacheMode() != QGraphicsItem::NoCache) {
+        const QSizeF size = proxy->boundingRect().size();
+        bytes += qint64(size.width()) * qint64(size.height()) * 4;
+    }
+    return bytes;
+}
+
+} // namespace
+
+void MindMapNode::measureMemory(MemoryLedger::Sample &sample) const
+{
+    qint64 nodeBytes = sizeof(MindMapNode)
+                       + MemoryLedger::stringBytes(m_id) + MemoryLedger::stringBytes(m_title)
+                       + MemoryLedger::stringBytes(m_description) + MemoryLedger::stringBytes(m_parentId)
+                       + MemoryLedger::stringListBytes(m_children) + MemoryLedger::stringListBytes(m_connections)
+                       + MemoryLedger::stringBytes(m_formatting.highlightColor)
+                       + MemoryLedger::stringBytes(m_formatting.textColor);
+    for (const MediaFile &media : m_mediaFiles) {
+        nodeBytes += sizeof(MediaFile) + MemoryLedger::stringBytes(media.id) + MemoryLedger::stringBytes(media.name)
+                     + MemoryLedger::stringBytes(media.filePath) + MemoryLedger::stringBytes(media.contentHash);
+        sample.addPixmap(MemoryLedger::MediaPixmaps, media.thumbnail);
+    }
+    sample.add(MemoryLedger::Nodes, nodeBytes);
+
+    const QGraphicsProxyWidget *proxies[] = {
+        m_titleEditProxy, m_descriptionEditProxy, m_checkBoxProxy,
+        m_addButtonProxy, m_formattingWidgetProxy, m_mediaWidgetProxy
+    };
+    for (const QGraphicsProxyWidget *proxy : proxies) {
+        if (proxy) {
+            sample.add(MemoryLedger::NodeWidgets, proxyBytes(proxy));
+        }
+    }
+    if (m_titleEdit) {
+        sample.add(MemoryLedger::NodeWidgets, MemoryLedger::stringBytes(m_titleEdit->text()), 0);
+    }
+    if (m_descriptionEdit) {
+        sample.add(MemoryLedger::TextDocuments, MemoryLedger::documentBytes(m_descriptionEdit->document()));
+    }
+}
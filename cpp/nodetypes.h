@@ -0,0 +1,30 @@
+#ifndef NODETYPES_H
+#define NODETYPES_H
+
+#include <QString>
+#include <QPixmap>
+
+// Plain node value types, kept apart from MindMapNode so the core library
+// (model, serialization, export) can use them without QtWidgets.
+
+struct MediaFile {
+    QString id;
+    QString name;
+    QString filePath;
+    QString type; // "image" or "document"
+    qint64 size;
+    qint64 lastModified;
+    QPixmap thumbnail;
+    QString contentHash; // filled in by MediaLibrary once the bytes are hashed
+};
+
+struct TextFormatting {
+    bool bold = false;
+    bool italic = false;
+    bool underline = false;
+    bool strikethrough = false;
+    QString highlightColor = "none";
+    QString textColor = "default";
+};
+
+#endif // NODETYPES_H
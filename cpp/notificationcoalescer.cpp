@@ -0,0 +1,75 @@
+#include "notificationcoalescer.h"
+
+NotificationCoalescer::NotificationCoalescer(int interval, QObject *parent)
+    : QObject(parent)
+    , m_viewportDirty(false)
+    , m_flushing(false)
+    , m_timer(new QTimer(this))
+{
+    m_timer->setSingleShot(true);
+    m_timer->setInterval(interval);
+    m_timer->setTimerType(Qt::PreciseTimer);
+    connect(m_timer, &QTimer::timeout, this, &NotificationCoalescer::flush);
+}
+
+NotificationCoalescer::~NotificationCoalescer()
+{
+}
+
+void NotificationCoalescer::nodeMoved(const QString &nodeId, const QPointF &position)
+{
+    m_positions.insert(nodeId, position);
+    schedule();
+}
+
+void NotificationCoalescer::forgetNode(const QString &nodeId)
+{
+    m_positions.remove(nodeId);
+}
+
+void NotificationCoalescer::viewportChanged()
+{
+    m_viewportDirty = true;
+    schedule();
+}
+
+void NotificationCoalescer::flush()
+{
+    m_timer->stop();
+    if (m_flushing || !hasPending()) {
+        return;
+    }
+
+    // Swap out first; anything a listener triggers goes to the next frame.
+    m_flushing = true;
+    QHash<QString, QPointF> positions;
+    qSwap(positions, m_positions);
+    const bool viewportDirty = m_viewportDirty;
+    m_viewportDirty = false;
+
+    if (!positions.isEmpty()) {
+        emit nodesMoved(positions);
+    }
+    if (viewportDirty) {
+        emit viewportSettled();
+    }
+    m_flushing = false;
+
+    if (hasPending()) {
+        schedule();
+    }
+}
+
+void NotificationCoalescer::setInterval(int msecs)
+{
+    m_timer->setInterval(msecs);
+}
+
+void NotificationCoalescer::schedule()
+{
+    // Deliberately not restarted: a continuous drag still delivers every
+    // interval instead of waiting for the mouse to stop.
+    if (!m_timer->isActive()) {
+        m_timer->start();
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef NOTIFICATIONCOALESCER_H
+#define NOTIFICATIONCOALESCER_H
+
+#include <QObject>
+#include <QString>
+#include <QHash>
+#include <QPointF>
+#include <QTimer>
+
+// Folds high-rate notifications (node moves, viewport scrolls) into at most
+// one delivery per frame. Moves are keyed by node id, so a drag of many
+// nodes over many mouse events arrives as one set of final positions.
+//
+// The owning view calls flush() from its own update tick so listeners run
+// right before the repaint; the internal timer only covers frames the view
+// doesn't repaint.
+class NotificationCoalescer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit NotificationCoalescer(int interval, QObject *parent = nullptr);
+    ~NotificationCoalescer();
+
+    // Input
+    void nodeMoved(const QString &nodeId, const QPointF &position);
+    void forgetNode(const QString &nodeId);
+    void viewportChanged();
+
+    // Delivery
+    void flush();
+    bool hasPending() const { return !m_positions.isEmpty() || m_viewportDirty; }
+    void setInterval(int msecs);
+    int getInterval() const { return m_timer->interval(); }
+
+signals:
+    void nodesMoved(const QHash<QString, QPointF> &positions);
+    void viewportSettled();
+
+private:
+    // Pending state
+    QHash<QString, QPointF> m_positions;
+    bool m_viewportDirty;
+    bool m_flushing;
+
+    // Frame timer
+    QTimer *m_timer;
+
+    // Methods
+    void schedule();
+};
+
+#endif // NOTIFICATIONCOALESCER_H
@@ -0,0 +1,179 @@
+#include "persistentnodestore.h"
+
+#include <QHash>
+#include <QtAlgorithms>
+
+PersistentNodeStore::PersistentNodeStore()
+    : m_root(new TrieNode)
+    , m_size(0)
+    , m_version(0)
+{
+}
+
+NodeRecordPtr PersistentNodeStore::value(const QString &nodeId) const
+{
+    const Slot *slot = find(m_root.constData(), nodeId, hashOf(nodeId));
+    return slot ? slot->record : NodeRecordPtr();
+}
+
+bool PersistentNodeStore::contains(const QString &nodeId) const
+{
+    return find(m_root.constData(), nodeId, hashOf(nodeId)) != nullptr;
+}
+
+QVector<NodeRecordPtr> PersistentNodeStore::values() const
+{
+    QVector<NodeRecordPtr> records;
+    records.reserve(m_size);
+    forEach([&records](const NodeRecordPtr &record) {
+        records.append(record);
+    });
+    return records;
+}
+
+void PersistentNodeStore::insert(const NodeRecord &record)
+{
+    insert(NodeRecordPtr(new NodeRecord(record)));
+}
+
+void PersistentNodeStore::insert(const NodeRecordPtr &record)
+{
+    if (insertInto(m_root, record, hashOf(record->id), 0)) {
+        m_size++;
+    }
+    m_version++;
+}
+
+void PersistentNodeStore::remove(const QString &nodeId)
+{
+    // Look first so a miss doesn't clone the path.
+    const quint32 hash = hashOf(nodeId);
+    if (!find(m_root.constData(), nodeId, hash)) {
+        return;
+    }
+    removeFrom(m_root, nodeId, hash, 0);
+    m_size--;
+    m_version++;
+}
+
+void PersistentNodeStore::clear()
+{
+    m_root = TrieNodePtr(new TrieNode);
+    m_size = 0;
+    m_version++;
+}
+
+quint32 PersistentNodeStore::hashOf(const QString &nodeId)
+{
+    return quint32(qHash(nodeId));
+}
+
+const PersistentNodeStore::Slot* PersistentNodeStore::find(const TrieNode *node, const QString &nodeId, quint32 hash)
+{
+    for (int shift = 0; ; shift += BITS_PER_LEVEL) {
+        if (shift >= HASH_BITS) {
+            for (const Slot &slot : node->slots) {
+                if (slot.record->id == nodeId) {
+                    return &slot;
+                }
+            }
+            return nullptr;
+        }
+
+        const quint32 bit = 1u << ((hash >> shift) & LEVEL_MASK);
+        if (!(node->bitmap & bit)) {
+            return nullptr;
+        }
+        const Slot &slot = node->slots.at(qPopulationCount(node->bitmap & (bit - 1)));
+        if (!slot.child) {
+            return slot.record->id == nodeId ? &slot : nullptr;
+        }
+        node = slot.child.constData();
+    }
+}
+
+bool PersistentNodeStore::insertInto(TrieNodePtr &node, const NodeRecordPtr &record, quint32 hash, int shift)
+{
+    // Clones only when a snapshot still shares this node. A cloned node
+    // references its children, which raises their counts in turn, so
+    // everything below a shared node is cloned on the way down as well.
+    node.detach();
+
+    if (shift >= HASH_BITS) {
+        for (Slot &slot : node->slots) {
+            if (slot.record->id == record->id) {
+                slot.record = record;
+                return false;
+            }
+        }
+        Slot slot;
+        slot.record = record;
+        slot.hash = hash;
+        node->slots.append(slot);
+        return true;
+    }
+
+    const quint32 bit = 1u << ((hash >> shift) & LEVEL_MASK);
+    const int position = qPopulationCount(node->bitmap & (bit - 1));
+    if (!(node->bitmap & bit)) {
+        Slot slot;
+        slot.record = record;
+        slot.hash = hash;
+        node->slots.insert(position, slot);
+        node->bitmap |= bit;
+        return true;
+    }
+
+    Slot &slot = node->slots[position];
+    if (slot.child) {
+        return insertInto(slot.child, record, hash, shift + BITS_PER_LEVEL);
+    }
+    if (slot.record->id == record->id) {
+        slot.record = record;
+        return false;
+    }
+
+    // Two keys share this prefix: push both one level down.
+    TrieNodePtr child(new TrieNode);
+    insertInto(child, slot.record, slot.hash, shift + BITS_PER_LEVEL);
+    insertInto(child, record, hash, shift + BITS_PER_LEVEL);
+    slot.record.reset();
+    slot.child = child;
+    return true;
+}
+
+void PersistentNodeStore::removeFrom(TrieNodePtr &node, const QString &nodeId, quint32 hash, int shift)
+{
+    node.detach();
+
+    if (shift >= HASH_BITS) {
+        for (int i = 0; i < node->slots.size(); ++i) {
+            if (node->slots.at(i).record->id == nodeId) {
+                node->slots.remove(i);
+                return;
+            }
+        }
+        return;
+    }
+
+    const quint32 bit = 1u << ((hash >> shift) & LEVEL_MASK);
+    const int position = qPopulationCount(node->bitmap & (bit - 1));
+    Slot &slot = node->slots[position];
+    if (slot.child) {
+        removeFrom(slot.child, nodeId, hash, shift + BITS_PER_LEVEL);
+
+        // Keep the trie canonical: a child left with a single leaf is
+        // replaced by that leaf.
+        const TrieNode *child = slot.child.constData();
+        if (child->slots.size() == 1 && !child->slots.first().child) {
+            const Slot leaf = child->slots.first();
+            slot.child.reset();
+            slot.record = leaf.record;
+            slot.hash = leaf.hash;
+        }
+        return;
+    }
+
+    node->slots.remove(position);
+    node->bitmap &= ~bit;
+}
@@ -0,0 +1,124 @@
+#ifndef PERSISTENTNODESTORE_H
+#define PERSISTENTNODESTORE_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QList>
+#include <QPointF>
+#include <QRectF>
+#include <QSharedData>
+#include <QSharedPointer>
+#include <QExplicitlySharedDataPointer>
+
+#include "nodetypes.h"
+
+class MindMapNode;
+
+// Immutable copy of a node's model state. Safe to read from any thread;
+// thumbnails (QPixmap) are left out for that reason.
+struct NodeRecord {
+    QString id;
+    QString parentId;
+    QString title;
+    QString description;
+    bool completed = false;
+    TextFormatting formatting;
+    QPointF position;
+    QRectF bounds;          // scene bounding rect, for rendering off the GUI thread
+    QList<MediaFile> mediaFiles;
+    QStringList children;
+    QStringList connections;
+
+    static NodeRecord fromNode(const MindMapNode *node); // defined in the GUI target, nodecapture.cpp
+};
+
+typedef QSharedPointer<const NodeRecord> NodeRecordPtr;
+
+// Persistent map of node id -> NodeRecord, implemented as a hash array
+// mapped trie (32-way, path copying). Copying a store is O(1) and yields a
+// frozen snapshot: writes on the live copy clone only the O(log32 n) trie
+// nodes on their path, and only where a snapshot still shares them.
+//
+// Writes belong to one thread (the GUI thread owns the live store).
+// Snapshots may be handed to and read from any thread; reference counts are
+// atomic and records are never modified after insertion.
+class PersistentNodeStore
+{
+public:
+    PersistentNodeStore();
+
+    // Reads
+    NodeRecordPtr value(const QString &nodeId) const;
+    bool contains(const QString &nodeId) const;
+    int size() const { return m_size; }
+    bool isEmpty() const { return m_size == 0; }
+    QVector<NodeRecordPtr> values() const;
+    template <typename Visitor> void forEach(Visitor visit) const;
+
+    // Writes
+    void insert(const NodeRecord &record);
+    void insert(const NodeRecordPtr &record);
+    void remove(const QString &nodeId);
+    void clear();
+
+    // Snapshots. version() changes on every write, so holders can tell
+    // cheaply whether a snapshot is still current.
+    PersistentNodeStore snapshot() const { return *this; }
+    quint64 version() const { return m_version; }
+    bool sharesStateWith(const PersistentNodeStore &other) const { return m_root == other.m_root; }
+
+private:
+    struct TrieNode;
+    typedef QExplicitlySharedDataPointer<TrieNode> TrieNodePtr;
+
+    struct Slot {
+        TrieNodePtr child;      // set for an inner slot
+        NodeRecordPtr record;   // set for a leaf slot
+        quint32 hash = 0;
+    };
+
+    // Below HASH_BITS a node is a bitmap-compressed array of up to 32 slots;
+    // at that depth it is a plain list of colliding leaves.
+    struct TrieNode : public QSharedData {
+        quint32 bitmap = 0;
+        QVector<Slot> slots;
+    };
+
+    // State
+    TrieNodePtr m_root;
+    int m_size;
+    quint64 m_version;
+
+    // Methods
+    static quint32 hashOf(const QString &nodeId);
+    static const Slot* find(const TrieNode *node, const QString &nodeId, quint32 hash);
+    static bool insertInto(TrieNodePtr &node, const NodeRecordPtr &record, quint32 hash, int shift);
+    static void removeFrom(TrieNodePtr &node, const QString &nodeId, quint32 hash, int shift);
+    template <typename Visitor> static void visit(const TrieNode *node, Visitor &visitor);
+
+    // Constants
+    static const int BITS_PER_LEVEL = 5;
+    static const int HASH_BITS = 32;
+    static const quint32 LEVEL_MASK = 0x1f;
+};
+
+template <typename Visitor>
+void PersistentNodeStore::forEach(Visitor visitor) const
+{
+    visit(m_root.constData(), visitor);
+}
+
+template <typename Visitor>
+void PersistentNodeStore::visit(const TrieNode *node, Visitor &visitor)
+{
+    for (const Slot &slot : node->slots) {
+        if (slot.child) {
+            visit(slot.child.constData(), visitor);
+        } else {
+            visitor(slot.record);
+        }
+    }
+}
+
+#endif // PERSISTENTNODESTORE_H
@@ -0,0 +1,258 @@
+#include "progresstracker.h"
+
+#include <QPen>
+
+ProgressTracker::ProgressTracker(QObject *parent)
+    : QObject(parent)
+    , m_statsChangePending(false)
+{
+}
+
+ProgressTracker::~ProgressTracker()
+{
+}
+
+void ProgressTracker::addNode(const QString &nodeId, const QString &parentId, bool completed)
+{
+    if (m_entries.contains(nodeId)) {
+        setParent(nodeId, parentId);
+        setCompleted(nodeId, completed);
+        return;
+    }
+
+    QStringList touched;
+    Entry entry;
+    entry.completed = completed;
+    m_entries.insert(nodeId, entry);
+    touched.append(nodeId);
+
+    m_stats.totalNodes++;
+    if (completed) {
+        m_stats.completedNodes++;
+    }
+    m_stats.rootNodes++;
+
+    if (!parentId.isEmpty() && parentId != nodeId) {
+        attach(nodeId, parentId, touched);
+    }
+
+    // Children loaded before this node can now hang off it, unless the
+    // file has a cycle (A under B, B under A); those stay roots.
+    const QStringList orphans = m_orphansByParentId.take(nodeId);
+    for (const QString &childId : orphans) {
+        auto it = m_entries.find(childId);
+        if (it == m_entries.end() || it->pendingParent != nodeId) {
+            continue;
+        }
+        it->pendingParent.clear();
+        if (!isAncestor(childId, nodeId)) {
+            attach(childId, nodeId, touched);
+        }
+    }
+
+    notify(touched);
+}
+
+void ProgressTracker::removeNode(const QString &nodeId)
+{
+    auto it = m_entries.find(nodeId);
+    if (it == m_entries.end()) {
+        return;
+    }
+
+    QStringList touched;
+    detach(nodeId, touched);
+
+    // Direct children become roots that wait for a node with this id again;
+    // their own counters are untouched.
+    it = m_entries.find(nodeId);
+    const bool completed = it->completed;
+    const QStringList children = it->children;
+    m_entries.erase(it);
+    for (const QString &childId : children) {
+        Entry &child = m_entries[childId];
+        child.parentId.clear();
+        child.pendingParent = nodeId;
+        m_orphansByParentId[nodeId].append(childId);
+        m_stats.rootNodes++;
+    }
+
+    m_stats.totalNodes--;
+    m_stats.rootNodes--;
+    if (completed) {
+        m_stats.completedNodes--;
+    }
+    notify(touched);
+}
+
+void ProgressTracker::setParent(const QString &nodeId, const QString &parentId)
+{
+    auto it = m_entries.find(nodeId);
+    if (it == m_entries.end()) {
+        return;
+    }
+    // A node waits on its pending parent or hangs off its attached one,
+    // never both; compare with whichever applies.
+    const QString &currentParent = it->pendingParent.isEmpty() ? it->parentId : it->pendingParent;
+    if (currentParent == parentId) {
+        return;
+    }
+    if (!parentId.isEmpty() && (parentId == nodeId || isAncestor(nodeId, parentId))) {
+        return; // would create a cycle
+    }
+
+    QStringList touched;
+    detach(nodeId, touched);
+    if (!parentId.isEmpty()) {
+        attach(nodeId, parentId, touched);
+    }
+    notify(touched);
+}
+
+void ProgressTracker::setCompleted(const QString &nodeId, bool completed)
+{
+    auto it = m_entries.find(nodeId);
+    if (it == m_entries.end() || it->completed == completed) {
+        return;
+    }
+
+    it->completed = completed;
+    m_stats.completedNodes += completed ? 1 : -1;
+
+    QStringList touched;
+    touched.append(nodeId);
+    propagate(it->parentId, completed ? 1 : -1, 0, touched);
+    notify(touched);
+}
+
+void ProgressTracker::clear()
+{
+    m_entries.clear();
+    m_orphansByParentId.clear();
+    m_stats = MapProgressStats();
+    scheduleStatsChanged();
+}
+
+NodeProgress ProgressTracker::progress(const QString &nodeId) const
+{
+    NodeProgress result;
+    auto it = m_entries.constFind(nodeId);
+    if (it != m_entries.constEnd()) {
+        result.doneBelow = it->doneBelow;
+        result.totalBelow = it->totalBelow;
+        result.completed = it->completed;
+    }
+    return result;
+}
+
+void ProgressTracker::paintRing(QPainter *painter, const QRectF &rect, const NodeProgress &progress)
+{
+    if (!progress.hasSubtasks()) {
+        return;
+    }
+
+    const int ringWidth = RING_WIDTH;
+    const QRectF ringRect = rect.adjusted(ringWidth / 2.0, ringWidth / 2.0, -ringWidth / 2.0, -ringWidth / 2.0);
+
+    painter->save();
+    painter->setRenderHint(QPainter::Antialiasing);
+    painter->setBrush(Qt::NoBrush);
+
+    painter->setPen(QPen(QColor(0x37, 0x41, 0x51), ringWidth, Qt::SolidLine, Qt::FlatCap));
+    painter->drawEllipse(ringRect);
+
+    // Qt angles are in 1/16th of a degree, counter-clockwise from 3 o'clock.
+    const int span = qRound(-progress.ratio() * 360.0 * 16.0);
+    if (span != 0) {
+        painter->setPen(QPen(QColor(0x10, 0xB9, 0x81), ringWidth, Qt::SolidLine, Qt::RoundCap));
+        painter->drawArc(ringRect, 90 * 16, span);
+    }
+    painter->restore();
+}
+
+void ProgressTracker::attach(const QString &nodeId, const QString &parentId, QStringList &touched)
+{
+    auto it = m_entries.find(nodeId);
+    if (!m_entries.contains(parentId)) {
+        it->pendingParent = parentId;
+        m_orphansByParentId[parentId].append(nodeId);
+        return;
+    }
+
+    it->parentId = parentId;
+    m_entries[parentId].children.append(nodeId);
+    m_stats.rootNodes--;
+    propagate(parentId, it->doneBelow + (it->completed ? 1 : 0), it->totalBelow + 1, touched);
+}
+
+void ProgressTracker::detach(const QString &nodeId, QStringList &touched)
+{
+    auto it = m_entries.find(nodeId);
+    if (!it->pendingParent.isEmpty()) {
+        QStringList &waiting = m_orphansByParentId[it->pendingParent];
+        waiting.removeOne(nodeId);
+        if (waiting.isEmpty()) {
+            m_orphansByParentId.remove(it->pendingParent);
+        }
+        it->pendingParent.clear();
+        return;
+    }
+    if (it->parentId.isEmpty()) {
+        return;
+    }
+
+    const QString parentId = it->parentId;
+    const int doneDelta = -(it->doneBelow + (it->completed ? 1 : 0));
+    const int totalDelta = -(it->totalBelow + 1);
+    it->parentId.clear();
+    m_entries[parentId].children.removeOne(nodeId);
+    m_stats.rootNodes++;
+    propagate(parentId, doneDelta, totalDelta, touched);
+}
+
+void ProgressTracker::propagate(const QString &fromParentId, int doneDelta, int totalDelta, QStringList &touched)
+{
+    QString currentId = fromParentId;
+    while (!currentId.isEmpty()) {
+        auto it = m_entries.find(currentId);
+        if (it == m_entries.end()) {
+            break;
+        }
+        it->doneBelow += doneDelta;
+        it->totalBelow += totalDelta;
+        touched.append(currentId);
+        currentId = it->parentId;
+    }
+}
+
+bool ProgressTracker::isAncestor(const QString &ancestorId, const QString &nodeId) const
+{
+    QString currentId = m_entries.value(nodeId).parentId;
+    while (!currentId.isEmpty()) {
+        if (currentId == ancestorId) {
+            return true;
+        }
+        currentId = m_entries.value(currentId).parentId;
+    }
+    return false;
+}
+
+void ProgressTracker::notify(const QStringList &touched)
+{
+    if (!touched.isEmpty()) {
+        emit progressChanged(touched);
+    }
+    scheduleStatsChanged();
+}
+
+void ProgressTracker::scheduleStatsChanged()
+{
+    if (m_statsChangePending) {
+        return;
+    }
+    m_statsChangePending = true;
+    QMetaObject::invokeMethod(this, [this]() {
+        m_statsChangePending = false;
+        emit statsChanged(m_stats);
+    }, Qt::QueuedConnection);
+}
@@ -0,0 +1,91 @@
+#ifndef PROGRESSTRACKER_H
+#define PROGRESSTRACKER_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QVector>
+#include <QRectF>
+#include <QPainter>
+
+// Aggregate counters for one node. "Subtasks" are all descendants, not
+// only direct children, so a ring on the root covers the whole map.
+struct NodeProgress {
+    int doneBelow = 0;
+    int totalBelow = 0;
+    bool completed = false;
+
+    bool hasSubtasks() const { return totalBelow > 0; }
+    qreal ratio() const { return totalBelow > 0 ? qreal(doneBelow) / totalBelow : (completed ? 1.0 : 0.0); }
+    QString label() const { return QString("%1 of %2 subtasks done").arg(doneBelow).arg(totalBelow); }
+};
+
+struct MapProgressStats {
+    int totalNodes = 0;
+    int completedNodes = 0;
+    int rootNodes = 0;
+
+    int openNodes() const { return totalNodes - completedNodes; }
+    qreal ratio() const { return totalNodes > 0 ? qreal(completedNodes) / totalNodes : 0.0; }
+};
+
+class ProgressTracker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ProgressTracker(QObject *parent = nullptr);
+    ~ProgressTracker();
+
+    // Updates, made by the scene as node records change. Each one walks the
+    // parent chain once, so the cost is O(depth) per edit.
+    void addNode(const QString &nodeId, const QString &parentId = QString(), bool completed = false);
+    void removeNode(const QString &nodeId);
+    void setParent(const QString &nodeId, const QString &parentId);
+    void setCompleted(const QString &nodeId, bool completed);
+    void clear();
+
+    // Queries
+    NodeProgress progress(const QString &nodeId) const;
+    MapProgressStats stats() const { return m_stats; }
+    bool contains(const QString &nodeId) const { return m_entries.contains(nodeId); }
+
+    // Draws the progress ring for a node into rect
+    static void paintRing(QPainter *painter, const QRectF &rect, const NodeProgress &progress);
+
+signals:
+    // Emitted once per edit with every node whose counters changed
+    void progressChanged(const QStringList &nodeIds);
+    // Queued, so a burst of edits (a load, a paste) delivers it once
+    void statsChanged(const MapProgressStats &stats);
+
+private:
+    struct Entry {
+        QString parentId;      // attached parent; empty for roots and orphans
+        QString pendingParent; // parent id waiting for that node to be added
+        QStringList children;  // attached children only
+        bool completed = false;
+        int doneBelow = 0;
+        int totalBelow = 0;
+    };
+
+    // Data
+    QHash<QString, Entry> m_entries;
+    QHash<QString, QStringList> m_orphansByParentId; // children added before their parent
+    MapProgressStats m_stats;
+    bool m_statsChangePending;
+
+    // Methods
+    void attach(const QString &nodeId, const QString &parentId, QStringList &touched);
+    void detach(const QString &nodeId, QStringList &touched);
+    void propagate(const QString &fromParentId, int doneDelta, int totalDelta, QStringList &touched);
+    bool isAncestor(const QString &ancestorId, const QString &nodeId) const;
+    void notify(const QStringList &touched);
+    void scheduleStatsChanged();
+
+    // Constants
+    static const int RING_WIDTH = 4;
+};
+
+#endif // PROGRESSTRACKER_H
@@ -0,0 +1,119 @@
+#include "quickjumppalette.h"
+
+QuickJumpPalette::QuickJumpPalette(QWidget *parent)
+    : QFrame(parent, Qt::Popup)
+    , m_scene(nullptr)
+    , m_mainLayout(nullptr)
+    , m_queryEdit(nullptr)
+    , m_resultList(nullptr)
+{
+    setupUI();
+    setupConnections();
+}
+
+QuickJumpPalette::~QuickJumpPalette()
+{
+}
+
+void QuickJumpPalette::setScene(MindMapScene *scene)
+{
+    m_scene = scene;
+}
+
+void QuickJumpPalette::popup()
+{
+    QWidget *anchor = parentWidget();
+    if (anchor) {
+        const QPoint topCenter = anchor->mapToGlobal(QPoint(anchor->width() / 2, 0));
+        move(topCenter.x() - PALETTE_WIDTH / 2, topCenter.y() + 60);
+    }
+
+    m_queryEdit->clear();
+    onQueryChanged(QString());
+    show();
+    m_queryEdit->setFocus();
+}
+
+bool QuickJumpPalette::eventFilter(QObject *watched, QEvent *event)
+{
+    if (watched == m_queryEdit && event->type() == QEvent::KeyPress) {
+        QKeyEvent *keyEvent = static_cast<QKeyEvent*>(event);
+        switch (keyEvent->key()) {
+        case Qt::Key_Down:
+            m_resultList->setCurrentRow(qMin(m_resultList->currentRow() + 1, m_resultList->count() - 1));
+            return true;
+        case Qt::Key_Up:
+            m_resultList->setCurrentRow(qMax(m_resultList->currentRow() - 1, 0));
+            return true;
+        case Qt::Key_Return:
+        case Qt::Key_Enter:
+            acceptCurrent();
+            return true;
+        case Qt::Key_Escape:
+            hide();
+            return true;
+        default:
+            break;
+        }
+    }
+    return QFrame::eventFilter(watched, event);
+}
+
+void QuickJumpPalette::onQueryChanged(const QString &query)
+{
+    m_resultList->clear();
+    if (!m_scene) {
+        return;
+    }
+
+    const QList<FuzzyMatch> matches = m_scene->getFuzzyMatcher()->match(query, MAX_RESULTS);
+    for (const FuzzyMatch &match : matches) {
+        MindMapNode *node = m_scene->getNode(match.nodeId);
+        if (!node) {
+            continue;
+        }
+        QListWidgetItem *item = new QListWidgetItem(node->getTitle(), m_resultList);
+        item->setData(Qt::UserRole, match.nodeId);
+    }
+    if (m_resultList->count() > 0) {
+        m_resultList->setCurrentRow(0);
+    }
+}
+
+void QuickJumpPalette::onItemActivated(QListWidgetItem *item)
+{
+    if (!item) {
+        return;
+    }
+    hide();
+    emit nodeChosen(item->data(Qt::UserRole).toString());
+}
+
+void QuickJumpPalette::setupUI()
+{
+    setFrameStyle(QFrame::StyledPanel | QFrame::Raised);
+    setFixedWidth(PALETTE_WIDTH);
+
+    m_mainLayout = new QVBoxLayout(this);
+    m_mainLayout->setContentsMargins(6, 6, 6, 6);
+
+    m_queryEdit = new QLineEdit(this);
+    m_queryEdit->setPlaceholderText("Go to node...");
+    m_queryEdit->installEventFilter(this);
+    m_mainLayout->addWidget(m_queryEdit);
+
+    m_resultList = new QListWidget(this);
+    m_resultList->setUniformItemSizes(true);
+    m_mainLayout->addWidget(m_resultList);
+}
+
+void QuickJumpPalette::setupConnections()
+{
+    connect(m_queryEdit, &QLineEdit::textChanged, this, &QuickJumpPalette::onQueryChanged);
+    connect(m_resultList, &QListWidget::itemActivated, this, &QuickJumpPalette::onItemActivated);
+}
+
+void QuickJumpPalette::acceptCurrent()
+{
+    onItemActivated(m_resultList->currentItem());
+}
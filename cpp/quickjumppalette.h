@@ -0,0 +1,56 @@
+#ifndef QUICKJUMPPALETTE_H
+#define QUICKJUMPPALETTE_H
+
+#include <QFrame>
+#include <QLineEdit>
+#include <QListWidget>
+#include <QVBoxLayout>
+#include <QKeyEvent>
+
+#include "mindmapscene.h"
+
+class QuickJumpPalette : public QFrame
+{
+    Q_OBJECT
+
+public:
+    explicit QuickJumpPalette(QWidget *parent = nullptr);
+    ~QuickJumpPalette();
+
+    // Scene management
+    void setScene(MindMapScene *scene);
+    MindMapScene* getScene() const { return m_scene; }
+
+    // Display
+    void popup();
+
+signals:
+    void nodeChosen(const QString &nodeId);
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private slots:
+    void onQueryChanged(const QString &query);
+    void onItemActivated(QListWidgetItem *item);
+
+private:
+    // Core components
+    MindMapScene *m_scene;
+
+    // UI components
+    QVBoxLayout *m_mainLayout;
+    QLineEdit *m_queryEdit;
+    QListWidget *m_resultList;
+
+    // Methods
+    void setupUI();
+    void setupConnections();
+    void acceptCurrent();
+
+    // Constants
+    static const int PALETTE_WIDTH = 480;
+    static const int MAX_RESULTS = 30;
+};
+
+#endif // QUICKJUMPPALETTE_H
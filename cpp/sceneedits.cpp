@@ -0,0 +1,188 @@
+#include "mindmapscene.h"
+#include "mindmapnode.h"
+
+// Batched scene edits: transactions, and the HistoryTarget interface that
+// undo/redo, paste, cut and duplicate apply their changes through.
+
+void MindMapScene::beginTransaction(const QString &text, const QString &mergeKey)
+{
+    m_transaction->begin(text, true, mergeKey);
+}
+
+void MindMapScene::commitTransaction()
+{
+    m_transaction->commit();
+}
+
+void MindMapScene::onTransactionFlush(const SceneChangeSet &changes)
+{
+    Q_UNUSED(changes);
+    // Every node the transaction touched has been queued for a re-read; the
+    // indexes are brought up to date from those in one pass.
+    flushPendingNodes();
+}
+
+void MindMapScene::onTransactionCommitted(const SceneChangeSet &changes)
+{
+    emit sceneChanged(changes);
+}
+
+// HistoryTarget. Each call applies its batch without recording it: undo and
+// redo are the history's own replays, and paste and cut record the batch
+// themselves. Touched nodes are queued for a re-read, which the
+// transaction's flush applies to the indexes once.
+
+void MindMapScene::insertNodes(const QVector<NodeSnapshot> &nodes)
+{
+    SceneTransactionGuard guard(m_transaction, QString(), false);
+
+    // Snapshots arrive parents first, so each parent already exists
+    for (const NodeSnapshot &snapshot : nodes) {
+        MindMapNode *node = new MindMapNode(this, snapshot.id);
+        node->setParentId(snapshot.parentId);
+        node->setTitle(snapshot.title);
+        node->setDescription(snapshot.description);
+        node->setCompleted(snapshot.completed);
+        node->setFormatting(snapshot.formatting);
+        for (const MediaFile &media : snapshot.mediaFiles) {
+            node->addMediaFile(media);
+        }
+        node->setPos(snapshot.position);
+        addNode(node);
+        m_transaction->nodeCreated(snapshot.id);
+        scheduleRefresh(snapshot.id);
+
+        if (MindMapNode *parent = m_nodes.value(snapshot.parentId)) {
+            parent->addChild(snapshot.id);
+            m_transaction->nodeModified(snapshot.parentId, SceneTransaction::ProgressCounters
+                                        | SceneTransaction::FilterIndex | SceneTransaction::TreeLayout);
+            scheduleRefresh(snapshot.parentId);
+        }
+    }
+    updateConnections();
+}
+
+void MindMapScene::removeNodes(const QStringList &nodeIds)
+{
+    SceneTransactionGuard guard(m_transaction, QString(), false);
+
+    for (const QString &nodeId : nodeIds) {
+        MindMapNode *node = m_nodes.value(nodeId);
+        if (!node) {
+            continue;
+        }
+        if (MindMapNode *parent = m_nodes.value(node->getParentId())) {
+            parent->removeChild(nodeId);
+            m_transaction->nodeModified(parent->getId(), SceneTransaction::ProgressCounters
+                                        | SceneTransaction::FilterIndex | SceneTransaction::TreeLayout);
+            scheduleRefresh(parent->getId());
+        }
+        m_transaction->nodeDeleted(nodeId);
+        scheduleRefresh(nodeId);
+        m_layoutAnimator->forgetItem(node);
+        removeNode(node);
+        delete node;
+    }
+    updateConnections();
+}
+
+void MindMapScene::moveNodes(const QHash<QString, QPointF> &positions)
+{
+    SceneTransactionGuard guard(m_transaction, QString(), false);
+
+    for (auto it = positions.constBegin(); it != positions.constEnd(); ++it) {
+        MindMapNode *node = m_nodes.value(it.key());
+        if (!node) {
+            continue;
+        }
+        node->setPos(it.value());
+        m_transaction->nodeModified(it.key(), SceneTransaction::Routing);
+        scheduleRefresh(it.key());
+    }
+    updateConnections();
+}
+
+void MindMapScene::setNodeProperties(const QVector<PropertyDelta> &deltas, bool useBefore)
+{
+    SceneTransactionGuard guard(m_transaction, QString(), false);
+
+    for (const PropertyDelta &delta : deltas) {
+        MindMapNode *node = m_nodes.value(delta.nodeId);
+        if (!node) {
+            continue;
+        }
+        const QVariant &value = useBefore ? delta.before : delta.after;
+        int staleIndexes = 0;
+        switch (delta.property) {
+        case NodeProperty::Title:
+            node->setTitle(value.toString());
+            staleIndexes = SceneTransaction::SearchIndexes;
+            break;
+        case NodeProperty::Description:
+            node->setDescription(value.toString());
+            staleIndexes = SceneTransaction::SearchIndexes;
+            break;
+        case NodeProperty::Completed:
+            node->setCompleted(value.toBool());
+            staleIndexes = SceneTransaction::FilterIndex | SceneTransaction::ProgressCounters;
+            break;
+        case NodeProperty::Formatting:
+            node->setFormatting(value.value<TextFormatting>());
+            staleIndexes = SceneTransaction::FilterIndex;
+            break;
+        case NodeProperty::Parent: {
+            // Both parents' child lists change with it
+            const QString parentId = value.toString();
+            if (MindMapNode *oldParent = m_nodes.value(node->getParentId())) {
+                oldParent->removeChild(delta.nodeId);
+                scheduleRefresh(oldParent->getId());
+            }
+            node->setParentId(parentId);
+            if (MindMapNode *newParent = m_nodes.value(parentId)) {
+                newParent->addChild(delta.nodeId);
+                scheduleRefresh(parentId);
+            }
+            staleIndexes = SceneTransaction::FilterIndex | SceneTransaction::ProgressCounters
+                | SceneTransaction::TreeLayout;
+            break;
+        }
+        }
+        node->update();
+        m_transaction->nodeModified(delta.nodeId, staleIndexes);
+        scheduleRefresh(delta.nodeId);
+    }
+}
+
+void MindMapScene::connectNodes(const QVector<ConnectionDelta> &connections)
+{
+    SceneTransactionGuard guard(m_transaction, QString(), false);
+
+    for (const ConnectionDelta &connection : connections) {
+        MindMapNode *fromNode = m_nodes.value(connection.fromId);
+        MindMapNode *toNode = m_nodes.value(connection.toId);
+        if (!fromNode || !toNode) {
+            continue;
+        }
+        createConnection(fromNode, toNode);
+        m_transaction->connectionCreated(connection.fromId, connection.toId);
+        scheduleRefresh(connection.fromId);
+        scheduleRefresh(connection.toId);
+    }
+}
+
+void MindMapScene::disconnectNodes(const QVector<ConnectionDelta> &connections)
+{
+    SceneTransactionGuard guard(m_transaction, QString(), false);
+
+    for (const ConnectionDelta &connection : connections) {
+        MindMapNode *fromNode = m_nodes.value(connection.fromId);
+        MindMapNode *toNode = m_nodes.value(connection.toId);
+        if (!fromNode || !toNode) {
+            continue;
+        }
+        removeConnection(fromNode, toNode);
+        m_transaction->connectionRemoved(connection.fromId, connection.toId);
+        scheduleRefresh(connection.fromId);
+        scheduleRefresh(connection.toId);
+    }
+}
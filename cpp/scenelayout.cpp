@@ -0,0 +1,165 @@
+#include "mindmapscene.h"
+#include "mindmapnode.h"
+
+// The scene's geometry services: tidy-tree layout, the force-directed
+// simulation and connection routing. Their structure is fed from node
+// record changes in scenemodel.cpp; this file applies their results.
+
+// Tree layout
+
+void MindMapScene::autoLayout()
+{
+    flushPendingNodes();
+    QHash<QString, QPointF> positions = m_treeLayout.relayout();
+
+    // The engine only reports what it moved; nodes dragged away since the
+    // last layout are put back too.
+    for (auto it = m_nodes.constBegin(); it != m_nodes.constEnd(); ++it) {
+        if (!positions.contains(it.key())) {
+            const QPointF position = m_treeLayout.position(it.key());
+            if (it.value()->pos() != position) {
+                positions.insert(it.key(), position);
+            }
+        }
+    }
+    applyLayout(positions);
+}
+
+void MindMapScene::setLayoutStyle(TreeLayoutEngine::Style style)
+{
+    m_treeLayout.setStyle(style);
+}
+
+// One animated batch and one undo step. The moved nodes are re-read once
+// the animation lands.
+void MindMapScene::applyLayout(const QHash<QString, QPointF> &positions)
+{
+    if (positions.isEmpty()) {
+        return;
+    }
+
+    SceneTransactionGuard guard(m_transaction, "Auto Layout");
+    HistoryCommand *command = m_transaction->historyCommand();
+    QHash<QGraphicsItem*, QPointF> targets;
+    targets.reserve(positions.size());
+    for (auto it = positions.constBegin(); it != positions.constEnd(); ++it) {
+        MindMapNode *node = m_nodes.value(it.key());
+        if (!node) {
+            continue;
+        }
+        command->addMove(it.key(), node->pos(), it.value());
+        m_transaction->nodeModified(it.key(), SceneTransaction::Routing);
+        m_animatedNodeIds.insert(it.key());
+        targets.insert(node, it.value());
+    }
+    m_layoutAnimator->animateTo(targets);
+}
+
+void MindMapScene::onLayoutAnimationFinished()
+{
+    for (const QString &nodeId : m_animatedNodeIds) {
+        scheduleRefresh(nodeId);
+    }
+    m_animatedNodeIds.clear();
+    updateConnections();
+}
+
+// Force-directed layout
+
+void MindMapScene::startForceLayout()
+{
+    flushPendingNodes();
+    m_layoutAnimator->finish();
+
+    QStringList nodeIds;
+    QVector<QPointF> positions;
+    QVector<QPair<QString, QString>> edges;
+    nodeIds.reserve(m_nodeStore.size());
+    positions.reserve(m_nodeStore.size());
+    m_nodeStore.forEach([&](const NodeRecordPtr &record) {
+        nodeIds.append(record->id);
+        positions.append(record->position);
+        if (!record->parentId.isEmpty()) {
+            edges.append(qMakePair(record->parentId, record->id));
+        }
+        for (const QString &targetId : record->connections) {
+            edges.append(qMakePair(record->id, targetId));
+        }
+    });
+    m_forceLayout->setGraph(nodeIds, positions, edges);
+    m_forceLayout->start();
+}
+
+void MindMapScene::stopForceLayout()
+{
+    m_forceLayout->stop();
+}
+
+void MindMapScene::onForceLayoutFrame()
+{
+    const QHash<QString, QPointF> positions = m_forceLayout->takePositions();
+    for (auto it = positions.constBegin(); it != positions.constEnd(); ++it) {
+        if (MindMapNode *node = m_nodes.value(it.key())) {
+            node->setPos(it.value());
+            scheduleRefresh(it.key());
+        }
+    }
+    updateConnections();
+}
+
+// Connection routing
+
+void MindMapScene::onRouteReady(const QString &edgeId)
+{
+    ConnectionLine *line = connectionForEdge(edgeId);
+    if (!line) {
+        return;
+    }
+    QPainterPath path;
+    if (m_connectionRouter->routedPath(edgeId, &path)) {
+        line->setRoutedPath(path);
+    } else {
+        line->clearRoutedPath();
+    }
+}
+
+void MindMapScene::onRouteInvalidated(const QString &edgeId)
+{
+    if (ConnectionLine *line = connectionForEdge(edgeId)) {
+        line->clearRoutedPath();
+    }
+}
+
+// Lines are rebuilt by updateConnections(), so no pointer to one is kept;
+// route results are debounced, which keeps this scan off the hot path.
+ConnectionLine* MindMapScene::connectionForEdge(const QString &edgeId) const
+{
+    for (ConnectionLine *line : m_connections) {
+        if (line->getEdgeId() == edgeId) {
+            return line;
+        }
+    }
+    return nullptr;
+}
+
+QString ConnectionLine::getEdgeId() const
+{
+    return ConnectionRouter::edgeKey(m_fromNode->getId(), m_toNode->getId());
+}
+
+void ConnectionLine::setRoutedPath(const QPainterPath &path)
+{
+    prepareGeometryChange();
+    m_routedPath = path;
+    update();
+}
+
+void ConnectionLine::clearRoutedPath()
+{
+    if (m_routedPath.isEmpty()) {
+        return;
+    }
+    prepareGeometryChange();
+    m_routedPath = QPainterPath();
+    update();
+}
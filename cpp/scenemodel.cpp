@@ -0,0 +1,388 @@
+#include "mindmapscene.h"
+#include "mindmapnode.h"
+
+#include <QEvent>
+#include <QTimer>
+#include <QTransform>
+#include <QGraphicsSceneMouseEvent>
+
+// The scene's model side: the services it owns and how they are kept in
+// step with the nodes. Items, selection and file I/O are in mindmapscene.cpp,
+// transactions and undo/redo in sceneedits.cpp, layout and routing in
+// scenelayout.cpp.
+//
+// Node setters don't notify the scene. Instead a node id is queued whenever
+// something may have changed that node: scene input on it, the scene's node
+// and connection signals, or refreshNode(). The queue is drained once per
+// event-loop pass; each node is captured as a NodeRecord, compared with the
+// one in the node store, and only a record that differs goes any further.
+
+namespace {
+
+bool sameFormatting(const TextFormatting &a, const TextFormatting &b)
+{
+    return a.bold == b.bold && a.italic == b.italic && a.underline == b.underline
+        && a.strikethrough == b.strikethrough && a.highlightColor == b.highlightColor
+        && a.textColor == b.textColor;
+}
+
+bool sameMedia(const QList<MediaFile> &a, const QList<MediaFile> &b)
+{
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (int i = 0; i < a.size(); ++i) {
+        if (a.at(i).id != b.at(i).id || a.at(i).filePath != b.at(i).filePath || a.at(i).name != b.at(i).name) {
+            return false;
+        }
+    }
+    return true;
+}
+
+QStringList mediaNames(const QList<MediaFile> &mediaFiles)
+{
+    QStringList names;
+    for (const MediaFile &media : mediaFiles) {
+        names.append(media.name);
+    }
+    return names;
+}
+
+bool sameRecord(const NodeRecord &a, const NodeRecord &b)
+{
+    return a.parentId == b.parentId && a.title == b.title && a.description == b.description
+        && a.completed == b.completed && sameFormatting(a.formatting, b.formatting)
+        && a.position == b.position && a.bounds == b.bounds && sameMedia(a.mediaFiles, b.mediaFiles)
+        && a.children == b.children && a.connections == b.connections;
+}
+
+// The node an item belongs to; a node's widgets sit in proxies below it
+MindMapNode* nodeForItem(QGraphicsItem *item)
+{
+    for (; item; item = item->parentItem()) {
+        if (MindMapNode *node = dynamic_cast<MindMapNode*>(item)) {
+            return node;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace
+
+NodeProgress MindMapNode::getProgress() const
+{
+    ProgressTracker *tracker = m_scene ? m_scene->getProgressTracker() : nullptr;
+    return tracker ? tracker->progress(m_id) : NodeProgress();
+}
+
+void MindMapScene::setupModel()
+{
+    m_taskFilterIndex = new TaskFilterIndex(this);
+    m_taskFilter = new TaskFilterController(this, m_taskFilterIndex, this);
+    m_progressTracker = new ProgressTracker(this);
+    m_mediaLibrary = new MediaLibrary(this);
+    m_contentBounds = new ContentBounds(this);
+    connect(m_contentBounds, &ContentBounds::sceneRectChanged, this, [this](const QRectF &rect) {
+        setSceneRect(rect);
+    });
+
+    m_transaction = new SceneTransaction(this);
+    connect(m_transaction, &SceneTransaction::flushIndexes, this, &MindMapScene::onTransactionFlush);
+    connect(m_transaction, &SceneTransaction::committed, this, &MindMapScene::onTransactionCommitted);
+    m_commandHistory = new CommandHistory(this);
+    m_commandHistory->setTarget(this);
+    m_transaction->setHistory(m_commandHistory);
+
+    m_layoutAnimator = new LayoutAnimator(this);
+    connect(m_layoutAnimator, &LayoutAnimator::finished, this, &MindMapScene::onLayoutAnimationFinished);
+    m_forceLayout = new ForceLayoutSimulation(this);
+    connect(m_forceLayout, &ForceLayoutSimulation::positionsReady, this, &MindMapScene::onForceLayoutFrame);
+    m_connectionRouter = new ConnectionRouter(this);
+    connect(m_connectionRouter, &ConnectionRouter::routeReady, this, &MindMapScene::onRouteReady);
+    connect(m_connectionRouter, &ConnectionRouter::routeInvalidated, this, &MindMapScene::onRouteInvalidated);
+
+    // Progress rings are painted from the tracker
+    connect(m_progressTracker, &ProgressTracker::progressChanged, this, [this](const QStringList &nodeIds) {
+        for (const QString &nodeId : nodeIds) {
+            if (MindMapNode *node = m_nodes.value(nodeId)) {
+                node->update();
+            }
+        }
+    });
+
+    m_syncTimer = new QTimer(this);
+    m_syncTimer->setSingleShot(true);
+    m_syncTimer->setInterval(0);
+    connect(m_syncTimer, &QTimer::timeout, this, &MindMapScene::flushPendingNodes);
+
+    // A new node also changes its parent's child list
+    connect(this, &MindMapScene::nodeCreated, this, [this](MindMapNode *node) {
+        scheduleRefresh(node->getId());
+        scheduleRefresh(node->getParentId());
+    });
+    connect(this, &MindMapScene::nodeDeleted, this, [this](MindMapNode *node) {
+        m_layoutAnimator->forgetItem(node);
+        forgetRecord(node->getId());
+    });
+    connect(this, &MindMapScene::nodeMoved, this, [this](MindMapNode *node) {
+        scheduleRefresh(node->getId());
+    });
+    // Title and description edits are committed as the editor loses focus,
+    // which is also when the selection tends to move on
+    connect(this, &MindMapScene::nodeSelected, this, [this](MindMapNode *node) {
+        if (node) {
+            scheduleRefresh(node->getId());
+        }
+    });
+    connect(this, &MindMapScene::nodeDeselected, this, [this](MindMapNode *node) {
+        if (node) {
+            scheduleRefresh(node->getId());
+        }
+    });
+    connect(this, &MindMapScene::connectionCreated, this, [this](MindMapNode *fromNode, MindMapNode *toNode) {
+        scheduleRefresh(fromNode->getId());
+        scheduleRefresh(toNode->getId());
+    });
+    connect(this, &MindMapScene::connectionRemoved, this, [this](MindMapNode *fromNode, MindMapNode *toNode) {
+        scheduleRefresh(fromNode->getId());
+        scheduleRefresh(toNode->getId());
+    });
+    connect(this, &MindMapScene::mindMapLoaded, this, &MindMapScene::syncModel);
+
+    syncModel();
+}
+
+// Node tracking
+
+PersistentNodeStore MindMapScene::snapshotNodes()
+{
+    flushPendingNodes();
+    return m_nodeStore.snapshot();
+}
+
+void MindMapScene::refreshNode(MindMapNode *node)
+{
+    if (node) {
+        m_pendingNodeIds.remove(node->getId());
+        updateRecord(node->getId());
+    }
+}
+
+void MindMapScene::syncModel()
+{
+    m_pendingNodeIds.clear();
+    for (auto it = m_nodes.constBegin(); it != m_nodes.constEnd(); ++it) {
+        updateRecord(it.key());
+    }
+
+    QStringList stale;
+    m_nodeStore.forEach([this, &stale](const NodeRecordPtr &record) {
+        if (!m_nodes.contains(record->id)) {
+            stale.append(record->id);
+        }
+    });
+    for (const QString &nodeId : stale) {
+        forgetRecord(nodeId);
+    }
+}
+
+bool MindMapScene::event(QEvent *event)
+{
+    // Edits through a node's widgets finish on one of these; the node being
+    // edited and the selection (which the toolbars edit) are re-read after.
+    const QEvent::Type type = event->type();
+    if (!m_syncTimer || (type != QEvent::KeyRelease && type != QEvent::FocusOut && type != QEvent::GraphicsSceneMouseRelease)) {
+        return QGraphicsScene::event(event);
+    }
+
+    MindMapNode *focusNode = nodeForItem(focusItem());
+    const bool handled = QGraphicsScene::event(event);
+    if (type != QEvent::KeyRelease) {
+        m_commandHistory->seal(); // a drag or a run of typing ends here
+    }
+    if (focusNode) {
+        scheduleRefresh(focusNode->getId());
+    }
+    if (type == QEvent::GraphicsSceneMouseRelease) {
+        const QPointF scenePos = static_cast<QGraphicsSceneMouseEvent*>(event)->scenePos();
+        if (MindMapNode *node = nodeForItem(itemAt(scenePos, QTransform()))) {
+            scheduleRefresh(node->getId());
+        }
+    }
+    for (MindMapNode *node : getSelectedNodes()) {
+        scheduleRefresh(node->getId());
+    }
+    return handled;
+}
+
+QList<MindMapNode*> MindMapScene::findNodes(const QString &query, int limit)
+{
+    flushPendingNodes();
+    QList<MindMapNode*> nodes;
+    for (const SearchResult &result : m_searchIndex.search(query, limit)) {
+        if (MindMapNode *node = m_nodes.value(result.nodeId)) {
+            nodes.append(node);
+        }
+    }
+    return nodes;
+}
+
+void MindMapScene::scheduleRefresh(const QString &nodeId)
+{
+    if (nodeId.isEmpty()) {
+        return;
+    }
+    m_pendingNodeIds.insert(nodeId);
+    if (m_syncTimer && !m_syncTimer->isActive()) {
+        m_syncTimer->start();
+    }
+}
+
+void MindMapScene::flushPendingNodes()
+{
+    if (m_syncTimer) {
+        m_syncTimer->stop();
+    }
+    QSet<QString> nodeIds;
+    qSwap(nodeIds, m_pendingNodeIds);
+    for (const QString &nodeId : nodeIds) {
+        updateRecord(nodeId);
+    }
+}
+
+void MindMapScene::updateRecord(const QString &nodeId)
+{
+    MindMapNode *node = m_nodes.value(nodeId);
+    if (!node) {
+        forgetRecord(nodeId);
+        return;
+    }
+
+    const NodeRecord record = NodeRecord::fromNode(node);
+    const NodeRecordPtr previous = m_nodeStore.value(nodeId);
+    if (previous && sameRecord(*previous, record)) {
+        return;
+    }
+    indexRecord(previous, record);
+    m_nodeStore.insert(record);
+}
+
+void MindMapScene::forgetRecord(const QString &nodeId)
+{
+    m_pendingNodeIds.remove(nodeId);
+    const NodeRecordPtr previous = m_nodeStore.value(nodeId);
+    if (!previous) {
+        return;
+    }
+    unindexRecord(*previous);
+    m_nodeStore.remove(nodeId);
+
+    // The parent's child list changed with it
+    scheduleRefresh(previous->parentId);
+}
+
+// Index maintenance. previous is null for a node the store hasn't seen.
+
+void MindMapScene::indexRecord(const NodeRecordPtr &previous, const NodeRecord &record)
+{
+    if (!previous || previous->title != record.title) {
+        m_searchIndex.setTitle(record.id, record.title);
+        m_fuzzyMatcher.setTitle(record.id, record.title);
+    }
+    if (!previous || previous->description != record.description) {
+        m_searchIndex.setDescription(record.id, record.description);
+    }
+    const QStringList names = mediaNames(record.mediaFiles);
+    if (!previous || mediaNames(previous->mediaFiles) != names) {
+        m_searchIndex.setMediaNames(record.id, names);
+    }
+    if (!previous) {
+        m_taskFilterIndex->addNode(record.id, record.parentId);
+    } else if (previous->parentId != record.parentId) {
+        m_taskFilterIndex->setParent(record.id, record.parentId);
+    }
+    if (!previous || previous->completed != record.completed) {
+        m_taskFilterIndex->setCompleted(record.id, record.completed);
+    }
+    if (!previous) {
+        m_progressTracker->addNode(record.id, record.parentId, record.completed);
+    } else {
+        if (previous->parentId != record.parentId) {
+            m_progressTracker->setParent(record.id, record.parentId);
+        }
+        if (previous->completed != record.completed) {
+            m_progressTracker->setCompleted(record.id, record.completed);
+        }
+    }
+    if (!previous || !sameFormatting(previous->formatting, record.formatting)) {
+        m_taskFilterIndex->setFormatting(record.id, record.formatting);
+    }
+    if (!previous || previous->mediaFiles.isEmpty() != record.mediaFiles.isEmpty()) {
+        m_taskFilterIndex->setHasAttachments(record.id, !record.mediaFiles.isEmpty());
+    }
+    if (!previous) {
+        m_treeLayout.addNode(record.id, record.parentId, record.bounds.size());
+    } else {
+        if (previous->parentId != record.parentId) {
+            m_treeLayout.setParent(record.id, record.parentId);
+        }
+        if (previous->bounds.size() != record.bounds.size()) {
+            m_treeLayout.setNodeSize(record.id, record.bounds.size());
+        }
+    }
+    if (!previous || previous->bounds != record.bounds) {
+        m_contentBounds->setRect(record.id, record.bounds);
+        m_connectionRouter->setNodeRect(record.id, record.bounds);
+    }
+    if (!previous || previous->connections != record.connections) {
+        updateEdges(previous ? previous->connections : QStringList(), record);
+    }
+    if (!previous || !sameMedia(previous->mediaFiles, record.mediaFiles)) {
+        updateAttachments(previous ? previous->mediaFiles : QList<MediaFile>(), record);
+    }
+}
+
+void MindMapScene::unindexRecord(const NodeRecord &record)
+{
+    m_searchIndex.removeNode(record.id);
+    m_fuzzyMatcher.removeNode(record.id);
+    m_taskFilterIndex->removeNode(record.id);
+    m_progressTracker->removeNode(record.id);
+    m_mediaLibrary->detachNode(record.id);
+    m_treeLayout.removeNode(record.id);
+    for (const QString &targetId : record.connections) {
+        m_connectionRouter->removeEdge(ConnectionRouter::edgeKey(record.id, targetId));
+    }
+    m_connectionRouter->removeNode(record.id);
+    m_contentBounds->remove(record.id);
+}
+
+// attach() is a no-op for an unchanged path, so only removals need a diff
+void MindMapScene::updateAttachments(const QList<MediaFile> &previous, const NodeRecord &record)
+{
+    QSet<QString> mediaIds;
+    for (const MediaFile &media : record.mediaFiles) {
+        mediaIds.insert(media.id);
+        m_mediaLibrary->attach(record.id, media.id, media.filePath, media.type);
+    }
+    for (const MediaFile &media : previous) {
+        if (!mediaIds.contains(media.id)) {
+            m_mediaLibrary->detach(record.id, media.id);
+        }
+    }
+}
+
+// Connections are stored on their source node only
+void MindMapScene::updateEdges(const QStringList &previous, const NodeRecord &record)
+{
+    for (const QString &targetId : previous) {
+        if (!record.connections.contains(targetId)) {
+            m_connectionRouter->removeEdge(ConnectionRouter::edgeKey(record.id, targetId));
+        }
+    }
+    for (const QString &targetId : record.connections) {
+        if (!previous.contains(targetId)) {
+            m_connectionRouter->addEdge(ConnectionRouter::edgeKey(record.id, targetId), record.id, targetId);
+        }
+    }
+}
@@ -0,0 +1,133 @@
+#include "scenetransaction.h"
+
+bool SceneChangeSet::isEmpty() const
+{
+    return createdNodes.isEmpty() && deletedNodes.isEmpty() && modifiedNodes.isEmpty()
+           && connectionsCreated.isEmpty() && connectionsRemoved.isEmpty();
+}
+
+int SceneChangeSet::size() const
+{
+    return createdNodes.size() + deletedNodes.size() + modifiedNodes.size()
+           + connectionsCreated.size() + connectionsRemoved.size();
+}
+
+void SceneChangeSet::clear()
+{
+    createdNodes.clear();
+    deletedNodes.clear();
+    modifiedNodes.clear();
+    connectionsCreated.clear();
+    connectionsRemoved.clear();
+    staleIndexes.clear();
+}
+
+// SceneTransaction
+
+SceneTransaction::SceneTransaction(QObject *parent)
+    : QObject(parent)
+    , m_command(QString())
+    , m_history(nullptr)
+    , m_depth(0)
+    , m_recordHistory(true)
+{
+}
+
+SceneTransaction::~SceneTransaction()
+{
+}
+
+void SceneTransaction::begin(const QString &text, bool recordHistory, const QString &mergeKey)
+{
+    if (m_depth++ == 0) {
+        m_command = HistoryCommand(text.isEmpty() ? QString("Edit") : text, mergeKey);
+        m_recordHistory = recordHistory;
+    }
+}
+
+void SceneTransaction::commit()
+{
+    if (m_depth == 0) {
+        qWarning("SceneTransaction::commit() without begin()");
+        return;
+    }
+    if (--m_depth > 0) {
+        return;
+    }
+
+    // Take the state first so handlers may open transactions of their own.
+    SceneChangeSet changes;
+    qSwap(changes, m_changes);
+    HistoryCommand command(QString());
+    qSwap(command, m_command);
+
+    if (!changes.isEmpty()) {
+        emit flushIndexes(changes);
+        emit committed(changes);
+    }
+    if (m_history && m_recordHistory && !command.isEmpty()) {
+        m_history->push(command);
+    }
+}
+
+void SceneTransaction::nodeCreated(const QString &nodeId)
+{
+    // Deleted and recreated within one transaction (e.g. undo of a delete
+    // followed by redo) is a modification of the existing entry.
+    if (m_changes.deletedNodes.remove(nodeId)) {
+        m_changes.modifiedNodes.insert(nodeId);
+    } else {
+        m_changes.createdNodes.insert(nodeId);
+    }
+    m_changes.staleIndexes[nodeId] = AllIndexes;
+}
+
+void SceneTransaction::nodeDeleted(const QString &nodeId)
+{
+    m_changes.modifiedNodes.remove(nodeId);
+    if (m_changes.createdNodes.remove(nodeId)) {
+        // Never reached the indexes, so there is nothing to remove either.
+        m_changes.staleIndexes.remove(nodeId);
+        return;
+    }
+    m_changes.deletedNodes.insert(nodeId);
+    m_changes.staleIndexes[nodeId] = AllIndexes;
+}
+
+void SceneTransaction::nodeModified(const QString &nodeId, int staleIndexes)
+{
+    if (!m_changes.createdNodes.contains(nodeId)) {
+        m_changes.modifiedNodes.insert(nodeId);
+    }
+    m_changes.staleIndexes[nodeId] |= staleIndexes;
+}
+
+void SceneTransaction::connectionCreated(const QString &fromId, const QString &toId)
+{
+    ConnectionDelta connection;
+    connection.fromId = fromId;
+    connection.toId = toId;
+    m_changes.connectionsCreated.append(connection);
+}
+
+void SceneTransaction::connectionRemoved(const QString &fromId, const QString &toId)
+{
+    ConnectionDelta connection;
+    connection.fromId = fromId;
+    connection.toId = toId;
+    m_changes.connectionsRemoved.append(connection);
+}
+
+// SceneTransactionGuard
+
+SceneTransactionGuard::SceneTransactionGuard(SceneTransaction *transaction, const QString &text,
+                                             bool recordHistory, const QString &mergeKey)
+    : m_transaction(transaction)
+{
+    m_transaction->begin(text, recordHistory, mergeKey);
+}
+
+SceneTransactionGuard::~SceneTransactionGuard()
+{
+    m_transaction->commit();
+}
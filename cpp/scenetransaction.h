@@ -0,0 +1,101 @@
+#ifndef SCENETRANSACTION_H
+#define SCENETRANSACTION_H
+
+#include <QObject>
+#include <QString>
+#include <QSet>
+#include <QHash>
+#include <QVector>
+
+#include "commandhistory.h"
+
+// Everything a committed transaction changed, delivered in one signal.
+// A node created and deleted inside the same transaction appears in neither
+// list.
+struct SceneChangeSet {
+    QSet<QString> createdNodes;
+    QSet<QString> deletedNodes;
+    QSet<QString> modifiedNodes;
+    QVector<ConnectionDelta> connectionsCreated;
+    QVector<ConnectionDelta> connectionsRemoved;
+    QHash<QString, int> staleIndexes; // node id -> SceneTransaction::Index flags
+
+    bool isEmpty() const;
+    int size() const;
+    void clear();
+};
+
+// Groups scene mutations. While a transaction is open the scene records what
+// changed instead of emitting per-node signals and refreshing its indexes
+// one node at a time; commit() flushes the stale indexes once, emits one
+// aggregated notification and pushes the recorded diff as a single undo
+// step. Transactions nest; only the outermost commit() delivers, and only
+// the outermost begin() decides whether the diff is recorded and under which
+// merge key. Undo and redo open theirs with recordHistory false, since the
+// history applies those changes itself; a drag or a run of typing passes the
+// same mergeKey for each step so CommandHistory folds them into one.
+class SceneTransaction : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Index {
+        SearchIndexes = 0x01,   // SearchIndex and FuzzyMatcher
+        FilterIndex = 0x02,
+        ProgressCounters = 0x04,
+        TreeLayout = 0x08,
+        Routing = 0x10,
+        AllIndexes = 0x1f
+    };
+
+    explicit SceneTransaction(QObject *parent = nullptr);
+    ~SceneTransaction();
+
+    void setHistory(CommandHistory *history) { m_history = history; }
+
+    // Control
+    void begin(const QString &text = QString(), bool recordHistory = true,
+               const QString &mergeKey = QString());
+    void commit();
+    bool isOpen() const { return m_depth > 0; }
+    int depth() const { return m_depth; }
+
+    // Recording, valid only while open
+    void nodeCreated(const QString &nodeId);
+    void nodeDeleted(const QString &nodeId);
+    void nodeModified(const QString &nodeId, int staleIndexes);
+    void connectionCreated(const QString &fromId, const QString &toId);
+    void connectionRemoved(const QString &fromId, const QString &toId);
+    HistoryCommand* historyCommand() { return &m_command; }
+
+    const SceneChangeSet& pending() const { return m_changes; }
+
+signals:
+    // Emitted in this order by the outermost commit()
+    void flushIndexes(const SceneChangeSet &changes);
+    void committed(const SceneChangeSet &changes);
+
+private:
+    // State
+    SceneChangeSet m_changes;
+    HistoryCommand m_command;
+    CommandHistory *m_history;
+    int m_depth;
+    bool m_recordHistory;
+};
+
+// Opens a transaction for the lifetime of the guard, like QSignalBlocker
+class SceneTransactionGuard
+{
+public:
+    SceneTransactionGuard(SceneTransaction *transaction, const QString &text = QString(),
+                          bool recordHistory = true, const QString &mergeKey = QString());
+    ~SceneTransactionGuard();
+
+private:
+    SceneTransaction *m_transaction;
+
+    Q_DISABLE_COPY(SceneTransactionGuard)
+};
+
+#endif // SCENETRANSACTION_H
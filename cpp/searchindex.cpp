@@ -0,0 +1,270 @@
+#include "searchindex.h"
+
+#include <QtMath>
+
+#include <algorithm>
+
+const float SearchIndex::FIELD_WEIGHTS[SearchIndex::FieldCount] = { 3.0f, 1.0f, 2.0f };
+const float SearchIndex::EXACT_MATCH_BONUS = 2.0f;
+
+SearchIndex::SearchIndex()
+{
+}
+
+void SearchIndex::setTitle(const QString &nodeId, const QString &title)
+{
+    setField(nodeId, TitleField, tokenize(title));
+}
+
+void SearchIndex::setDescription(const QString &nodeId, const QString &description)
+{
+    setField(nodeId, DescriptionField, tokenize(description));
+}
+
+void SearchIndex::setMediaNames(const QString &nodeId, const QStringList &names)
+{
+    QStringList terms;
+    for (const QString &name : names) {
+        terms += tokenize(name);
+    }
+    setField(nodeId, MediaField, terms);
+}
+
+void SearchIndex::addMediaName(const QString &nodeId, const QString &name)
+{
+    const QStringList terms = tokenize(name);
+    if (terms.isEmpty()) {
+        return;
+    }
+    const int docId = documentFor(nodeId);
+    addTerms(docId, MediaField, terms);
+    m_documents[docId].fieldTerms[MediaField] += terms;
+}
+
+void SearchIndex::removeNode(const QString &nodeId)
+{
+    auto it = m_docIdByNode.find(nodeId);
+    if (it == m_docIdByNode.end()) {
+        return;
+    }
+
+    const int docId = it.value();
+    Document &document = m_documents[docId];
+    for (int field = 0; field < FieldCount; ++field) {
+        removeTerms(docId, static_cast<Field>(field), document.fieldTerms[field]);
+        document.fieldTerms[field].clear();
+    }
+    document.nodeId.clear();
+    document.live = false;
+
+    m_docIdByNode.erase(it);
+    m_freeDocIds.append(docId);
+}
+
+void SearchIndex::clear()
+{
+    m_terms.clear();
+    m_documents.clear();
+    m_docIdByNode.clear();
+    m_freeDocIds.clear();
+}
+
+QList<SearchResult> SearchIndex::search(const QString &query, int limit, bool *truncated) const
+{
+    QList<SearchResult> results;
+    if (truncated) {
+        *truncated = false;
+    }
+    const QStringList tokens = tokenize(query);
+    if (tokens.isEmpty() || limit <= 0) {
+        return results;
+    }
+
+    QVector<QHash<int, float>> perToken(tokens.size());
+    for (int i = 0; i < tokens.size(); ++i) {
+        if (collectPrefix(tokens.at(i), perToken[i]) && truncated) {
+            *truncated = true;
+        }
+        if (perToken.at(i).isEmpty()) {
+            return results;
+        }
+    }
+
+    // Intersect starting from the rarest token so the candidate set is as
+    // small as possible from the first step.
+    std::sort(perToken.begin(), perToken.end(), [](const QHash<int, float> &a, const QHash<int, float> &b) {
+        return a.size() < b.size();
+    });
+
+    QVector<QPair<float, int>> ranked;
+    ranked.reserve(perToken.first().size());
+    for (auto it = perToken.first().constBegin(); it != perToken.first().constEnd(); ++it) {
+        float score = it.value();
+        bool matchesAll = true;
+        for (int i = 1; i < perToken.size(); ++i) {
+            auto other = perToken.at(i).constFind(it.key());
+            if (other == perToken.at(i).constEnd()) {
+                matchesAll = false;
+                break;
+            }
+            score += other.value();
+        }
+        if (matchesAll) {
+            ranked.append(qMakePair(score, it.key()));
+        }
+    }
+
+    const int count = qMin(limit, ranked.size());
+    std::partial_sort(ranked.begin(), ranked.begin() + count, ranked.end(),
+                      [this](const QPair<float, int> &a, const QPair<float, int> &b) {
+        if (a.first != b.first) {
+            return a.first > b.first;
+        }
+        return m_documents.at(a.second).nodeId < m_documents.at(b.second).nodeId;
+    });
+
+    results.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        SearchResult result;
+        result.nodeId = m_documents.at(ranked.at(i).second).nodeId;
+        result.score = ranked.at(i).first;
+        results.append(result);
+    }
+    return results;
+}
+
+QStringList SearchIndex::tokenize(const QString &text)
+{
+    QStringList tokens;
+    const QString folded = text.toCaseFolded();
+    int start = -1;
+    for (int i = 0; i <= folded.size(); ++i) {
+        const bool isWordChar = i < folded.size() && folded.at(i).isLetterOrNumber();
+        if (isWordChar && start < 0) {
+            start = i;
+        } else if (!isWordChar && start >= 0) {
+            tokens.append(folded.mid(start, i - start));
+            start = -1;
+        }
+    }
+    return tokens;
+}
+
+int SearchIndex::documentFor(const QString &nodeId)
+{
+    auto it = m_docIdByNode.constFind(nodeId);
+    if (it != m_docIdByNode.constEnd()) {
+        return it.value();
+    }
+
+    int docId;
+    if (!m_freeDocIds.isEmpty()) {
+        docId = m_freeDocIds.takeLast();
+    } else {
+        docId = m_documents.size();
+        m_documents.append(Document());
+    }
+    m_documents[docId].nodeId = nodeId;
+    m_documents[docId].live = true;
+    m_docIdByNode.insert(nodeId, docId);
+    return docId;
+}
+
+void SearchIndex::setField(const QString &nodeId, Field field, const QStringList &terms)
+{
+    const int docId = documentFor(nodeId);
+    Document &document = m_documents[docId];
+    if (document.fieldTerms[field] == terms) {
+        return;
+    }
+
+    // Only the changed field is re-indexed; the cost is proportional to the
+    // length of the old and new text, not to the size of the map.
+    removeTerms(docId, field, document.fieldTerms[field]);
+    addTerms(docId, field, terms);
+    document.fieldTerms[field] = terms;
+}
+
+void SearchIndex::addTerms(int docId, Field field, const QStringList &terms)
+{
+    const float weight = FIELD_WEIGHTS[field];
+    for (const QString &term : terms) {
+        m_terms[term][docId] += weight;
+    }
+}
+
+void SearchIndex::removeTerms(int docId, Field field, const QStringList &terms)
+{
+    const float weight = FIELD_WEIGHTS[field];
+    for (const QString &term : terms) {
+        auto termIt = m_terms.find(term);
+        if (termIt == m_terms.end()) {
+            continue;
+        }
+        Postings &postings = termIt->second;
+        auto posting = postings.find(docId);
+        if (posting == postings.end()) {
+            continue;
+        }
+        posting.value() -= weight;
+        if (posting.value() <= 0.001f) {
+            postings.erase(posting);
+        }
+        if (postings.isEmpty()) {
+            m_terms.erase(termIt);
+        }
+    }
+}
+
+bool SearchIndex::collectPrefix(const QString &prefix, QHash<int, float> &scores) const
+{
+    const float documentTotal = static_cast<float>(qMax(1, m_docIdByNode.size()));
+
+    // The cost of a prefix is the postings it expands to, not the number of
+    // terms. Within budget every completion is used; past it, the exact term
+    // and then the most frequent completions, which cover the most documents.
+    typedef std::map<QString, Postings>::const_iterator TermIterator;
+    QVector<TermIterator> completions;
+    qint64 totalPostings = 0;
+    for (auto it = m_terms.lower_bound(prefix); it != m_terms.end() && it->first.startsWith(prefix); ++it) {
+        completions.append(it);
+        totalPostings += it->second.size();
+    }
+
+    bool truncated = false;
+    if (totalPostings > MAX_PREFIX_POSTINGS) {
+        std::sort(completions.begin(), completions.end(), [&prefix](TermIterator a, TermIterator b) {
+            const bool aExact = a->first.size() == prefix.size();
+            const bool bExact = b->first.size() == prefix.size();
+            if (aExact != bExact) {
+                return aExact;
+            }
+            return a->second.size() > b->second.size();
+        });
+        qint64 budget = MAX_PREFIX_POSTINGS;
+        int kept = 0;
+        while (kept < completions.size() && (kept == 0 || completions.at(kept)->second.size() <= budget)) {
+            budget -= completions.at(kept)->second.size();
+            ++kept;
+        }
+        completions.resize(kept);
+        truncated = true;
+    }
+
+    for (TermIterator it : completions) {
+        const Postings &postings = it->second;
+        const float idf = qLn(1.0f + documentTotal / postings.size());
+        const float completion = it->first.size() == prefix.size()
+            ? EXACT_MATCH_BONUS
+            : static_cast<float>(prefix.size()) / it->first.size();
+        const float termFactor = idf * completion;
+
+        for (auto posting = postings.constBegin(); posting != postings.constEnd(); ++posting) {
+            float &score = scores[posting.key()];
+            // A document matching several completions of one prefix keeps
+            // its best one rather than accumulating all of them.
+            score = qMax(score, posting.value() * termFactor);
+        }
+    }
+    return truncated;
+}
@@ -0,0 +1,80 @@
+#ifndef SEARCHINDEX_H
+#define SEARCHINDEX_H
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QList>
+#include <QVector>
+
+#include <map>
+
+struct SearchResult {
+    QString nodeId;
+    float score = 0.0f;
+};
+
+class SearchIndex
+{
+public:
+    enum Field {
+        TitleField = 0,
+        DescriptionField = 1,
+        MediaField = 2,
+        FieldCount = 3
+    };
+
+    SearchIndex();
+
+    // Incremental updates, made by the scene as node records change
+    void setTitle(const QString &nodeId, const QString &title);
+    void setDescription(const QString &nodeId, const QString &description);
+    void setMediaNames(const QString &nodeId, const QStringList &names);
+    void addMediaName(const QString &nodeId, const QString &name);
+    void removeNode(const QString &nodeId);
+    void clear();
+
+    // Queries. Every query token is matched as a prefix; all tokens must
+    // match (AND), and results are ranked by field weight, exactness and
+    // term rarity. A very short prefix may complete to more postings than
+    // MAX_PREFIX_POSTINGS; then only its most frequent completions (and the
+    // exact term) are used, and *truncated is set.
+    QList<SearchResult> search(const QString &query, int limit = DEFAULT_LIMIT, bool *truncated = nullptr) const;
+    int documentCount() const { return m_docIdByNode.size(); }
+    int termCount() const { return static_cast<int>(m_terms.size()); }
+
+    static QStringList tokenize(const QString &text);
+
+    // Constants
+    static const int DEFAULT_LIMIT = 50;
+
+private:
+    struct Document {
+        QString nodeId;
+        QStringList fieldTerms[FieldCount];
+        bool live = false;
+    };
+
+    // Postings: doc id -> accumulated field weight for that term
+    typedef QHash<int, float> Postings;
+
+    // Index
+    std::map<QString, Postings> m_terms;  // ordered, so a prefix is a range
+    QVector<Document> m_documents;
+    QHash<QString, int> m_docIdByNode;
+    QVector<int> m_freeDocIds;
+
+    // Methods
+    int documentFor(const QString &nodeId);
+    void setField(const QString &nodeId, Field field, const QStringList &terms);
+    void addTerms(int docId, Field field, const QStringList &terms);
+    void removeTerms(int docId, Field field, const QStringList &terms);
+    bool collectPrefix(const QString &prefix, QHash<int, float> &scores) const;
+
+    // Constants
+    static const int MAX_PREFIX_POSTINGS = 200000;
+    static const float FIELD_WEIGHTS[FieldCount];
+    static const float EXACT_MATCH_BONUS;
+};
+
+#endif // SEARCHINDEX_H
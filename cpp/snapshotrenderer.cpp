@@ -0,0 +1,156 @@
+#include "snapshotrenderer.h"
+#include "tracelog.h"
+
+#include <QFont>
+#include <QFontMetricsF>
+#include <QPen>
+
+const qreal SnapshotRenderer::EDGE_WIDTH = 2.0;
+
+SnapshotRenderer::SnapshotRenderer(const PersistentNodeStore &nodes)
+    : m_nodes(nodes)
+    , m_detail(FullDetail)
+    , m_background(Qt::white)
+{
+    m_nodes.forEach([this](const NodeRecordPtr &record) {
+        m_nodeGrid.insert(record->id, record->bounds);
+        m_bounds = m_bounds.united(record->bounds);
+    });
+
+    // Edges are indexed by their own extent so long lines still show up in
+    // areas that contain neither endpoint.
+    m_nodes.forEach([this](const NodeRecordPtr &record) {
+        if (!record->parentId.isEmpty()) {
+            if (NodeRecordPtr parent = m_nodes.value(record->parentId)) {
+                addEdge(*parent, *record);
+            }
+        }
+        for (const QString &targetId : record->connections) {
+            if (NodeRecordPtr target = m_nodes.value(targetId)) {
+                addEdge(*record, *target);
+            }
+        }
+    });
+}
+
+void SnapshotRenderer::render(QPainter *painter, const QRectF &area) const
+{
+    TRACE_SCOPE("SnapshotRenderer::render");
+    painter->save();
+    painter->setRenderHint(QPainter::Antialiasing, m_detail == FullDetail);
+    painter->setRenderHint(QPainter::TextAntialiasing);
+
+    painter->setPen(QPen(edgeColor(), EDGE_WIDTH));
+    painter->drawLines(edgesIn(area));
+
+    const QStringList nodeIds = nodesIn(area);
+    for (const QString &nodeId : nodeIds) {
+        if (NodeRecordPtr node = m_nodes.value(nodeId)) {
+            paintNode(painter, *node);
+        }
+    }
+    painter->restore();
+}
+
+QVector<QLineF> SnapshotRenderer::edgesIn(const QRectF &area) const
+{
+    const QStringList edgeIds = m_edgeGrid.query(area);
+    QVector<QLineF> lines;
+    lines.reserve(edgeIds.size());
+    for (const QString &edgeId : edgeIds) {
+        lines.append(m_edges.value(edgeId));
+    }
+    return lines;
+}
+
+QStringList SnapshotRenderer::nodesIn(const QRectF &area) const
+{
+    // Sorted so overlapping cards stack the same way in every tile or page
+    QStringList nodeIds = m_nodeGrid.query(area);
+    nodeIds.sort();
+    return nodeIds;
+}
+
+QColor SnapshotRenderer::highlightColor(const QString &name)
+{
+    if (name == "yellow") return QColor(0xFE, 0xF9, 0xC3);
+    if (name == "green") return QColor(0xBB, 0xF7, 0xD0);
+    if (name == "blue") return QColor(0xBF, 0xDB, 0xFE);
+    if (name == "pink") return QColor(0xFB, 0xCF, 0xE8);
+    if (name == "purple") return QColor(0xE9, 0xD5, 0xFF);
+    return QColor(Qt::white);
+}
+
+QColor SnapshotRenderer::textColor(const QString &name)
+{
+    if (name == "red") return QColor(0xB9, 0x1C, 0x1C);
+    if (name == "blue") return QColor(0x1D, 0x4E, 0xD8);
+    if (name == "green") return QColor(0x15, 0x80, 0x3D);
+    if (name == "purple") return QColor(0x7E, 0x22, 0xCE);
+    if (name == "orange") return QColor(0xC2, 0x41, 0x0C);
+    if (name == "pink") return QColor(0xBE, 0x18, 0x5D);
+    return QColor(0x11, 0x18, 0x27);
+}
+
+QColor SnapshotRenderer::borderColor(bool completed)
+{
+    return completed ? QColor(0x22, 0xC5, 0x5E) : QColor(0xE5, 0xE7, 0xEB);
+}
+
+QFont SnapshotRenderer::titleFont(const NodeRecord &node)
+{
+    QFont font;
+    font.setPixelSize(TITLE_PIXEL_SIZE);
+    font.setBold(node.formatting.bold);
+    font.setItalic(node.formatting.italic);
+    font.setUnderline(node.formatting.underline);
+    font.setStrikeOut(node.formatting.strikethrough || node.completed);
+    return font;
+}
+
+QFont SnapshotRenderer::descriptionFont()
+{
+    QFont font;
+    font.setPixelSize(DESCRIPTION_PIXEL_SIZE);
+    return font;
+}
+
+void SnapshotRenderer::addEdge(const NodeRecord &from, const NodeRecord &to)
+{
+    const QString edgeId = from.id + QLatin1Char('>') + to.id;
+    const QLineF line(from.bounds.center(), to.bounds.center());
+    m_edges.insert(edgeId, line);
+
+    // Pad by the pen so horizontal and vertical lines have an area.
+    const qreal pad = EDGE_WIDTH;
+    m_edgeGrid.insert(edgeId, QRectF(line.p1(), line.p2()).normalized().adjusted(-pad, -pad, pad, pad));
+}
+
+void SnapshotRenderer::paintNode(QPainter *painter, const NodeRecord &node) const
+{
+    const QRectF rect = node.bounds;
+    painter->setPen(QPen(borderColor(node.completed), 2));
+    painter->setBrush(highlightColor(node.formatting.highlightColor));
+
+    if (m_detail == Simplified) {
+        painter->drawRect(rect);
+        return;
+    }
+    painter->drawRoundedRect(rect, CORNER_RADIUS, CORNER_RADIUS);
+
+    const QRectF textRect = rect.adjusted(PADDING, PADDING, -PADDING, -PADDING);
+    const QFont title = titleFont(node);
+    painter->setFont(title);
+    painter->setPen(textColor(node.formatting.textColor));
+
+    const QFontMetricsF titleMetrics(title);
+    painter->drawText(textRect.topLeft() + QPointF(0, titleMetrics.ascent()),
+                      titleMetrics.elidedText(node.title, Qt::ElideRight, textRect.width()));
+
+    if (!node.description.isEmpty() && textRect.height() > 2 * titleMetrics.height()) {
+        painter->setFont(descriptionFont());
+        painter->setPen(descriptionColor());
+        painter->drawText(textRect.adjusted(0, titleMetrics.height() + 4, 0, 0),
+                          Qt::AlignLeft | Qt::AlignTop | Qt::TextWordWrap, node.description);
+    }
+}
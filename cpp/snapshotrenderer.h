@@ -0,0 +1,86 @@
+#ifndef SNAPSHOTRENDERER_H
+#define SNAPSHOTRENDERER_H
+
+#include <QString>
+#include <QHash>
+#include <QLineF>
+#include <QRectF>
+#include <QColor>
+#include <QPainter>
+#include <QFont>
+#include <QVector>
+
+#include "persistentnodestore.h"
+#include "spatialgrid.h"
+
+// Paints a frozen PersistentNodeStore snapshot: connections first, then the
+// node cards. Everything is read-only after construction, so one renderer
+// can serve many threads painting different areas at once (export tiles,
+// PDF pages) while the user keeps editing the live scene.
+class SnapshotRenderer
+{
+public:
+    enum Detail {
+        FullDetail,     // cards with title, description and formatting
+        Simplified      // cards as plain boxes, connections as straight lines
+    };
+
+    explicit SnapshotRenderer(const PersistentNodeStore &nodes);
+
+    QRectF bounds() const { return m_bounds; }
+    int nodeCount() const { return m_nodeGrid.count(); }
+
+    void setDetail(Detail detail) { m_detail = detail; }
+    Detail getDetail() const { return m_detail; }
+    void setBackground(const QColor &color) { m_background = color; }
+    QColor getBackground() const { return m_background; }
+
+    // Paints whatever intersects area; painter is already transformed to
+    // scene coordinates. Thread-safe.
+    void render(QPainter *painter, const QRectF &area) const;
+
+    // Geometry for writers that emit their own primitives (SVG). Nodes come
+    // back in paint order.
+    QVector<QLineF> edgesIn(const QRectF &area) const;
+    QStringList nodesIn(const QRectF &area) const;
+    NodeRecordPtr node(const QString &nodeId) const { return m_nodes.value(nodeId); }
+
+    // Formatting colours, shared with the web app's palette
+    static QColor highlightColor(const QString &name);
+    static QColor textColor(const QString &name);
+    static QColor borderColor(bool completed);
+    static QColor edgeColor() { return QColor(0x9C, 0xA3, 0xAF); }
+    static QColor descriptionColor() { return QColor(0x4B, 0x55, 0x63); }
+
+    // Fonts are sized in pixels, i.e. scene units, so output matches on
+    // every device regardless of its resolution.
+    static QFont titleFont(const NodeRecord &node);
+    static QFont descriptionFont();
+
+    // Constants
+    static const int CORNER_RADIUS = 8;
+    static const int PADDING = 10;
+
+private:
+    // Snapshot and its indexes
+    PersistentNodeStore m_nodes;
+    SpatialGrid m_nodeGrid;
+    SpatialGrid m_edgeGrid;
+    QHash<QString, QLineF> m_edges;
+    QRectF m_bounds;
+
+    // Options
+    Detail m_detail;
+    QColor m_background;
+
+    // Methods
+    void addEdge(const NodeRecord &from, const NodeRecord &to);
+    void paintNode(QPainter *painter, const NodeRecord &node) const;
+
+    // Constants
+    static const int TITLE_PIXEL_SIZE = 15;         // 11pt at 96 dpi
+    static const int DESCRIPTION_PIXEL_SIZE = 12;   // 9pt at 96 dpi
+    static const qreal EDGE_WIDTH;
+};
+
+#endif // SNAPSHOTRENDERER_H
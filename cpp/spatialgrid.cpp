@@ -0,0 +1,142 @@
+#include "spatialgrid.h"
+
+#include <QSet>
+#include <QtMath>
+
+const qreal SpatialGrid::DEFAULT_CELL_SIZE = 512.0;
+
+SpatialGrid::SpatialGrid(qreal cellSize)
+    : m_cellSize(cellSize > 0 ? cellSize : DEFAULT_CELL_SIZE)
+{
+}
+
+void SpatialGrid::insert(const QString &id, const QRectF &rect)
+{
+    auto existing = m_rects.find(id);
+    if (existing != m_rects.end()) {
+        int ox0, oy0, ox1, oy1, nx0, ny0, nx1, ny1;
+        cellRange(existing.value(), ox0, oy0, ox1, oy1);
+        cellRange(rect, nx0, ny0, nx1, ny1);
+        const QRectF previous = existing.value();
+        existing.value() = rect;
+        if (ox0 == nx0 && oy0 == ny0 && ox1 == nx1 && oy1 == ny1) {
+            return; // same cells, nothing to move
+        }
+        unplace(id, previous);
+    } else {
+        m_rects.insert(id, rect);
+    }
+    place(id, rect);
+}
+
+void SpatialGrid::remove(const QString &id)
+{
+    auto existing = m_rects.find(id);
+    if (existing == m_rects.end()) {
+        return;
+    }
+    unplace(id, existing.value());
+    m_rects.erase(existing);
+}
+
+void SpatialGrid::clear()
+{
+    m_cells.clear();
+    m_rects.clear();
+    m_oversized.clear();
+}
+
+QStringList SpatialGrid::query(const QRectF &area) const
+{
+    QStringList result;
+    int x0, y0, x1, y1;
+    cellRange(area, x0, y0, x1, y1);
+    const bool singleCell = x0 == x1 && y0 == y1;
+
+    // An area covering more cells than are occupied is cheaper to scan flat.
+    if (qint64(x1 - x0 + 1) * qint64(y1 - y0 + 1) > m_cells.size()) {
+        for (auto it = m_rects.constBegin(); it != m_rects.constEnd(); ++it) {
+            if (it.value().intersects(area)) {
+                result.append(it.key());
+            }
+        }
+        return result;
+    }
+
+    QSet<QString> seen;
+    for (const QString &id : m_oversized) {
+        if (m_rects.value(id).intersects(area)) {
+            result.append(id);
+        }
+    }
+    for (int x = x0; x <= x1; ++x) {
+        for (int y = y0; y <= y1; ++y) {
+            auto cell = m_cells.constFind(cellKey(x, y));
+            if (cell == m_cells.constEnd()) {
+                continue;
+            }
+            for (const QString &id : cell.value()) {
+                // Entries spanning several cells would otherwise repeat.
+                if (!singleCell && seen.contains(id)) {
+                    continue;
+                }
+                if (m_rects.value(id).intersects(area)) {
+                    result.append(id);
+                    if (!singleCell) {
+                        seen.insert(id);
+                    }
+                }
+            }
+        }
+    }
+    return result;
+}
+
+void SpatialGrid::cellRange(const QRectF &rect, int &x0, int &y0, int &x1, int &y1) const
+{
+    x0 = qFloor(rect.left() / m_cellSize);
+    y0 = qFloor(rect.top() / m_cellSize);
+    x1 = qFloor(rect.right() / m_cellSize);
+    y1 = qFloor(rect.bottom() / m_cellSize);
+}
+
+void SpatialGrid::place(const QString &id, const QRectF &rect)
+{
+    int x0, y0, x1, y1;
+    cellRange(rect, x0, y0, x1, y1);
+    if (x1 - x0 >= MAX_CELL_SPAN || y1 - y0 >= MAX_CELL_SPAN) {
+        m_oversized.append(id);
+        return;
+    }
+    for (int x = x0; x <= x1; ++x) {
+        for (int y = y0; y <= y1; ++y) {
+            m_cells[cellKey(x, y)].append(id);
+        }
+    }
+}
+
+void SpatialGrid::unplace(const QString &id, const QRectF &rect)
+{
+    int x0, y0, x1, y1;
+    cellRange(rect, x0, y0, x1, y1);
+    if (x1 - x0 >= MAX_CELL_SPAN || y1 - y0 >= MAX_CELL_SPAN) {
+        m_oversized.removeOne(id);
+        return;
+    }
+    for (int x = x0; x <= x1; ++x) {
+        for (int y = y0; y <= y1; ++y) {
+            auto cell = m_cells.find(cellKey(x, y));
+            if (cell != m_cells.end()) {
+                cell.value().removeOne(id);
+                if (cell.value().isEmpty()) {
+                    m_cells.erase(cell);
+                }
+            }
+        }
+    }
+}
+
+quint64 SpatialGrid::cellKey(int x, int y)
+{
+    return (quint64(quint32(x)) << 32) | quint32(y);
+}
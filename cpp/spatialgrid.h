@@ -0,0 +1,48 @@
+#ifndef SPATIALGRID_H
+#define SPATIALGRID_H
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QVector>
+#include <QRectF>
+
+// Uniform-grid spatial index over id-keyed rectangles. Updates touch only
+// the cells a rectangle covers; queries visit only the cells the area covers.
+class SpatialGrid
+{
+public:
+    explicit SpatialGrid(qreal cellSize = DEFAULT_CELL_SIZE);
+
+    // Entries
+    void insert(const QString &id, const QRectF &rect); // inserts or moves
+    void remove(const QString &id);
+    void clear();
+    bool contains(const QString &id) const { return m_rects.contains(id); }
+    QRectF rect(const QString &id) const { return m_rects.value(id); }
+    int count() const { return m_rects.size(); }
+
+    // Ids whose rectangle intersects area
+    QStringList query(const QRectF &area) const;
+
+    // Constants
+    static const qreal DEFAULT_CELL_SIZE;
+
+private:
+    // Data
+    QHash<quint64, QVector<QString>> m_cells;
+    QHash<QString, QRectF> m_rects;
+    QVector<QString> m_oversized; // entries covering too many cells, checked on every query
+    qreal m_cellSize;
+
+    // Methods
+    void cellRange(const QRectF &rect, int &x0, int &y0, int &x1, int &y1) const;
+    void place(const QString &id, const QRectF &rect);
+    void unplace(const QString &id, const QRectF &rect);
+    static quint64 cellKey(int x, int y);
+
+    // Constants
+    static const int MAX_CELL_SPAN = 64; // per axis
+};
+
+#endif // SPATIALGRID_H
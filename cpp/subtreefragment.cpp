@@ -0,0 +1,492 @@
+#include "subtreefragment.h"
+#include "mindmapscene.h"
+#include "mapdocument.h"
+
+#include <QDataStream>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QUuid>
+
+const char SubtreeFragment::MIME_TYPE[] = "application/x-mind2do-fragment";
+
+namespace {
+
+void writeString(QDataStream &stream, const QString &value)
+{
+    stream << value.toUtf8();
+}
+
+QString readString(QDataStream &stream)
+{
+    QByteArray bytes;
+    stream >> bytes;
+    return QString::fromUtf8(bytes);
+}
+
+QString newId()
+{
+    return QUuid::createUuid().toString(QUuid::WithoutBraces);
+}
+
+enum NodeFlag {
+    FlagCompleted = 0x01,
+    FlagBold = 0x02,
+    FlagItalic = 0x04,
+    FlagUnderline = 0x08,
+    FlagStrikethrough = 0x10
+};
+
+} // namespace
+
+SubtreeFragment::SubtreeFragment()
+{
+}
+
+SubtreeFragment SubtreeFragment::capture(MindMapScene *scene, const QStringList &rootIds)
+{
+    SubtreeFragment fragment;
+    const QSet<QString> selected(rootIds.begin(), rootIds.end());
+    QHash<QString, int> indexById;
+    QStringList ids;
+    QPointF origin;
+    QVector<QPair<MindMapNode*, int>> stack;
+
+    for (const QString &rootId : rootIds) {
+        MindMapNode *root = scene->getNode(rootId);
+        if (!root || indexById.contains(rootId)) {
+            continue;
+        }
+
+        // A root inside another selected branch is copied with that branch.
+        bool nested = false;
+        QSet<QString> seen;
+        for (QString ancestor = root->getParentId(); !ancestor.isEmpty() && !seen.contains(ancestor); ) {
+            if (selected.contains(ancestor)) {
+                nested = true;
+                break;
+            }
+            seen.insert(ancestor);
+            MindMapNode *ancestorNode = scene->getNode(ancestor);
+            ancestor = ancestorNode ? ancestorNode->getParentId() : QString();
+        }
+        if (nested) {
+            continue;
+        }
+
+        if (fragment.m_nodes.isEmpty()) {
+            origin = root->getPosition();
+        }
+
+        // Iterative preorder; children are pushed reversed to keep their order.
+        stack.append(qMakePair(root, -1));
+        while (!stack.isEmpty()) {
+            const QPair<MindMapNode*, int> item = stack.takeLast();
+            MindMapNode *node = item.first;
+            if (indexById.contains(node->getId())) {
+                continue;
+            }
+
+            const int index = fragment.m_nodes.size();
+            indexById.insert(node->getId(), index);
+            ids.append(node->getId());
+
+            Node entry;
+            entry.parent = item.second;
+            entry.title = node->getTitle();
+            entry.description = node->getDescription();
+            entry.completed = node->isCompleted();
+            entry.formatting = node->getFormatting();
+            entry.offset = node->getPosition() - origin;
+            entry.mediaFiles = node->getMediaFiles();
+            for (MediaFile &media : entry.mediaFiles) {
+                media.thumbnail = QPixmap();
+            }
+            fragment.m_nodes.append(entry);
+
+            const QStringList children = node->getChildren();
+            for (int i = children.size() - 1; i >= 0; --i) {
+                if (MindMapNode *child = scene->getNode(children.at(i))) {
+                    stack.append(qMakePair(child, index));
+                }
+            }
+        }
+    }
+
+    // Cross-links whose both ends were copied
+    QSet<quint64> seenLinks;
+    for (int i = 0; i < ids.size(); ++i) {
+        const QStringList connections = scene->getNode(ids.at(i))->getConnections();
+        for (const QString &targetId : connections) {
+            auto it = indexById.constFind(targetId);
+            if (it != indexById.constEnd()) {
+                fragment.appendLink(i, it.value(), &seenLinks);
+            }
+        }
+    }
+
+    return fragment;
+}
+
+void SubtreeFragment::instantiate(const QString &parentId, const QPointF &anchor,
+                                  QVector<NodeSnapshot> *nodes, QVector<ConnectionDelta> *links) const
+{
+    QVector<QString> ids(m_nodes.size());
+    nodes->reserve(nodes->size() + m_nodes.size());
+
+    // Parents precede children, so every parent id is already assigned.
+    for (int i = 0; i < m_nodes.size(); ++i) {
+        const Node &node = m_nodes.at(i);
+        ids[i] = newId();
+
+        NodeSnapshot snapshot;
+        snapshot.id = ids.at(i);
+        snapshot.parentId = node.parent < 0 ? parentId : ids.at(node.parent);
+        snapshot.title = node.title;
+        snapshot.description = node.description;
+        snapshot.completed = node.completed;
+        snapshot.formatting = node.formatting;
+        snapshot.position = anchor + node.offset;
+        snapshot.mediaFiles = node.mediaFiles;
+        for (MediaFile &media : snapshot.mediaFiles) {
+            media.id = newId();
+        }
+        nodes->append(snapshot);
+    }
+
+    links->reserve(links->size() + m_links.size());
+    for (const QPair<int, int> &link : m_links) {
+        ConnectionDelta connection;
+        connection.fromId = ids.at(link.first);
+        connection.toId = ids.at(link.second);
+        links->append(connection);
+    }
+}
+
+// Binary form
+
+QByteArray SubtreeFragment::toBinary() const
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_6_0);
+
+    stream << MAGIC << FORMAT_VERSION << quint32(m_nodes.size());
+    for (const Node &node : m_nodes) {
+        quint8 flags = 0;
+        if (node.completed) flags |= FlagCompleted;
+        if (node.formatting.bold) flags |= FlagBold;
+        if (node.formatting.italic) flags |= FlagItalic;
+        if (node.formatting.underline) flags |= FlagUnderline;
+        if (node.formatting.strikethrough) flags |= FlagStrikethrough;
+
+        stream << qint32(node.parent) << flags << node.offset.x() << node.offset.y();
+        writeString(stream, node.title);
+        writeString(stream, node.description);
+        writeString(stream, node.formatting.highlightColor);
+        writeString(stream, node.formatting.textColor);
+
+        stream << quint32(node.mediaFiles.size());
+        for (const MediaFile &media : node.mediaFiles) {
+            writeString(stream, media.name);
+            writeString(stream, media.filePath);
+            writeString(stream, media.type);
+            writeString(stream, media.contentHash);
+            stream << qint64(media.size) << qint64(media.lastModified);
+        }
+    }
+
+    stream << quint32(m_links.size());
+    for (const QPair<int, int> &link : m_links) {
+        stream << qint32(link.first) << qint32(link.second);
+    }
+    return data;
+}
+
+bool SubtreeFragment::fromBinary(const QByteArray &data, SubtreeFragment *fragment)
+{
+    QDataStream stream(data);
+    stream.setVersion(QDataStream::Qt_6_0);
+
+    quint32 magic = 0;
+    quint16 version = 0;
+    quint32 nodeCount = 0;
+    stream >> magic >> version >> nodeCount;
+    if (stream.status() != QDataStream::Ok || magic != MAGIC || version > FORMAT_VERSION) {
+        return false;
+    }
+
+    // Every node takes well over 16 bytes; don't trust the count further.
+    SubtreeFragment result;
+    result.m_nodes.reserve(qMin<qint64>(nodeCount, data.size() / 16));
+    for (quint32 i = 0; i < nodeCount && stream.status() == QDataStream::Ok; ++i) {
+        Node node;
+        qint32 parent = -1;
+        quint8 flags = 0;
+        double x = 0.0;
+        double y = 0.0;
+        stream >> parent >> flags >> x >> y;
+        node.parent = parent;
+        node.offset = QPointF(x, y);
+        node.completed = flags & FlagCompleted;
+        node.formatting.bold = flags & FlagBold;
+        node.formatting.italic = flags & FlagItalic;
+        node.formatting.underline = flags & FlagUnderline;
+        node.formatting.strikethrough = flags & FlagStrikethrough;
+        node.title = readString(stream);
+        node.description = readString(stream);
+        node.formatting.highlightColor = readString(stream);
+        node.formatting.textColor = readString(stream);
+
+        quint32 mediaCount = 0;
+        stream >> mediaCount;
+        for (quint32 m = 0; m < mediaCount && stream.status() == QDataStream::Ok; ++m) {
+            MediaFile media;
+            media.name = readString(stream);
+            media.filePath = readString(stream);
+            media.type = readString(stream);
+            media.contentHash = readString(stream);
+            qint64 size = 0;
+            qint64 lastModified = 0;
+            stream >> size >> lastModified;
+            media.size = size;
+            media.lastModified = lastModified;
+            node.mediaFiles.append(media);
+        }
+        result.m_nodes.append(node);
+    }
+
+    quint32 linkCount = 0;
+    stream >> linkCount;
+    for (quint32 i = 0; i < linkCount && stream.status() == QDataStream::Ok; ++i) {
+        qint32 from = 0;
+        qint32 to = 0;
+        stream >> from >> to;
+        result.m_links.append(qMakePair(int(from), int(to)));
+    }
+
+    if (stream.status() != QDataStream::Ok || !result.isValid()) {
+        return false;
+    }
+    *fragment = result;
+    return true;
+}
+
+// JSON form, using the web app's node schema
+
+QJsonDocument SubtreeFragment::toJson() const
+{
+    auto idFor = [](int index) { return QString("n%1").arg(index); };
+
+    QVector<QJsonArray> children(m_nodes.size());
+    QVector<QJsonArray> connections(m_nodes.size());
+    for (int i = 0; i < m_nodes.size(); ++i) {
+        if (m_nodes.at(i).parent >= 0) {
+            children[m_nodes.at(i).parent].append(idFor(i));
+        }
+    }
+    for (const QPair<int, int> &link : m_links) {
+        connections[link.first].append(idFor(link.second));
+    }
+
+    QJsonArray nodes;
+    for (int i = 0; i < m_nodes.size(); ++i) {
+        const Node &node = m_nodes.at(i);
+
+        QJsonArray media;
+        for (const MediaFile &file : node.mediaFiles) {
+            media.append(MapDocument::mediaToJson(file));
+        }
+
+        QJsonObject json;
+        json["id"] = idFor(i);
+        json["title"] = node.title;
+        json["description"] = node.description;
+        json["x"] = node.offset.x();
+        json["y"] = node.offset.y();
+        json["completed"] = node.completed;
+        json["parentId"] = node.parent < 0 ? QJsonValue() : QJsonValue(idFor(node.parent));
+        json["children"] = children.at(i);
+        json["connections"] = connections.at(i);
+        json["media"] = media;
+        json["formatting"] = MapDocument::formattingToJson(node.formatting);
+        nodes.append(json);
+    }
+
+    QJsonObject root;
+    root["version"] = "1.0";
+    root["nodes"] = nodes;
+    return QJsonDocument(root);
+}
+
+bool SubtreeFragment::fromJson(const QJsonDocument &document, SubtreeFragment *fragment)
+{
+    const QJsonArray nodes = document.isArray() ? document.array() : document.object().value("nodes").toArray();
+    if (nodes.isEmpty()) {
+        return false;
+    }
+
+    SubtreeFragment result;
+    QHash<QString, int> indexById;
+    QStringList parentIds;
+    QVector<QStringList> connections;
+    result.m_nodes.reserve(nodes.size());
+
+    for (const QJsonValue &value : nodes) {
+        const QJsonObject json = value.toObject();
+        const QString id = json.value("id").toString();
+        if (id.isEmpty() || indexById.contains(id)) {
+            continue;
+        }
+        indexById.insert(id, result.m_nodes.size());
+        parentIds.append(json.value("parentId").toString());
+
+        QStringList targets;
+        for (const QJsonValue &target : json.value("connections").toArray()) {
+            targets.append(target.toString());
+        }
+        connections.append(targets);
+
+        Node node;
+        node.title = json.value("title").toString();
+        node.description = json.value("description").toString();
+        node.completed = json.value("completed").toBool();
+        node.offset = QPointF(json.value("x").toDouble(), json.value("y").toDouble());
+
+        node.formatting = MapDocument::formattingFromJson(json.value("formatting").toObject());
+        for (const QJsonValue &media : json.value("media").toArray()) {
+            node.mediaFiles.append(MapDocument::mediaFromJson(media.toObject()));
+        }
+        result.m_nodes.append(node);
+    }
+
+    // Resolve references now that every id has an index.
+    QSet<quint64> seenLinks;
+    for (int i = 0; i < result.m_nodes.size(); ++i) {
+        result.m_nodes[i].parent = indexById.value(parentIds.at(i), -1);
+        for (const QString &targetId : connections.at(i)) {
+            auto it = indexById.constFind(targetId);
+            if (it != indexById.constEnd()) {
+                result.appendLink(i, it.value(), &seenLinks);
+            }
+        }
+    }
+
+    result.reorderToPreorder();
+    if (result.m_nodes.isEmpty()) {
+        return false;
+    }
+    const QPointF origin = result.m_nodes.first().offset;
+    for (Node &node : result.m_nodes) {
+        node.offset -= origin;
+    }
+
+    *fragment = result;
+    return true;
+}
+
+// Clipboard
+
+QMimeData* SubtreeFragment::toMimeData() const
+{
+    QMimeData *mimeData = new QMimeData();
+    mimeData->setData(MIME_TYPE, toBinary());
+    if (m_nodes.size() <= MAX_JSON_NODES) {
+        mimeData->setText(QString::fromUtf8(toJson().toJson(QJsonDocument::Compact)));
+    }
+    return mimeData;
+}
+
+bool SubtreeFragment::fromMimeData(const QMimeData *mimeData, SubtreeFragment *fragment)
+{
+    if (!mimeData) {
+        return false;
+    }
+    if (mimeData->hasFormat(MIME_TYPE) && fromBinary(mimeData->data(MIME_TYPE), fragment)) {
+        return true;
+    }
+    if (mimeData->hasText()) {
+        return fromJson(QJsonDocument::fromJson(mimeData->text().toUtf8()), fragment);
+    }
+    return false;
+}
+
+void SubtreeFragment::appendLink(int from, int to, QSet<quint64> *seen)
+{
+    if (from == to) {
+        return;
+    }
+    // Links recorded on both ends are kept once.
+    const quint64 key = (quint64(qMin(from, to)) << 32) | quint64(qMax(from, to));
+    if (seen->contains(key)) {
+        return;
+    }
+    seen->insert(key);
+    m_links.append(qMakePair(from, to));
+}
+
+bool SubtreeFragment::isValid() const
+{
+    for (int i = 0; i < m_nodes.size(); ++i) {
+        if (m_nodes.at(i).parent >= i || m_nodes.at(i).parent < -1) {
+            return false;
+        }
+    }
+    for (const QPair<int, int> &link : m_links) {
+        if (link.first < 0 || link.first >= m_nodes.size() || link.second < 0 || link.second >= m_nodes.size()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void SubtreeFragment::reorderToPreorder()
+{
+    const int count = m_nodes.size();
+    QVector<QVector<int>> children(count);
+    for (int i = 0; i < count; ++i) {
+        if (m_nodes.at(i).parent >= 0) {
+            children[m_nodes.at(i).parent].append(i);
+        }
+    }
+
+    // Walk from the roots; anything left over sits on a parent cycle and
+    // becomes a root itself.
+    QVector<int> newIndex(count, -1);
+    QVector<int> order;
+    order.reserve(count);
+    QVector<int> stack;
+    for (int pass = 0; pass < 2; ++pass) {
+        for (int start = 0; start < count; ++start) {
+            if (newIndex.at(start) >= 0 || (pass == 0 && m_nodes.at(start).parent >= 0)) {
+                continue;
+            }
+            m_nodes[start].parent = -1;
+            stack.append(start);
+            while (!stack.isEmpty()) {
+                const int index = stack.takeLast();
+                if (newIndex.at(index) >= 0) {
+                    continue;
+                }
+                newIndex[index] = order.size();
+                order.append(index);
+                const QVector<int> &kids = children.at(index);
+                for (int k = kids.size() - 1; k >= 0; --k) {
+                    stack.append(kids.at(k));
+                }
+            }
+        }
+    }
+
+    QVector<Node> nodes;
+    nodes.reserve(count);
+    for (int index : order) {
+        Node node = m_nodes.at(index);
+        node.parent = node.parent < 0 ? -1 : newIndex.at(node.parent);
+        nodes.append(node);
+    }
+    m_nodes = nodes;
+    for (QPair<int, int> &link : m_links) {
+        link.first = newIndex.at(link.first);
+        link.second = newIndex.at(link.second);
+    }
+}
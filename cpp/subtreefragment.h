@@ -0,0 +1,83 @@
+#ifndef SUBTREEFRAGMENT_H
+#define SUBTREEFRAGMENT_H
+
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QVector>
+#include <QList>
+#include <QPair>
+#include <QSet>
+#include <QPointF>
+#include <QJsonDocument>
+#include <QMimeData>
+
+#include "commandhistory.h"
+
+class MindMapScene;
+
+// A detached copy of one or more branches, used for copy/paste and
+// duplicate. Nodes are stored in preorder and refer to each other by index,
+// not id, so pasting assigns fresh ids in a single pass with no lookups.
+//
+// On the clipboard the fragment is a compact binary blob under MIME_TYPE,
+// with the JSON form (the web app's node schema) as text/plain fallback.
+class SubtreeFragment
+{
+public:
+    struct Node {
+        int parent = -1;        // index of the parent, always lower; -1 for a branch root
+        QString title;
+        QString description;
+        bool completed = false;
+        TextFormatting formatting;
+        QPointF offset;         // relative to the first root
+        QList<MediaFile> mediaFiles;
+    };
+
+    SubtreeFragment();
+
+    // Copies the branches under rootIds. Roots inside another selected
+    // branch are folded into it.
+    static SubtreeFragment capture(MindMapScene *scene, const QStringList &rootIds);
+
+    // Nodes with new ids, the branch roots attached to parentId and the
+    // first root placed at anchor, plus the cross-links among them
+    void instantiate(const QString &parentId, const QPointF &anchor,
+                     QVector<NodeSnapshot> *nodes, QVector<ConnectionDelta> *links) const;
+
+    bool isEmpty() const { return m_nodes.isEmpty(); }
+    int count() const { return m_nodes.size(); }
+    const QVector<Node>& nodes() const { return m_nodes; }
+    const QVector<QPair<int, int>>& links() const { return m_links; }
+
+    // Encoding
+    QByteArray toBinary() const;
+    static bool fromBinary(const QByteArray &data, SubtreeFragment *fragment);
+    QJsonDocument toJson() const;
+    static bool fromJson(const QJsonDocument &document, SubtreeFragment *fragment);
+
+    // Clipboard
+    QMimeData* toMimeData() const;
+    static bool fromMimeData(const QMimeData *mimeData, SubtreeFragment *fragment);
+
+    // Constants
+    static const char MIME_TYPE[];
+
+private:
+    // Content
+    QVector<Node> m_nodes;
+    QVector<QPair<int, int>> m_links;
+
+    // Methods
+    void appendLink(int from, int to, QSet<quint64> *seen);
+    bool isValid() const;
+    void reorderToPreorder();
+
+    // Constants
+    static const quint32 MAGIC = 0x4D324446; // "M2DF"
+    static const quint16 FORMAT_VERSION = 1;
+    static const int MAX_JSON_NODES = 20000; // larger copies put only the binary form on the clipboard
+};
+
+#endif // SUBTREEFRAGMENT_H
@@ -0,0 +1,438 @@
+#include "taskfilter.h"
+
+#include <QQueue>
+
+// NodeBitset
+
+NodeBitset::NodeBitset(int size, bool value)
+    : m_words((size + 63) / 64, value ? ~quint64(0) : quint64(0))
+    , m_size(size)
+{
+    trimTail();
+}
+
+void NodeBitset::resize(int size)
+{
+    m_words.resize((size + 63) / 64);
+    m_size = size;
+    trimTail();
+}
+
+void NodeBitset::setBit(int index, bool value)
+{
+    if (index >= m_size) {
+        resize(index + 1);
+    }
+    const quint64 bit = quint64(1) << (index & 63);
+    if (value) {
+        m_words[index >> 6] |= bit;
+    } else {
+        m_words[index >> 6] &= ~bit;
+    }
+}
+
+int NodeBitset::count() const
+{
+    int total = 0;
+    for (quint64 word : m_words) {
+        total += qPopulationCount(word);
+    }
+    return total;
+}
+
+NodeBitset &NodeBitset::operator&=(const NodeBitset &other)
+{
+    const int common = qMin(m_words.size(), other.m_words.size());
+    for (int i = 0; i < common; ++i) {
+        m_words[i] &= other.m_words.at(i);
+    }
+    for (int i = common; i < m_words.size(); ++i) {
+        m_words[i] = 0;
+    }
+    return *this;
+}
+
+NodeBitset &NodeBitset::operator|=(const NodeBitset &other)
+{
+    if (other.m_size > m_size) {
+        resize(other.m_size);
+    }
+    for (int i = 0; i < other.m_words.size(); ++i) {
+        m_words[i] |= other.m_words.at(i);
+    }
+    return *this;
+}
+
+NodeBitset &NodeBitset::operator^=(const NodeBitset &other)
+{
+    if (other.m_size > m_size) {
+        resize(other.m_size);
+    }
+    for (int i = 0; i < other.m_words.size(); ++i) {
+        m_words[i] ^= other.m_words.at(i);
+    }
+    return *this;
+}
+
+NodeBitset &NodeBitset::andNot(const NodeBitset &other)
+{
+    const int common = qMin(m_words.size(), other.m_words.size());
+    for (int i = 0; i < common; ++i) {
+        m_words[i] &= ~other.m_words.at(i);
+    }
+    return *this;
+}
+
+void NodeBitset::trimTail()
+{
+    if ((m_size & 63) != 0 && !m_words.isEmpty()) {
+        m_words.last() &= (quint64(1) << (m_size & 63)) - 1;
+    }
+}
+
+// TaskFilterQuery
+
+bool TaskFilterQuery::isEmpty() const
+{
+    return completed == Any && hasAttachments == Any && highlightColor.isEmpty() && textColor.isEmpty()
+        && minDepth < 0 && maxDepth < 0 && subtreeRootId.isEmpty();
+}
+
+// TaskFilterIndex
+
+TaskFilterIndex::TaskFilterIndex(QObject *parent)
+    : QObject(parent)
+{
+}
+
+TaskFilterIndex::~TaskFilterIndex()
+{
+}
+
+void TaskFilterIndex::addNode(const QString &nodeId, const QString &parentId)
+{
+    if (m_slotById.contains(nodeId)) {
+        setParent(nodeId, parentId);
+        return;
+    }
+
+    const int slot = allocateSlot(nodeId);
+    m_live.setBit(slot);
+    setColorBit(m_highlight, m_highlightBySlot, slot, "none");
+    setColorBit(m_textColor, m_textColorBySlot, slot, "default");
+    setDepth(slot, 0);
+
+    if (!parentId.isEmpty()) {
+        setParent(nodeId, parentId);
+    }
+
+    // Children loaded before this node can now hang off it, unless they
+    // have since moved elsewhere; setParent refuses cycles, leaving a root.
+    const QStringList orphans = m_orphansByParentId.take(nodeId);
+    for (const QString &childId : orphans) {
+        const int child = slotOf(childId);
+        if (child >= 0 && m_pendingParentBySlot.at(child) == nodeId) {
+            m_pendingParentBySlot[child].clear();
+            setParent(childId, nodeId);
+        }
+    }
+    emit changed();
+}
+
+void TaskFilterIndex::removeNode(const QString &nodeId)
+{
+    auto it = m_slotById.find(nodeId);
+    if (it == m_slotById.end()) {
+        return;
+    }
+    const int slot = it.value();
+    m_slotById.erase(it);
+
+    detachFromParent(slot);
+    const QVector<int> children = m_children.at(slot);
+    for (int child : children) {
+        m_parent[child] = -1;
+        m_pendingParentBySlot[child] = nodeId;
+        setSubtreeDepth(child, 0);
+        m_orphansByParentId[nodeId].append(m_nodeIds.at(child));
+    }
+    m_children[slot].clear();
+
+    m_live.setBit(slot, false);
+    m_completed.setBit(slot, false);
+    m_hasAttachments.setBit(slot, false);
+    setColorBit(m_highlight, m_highlightBySlot, slot, QString());
+    setColorBit(m_textColor, m_textColorBySlot, slot, QString());
+    if (m_depth.at(slot) < m_byDepth.size()) {
+        m_byDepth[m_depth.at(slot)].setBit(slot, false);
+    }
+    m_depth[slot] = -1;
+    m_nodeIds[slot].clear();
+    m_freeSlots.append(slot);
+
+    emit slotReleased(slot);
+    emit changed();
+}
+
+void TaskFilterIndex::setParent(const QString &nodeId, const QString &parentId)
+{
+    const int slot = slotOf(nodeId);
+    if (slot < 0) {
+        return;
+    }
+    const int parentSlot = slotOf(parentId);
+    if (parentSlot >= 0 ? parentSlot == m_parent.at(slot)
+                        : m_parent.at(slot) < 0 && m_pendingParentBySlot.at(slot) == parentId) {
+        return;
+    }
+
+    // Refuse to hang a node below its own descendant.
+    for (int ancestor = parentSlot; ancestor >= 0; ancestor = m_parent.at(ancestor)) {
+        if (ancestor == slot) {
+            return;
+        }
+    }
+
+    detachFromParent(slot);
+    if (parentSlot >= 0) {
+        m_parent[slot] = parentSlot;
+        m_children[parentSlot].append(slot);
+    } else if (!parentId.isEmpty()) {
+        m_pendingParentBySlot[slot] = parentId;
+        m_orphansByParentId[parentId].append(nodeId);
+    }
+
+    setSubtreeDepth(slot, parentSlot >= 0 ? m_depth.at(parentSlot) + 1 : 0);
+    emit changed();
+}
+
+void TaskFilterIndex::setCompleted(const QString &nodeId, bool completed)
+{
+    const int slot = slotOf(nodeId);
+    if (slot < 0 || m_completed.testBit(slot) == completed) {
+        return;
+    }
+    m_completed.setBit(slot, completed);
+    emit changed();
+}
+
+void TaskFilterIndex::setFormatting(const QString &nodeId, const TextFormatting &formatting)
+{
+    const int slot = slotOf(nodeId);
+    if (slot < 0) {
+        return;
+    }
+    if (m_highlightBySlot.at(slot) == formatting.highlightColor
+        && m_textColorBySlot.at(slot) == formatting.textColor) {
+        return;
+    }
+    setColorBit(m_highlight, m_highlightBySlot, slot, formatting.highlightColor);
+    setColorBit(m_textColor, m_textColorBySlot, slot, formatting.textColor);
+    emit changed();
+}
+
+void TaskFilterIndex::setHasAttachments(const QString &nodeId, bool hasAttachments)
+{
+    const int slot = slotOf(nodeId);
+    if (slot < 0 || m_hasAttachments.testBit(slot) == hasAttachments) {
+        return;
+    }
+    m_hasAttachments.setBit(slot, hasAttachments);
+    emit changed();
+}
+
+void TaskFilterIndex::clear()
+{
+    const int previousCapacity = m_nodeIds.size();
+    m_nodeIds.clear();
+    m_slotById.clear();
+    m_freeSlots.clear();
+    m_parent.clear();
+    m_children.clear();
+    m_depth.clear();
+    m_highlightBySlot.clear();
+    m_textColorBySlot.clear();
+    m_pendingParentBySlot.clear();
+    m_orphansByParentId.clear();
+    m_live = NodeBitset();
+    m_completed = NodeBitset();
+    m_hasAttachments = NodeBitset();
+    m_highlight.clear();
+    m_textColor.clear();
+    m_byDepth.clear();
+
+    for (int slot = 0; slot < previousCapacity; ++slot) {
+        emit slotReleased(slot);
+    }
+    emit changed();
+}
+
+NodeBitset TaskFilterIndex::evaluate(const TaskFilterQuery &query) const
+{
+    // Start from the most selective cheap term and narrow with word-wide ANDs.
+    NodeBitset result = m_live;
+
+    if (query.completed == TaskFilterQuery::Yes) {
+        result &= m_completed;
+    } else if (query.completed == TaskFilterQuery::No) {
+        result.andNot(m_completed);
+    }
+
+    if (query.hasAttachments == TaskFilterQuery::Yes) {
+        result &= m_hasAttachments;
+    } else if (query.hasAttachments == TaskFilterQuery::No) {
+        result.andNot(m_hasAttachments);
+    }
+
+    if (!query.highlightColor.isEmpty()) {
+        result &= m_highlight.value(query.highlightColor);
+    }
+    if (!query.textColor.isEmpty()) {
+        result &= m_textColor.value(query.textColor);
+    }
+
+    if (query.minDepth >= 0 || query.maxDepth >= 0) {
+        NodeBitset depthBits(m_live.size());
+        const int lowest = qMax(0, query.minDepth);
+        const int highest = query.maxDepth >= 0 ? qMin(query.maxDepth, m_byDepth.size() - 1) : m_byDepth.size() - 1;
+        for (int depth = lowest; depth <= highest; ++depth) {
+            depthBits |= m_byDepth.at(depth);
+        }
+        result &= depthBits;
+    }
+
+    if (!query.subtreeRootId.isEmpty()) {
+        result &= subtree(query.subtreeRootId);
+    }
+    return result;
+}
+
+NodeBitset TaskFilterIndex::subtree(const QString &rootId) const
+{
+    NodeBitset bits(m_live.size());
+    const int root = slotOf(rootId);
+    if (root < 0) {
+        return bits;
+    }
+
+    QQueue<int> pending;
+    pending.enqueue(root);
+    while (!pending.isEmpty()) {
+        const int current = pending.dequeue();
+        bits.setBit(current);
+        for (int child : m_children.at(current)) {
+            pending.enqueue(child);
+        }
+    }
+    return bits;
+}
+
+QStringList TaskFilterIndex::nodeIds(const NodeBitset &bits) const
+{
+    QStringList ids;
+    ids.reserve(bits.count());
+    bits.forEachSetBit([&](int slot) {
+        if (slot < m_nodeIds.size() && !m_nodeIds.at(slot).isEmpty()) {
+            ids.append(m_nodeIds.at(slot));
+        }
+    });
+    return ids;
+}
+
+int TaskFilterIndex::allocateSlot(const QString &nodeId)
+{
+    int slot;
+    if (!m_freeSlots.isEmpty()) {
+        slot = m_freeSlots.takeLast();
+        m_nodeIds[slot] = nodeId;
+    } else {
+        slot = m_nodeIds.size();
+        grow(slot + 1);
+        m_nodeIds[slot] = nodeId;
+    }
+    m_slotById.insert(nodeId, slot);
+    m_parent[slot] = -1;
+    m_children[slot].clear();
+    return slot;
+}
+
+void TaskFilterIndex::grow(int capacity)
+{
+    while (m_nodeIds.size() < capacity) {
+        m_nodeIds.append(QString());
+    }
+    m_parent.resize(capacity);
+    m_children.resize(capacity);
+    m_depth.resize(capacity);
+    m_highlightBySlot.resize(capacity);
+    m_textColorBySlot.resize(capacity);
+    m_pendingParentBySlot.resize(capacity);
+    m_live.resize(capacity);
+    m_completed.resize(capacity);
+    m_hasAttachments.resize(capacity);
+}
+
+void TaskFilterIndex::setDepth(int slot, int depth)
+{
+    const int previous = m_depth.at(slot);
+    if (previous >= 0 && previous < m_byDepth.size()) {
+        m_byDepth[previous].setBit(slot, false);
+    }
+    while (m_byDepth.size() <= depth) {
+        m_byDepth.append(NodeBitset(m_live.size()));
+    }
+    m_byDepth[depth].setBit(slot);
+    m_depth[slot] = depth;
+}
+
+void TaskFilterIndex::setSubtreeDepth(int slot, int depth)
+{
+    // Depth changes ripple through the moved subtree only.
+    QQueue<int> pending;
+    setDepth(slot, depth);
+    pending.enqueue(slot);
+    while (!pending.isEmpty()) {
+        const int current = pending.dequeue();
+        for (int child : m_children.at(current)) {
+            setDepth(child, m_depth.at(current) + 1);
+            pending.enqueue(child);
+        }
+    }
+}
+
+void TaskFilterIndex::setColorBit(QHash<QString, NodeBitset> &index, QVector<QString> &bySlot, int slot,
+                                  const QString &color)
+{
+    const QString previous = bySlot.at(slot);
+    if (!previous.isEmpty()) {
+        auto it = index.find(previous);
+        if (it != index.end()) {
+            it.value().setBit(slot, false);
+        }
+    }
+    bySlot[slot] = color;
+    if (!color.isEmpty()) {
+        index[color].setBit(slot);
+    }
+}
+
+void TaskFilterIndex::detachFromParent(int slot)
+{
+    QString &pendingParent = m_pendingParentBySlot[slot];
+    if (!pendingParent.isEmpty()) {
+        auto it = m_orphansByParentId.find(pendingParent);
+        if (it != m_orphansByParentId.end()) {
+            it->removeOne(m_nodeIds.at(slot));
+            if (it->isEmpty()) {
+                m_orphansByParentId.erase(it);
+            }
+        }
+        pendingParent.clear();
+    }
+
+    const int parentSlot = m_parent.at(slot);
+    if (parentSlot >= 0) {
+        m_children[parentSlot].removeOne(slot);
+    }
+    m_parent[slot] = -1;
+}
@@ -0,0 +1,131 @@
+#ifndef TASKFILTER_H
+#define TASKFILTER_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QVector>
+#include <QtAlgorithms>
+
+#include "nodetypes.h"
+
+// Fixed-width bitset over node slots, word-at-a-time for the bulk ops.
+class NodeBitset
+{
+public:
+    NodeBitset() : m_size(0) {}
+    explicit NodeBitset(int size, bool value = false);
+
+    int size() const { return m_size; }
+    void resize(int size);
+    bool testBit(int index) const { return (m_words.at(index >> 6) >> (index & 63)) & 1; }
+    bool testBitSafe(int index) const { return index >= 0 && index < m_size && testBit(index); }
+    void setBit(int index, bool value = true);
+    int count() const;
+    bool isEmpty() const { return count() == 0; }
+
+    NodeBitset &operator&=(const NodeBitset &other);
+    NodeBitset &operator|=(const NodeBitset &other);
+    NodeBitset &operator^=(const NodeBitset &other);
+    NodeBitset &andNot(const NodeBitset &other);
+    NodeBitset operator&(const NodeBitset &other) const { NodeBitset r(*this); r &= other; return r; }
+    NodeBitset operator|(const NodeBitset &other) const { NodeBitset r(*this); r |= other; return r; }
+    NodeBitset operator^(const NodeBitset &other) const { NodeBitset r(*this); r ^= other; return r; }
+
+    // Visits set bits only, skipping empty words.
+    template <typename Function>
+    void forEachSetBit(Function function) const
+    {
+        for (int w = 0; w < m_words.size(); ++w) {
+            quint64 word = m_words.at(w);
+            while (word) {
+                const int bit = qCountTrailingZeroBits(word);
+                function((w << 6) + bit);
+                word &= word - 1;
+            }
+        }
+    }
+
+private:
+    QVector<quint64> m_words;
+    int m_size;
+
+    void trimTail();
+};
+
+struct TaskFilterQuery {
+    enum TriState { Any, Yes, No };
+
+    TriState completed = Any;
+    TriState hasAttachments = Any;
+    QString highlightColor;     // empty = any
+    QString textColor;          // empty = any
+    int minDepth = -1;          // -1 = no bound
+    int maxDepth = -1;
+    QString subtreeRootId;      // empty = whole map; root itself is included
+
+    bool isEmpty() const;
+};
+
+class TaskFilterIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit TaskFilterIndex(QObject *parent = nullptr);
+    ~TaskFilterIndex();
+
+    // Updates, made by the scene as node records change
+    void addNode(const QString &nodeId, const QString &parentId = QString());
+    void removeNode(const QString &nodeId);
+    void setParent(const QString &nodeId, const QString &parentId);
+    void setCompleted(const QString &nodeId, bool completed);
+    void setFormatting(const QString &nodeId, const TextFormatting &formatting);
+    void setHasAttachments(const QString &nodeId, bool hasAttachments);
+    void clear();
+
+    // Queries
+    NodeBitset evaluate(const TaskFilterQuery &query) const;
+    NodeBitset liveNodes() const { return m_live; }
+    NodeBitset subtree(const QString &rootId) const;
+    QString nodeIdAt(int slot) const { return m_nodeIds.value(slot); }
+    int slotOf(const QString &nodeId) const { return m_slotById.value(nodeId, -1); }
+    QStringList nodeIds(const NodeBitset &bits) const;
+    int capacity() const { return m_nodeIds.size(); }
+
+signals:
+    void changed();
+    void slotReleased(int slot);
+
+private:
+    // Slots
+    QStringList m_nodeIds;
+    QHash<QString, int> m_slotById;
+    QVector<int> m_freeSlots;
+    QVector<int> m_parent;
+    QVector<QVector<int>> m_children;
+    QVector<int> m_depth;
+    QVector<QString> m_highlightBySlot;
+    QVector<QString> m_textColorBySlot;
+    QVector<QString> m_pendingParentBySlot;           // parent id a slot waits for, if not added yet
+    QHash<QString, QStringList> m_orphansByParentId;  // child ids added before their parent
+
+    // Attribute bitsets
+    NodeBitset m_live;
+    NodeBitset m_completed;
+    NodeBitset m_hasAttachments;
+    QHash<QString, NodeBitset> m_highlight;
+    QHash<QString, NodeBitset> m_textColor;
+    QVector<NodeBitset> m_byDepth;
+
+    // Methods
+    int allocateSlot(const QString &nodeId);
+    void grow(int capacity);
+    void setDepth(int slot, int depth);
+    void setSubtreeDepth(int slot, int depth);
+    void setColorBit(QHash<QString, NodeBitset> &index, QVector<QString> &bySlot, int slot, const QString &color);
+    void detachFromParent(int slot); // from the attached or the pending parent
+};
+
+#endif // TASKFILTER_H
@@ -0,0 +1,110 @@
+#include "taskfiltercontroller.h"
+#include "mindmapscene.h"
+
+const qreal TaskFilterController::DIMMED_OPACITY = 0.25;
+
+TaskFilterController::TaskFilterController(MindMapScene *scene, TaskFilterIndex *index, QObject *parent)
+    : QObject(parent)
+    , m_scene(scene)
+    , m_index(index)
+    , m_mode(DimNonMatching)
+    , m_active(false)
+    , m_refreshTimer(nullptr)
+{
+    // Edits arrive one node at a time; re-evaluation is coalesced to once per
+    // event-loop pass.
+    m_refreshTimer = new QTimer(this);
+    m_refreshTimer->setSingleShot(true);
+    m_refreshTimer->setInterval(0);
+    connect(m_refreshTimer, &QTimer::timeout, this, &TaskFilterController::refresh);
+
+    connect(m_index, &TaskFilterIndex::changed, this, &TaskFilterController::onIndexChanged);
+    connect(m_index, &TaskFilterIndex::slotReleased, this, &TaskFilterController::onSlotReleased);
+}
+
+TaskFilterController::~TaskFilterController()
+{
+}
+
+void TaskFilterController::apply(const TaskFilterQuery &query, Mode mode)
+{
+    if (m_active && mode != m_mode) {
+        present(NodeBitset());
+    }
+    m_query = query;
+    m_mode = mode;
+    m_active = !query.isEmpty();
+    refresh();
+}
+
+void TaskFilterController::clearFilter()
+{
+    m_query = TaskFilterQuery();
+    m_active = false;
+    refresh();
+}
+
+void TaskFilterController::onIndexChanged()
+{
+    if (m_active) {
+        m_refreshTimer->start();
+    }
+}
+
+void TaskFilterController::onSlotReleased(int slot)
+{
+    if (slot < m_presented.size()) {
+        m_presented.setBit(slot, false);
+    }
+    if (slot < m_matches.size()) {
+        m_matches.setBit(slot, false);
+    }
+}
+
+void TaskFilterController::refresh()
+{
+    m_refreshTimer->stop();
+
+    if (!m_active) {
+        m_matches = m_index->liveNodes();
+        present(NodeBitset());
+        emit filterApplied(m_matches.count());
+        return;
+    }
+
+    m_matches = m_index->evaluate(m_query);
+    NodeBitset nonMatching = m_index->liveNodes();
+    nonMatching.andNot(m_matches);
+    present(nonMatching);
+    emit filterApplied(m_matches.count());
+}
+
+void TaskFilterController::present(const NodeBitset &nonMatching)
+{
+    // Only items whose state flips are touched; the XOR of the old and new
+    // sets is exactly that list.
+    const NodeBitset flipped = m_presented ^ nonMatching;
+    flipped.forEachSetBit([&](int slot) {
+        presentSlot(slot, !nonMatching.testBitSafe(slot));
+    });
+    m_presented = nonMatching;
+}
+
+void TaskFilterController::presentSlot(int slot, bool matching)
+{
+    if (!m_scene) {
+        return;
+    }
+    MindMapNode *node = m_scene->getNode(m_index->nodeIdAt(slot));
+    if (!node) {
+        return;
+    }
+
+    if (m_mode == HideNonMatching) {
+        node->setVisible(matching);
+        node->setOpacity(1.0);
+    } else {
+        node->setOpacity(matching ? 1.0 : DIMMED_OPACITY);
+        node->setVisible(true);
+    }
+}
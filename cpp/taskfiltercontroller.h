@@ -0,0 +1,65 @@
+#ifndef TASKFILTERCONTROLLER_H
+#define TASKFILTERCONTROLLER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QPointer>
+
+#include "taskfilter.h"
+
+class MindMapScene;
+
+// Presents a TaskFilterIndex query on the scene by dimming or hiding the
+// nodes that don't match. The index lives in the core library; this half
+// needs the scene's widgets.
+class TaskFilterController : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Mode {
+        DimNonMatching,
+        HideNonMatching
+    };
+
+    explicit TaskFilterController(MindMapScene *scene, TaskFilterIndex *index, QObject *parent = nullptr);
+    ~TaskFilterController();
+
+    // Filter control
+    void apply(const TaskFilterQuery &query, Mode mode = DimNonMatching);
+    void clearFilter();
+    bool isActive() const { return m_active; }
+    TaskFilterQuery getQuery() const { return m_query; }
+    NodeBitset getMatches() const { return m_matches; }
+    int matchCount() const { return m_matches.count(); }
+
+signals:
+    void filterApplied(int matchCount);
+
+private slots:
+    void onIndexChanged();
+    void onSlotReleased(int slot);
+    void refresh();
+
+private:
+    // Core components
+    QPointer<MindMapScene> m_scene;
+    TaskFilterIndex *m_index;
+
+    // Filter state
+    TaskFilterQuery m_query;
+    Mode m_mode;
+    bool m_active;
+    NodeBitset m_matches;
+    NodeBitset m_presented;  // slots currently dimmed or hidden in the scene
+    QTimer *m_refreshTimer;
+
+    // Methods
+    void present(const NodeBitset &nonMatching);
+    void presentSlot(int slot, bool matching);
+
+    // Constants
+    static const qreal DIMMED_OPACITY;
+};
+
+#endif // TASKFILTERCONTROLLER_H
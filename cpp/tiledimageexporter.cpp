@@ -0,0 +1,332 @@
+#include "tiledimageexporter.h"
+#include "tracelog.h"
+
+#include <QSaveFile>
+#include <QImage>
+#include <QPainter>
+#include <QQueue>
+#include <QtEndian>
+#include <QtMath>
+
+#include <cstring>
+
+namespace {
+
+// TIFF field types and tags used by the writer
+enum TiffType {
+    TiffShort = 3,
+    TiffLong = 4,
+    TiffRational = 5
+};
+
+struct TiffEntry {
+    quint16 tag;
+    quint16 type;
+    quint32 count;
+    QByteArray data; // little-endian values
+};
+
+QByteArray shorts(std::initializer_list<quint16> values)
+{
+    QByteArray data;
+    for (quint16 value : values) {
+        quint16 le = qToLittleEndian(value);
+        data.append(reinterpret_cast<const char*>(&le), sizeof(le));
+    }
+    return data;
+}
+
+QByteArray longs(const QVector<quint32> &values)
+{
+    QByteArray data(values.size() * int(sizeof(quint32)), Qt::Uninitialized);
+    for (int i = 0; i < values.size(); ++i) {
+        qToLittleEndian(values.at(i), data.data() + i * sizeof(quint32));
+    }
+    return data;
+}
+
+TiffEntry entry(quint16 tag, quint16 type, quint32 count, const QByteArray &data)
+{
+    TiffEntry result;
+    result.tag = tag;
+    result.type = type;
+    result.count = count;
+    result.data = data;
+    return result;
+}
+
+// Writes the directory at the current (even) position: entry count,
+// entries sorted by tag, next-IFD offset, then values too large to inline.
+bool writeDirectory(QFileDevice &file, const QVector<TiffEntry> &entries)
+{
+    const quint32 directoryOffset = quint32(file.pos());
+    quint32 dataOffset = directoryOffset + 2 + entries.size() * 12 + 4;
+
+    QByteArray directory;
+    QByteArray overflow;
+    directory.append(shorts({quint16(entries.size())}));
+    for (const TiffEntry &e : entries) {
+        directory.append(shorts({e.tag, e.type}));
+        directory.append(longs({e.count}));
+        if (e.data.size() <= 4) {
+            directory.append(e.data.leftJustified(4, '\0'));
+        } else {
+            directory.append(longs({dataOffset + quint32(overflow.size())}));
+            overflow.append(e.data);
+            if (overflow.size() % 2) {
+                overflow.append('\0');
+            }
+        }
+    }
+    directory.append(longs({0}));
+
+    if (file.write(directory) != directory.size() || file.write(overflow) != overflow.size()) {
+        return false;
+    }
+
+    // Point the header at the directory
+    file.seek(4);
+    const QByteArray offset = longs({directoryOffset});
+    return file.write(offset) == offset.size();
+}
+
+} // namespace
+
+TiledImageExporter::TiledImageExporter(QObject *parent)
+    : QObject(parent)
+    , m_running(false)
+    , m_cancelRequested(false)
+{
+    m_driverPool.setMaxThreadCount(1);
+    m_workerPool.setMaxThreadCount(qMax(1, QThread::idealThreadCount()));
+}
+
+TiledImageExporter::~TiledImageExporter()
+{
+    cancel();
+    waitForFinished();
+}
+
+bool TiledImageExporter::start(const PersistentNodeStore &snapshot, const QRectF &sceneArea, int dpi, const QString &filePath)
+{
+    if (m_running.load() || sceneArea.isEmpty() || dpi <= 0) {
+        return false;
+    }
+
+    const Job job = makeJob(sceneArea, dpi, filePath);
+    m_running.store(true);
+    m_cancelRequested.store(false);
+
+    // The renderer indexes the snapshot, which is O(n); do it off the GUI thread.
+    m_future = QtConcurrent::run(&m_driverPool, [this, job, snapshot]() mutable {
+        job.renderer.reset(new SnapshotRenderer(snapshot));
+        run(job);
+    });
+    return true;
+}
+
+bool TiledImageExporter::writeImage(const PersistentNodeStore &snapshot, const QRectF &sceneArea, int dpi,
+                                    const QString &filePath, QString *message)
+{
+    if (sceneArea.isEmpty() || dpi <= 0) {
+        *message = "Nothing to export";
+        return false;
+    }
+    bool idle = false;
+    if (!m_running.compare_exchange_strong(idle, true)) {
+        *message = "An export is already running";
+        return false;
+    }
+    m_cancelRequested.store(false);
+
+    Job job = makeJob(sceneArea, dpi, filePath);
+    job.renderer.reset(new SnapshotRenderer(snapshot));
+    const bool success = execute(job, message);
+    m_running.store(false);
+    return success;
+}
+
+void TiledImageExporter::cancel()
+{
+    m_cancelRequested.store(true);
+}
+
+void TiledImageExporter::waitForFinished()
+{
+    m_future.waitForFinished();
+}
+
+QSize TiledImageExporter::outputSize(const QRectF &sceneArea, int dpi)
+{
+    const qreal scale = qreal(dpi) / SCREEN_DPI;
+    return QSize(qCeil(sceneArea.width() * scale), qCeil(sceneArea.height() * scale));
+}
+
+TiledImageExporter::Job TiledImageExporter::makeJob(const QRectF &sceneArea, int dpi, const QString &filePath)
+{
+    Job job;
+    job.sceneArea = sceneArea;
+    job.dpi = dpi;
+    job.scale = qreal(dpi) / SCREEN_DPI;
+    job.size = outputSize(sceneArea, dpi);
+    job.filePath = filePath;
+    return job;
+}
+
+void TiledImageExporter::run(const Job &job)
+{
+    QString message;
+    const bool success = execute(job, &message);
+    m_running.store(false);
+    QMetaObject::invokeMethod(this, [this, success, message]() {
+        emit finished(success, message);
+    }, Qt::QueuedConnection);
+}
+
+bool TiledImageExporter::execute(const Job &job, QString *message)
+{
+    QString error;
+    const bool success = writeTiles(job, &error);
+    *message = success
+        ? QString("Exported %1 x %2 px").arg(job.size.width()).arg(job.size.height())
+        : error;
+    return success;
+}
+
+bool TiledImageExporter::writeTiles(const Job &job, QString *error)
+{
+    TRACE_SCOPE("TiledImageExporter::writeTiles");
+    // Written to a temporary file and renamed over the target on commit(),
+    // so a cancelled or failed export keeps the previous file intact.
+    QSaveFile file(job.filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        *error = file.errorString();
+        return false;
+    }
+
+    // Header: little-endian, magic 42, directory offset patched at the end
+    file.write("II");
+    file.write(shorts({42}));
+    file.write(longs({0}));
+
+    const int columns = (job.size.width() + TILE_SIZE - 1) / TILE_SIZE;
+    const int rows = (job.size.height() + TILE_SIZE - 1) / TILE_SIZE;
+    const int total = columns * rows;
+    const int maxInFlight = m_workerPool.maxThreadCount() * TILES_IN_FLIGHT_PER_THREAD;
+
+    QVector<quint32> offsets(total);
+    QVector<quint32> byteCounts(total);
+    QQueue<QFuture<QByteArray>> inFlight;
+    int next = 0;
+    bool ok = true;
+
+    // Tiles are rendered out of order but written in order; the window of
+    // futures bounds how many finished tiles wait in memory.
+    for (int written = 0; written < total; ++written) {
+        while (next < total && inFlight.size() < maxInFlight) {
+            const int column = next % columns;
+            const int row = next / columns;
+            inFlight.enqueue(QtConcurrent::run(&m_workerPool, [job, column, row]() {
+                return renderTile(job, column, row);
+            }));
+            next++;
+        }
+
+        const QByteArray tile = inFlight.dequeue().result();
+        if (m_cancelRequested.load()) {
+            *error = "Export cancelled";
+            ok = false;
+            break;
+        }
+        if (file.pos() + tile.size() > qint64(0xFFFFFFFE)) {
+            *error = "Compressed image exceeds the 4 GB TIFF limit; export at a lower resolution";
+            ok = false;
+            break;
+        }
+
+        offsets[written] = quint32(file.pos());
+        byteCounts[written] = quint32(tile.size());
+        if (file.write(tile) != tile.size()) {
+            *error = file.errorString();
+            ok = false;
+            break;
+        }
+        if (tile.size() % 2) {
+            file.write("\0", 1); // keep offsets word-aligned
+        }
+
+        if (written % columns == columns - 1 || written == total - 1) {
+            report(written + 1, total);
+        }
+    }
+
+    while (!inFlight.isEmpty()) {
+        inFlight.dequeue().waitForFinished();
+    }
+    if (!ok) {
+        return false;
+    }
+
+    // Resolution as a rational: dpi / 1
+    QByteArray resolution = longs({quint32(job.dpi), 1});
+
+    QVector<TiffEntry> entries;
+    entries.append(entry(256, TiffLong, 1, longs({quint32(job.size.width())})));   // ImageWidth
+    entries.append(entry(257, TiffLong, 1, longs({quint32(job.size.height())})));  // ImageLength
+    entries.append(entry(258, TiffShort, 4, shorts({8, 8, 8, 8})));                 // BitsPerSample
+    entries.append(entry(259, TiffShort, 1, shorts({8})));                          // Compression: Deflate
+    entries.append(entry(262, TiffShort, 1, shorts({2})));                          // Photometric: RGB
+    entries.append(entry(277, TiffShort, 1, shorts({4})));                          // SamplesPerPixel
+    entries.append(entry(282, TiffRational, 1, resolution));                        // XResolution
+    entries.append(entry(283, TiffRational, 1, resolution));                        // YResolution
+    entries.append(entry(284, TiffShort, 1, shorts({1})));                          // PlanarConfiguration: chunky
+    entries.append(entry(296, TiffShort, 1, shorts({2})));                          // ResolutionUnit: inch
+    entries.append(entry(322, TiffLong, 1, longs({quint32(TILE_SIZE)})));           // TileWidth
+    entries.append(entry(323, TiffLong, 1, longs({quint32(TILE_SIZE)})));           // TileLength
+    entries.append(entry(324, TiffLong, quint32(total), longs(offsets)));           // TileOffsets
+    entries.append(entry(325, TiffLong, quint32(total), longs(byteCounts)));        // TileByteCounts
+    entries.append(entry(338, TiffShort, 1, shorts({1})));                          // ExtraSamples: premultiplied alpha
+
+    if (file.pos() % 2) {
+        file.write("\0", 1);
+    }
+    if (!writeDirectory(file, entries) || !file.commit()) {
+        *error = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+QByteArray TiledImageExporter::renderTile(const Job &job, int column, int row)
+{
+    TRACE_SCOPE("TiledImageExporter::renderTile");
+    QImage image(TILE_SIZE, TILE_SIZE, QImage::Format_RGBA8888_Premultiplied);
+    image.fill(job.renderer->getBackground());
+
+    // Tile pixel (0, 0) is scene point origin; edge tiles overhang the image
+    // and TIFF readers ignore the excess.
+    const QPointF origin = job.sceneArea.topLeft() + QPointF(column, row) * (TILE_SIZE / job.scale);
+    const qreal span = TILE_SIZE / job.scale;
+    {
+        QPainter painter(&image);
+        painter.scale(job.scale, job.scale);
+        painter.translate(-origin);
+        job.renderer->render(&painter, QRectF(origin, QSizeF(span, span)));
+    }
+
+    // Rows without scanline padding, then zlib. qCompress prefixes the
+    // uncompressed length, which is not part of a TIFF Deflate stream.
+    const int rowBytes = TILE_SIZE * 4;
+    QByteArray raw(rowBytes * TILE_SIZE, Qt::Uninitialized);
+    for (int y = 0; y < TILE_SIZE; ++y) {
+        memcpy(raw.data() + y * rowBytes, image.constScanLine(y), rowBytes);
+    }
+    return qCompress(raw, COMPRESSION_LEVEL).mid(4);
+}
+
+void TiledImageExporter::report(int tilesDone, int tilesTotal)
+{
+    QMetaObject::invokeMethod(this, [this, tilesDone, tilesTotal]() {
+        emit progress(tilesDone, tilesTotal);
+    }, Qt::QueuedConnection);
+}
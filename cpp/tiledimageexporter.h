@@ -0,0 +1,86 @@
+#ifndef TILEDIMAGEEXPORTER_H
+#define TILEDIMAGEEXPORTER_H
+
+#include <QObject>
+#include <QString>
+#include <QRectF>
+#include <QByteArray>
+#include <QSharedPointer>
+#include <QThreadPool>
+#include <QFuture>
+#include <QtConcurrent>
+
+#include <atomic>
+
+#include "persistentnodestore.h"
+#include "snapshotrenderer.h"
+
+// Exports a map snapshot as a tiled, Deflate-compressed TIFF of any size.
+// Tiles are painted into small QImages on a worker pool and written to the
+// file in order as they complete, so peak memory is a few tiles regardless
+// of the output resolution. The image file directory goes at the end, once
+// every tile's offset is known.
+class TiledImageExporter : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit TiledImageExporter(QObject *parent = nullptr);
+    ~TiledImageExporter();
+
+    // Renders sceneArea of the snapshot at dpi (96 = one pixel per scene
+    // unit) into filePath. Returns false if an export is already running.
+    bool start(const PersistentNodeStore &snapshot, const QRectF &sceneArea, int dpi, const QString &filePath);
+    void cancel();
+    void waitForFinished();
+
+    // Blocking variant for callers without an event loop (command-line
+    // mode). Tiles still render on the worker pool; finished is not emitted.
+    bool writeImage(const PersistentNodeStore &snapshot, const QRectF &sceneArea, int dpi,
+                    const QString &filePath, QString *message);
+    bool isRunning() const { return m_running.load(); }
+
+    // Tile render threads; one per core by default. Callers running several
+    // exports at once should split the cores between them.
+    void setWorkerCount(int count) { m_workerPool.setMaxThreadCount(qMax(1, count)); }
+
+    // Output size in pixels for the given area and resolution
+    static QSize outputSize(const QRectF &sceneArea, int dpi);
+
+signals:
+    void progress(int tilesDone, int tilesTotal);
+    void finished(bool success, const QString &message);
+
+private:
+    struct Job {
+        QSharedPointer<const SnapshotRenderer> renderer;
+        QRectF sceneArea;
+        qreal scale = 1.0;
+        int dpi = 96;
+        QSize size;
+        QString filePath;
+    };
+
+    // Threads
+    QThreadPool m_driverPool;
+    QThreadPool m_workerPool;
+    QFuture<void> m_future;
+    std::atomic<bool> m_running;
+    std::atomic<bool> m_cancelRequested;
+
+    // Methods
+    static Job makeJob(const QRectF &sceneArea, int dpi, const QString &filePath);
+    void run(const Job &job);
+    bool execute(const Job &job, QString *message);
+    bool writeTiles(const Job &job, QString *error);
+    static QByteArray renderTile(const Job &job, int column, int row);
+    void report(int tilesDone, int tilesTotal);
+
+    // Constants
+    static const int TILE_SIZE = 256;          // pixels; TIFF requires a multiple of 16
+    static const int TILES_IN_FLIGHT_PER_THREAD = 2;
+    static const int COMPRESSION_LEVEL = 6;
+    static const int SCREEN_DPI = 96;
+};
+
+#endif // TILEDIMAGEEXPORTER_H
@@ -0,0 +1,239 @@
+#include "tracelog.h"
+
+#include <QCoreApplication>
+#include <QThread>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QList>
+#include <QVector>
+#include <QSharedPointer>
+#include <QSaveFile>
+#include <QTextStream>
+
+#include <limits>
+
+const char TraceLog::ENVIRONMENT_VARIABLE[] = "MIND2DO_TRACE";
+
+std::atomic<bool> TraceLog::s_enabled(false);
+std::atomic<qint64> TraceLog::s_clearedAt(0);
+
+// Single writer (the owning thread), any number of readers. Fields are
+// atomics so a reader racing the writer sees a torn event at worst, which
+// the claimed/head check in writeChromeTrace() throws away.
+struct TraceLog::ThreadBuffer {
+    struct Event {
+        std::atomic<const char *> name;
+        std::atomic<qint64> begin;
+        std::atomic<qint64> end;
+    };
+
+    Event events[RING_CAPACITY];
+    std::atomic<quint64> claimed{0};    // slots a write has started on
+    std::atomic<quint64> head{0};       // slots fully written
+    std::atomic<bool> retired{false};   // owning thread has exited
+    int threadId = 0;
+    QString threadName;
+};
+
+namespace {
+
+struct Registry {
+    QMutex mutex;
+    QList<QSharedPointer<TraceLog::ThreadBuffer>> buffers;
+    int nextThreadId = 1;
+};
+
+Registry& registry()
+{
+    static Registry instance;
+    return instance;
+}
+
+// Marks the thread's buffer retired when the thread exits; the registry
+// keeps the buffer, and its events, until it is pruned.
+struct ThreadSlot {
+    TraceLog::ThreadBuffer *buffer = nullptr;
+    ~ThreadSlot()
+    {
+        if (buffer) {
+            buffer->retired.store(true);
+        }
+    }
+};
+
+thread_local ThreadSlot t_slot;
+
+struct CopiedEvent {
+    const char *name;
+    qint64 begin;
+    qint64 end;
+};
+
+QString jsonString(const QString &text)
+{
+    QString escaped = text;
+    escaped.replace('\\', "\\\\").replace('"', "\\\"");
+    return '"' + escaped + '"';
+}
+
+QString microseconds(qint64 nanoseconds)
+{
+    return QString::number(nanoseconds / 1000.0, 'f', 3);
+}
+
+} // namespace
+
+void TraceLog::setEnabled(bool enabled)
+{
+    s_enabled.store(enabled);
+}
+
+void TraceLog::clear()
+{
+    s_clearedAt.store(now());
+}
+
+void TraceLog::record(const char *name, qint64 beginNs, qint64 endNs)
+{
+    ThreadBuffer *buffer = t_slot.buffer;
+    if (!buffer) {
+        buffer = registerThread();
+        t_slot.buffer = buffer;
+    }
+
+    // Seqlock-style publish: claim the slot, write it, then advance head.
+    const quint64 index = buffer->head.load(std::memory_order_relaxed);
+    buffer->claimed.store(index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    ThreadBuffer::Event &event = buffer->events[index & (RING_CAPACITY - 1)];
+    event.name.store(name, std::memory_order_relaxed);
+    event.begin.store(beginNs, std::memory_order_relaxed);
+    event.end.store(endNs, std::memory_order_relaxed);
+    buffer->head.store(index + 1, std::memory_order_release);
+}
+
+TraceLog::ThreadBuffer* TraceLog::registerThread()
+{
+    QSharedPointer<ThreadBuffer> buffer(new ThreadBuffer);
+
+    QThread *thread = QThread::currentThread();
+    const QCoreApplication *app = QCoreApplication::instance();
+    QString name = app && thread == app->thread() ? QString("Main") : thread->objectName();
+    if (name.isEmpty()) {
+        name = "Thread";
+    }
+    buffer->threadName = QString("%1 (%2)").arg(name).arg(quintptr(QThread::currentThreadId()));
+
+    Registry &reg = registry();
+    QMutexLocker locker(&reg.mutex);
+    buffer->threadId = reg.nextThreadId++;
+    reg.buffers.append(buffer);
+
+    // Pool threads come and go; keep only the most recent exited ones.
+    int retired = 0;
+    for (int i = reg.buffers.size() - 1; i >= 0; --i) {
+        if (reg.buffers.at(i)->retired.load() && ++retired > MAX_RETIRED_THREADS) {
+            reg.buffers.removeAt(i);
+        }
+    }
+    return buffer.data();
+}
+
+bool TraceLog::writeChromeTrace(const QString &filePath, QString *error)
+{
+    QList<QSharedPointer<ThreadBuffer>> buffers;
+    {
+        Registry &reg = registry();
+        QMutexLocker locker(&reg.mutex);
+        buffers = reg.buffers;
+    }
+
+    // Copy each ring without stopping its writer, then drop whatever the
+    // writer may have overwritten while we were copying.
+    const qint64 clearedAt = s_clearedAt.load();
+    const quint64 capacity = RING_CAPACITY;
+    QVector<QVector<CopiedEvent>> copies(buffers.size());
+    qint64 origin = std::numeric_limits<qint64>::max();
+    for (int b = 0; b < buffers.size(); ++b) {
+        ThreadBuffer *buffer = buffers.at(b).data();
+        const quint64 head = buffer->head.load(std::memory_order_acquire);
+        const quint64 first = head > capacity ? head - capacity : 0;
+
+        QVector<CopiedEvent> events;
+        events.reserve(int(head - first));
+        for (quint64 index = first; index < head; ++index) {
+            const ThreadBuffer::Event &event = buffer->events[index & (capacity - 1)];
+            events.append({event.name.load(std::memory_order_relaxed),
+                           event.begin.load(std::memory_order_relaxed),
+                           event.end.load(std::memory_order_relaxed)});
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const quint64 claimed = buffer->claimed.load(std::memory_order_relaxed);
+        const quint64 stable = claimed > capacity ? claimed - capacity : 0;
+        if (stable > first) {
+            events.remove(0, int(qMin(stable - first, quint64(events.size()))));
+        }
+
+        for (const CopiedEvent &event : events) {
+            if (event.begin >= clearedAt) {
+                copies[b].append(event);
+                origin = qMin(origin, event.begin);
+            }
+        }
+    }
+
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        *error = QString("Cannot write %1: %2").arg(filePath, file.errorString());
+        return false;
+    }
+
+    const qint64 pid = QCoreApplication::applicationPid();
+    QTextStream out(&file);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << pid
+        << ",\"tid\":0,\"args\":{\"name\":\"Mind2Do\"}}";
+    for (int b = 0; b < buffers.size(); ++b) {
+        const ThreadBuffer *buffer = buffers.at(b).data();
+        if (copies.at(b).isEmpty()) {
+            continue;
+        }
+        out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << buffer->threadId
+            << ",\"args\":{\"name\":" << jsonString(buffer->threadName) << "}}";
+        for (const CopiedEvent &event : copies.at(b)) {
+            out << ",\n{\"name\":" << jsonString(QString::fromLatin1(event.name))
+                << ",\"cat\":\"mind2do\",\"ph\":\"X\",\"pid\":" << pid << ",\"tid\":" << buffer->threadId
+                << ",\"ts\":" << microseconds(event.begin - origin)
+                << ",\"dur\":" << microseconds(event.end - event.begin) << "}";
+        }
+    }
+    out << "\n]}\n";
+    out.flush();
+
+    if (!file.commit()) {
+        *error = QString("Cannot write %1: %2").arg(filePath, file.errorString());
+        return false;
+    }
+    return true;
+}
+
+void TraceLog::startFromEnvironment()
+{
+    if (qEnvironmentVariableIsEmpty(ENVIRONMENT_VARIABLE)) {
+        return;
+    }
+    clear();
+    setEnabled(true);
+    qAddPostRoutine(&TraceLog::writeEnvironmentTrace);
+}
+
+void TraceLog::writeEnvironmentTrace()
+{
+    setEnabled(false);
+    QString error;
+    if (!writeChromeTrace(qEnvironmentVariable(ENVIRONMENT_VARIABLE), &error)) {
+        qWarning("%s", qPrintable(error));
+    }
+}
@@ -0,0 +1,102 @@
+#ifndef TRACELOG_H
+#define TRACELOG_H
+
+#include <QString>
+#include <QStringList>
+
+#include <atomic>
+#include <chrono>
+
+// Scoped trace markers for diagnosing stalls, written out in the Chrome
+// trace-event format (chrome://tracing, ui.perfetto.dev).
+//
+//     void MindMapScene::saveMindMap(const QString &filePath)
+//     {
+//         TRACE_SCOPE("saveMindMap");
+//         ...
+//     }
+//
+// While recording is off a marker costs one relaxed atomic load. While on,
+// each thread appends complete events to its own fixed-size ring buffer
+// with no locks; the oldest events are overwritten once a buffer is full,
+// so the trace always holds the most recent activity. Names must be string
+// literals (only the pointer is stored).
+//
+// Recording starts from the Help menu, or for a whole run by setting
+// MIND2DO_TRACE=<file.json>; the trace is then written there on exit.
+// Define MIND2DO_NO_TRACE to compile the markers out entirely.
+class TraceLog
+{
+public:
+    static bool isEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+    static void setEnabled(bool enabled);
+
+    // Forgets everything recorded so far; safe while other threads record.
+    static void clear();
+
+    // Writes every thread's buffered events as a Chrome trace JSON file.
+    static bool writeChromeTrace(const QString &filePath, QString *error);
+
+    // Starts recording if MIND2DO_TRACE is set and writes the trace to
+    // that path when the application object is destroyed. Call once the
+    // QCoreApplication exists.
+    static void startFromEnvironment();
+
+    static qint64 now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+    static void record(const char *name, qint64 beginNs, qint64 endNs);
+
+    struct ThreadBuffer;    // one thread's ring, defined in tracelog.cpp
+
+    // Constants
+    static const int RING_CAPACITY = 32768;     // events per thread, a power of two
+    static const int MAX_RETIRED_THREADS = 32;  // buffers kept after their thread exits
+    static const char ENVIRONMENT_VARIABLE[];
+
+private:
+    // Methods
+    static ThreadBuffer* registerThread();
+    static void writeEnvironmentTrace();
+
+    static std::atomic<bool> s_enabled;
+    static std::atomic<qint64> s_clearedAt;
+};
+
+// One complete event from construction to destruction
+class TraceScope
+{
+public:
+    explicit TraceScope(const char *name)
+        : m_name(TraceLog::isEnabled() ? name : nullptr)
+        , m_begin(m_name ? TraceLog::now() : 0)
+    {
+    }
+
+    ~TraceScope()
+    {
+        if (m_name) {
+            TraceLog::record(m_name, m_begin, TraceLog::now());
+        }
+    }
+
+    TraceScope(const TraceScope &) = delete;
+    TraceScope& operator=(const TraceScope &) = delete;
+
+private:
+    const char *m_name;
+    qint64 m_begin;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+#ifdef MIND2DO_NO_TRACE
+#define TRACE_SCOPE(name) do {} while (false)
+#else
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope_, __LINE__)(name)
+#endif
+
+#endif // TRACELOG_H
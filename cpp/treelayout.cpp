@@ -0,0 +1,693 @@
+#include "treelayout.h"
+
+#include <QElapsedTimer>
+#include <QtMath>
+
+#include <limits>
+
+const int TreeLayoutEngine::VIRTUAL_ROOT;
+const double TreeLayoutEngine::SIBLING_GAP = 24.0;
+const double TreeLayoutEngine::SUBTREE_GAP = 48.0;
+const double TreeLayoutEngine::LEVEL_GAP = 80.0;
+const double TreeLayoutEngine::CONTOUR_EPSILON = 0.01;
+
+TreeLayoutEngine::TreeLayoutEngine()
+    : m_fullOutput(true)
+    , m_style(LeftRight)
+    , m_lastVisited(0)
+    , m_lastNsecs(0)
+{
+    clear();
+}
+
+void TreeLayoutEngine::addNode(const QString &nodeId, const QString &parentId, const QSizeF &size)
+{
+    if (m_indexById.contains(nodeId)) {
+        setParent(nodeId, parentId);
+        setNodeSize(nodeId, size);
+        return;
+    }
+
+    const int index = allocateNode(nodeId);
+    m_nodes[index].size = size;
+
+    int parentIndex = m_indexById.value(parentId, VIRTUAL_ROOT);
+    if (!parentId.isEmpty() && parentIndex == VIRTUAL_ROOT) {
+        m_nodes[index].pendingParent = parentId;
+        m_orphansByParentId[parentId].append(index);
+    }
+    markDirty(parentIndex);
+    attach(index, parentIndex);
+
+    // Children added before this node move from the virtual root under it.
+    const QVector<int> orphans = m_orphansByParentId.take(nodeId);
+    for (int child : orphans) {
+        Node &orphan = m_nodes[child];
+        if (!orphan.live || orphan.pendingParent != nodeId) {
+            continue;
+        }
+        orphan.pendingParent.clear();
+        markDirty(orphan.parent);
+        detach(child);
+        attach(child, index);
+    }
+}
+
+void TreeLayoutEngine::removeNode(const QString &nodeId)
+{
+    const int index = m_indexById.value(nodeId, -1);
+    if (index < 0) {
+        return;
+    }
+
+    m_pending.remove(index);
+    markDirty(m_nodes.at(index).parent);
+
+    // Children become roots until a node with this id shows up again.
+    const QVector<int> children = m_nodes.at(index).children;
+    if (!children.isEmpty()) {
+        markDirty(VIRTUAL_ROOT);
+    }
+    for (int child : children) {
+        detach(child);
+        attach(child, VIRTUAL_ROOT);
+        m_nodes[child].pendingParent = nodeId;
+        m_orphansByParentId[nodeId].append(child);
+    }
+
+    Node &node = m_nodes[index];
+    if (!node.pendingParent.isEmpty()) {
+        m_orphansByParentId[node.pendingParent].removeOne(index);
+    }
+    detach(index);
+    node = Node();
+    m_indexById.remove(nodeId);
+    m_freeIndices.append(index);
+}
+
+void TreeLayoutEngine::setParent(const QString &nodeId, const QString &parentId)
+{
+    const int index = m_indexById.value(nodeId, -1);
+    if (index < 0) {
+        return;
+    }
+    const int parentIndex = m_indexById.value(parentId, VIRTUAL_ROOT);
+    Node &node = m_nodes[index];
+    if (node.parent == parentIndex && (parentIndex != VIRTUAL_ROOT || node.pendingParent == parentId)) {
+        return;
+    }
+
+    // Refuse to hang a node below its own descendant.
+    for (int ancestor = parentIndex; ancestor != VIRTUAL_ROOT; ancestor = m_nodes.at(ancestor).parent) {
+        if (ancestor == index) {
+            return;
+        }
+    }
+
+    if (!node.pendingParent.isEmpty()) {
+        m_orphansByParentId[node.pendingParent].removeOne(index);
+        node.pendingParent.clear();
+    }
+    if (!parentId.isEmpty() && parentIndex == VIRTUAL_ROOT) {
+        node.pendingParent = parentId;
+        m_orphansByParentId[parentId].append(index);
+    }
+
+    markDirty(node.parent);
+    markDirty(parentIndex);
+    detach(index);
+    attach(index, parentIndex);
+}
+
+void TreeLayoutEngine::setNodeSize(const QString &nodeId, const QSizeF &size)
+{
+    const int index = m_indexById.value(nodeId, -1);
+    if (index < 0 || m_nodes.at(index).size == size) {
+        return;
+    }
+    // A node's size only affects how it packs against its siblings, so the
+    // parent's subtree is the smallest one that can change.
+    markDirty(m_nodes.at(index).parent);
+    m_nodes[index].size = size;
+}
+
+void TreeLayoutEngine::clear()
+{
+    m_nodes.clear();
+    m_indexById.clear();
+    m_freeIndices.clear();
+    m_orphansByParentId.clear();
+    m_pending.clear();
+    m_committed.clear();
+    m_levelOffsets.clear();
+
+    Node root;
+    root.live = true;
+    root.placed = true;
+    root.level = -1;
+    m_nodes.append(root);
+    m_fullOutput = true;
+}
+
+void TreeLayoutEngine::setStyle(Style style)
+{
+    if (m_style == style) {
+        return;
+    }
+    m_style = style;
+    // Breadth sizes depend on the orientation, so every contour changes.
+    m_pending.clear();
+    m_pending.insert(VIRTUAL_ROOT, Contour());
+    m_fullOutput = true;
+}
+
+void TreeLayoutEngine::setOrigin(const QPointF &origin)
+{
+    if (m_origin == origin) {
+        return;
+    }
+    m_origin = origin;
+    m_fullOutput = true;
+}
+
+QHash<QString, QPointF> TreeLayoutEngine::relayout()
+{
+    QElapsedTimer timer;
+    timer.start();
+    m_lastVisited = 0;
+    m_committed.clear();
+
+    QSet<int> committedRoots;
+    const QList<int> dirtyRoots = m_pending.keys();
+    for (int dirty : dirtyRoots) {
+        if (hasPendingAncestor(dirty) || isCovered(dirty, committedRoots)) {
+            continue;
+        }
+
+        int root = dirty;
+        Contour before = m_pending.value(dirty);
+        QVector<int> order;
+        forever {
+            order.clear();
+            collectSubtree(root, order);
+            walk(root, order);
+            m_lastVisited += order.size();
+
+            // An unchanged outline cannot move anything outside this subtree.
+            if (root == VIRTUAL_ROOT || sameContour(before, walkedContour(root, order))) {
+                break;
+            }
+            // Once the climb covers most of the map, walking each remaining
+            // ancestor separately costs more than one walk of everything.
+            root = m_nodes.at(root).parent;
+            if (m_nodes.at(root).subtreeSize * 2 > m_nodes.at(VIRTUAL_ROOT).subtreeSize) {
+                root = VIRTUAL_ROOT;
+            }
+            before = committedContour(root);
+        }
+
+        const double base = m_nodes.at(root).breadth;
+        for (int v : order) {
+            Node &node = m_nodes[v];
+            node.breadth = base + node.relative;
+            node.placedSize = node.size;
+            node.placed = true;
+            m_committed.insert(v);
+        }
+        committedRoots.insert(root);
+    }
+    m_pending.clear();
+
+    const bool levelsChanged = updateLevelOffsets();
+    const bool everything = m_fullOutput || levelsChanged || m_style == Radial;
+
+    double breadthMin = 0.0;
+    double breadthSpan = 1.0;
+    double ringSpacing = 0.0;
+    if (m_style == Radial) {
+        double low = std::numeric_limits<double>::max();
+        double high = std::numeric_limits<double>::lowest();
+        double depthExtent = 0.0;
+        int maxLevel = 1;
+        for (int i = 1; i < m_nodes.size(); ++i) {
+            const Node &node = m_nodes.at(i);
+            if (!node.live) {
+                continue;
+            }
+            const double half = breadthSize(node.size) / 2.0;
+            low = qMin(low, node.breadth - half);
+            high = qMax(high, node.breadth + half);
+            depthExtent = qMax(depthExtent, depthSize(node.size));
+            maxLevel = qMax(maxLevel, node.level + 1);
+        }
+        if (high > low) {
+            breadthMin = low;
+            breadthSpan = high - low + SUBTREE_GAP;
+        }
+        // The outer ring must be long enough to hold the whole breadth.
+        ringSpacing = qMax(depthExtent + LEVEL_GAP, breadthSpan / (2.0 * M_PI * maxLevel));
+    }
+
+    QHash<QString, QPointF> changed;
+    auto emitNode = [&](int index) {
+        Node &node = m_nodes[index];
+        if (index == VIRTUAL_ROOT || !node.live) {
+            return;
+        }
+        const QPointF position = placeNode(node, breadthMin, breadthSpan, ringSpacing);
+        if (position != node.position) {
+            node.position = position;
+            changed.insert(node.id, position);
+        }
+    };
+    if (everything) {
+        for (int i = 1; i < m_nodes.size(); ++i) {
+            emitNode(i);
+        }
+    } else {
+        for (int index : m_committed) {
+            emitNode(index);
+        }
+    }
+    m_fullOutput = false;
+
+    m_lastNsecs = timer.nsecsElapsed();
+    return changed;
+}
+
+QHash<QString, QPointF> TreeLayoutEngine::layoutAll()
+{
+    m_pending.clear();
+    m_pending.insert(VIRTUAL_ROOT, Contour());
+    m_fullOutput = true;
+    return relayout();
+}
+
+QPointF TreeLayoutEngine::position(const QString &nodeId) const
+{
+    const int index = m_indexById.value(nodeId, -1);
+    return index < 0 ? QPointF() : m_nodes.at(index).position;
+}
+
+int TreeLayoutEngine::allocateNode(const QString &nodeId)
+{
+    int index;
+    if (!m_freeIndices.isEmpty()) {
+        index = m_freeIndices.takeLast();
+    } else {
+        index = m_nodes.size();
+        m_nodes.append(Node());
+    }
+    m_nodes[index].id = nodeId;
+    m_nodes[index].live = true;
+    m_indexById.insert(nodeId, index);
+    return index;
+}
+
+void TreeLayoutEngine::attach(int index, int parentIndex)
+{
+    m_nodes[index].parent = parentIndex;
+    m_nodes[parentIndex].children.append(index);
+    addToSubtreeSizes(parentIndex, m_nodes.at(index).subtreeSize);
+    setSubtreeLevel(index, m_nodes.at(parentIndex).level + 1);
+}
+
+void TreeLayoutEngine::detach(int index)
+{
+    const int parentIndex = m_nodes.at(index).parent;
+    if (parentIndex >= 0) {
+        m_nodes[parentIndex].children.removeOne(index);
+        addToSubtreeSizes(parentIndex, -m_nodes.at(index).subtreeSize);
+    }
+    m_nodes[index].parent = -1;
+}
+
+void TreeLayoutEngine::addToSubtreeSizes(int index, int delta)
+{
+    for (int current = index; current >= 0; current = m_nodes.at(current).parent) {
+        m_nodes[current].subtreeSize += delta;
+    }
+}
+
+void TreeLayoutEngine::setSubtreeLevel(int index, int level)
+{
+    if (m_nodes.at(index).level == level && m_nodes.at(index).placed) {
+        return;
+    }
+    QVector<int> stack;
+    stack.append(index);
+    m_nodes[index].level = level;
+    while (!stack.isEmpty()) {
+        const int current = stack.takeLast();
+        for (int child : m_nodes.at(current).children) {
+            m_nodes[child].level = m_nodes.at(current).level + 1;
+            stack.append(child);
+        }
+    }
+}
+
+void TreeLayoutEngine::markDirty(int index)
+{
+    if (index < 0) {
+        index = VIRTUAL_ROOT;
+    }
+    if (m_pending.contains(index) || hasPendingAncestor(index)) {
+        return;
+    }
+    m_pending.insert(index, index == VIRTUAL_ROOT ? Contour() : committedContour(index));
+}
+
+bool TreeLayoutEngine::hasPendingAncestor(int index) const
+{
+    for (int ancestor = m_nodes.at(index).parent; ancestor >= 0; ancestor = m_nodes.at(ancestor).parent) {
+        if (m_pending.contains(ancestor)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool TreeLayoutEngine::isCovered(int index, const QSet<int> &roots) const
+{
+    for (int current = index; current >= 0; current = m_nodes.at(current).parent) {
+        if (roots.contains(current)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void TreeLayoutEngine::collectSubtree(int root, QVector<int> &order) const
+{
+    // Preorder, children in their stored order.
+    QVector<int> stack;
+    stack.append(root);
+    while (!stack.isEmpty()) {
+        const int current = stack.takeLast();
+        order.append(current);
+        const QVector<int> &children = m_nodes.at(current).children;
+        for (int i = children.size() - 1; i >= 0; --i) {
+            stack.append(children.at(i));
+        }
+    }
+}
+
+void TreeLayoutEngine::walk(int root, const QVector<int> &preorder)
+{
+    for (int v : preorder) {
+        Node &node = m_nodes[v];
+        node.thread = -1;
+        node.ancestor = v;
+        node.defaultAncestor = node.children.isEmpty() ? -1 : node.children.first();
+        node.prelim = 0.0;
+        node.mod = 0.0;
+        node.shift = 0.0;
+        node.change = 0.0;
+        for (int i = 0; i < node.children.size(); ++i) {
+            m_nodes[node.children.at(i)].number = i;
+        }
+    }
+    m_nodes[root].number = 0;
+
+    // First walk, postorder. Each child is apportioned against its left
+    // siblings as soon as its own subtree is finished, exactly as in the
+    // recursive formulation.
+    QVector<QPair<int, int>> stack;
+    stack.append(qMakePair(root, 0));
+    while (!stack.isEmpty()) {
+        QPair<int, int> &top = stack.last();
+        const int v = top.first;
+        if (top.second < m_nodes.at(v).children.size()) {
+            const int child = m_nodes.at(v).children.at(top.second++);
+            stack.append(qMakePair(child, 0));
+            continue;
+        }
+        stack.removeLast();
+
+        Node &node = m_nodes[v];
+        const int leftSibling = (v != root && node.number > 0)
+            ? m_nodes.at(node.parent).children.at(node.number - 1) : -1;
+        if (node.children.isEmpty()) {
+            node.prelim = leftSibling >= 0 ? m_nodes.at(leftSibling).prelim + separation(leftSibling, v) : 0.0;
+        } else {
+            executeShifts(v);
+            const double midpoint = (m_nodes.at(node.children.first()).prelim
+                                     + m_nodes.at(node.children.last()).prelim) / 2.0;
+            if (leftSibling >= 0) {
+                node.prelim = m_nodes.at(leftSibling).prelim + separation(leftSibling, v);
+                node.mod = node.prelim - midpoint;
+            } else {
+                node.prelim = midpoint;
+            }
+        }
+
+        if (v != root) {
+            Node &parent = m_nodes[node.parent];
+            parent.defaultAncestor = apportion(v, parent.defaultAncestor);
+        }
+    }
+
+    // Second walk, preorder: sum modifiers down the tree, relative to root.
+    for (int v : preorder) {
+        Node &node = m_nodes[v];
+        if (v == root) {
+            node.relative = node.prelim;
+        } else {
+            const Node &parent = m_nodes.at(node.parent);
+            node.relative = node.prelim + (parent.relative - parent.prelim + parent.mod);
+        }
+    }
+    const double rootOffset = m_nodes.at(root).relative;
+    for (int v : preorder) {
+        m_nodes[v].relative -= rootOffset;
+    }
+}
+
+int TreeLayoutEngine::apportion(int v, int defaultAncestor)
+{
+    const Node &node = m_nodes.at(v);
+    if (node.number == 0) {
+        return defaultAncestor;
+    }
+    const QVector<int> &siblings = m_nodes.at(node.parent).children;
+    int vip = v;
+    int vop = v;
+    int vim = siblings.at(node.number - 1);
+    int vom = siblings.first();
+    double sip = m_nodes.at(vip).mod;
+    double sop = m_nodes.at(vop).mod;
+    double sim = m_nodes.at(vim).mod;
+    double som = m_nodes.at(vom).mod;
+
+    while (nextRight(vim) >= 0 && nextLeft(vip) >= 0) {
+        vim = nextRight(vim);
+        vip = nextLeft(vip);
+        vom = nextLeft(vom);
+        vop = nextRight(vop);
+        m_nodes[vop].ancestor = v;
+
+        const double shift = (m_nodes.at(vim).prelim + sim) - (m_nodes.at(vip).prelim + sip) + separation(vim, vip);
+        if (shift > 0.0) {
+            const int candidate = m_nodes.at(vim).ancestor;
+            const int ancestor = m_nodes.at(candidate).parent == node.parent ? candidate : defaultAncestor;
+            moveSubtree(ancestor, v, shift);
+            sip += shift;
+            sop += shift;
+        }
+        sim += m_nodes.at(vim).mod;
+        sip += m_nodes.at(vip).mod;
+        som += m_nodes.at(vom).mod;
+        sop += m_nodes.at(vop).mod;
+    }
+
+    if (nextRight(vim) >= 0 && nextRight(vop) < 0) {
+        m_nodes[vop].thread = nextRight(vim);
+        m_nodes[vop].mod += sim - sop;
+    }
+    if (nextLeft(vip) >= 0 && nextLeft(vom) < 0) {
+        m_nodes[vom].thread = nextLeft(vip);
+        m_nodes[vom].mod += sip - som;
+        defaultAncestor = v;
+    }
+    return defaultAncestor;
+}
+
+void TreeLayoutEngine::moveSubtree(int wm, int wp, double shift)
+{
+    Node &left = m_nodes[wm];
+    Node &right = m_nodes[wp];
+    const double subtrees = right.number - left.number;
+    right.change -= shift / subtrees;
+    right.shift += shift;
+    left.change += shift / subtrees;
+    right.prelim += shift;
+    right.mod += shift;
+}
+
+void TreeLayoutEngine::executeShifts(int v)
+{
+    double shift = 0.0;
+    double change = 0.0;
+    const QVector<int> &children = m_nodes.at(v).children;
+    for (int i = children.size() - 1; i >= 0; --i) {
+        Node &child = m_nodes[children.at(i)];
+        child.prelim += shift;
+        child.mod += shift;
+        change += child.change;
+        shift += child.shift + change;
+    }
+}
+
+int TreeLayoutEngine::nextLeft(int v) const
+{
+    const Node &node = m_nodes.at(v);
+    return node.children.isEmpty() ? node.thread : node.children.first();
+}
+
+int TreeLayoutEngine::nextRight(int v) const
+{
+    const Node &node = m_nodes.at(v);
+    return node.children.isEmpty() ? node.thread : node.children.last();
+}
+
+double TreeLayoutEngine::separation(int left, int right) const
+{
+    const Node &a = m_nodes.at(left);
+    const Node &b = m_nodes.at(right);
+    const bool siblings = a.parent == b.parent && a.parent != VIRTUAL_ROOT;
+    return (breadthSize(a.size) + breadthSize(b.size)) / 2.0 + (siblings ? SIBLING_GAP : SUBTREE_GAP);
+}
+
+TreeLayoutEngine::Contour TreeLayoutEngine::committedContour(int root) const
+{
+    Contour contour;
+    if (root == VIRTUAL_ROOT || !m_nodes.at(root).placed) {
+        return contour;
+    }
+    QVector<int> order;
+    collectSubtree(root, order);
+    const double base = m_nodes.at(root).breadth;
+    const int baseLevel = m_nodes.at(root).level;
+    for (int v : order) {
+        const Node &node = m_nodes.at(v);
+        if (!node.placed) {
+            continue;
+        }
+        const int level = node.level - baseLevel;
+        if (level >= contour.size()) {
+            contour.resize(level + 1);
+            contour[level] = qMakePair(std::numeric_limits<double>::max(), std::numeric_limits<double>::lowest());
+        }
+        const double half = breadthSize(node.placedSize) / 2.0;
+        contour[level].first = qMin(contour.at(level).first, node.breadth - base - half);
+        contour[level].second = qMax(contour.at(level).second, node.breadth - base + half);
+    }
+    return contour;
+}
+
+TreeLayoutEngine::Contour TreeLayoutEngine::walkedContour(int root, const QVector<int> &preorder) const
+{
+    Contour contour;
+    const int baseLevel = m_nodes.at(root).level;
+    for (int v : preorder) {
+        const Node &node = m_nodes.at(v);
+        const int level = node.level - baseLevel;
+        if (level >= contour.size()) {
+            contour.resize(level + 1);
+            contour[level] = qMakePair(std::numeric_limits<double>::max(), std::numeric_limits<double>::lowest());
+        }
+        const double half = breadthSize(node.size) / 2.0;
+        contour[level].first = qMin(contour.at(level).first, node.relative - half);
+        contour[level].second = qMax(contour.at(level).second, node.relative + half);
+    }
+    return contour;
+}
+
+bool TreeLayoutEngine::sameContour(const Contour &a, const Contour &b)
+{
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (int i = 0; i < a.size(); ++i) {
+        if (qAbs(a.at(i).first - b.at(i).first) > CONTOUR_EPSILON
+            || qAbs(a.at(i).second - b.at(i).second) > CONTOUR_EPSILON) {
+            return false;
+        }
+    }
+    return true;
+}
+
+double TreeLayoutEngine::breadthSize(const QSizeF &size) const
+{
+    switch (m_style) {
+    case TopDown:
+        return size.width();
+    case LeftRight:
+        return size.height();
+    case Radial:
+    default:
+        return qMax(size.width(), size.height());
+    }
+}
+
+double TreeLayoutEngine::depthSize(const QSizeF &size) const
+{
+    switch (m_style) {
+    case TopDown:
+        return size.height();
+    case LeftRight:
+        return size.width();
+    case Radial:
+    default:
+        return qMax(size.width(), size.height());
+    }
+}
+
+bool TreeLayoutEngine::updateLevelOffsets()
+{
+    // Layers are as thick as their largest node, so one wide node pushes the
+    // deeper layers out rather than overlapping them.
+    QVector<double> extents;
+    for (int i = 1; i < m_nodes.size(); ++i) {
+        const Node &node = m_nodes.at(i);
+        if (!node.live) {
+            continue;
+        }
+        if (node.level >= extents.size()) {
+            extents.resize(node.level + 1);
+        }
+        extents[node.level] = qMax(extents.at(node.level), depthSize(node.size));
+    }
+
+    QVector<double> offsets(extents.size());
+    double offset = 0.0;
+    for (int level = 0; level < extents.size(); ++level) {
+        offsets[level] = offset;
+        offset += extents.at(level) + LEVEL_GAP;
+    }
+
+    if (offsets == m_levelOffsets) {
+        return false;
+    }
+    m_levelOffsets = offsets;
+    return true;
+}
+
+QPointF TreeLayoutEngine::placeNode(const Node &node, double breadthMin, double breadthSpan, double ringSpacing) const
+{
+    const double layer = node.level < m_levelOffsets.size() ? m_levelOffsets.at(node.level) : 0.0;
+    switch (m_style) {
+    case TopDown:
+        return m_origin + QPointF(node.breadth - node.size.width() / 2.0, layer);
+    case LeftRight:
+        return m_origin + QPointF(layer, node.breadth - node.size.height() / 2.0);
+    case Radial:
+    default: {
+        // A single root sits in the centre; several roots share the first ring.
+        const int ring = node.level + (m_nodes.at(VIRTUAL_ROOT).children.size() > 1 ? 1 : 0);
+        const double angle = 2.0 * M_PI * (node.breadth - breadthMin) / breadthSpan;
+        const QPointF centre(ring * ringSpacing * qCos(angle), ring * ringSpacing * qSin(angle));
+        return m_origin + centre - QPointF(node.size.width() / 2.0, node.size.height() / 2.0);
+    }
+    }
+}
@@ -0,0 +1,141 @@
+#ifndef TREELAYOUT_H
+#define TREELAYOUT_H
+
+#include <QString>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+#include <QPair>
+#include <QPointF>
+#include <QSizeF>
+
+// Tidy-tree layout (Walker's algorithm with Buchheim's linear-time
+// apportioning). Nodes are laid out in layers by depth; the breadth axis is
+// packed from subtree contours so no two nodes overlap.
+//
+// Edits mark the parent of the changed node dirty. relayout() re-runs the
+// walk on that subtree only and climbs to the next ancestor only while the
+// subtree's outline (its per-level extent) changed, so an edit deep inside a
+// large map usually touches a handful of nodes.
+class TreeLayoutEngine
+{
+public:
+    enum Style {
+        TopDown,
+        LeftRight,
+        Radial
+    };
+
+    TreeLayoutEngine();
+
+    // Structure, mirrored from the scene
+    void addNode(const QString &nodeId, const QString &parentId, const QSizeF &size);
+    void removeNode(const QString &nodeId);
+    void setParent(const QString &nodeId, const QString &parentId);
+    void setNodeSize(const QString &nodeId, const QSizeF &size);
+    void clear();
+    int count() const { return m_indexById.size(); }
+
+    // Options; changing either forces a full layout on the next relayout()
+    void setStyle(Style style);
+    Style getStyle() const { return m_style; }
+    void setOrigin(const QPointF &origin);
+    QPointF getOrigin() const { return m_origin; }
+
+    // Layout. Both return the top-left positions that changed since the last
+    // call, keyed by node id.
+    QHash<QString, QPointF> relayout();
+    QHash<QString, QPointF> layoutAll();
+    bool needsLayout() const { return !m_pending.isEmpty(); }
+    QPointF position(const QString &nodeId) const;
+
+    // Diagnostics for the last relayout()
+    int lastVisitedCount() const { return m_lastVisited; }
+    qint64 lastLayoutNsecs() const { return m_lastNsecs; }
+
+private:
+    typedef QVector<QPair<double, double>> Contour; // per relative level: min, max breadth
+
+    struct Node {
+        QString id;
+        int parent = -1;
+        QVector<int> children;
+        int level = 0;
+        int subtreeSize = 1;    // this node and all its descendants
+        QSizeF size;
+        QSizeF placedSize;      // size used by the last committed layout
+        bool live = false;
+        bool placed = false;
+        QString pendingParent;  // parent id waiting for that node to be added
+        double breadth = 0.0;   // committed breadth-axis centre
+        QPointF position;       // committed top-left position
+
+        // Walker scratch, valid only during a walk
+        int number = 0;
+        int thread = -1;
+        int ancestor = -1;
+        int defaultAncestor = -1;
+        double prelim = 0.0;
+        double mod = 0.0;
+        double shift = 0.0;
+        double change = 0.0;
+        double relative = 0.0;
+    };
+
+    // Tree; index 0 is a virtual root holding every real root
+    QVector<Node> m_nodes;
+    QHash<QString, int> m_indexById;
+    QVector<int> m_freeIndices;
+    QHash<QString, QVector<int>> m_orphansByParentId; // children added before their parent
+
+    // Dirty subtrees and the outline each had before its first edit
+    QHash<int, Contour> m_pending;
+    QSet<int> m_committed;
+    bool m_fullOutput;
+
+    // Options and cached layer geometry
+    Style m_style;
+    QPointF m_origin;
+    QVector<double> m_levelOffsets;
+
+    // Diagnostics
+    int m_lastVisited;
+    qint64 m_lastNsecs;
+
+    // Methods
+    int allocateNode(const QString &nodeId);
+    void attach(int index, int parentIndex);
+    void detach(int index);
+    void setSubtreeLevel(int index, int level);
+    void addToSubtreeSizes(int index, int delta);
+    void markDirty(int index);
+    bool hasPendingAncestor(int index) const;
+    bool isCovered(int index, const QSet<int> &roots) const;
+
+    void collectSubtree(int root, QVector<int> &order) const;
+    void walk(int root, const QVector<int> &preorder);
+    int apportion(int v, int defaultAncestor);
+    void moveSubtree(int wm, int wp, double shift);
+    void executeShifts(int v);
+    int nextLeft(int v) const;
+    int nextRight(int v) const;
+    double separation(int left, int right) const;
+
+    Contour committedContour(int root) const;
+    Contour walkedContour(int root, const QVector<int> &preorder) const;
+    static bool sameContour(const Contour &a, const Contour &b);
+
+    double breadthSize(const QSizeF &size) const;
+    double depthSize(const QSizeF &size) const;
+    bool updateLevelOffsets();
+    QPointF placeNode(const Node &node, double breadthMin, double breadthSpan, double ringSpacing) const;
+
+    // Constants
+    static const int VIRTUAL_ROOT = 0;
+    static const double SIBLING_GAP;
+    static const double SUBTREE_GAP;
+    static const double LEVEL_GAP;
+    static const double CONTOUR_EPSILON;
+};
+
+#endif // TREELAYOUT_H
@@ -0,0 +1,471 @@
+#include "vectorexporter.h"
+#include "tracelog.h"
+
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QPainter>
+#include <QPdfWriter>
+#include <QPageSize>
+#include <QQueue>
+#include <QTextLayout>
+#include <QFontMetricsF>
+#include <QXmlStreamWriter>
+#include <QtMath>
+
+namespace {
+
+QString number(qreal value)
+{
+    return QString::number(value, 'f', 2);
+}
+
+} // namespace
+
+VectorExporter::VectorExporter(QObject *parent)
+    : QObject(parent)
+    , m_running(false)
+    , m_cancelRequested(false)
+{
+    m_driverPool.setMaxThreadCount(1);
+    m_workerPool.setMaxThreadCount(qMax(1, QThread::idealThreadCount()));
+}
+
+VectorExporter::~VectorExporter()
+{
+    cancel();
+    waitForFinished();
+}
+
+bool VectorExporter::exportSvg(const PersistentNodeStore &snapshot, const QRectF &sceneArea, const QString &filePath,
+                               SnapshotRenderer::Detail detail)
+{
+    Job job;
+    job.format = Svg;
+    job.sceneArea = sceneArea;
+    job.filePath = filePath;
+    return start(job, snapshot, detail);
+}
+
+bool VectorExporter::exportPdf(const PersistentNodeStore &snapshot, const QRectF &sceneArea, const QString &filePath,
+                               const QPageLayout &pageLayout, qreal scale, SnapshotRenderer::Detail detail)
+{
+    if (scale <= 0 || !pageLayout.isValid()) {
+        return false;
+    }
+
+    Job job;
+    job.format = Pdf;
+    job.sceneArea = sceneArea;
+    job.filePath = filePath;
+    job.pageLayout = pageLayout;
+    job.scale = scale;
+    return start(job, snapshot, detail);
+}
+
+bool VectorExporter::writeSvgFile(const PersistentNodeStore &snapshot, const QRectF &sceneArea, const QString &filePath,
+                                  SnapshotRenderer::Detail detail, QString *message)
+{
+    Job job;
+    job.format = Svg;
+    job.sceneArea = sceneArea;
+    job.filePath = filePath;
+    return runNow(job, snapshot, detail, message);
+}
+
+bool VectorExporter::writePdfFile(const PersistentNodeStore &snapshot, const QRectF &sceneArea, const QString &filePath,
+                                  const QPageLayout &pageLayout, qreal scale, SnapshotRenderer::Detail detail,
+                                  QString *message)
+{
+    if (scale <= 0 || !pageLayout.isValid()) {
+        *message = "Invalid page layout";
+        return false;
+    }
+
+    Job job;
+    job.format = Pdf;
+    job.sceneArea = sceneArea;
+    job.filePath = filePath;
+    job.pageLayout = pageLayout;
+    job.scale = scale;
+    return runNow(job, snapshot, detail, message);
+}
+
+void VectorExporter::cancel()
+{
+    m_cancelRequested.store(true);
+}
+
+void VectorExporter::waitForFinished()
+{
+    m_future.waitForFinished();
+}
+
+qreal VectorExporter::scaleForPagesAcross(const QRectF &sceneArea, const QPageLayout &pageLayout, int pagesAcross)
+{
+    if (sceneArea.isEmpty() || pagesAcross <= 0) {
+        return 1.0;
+    }
+    return pagesAcross * pageLayout.paintRect(QPageLayout::Point).width() / sceneArea.width();
+}
+
+QSize VectorExporter::pageGrid(const QRectF &sceneArea, const QPageLayout &pageLayout, qreal scale)
+{
+    const QRectF paint = pageLayout.paintRect(QPageLayout::Point);
+    if (sceneArea.isEmpty() || paint.isEmpty() || scale <= 0) {
+        return QSize();
+    }
+    // A hair of tolerance so an exact fit doesn't spill onto a blank page
+    const qreal columns = sceneArea.width() * scale / paint.width();
+    const qreal rows = sceneArea.height() * scale / paint.height();
+    return QSize(qMax(1, qCeil(columns - 1e-6)), qMax(1, qCeil(rows - 1e-6)));
+}
+
+QPageLayout VectorExporter::posterLayout(const QRectF &sceneArea)
+{
+    return QPageLayout(QPageSize(QPageSize::A4),
+                       sceneArea.width() > sceneArea.height() ? QPageLayout::Landscape : QPageLayout::Portrait,
+                       QMarginsF(36, 36, 36, 36));
+}
+
+bool VectorExporter::start(const Job &job, const PersistentNodeStore &snapshot, SnapshotRenderer::Detail detail)
+{
+    if (m_running.load() || job.sceneArea.isEmpty()) {
+        return false;
+    }
+
+    m_running.store(true);
+    m_cancelRequested.store(false);
+
+    // Indexing the snapshot is O(n); do it off the GUI thread.
+    m_future = QtConcurrent::run(&m_driverPool, [this, job, snapshot, detail]() mutable {
+        SnapshotRenderer *renderer = new SnapshotRenderer(snapshot);
+        renderer->setDetail(detail);
+        job.renderer.reset(renderer);
+        run(job);
+    });
+    return true;
+}
+
+bool VectorExporter::runNow(Job job, const PersistentNodeStore &snapshot, SnapshotRenderer::Detail detail,
+                            QString *message)
+{
+    if (job.sceneArea.isEmpty()) {
+        *message = "Nothing to export";
+        return false;
+    }
+    bool idle = false;
+    if (!m_running.compare_exchange_strong(idle, true)) {
+        *message = "An export is already running";
+        return false;
+    }
+    m_cancelRequested.store(false);
+
+    SnapshotRenderer *renderer = new SnapshotRenderer(snapshot);
+    renderer->setDetail(detail);
+    job.renderer.reset(renderer);
+    const bool success = execute(job, message);
+    m_running.store(false);
+    return success;
+}
+
+void VectorExporter::run(const Job &job)
+{
+    QString message;
+    const bool success = execute(job, &message);
+    m_running.store(false);
+    QMetaObject::invokeMethod(this, [this, success, message]() {
+        emit finished(success, message);
+    }, Qt::QueuedConnection);
+}
+
+bool VectorExporter::execute(const Job &job, QString *message)
+{
+    QString error;
+    QString summary;
+    const bool success = job.format == Svg ? writeSvg(job, &error, &summary)
+                                           : writePdf(job, &error, &summary);
+    *message = success ? summary : error;
+    return success;
+}
+
+bool VectorExporter::writeSvg(const Job &job, QString *error, QString *summary)
+{
+    TRACE_SCOPE("VectorExporter::writeSvg");
+    // Written next to the target and renamed over it on commit, so a failed
+    // or cancelled export leaves an existing file alone.
+    QSaveFile file(job.filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        *error = file.errorString();
+        return false;
+    }
+
+    const SnapshotRenderer &renderer = *job.renderer;
+    const QRectF area = job.sceneArea;
+
+    QXmlStreamWriter xml(&file);
+    xml.writeStartDocument();
+    xml.writeStartElement("svg");
+    xml.writeDefaultNamespace("http://www.w3.org/2000/svg");
+    xml.writeAttribute("version", "1.1");
+    xml.writeAttribute("width", number(area.width()));
+    xml.writeAttribute("height", number(area.height()));
+    xml.writeAttribute("viewBox", QString("%1 %2 %3 %4").arg(number(area.x()), number(area.y()),
+                                                             number(area.width()), number(area.height())));
+
+    xml.writeEmptyElement("rect");
+    xml.writeAttribute("x", number(area.x()));
+    xml.writeAttribute("y", number(area.y()));
+    xml.writeAttribute("width", number(area.width()));
+    xml.writeAttribute("height", number(area.height()));
+    xml.writeAttribute("fill", renderer.getBackground().name());
+
+    // Connections under the cards, as in the scene
+    const QVector<QLineF> edges = renderer.edgesIn(area);
+    xml.writeStartElement("g");
+    xml.writeAttribute("id", "connections");
+    xml.writeAttribute("stroke", SnapshotRenderer::edgeColor().name());
+    xml.writeAttribute("stroke-width", "2");
+    for (const QLineF &line : edges) {
+        xml.writeEmptyElement("line");
+        xml.writeAttribute("x1", number(line.x1()));
+        xml.writeAttribute("y1", number(line.y1()));
+        xml.writeAttribute("x2", number(line.x2()));
+        xml.writeAttribute("y2", number(line.y2()));
+    }
+    xml.writeEndElement();
+
+    const QStringList nodeIds = renderer.nodesIn(area);
+    const int total = nodeIds.size();
+    xml.writeStartElement("g");
+    xml.writeAttribute("id", "nodes");
+    xml.writeAttribute("stroke-width", "2");
+    for (int i = 0; i < total; ++i) {
+        if (m_cancelRequested.load()) {
+            *error = "Export cancelled";
+            return false;
+        }
+        if (NodeRecordPtr node = renderer.node(nodeIds.at(i))) {
+            writeSvgNode(xml, renderer, *node);
+        }
+        if ((i + 1) % SVG_PROGRESS_STEP == 0) {
+            report(i + 1, total);
+        }
+    }
+    xml.writeEndElement();
+
+    xml.writeEndElement(); // svg
+    xml.writeEndDocument();
+    report(total, total);
+
+    if (xml.hasError() || !file.commit()) {
+        *error = file.errorString();
+        return false;
+    }
+    *summary = QString("Exported %1 nodes to %2").arg(total).arg(QFileInfo(job.filePath).fileName());
+    return true;
+}
+
+void VectorExporter::writeSvgNode(QXmlStreamWriter &xml, const SnapshotRenderer &renderer, const NodeRecord &node)
+{
+    const QRectF rect = node.bounds;
+    const bool fullDetail = renderer.getDetail() == SnapshotRenderer::FullDetail;
+
+    xml.writeStartElement("g");
+    xml.writeAttribute("id", "node-" + node.id);
+
+    xml.writeEmptyElement("rect");
+    xml.writeAttribute("x", number(rect.x()));
+    xml.writeAttribute("y", number(rect.y()));
+    xml.writeAttribute("width", number(rect.width()));
+    xml.writeAttribute("height", number(rect.height()));
+    if (fullDetail) {
+        xml.writeAttribute("rx", QString::number(SnapshotRenderer::CORNER_RADIUS));
+    }
+    xml.writeAttribute("fill", SnapshotRenderer::highlightColor(node.formatting.highlightColor).name());
+    xml.writeAttribute("stroke", SnapshotRenderer::borderColor(node.completed).name());
+
+    if (!fullDetail) {
+        xml.writeEndElement(); // g
+        return;
+    }
+
+    // Same layout as SnapshotRenderer::paintNode
+    const qreal padding = SnapshotRenderer::PADDING;
+    const QRectF textRect = rect.adjusted(padding, padding, -padding, -padding);
+    const QFont title = SnapshotRenderer::titleFont(node);
+    const QFontMetricsF titleMetrics(title);
+
+    QStringList decorations;
+    if (title.underline()) {
+        decorations << "underline";
+    }
+    if (title.strikeOut()) {
+        decorations << "line-through";
+    }
+
+    xml.writeStartElement("text");
+    xml.writeAttribute("x", number(textRect.left()));
+    xml.writeAttribute("y", number(textRect.top() + titleMetrics.ascent()));
+    xml.writeAttribute("font-size", QString("%1px").arg(title.pixelSize()));
+    if (title.bold()) {
+        xml.writeAttribute("font-weight", "bold");
+    }
+    if (title.italic()) {
+        xml.writeAttribute("font-style", "italic");
+    }
+    if (!decorations.isEmpty()) {
+        xml.writeAttribute("text-decoration", decorations.join(' '));
+    }
+    xml.writeAttribute("fill", SnapshotRenderer::textColor(node.formatting.textColor).name());
+    xml.writeCharacters(titleMetrics.elidedText(node.title, Qt::ElideRight, textRect.width()));
+    xml.writeEndElement();
+
+    if (!node.description.isEmpty() && textRect.height() > 2 * titleMetrics.height()) {
+        // SVG 1.1 has no text wrapping; break lines the way Qt would and
+        // emit one tspan per line that fits the card.
+        const QFont description = SnapshotRenderer::descriptionFont();
+        const QRectF area = textRect.adjusted(0, titleMetrics.height() + 4, 0, 0);
+
+        QTextLayout layout(node.description, description);
+        QTextOption option;
+        option.setWrapMode(QTextOption::WrapAtWordBoundaryOrAnywhere);
+        layout.setTextOption(option);
+
+        xml.writeStartElement("text");
+        xml.writeAttribute("font-size", QString("%1px").arg(description.pixelSize()));
+        xml.writeAttribute("fill", SnapshotRenderer::descriptionColor().name());
+        qreal y = 0;
+        layout.beginLayout();
+        for (QTextLine line = layout.createLine(); line.isValid(); line = layout.createLine()) {
+            line.setLineWidth(area.width());
+            if (y + line.height() > area.height()) {
+                break;
+            }
+            xml.writeStartElement("tspan");
+            xml.writeAttribute("x", number(area.left()));
+            xml.writeAttribute("y", number(area.top() + y + line.ascent()));
+            xml.writeCharacters(node.description.mid(line.textStart(), line.textLength()).trimmed());
+            xml.writeEndElement();
+            y += line.height();
+        }
+        layout.endLayout();
+        xml.writeEndElement(); // text
+    }
+
+    xml.writeEndElement(); // g
+}
+
+bool VectorExporter::writePdf(const Job &job, QString *error, QString *summary)
+{
+    TRACE_SCOPE("VectorExporter::writePdf");
+    const QSize grid = pageGrid(job.sceneArea, job.pageLayout, job.scale);
+    const int total = grid.width() * grid.height();
+    if (total <= 0) {
+        *error = "Page layout has no printable area";
+        return false;
+    }
+    if (total > MAX_PAGES) {
+        *error = QString("Export would need %1 pages; use fewer pages across").arg(total);
+        return false;
+    }
+
+    // As for SVG: the target is only replaced once every page is written
+    QSaveFile file(job.filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        *error = file.errorString();
+        return false;
+    }
+    QPdfWriter writer(&file);
+    writer.setPageLayout(job.pageLayout);
+    writer.setCreator("Mind2Do");
+    writer.setTitle(QFileInfo(job.filePath).completeBaseName());
+
+    QPainter painter;
+    if (!painter.begin(&writer)) {
+        *error = "Cannot write " + job.filePath;
+        return false;
+    }
+
+    // Scene units -> points -> device units of the writer
+    const qreal deviceScale = job.scale * writer.resolution() / POINTS_PER_INCH;
+    const int maxInFlight = m_workerPool.maxThreadCount() * PAGES_IN_FLIGHT_PER_THREAD;
+    QQueue<QFuture<QPicture>> inFlight;
+    int next = 0;
+    bool ok = true;
+
+    // Pages are recorded out of order but replayed in order; the window of
+    // futures bounds how many finished pages wait in memory.
+    for (int written = 0; written < total; ++written) {
+        while (next < total && inFlight.size() < maxInFlight) {
+            const QRectF area = pageArea(job, grid, next);
+            inFlight.enqueue(QtConcurrent::run(&m_workerPool, [job, area]() {
+                return recordPage(job, area);
+            }));
+            next++;
+        }
+
+        const QPicture picture = inFlight.dequeue().result();
+        if (m_cancelRequested.load()) {
+            *error = "Export cancelled";
+            ok = false;
+            break;
+        }
+        if (written > 0 && !writer.newPage()) {
+            *error = "Cannot add page to " + job.filePath;
+            ok = false;
+            break;
+        }
+
+        painter.save();
+        painter.scale(deviceScale, deviceScale);
+        painter.translate(-pageArea(job, grid, written).topLeft());
+        painter.drawPicture(QPointF(0, 0), picture);
+        painter.restore();
+        report(written + 1, total);
+    }
+
+    while (!inFlight.isEmpty()) {
+        inFlight.dequeue().waitForFinished();
+    }
+    painter.end();
+    if (!ok) {
+        return false;
+    }
+    if (!file.commit()) {
+        *error = file.errorString();
+        return false;
+    }
+
+    *summary = QString("Exported %1 page(s), %2 x %3, to %4")
+                   .arg(total).arg(grid.width()).arg(grid.height())
+                   .arg(QFileInfo(job.filePath).fileName());
+    return true;
+}
+
+QPicture VectorExporter::recordPage(const Job &job, const QRectF &pageArea)
+{
+    TRACE_SCOPE("VectorExporter::recordPage");
+    // Recorded in scene coordinates, clipped and culled to the page
+    QPicture picture;
+    QPainter painter(&picture);
+    painter.setClipRect(pageArea);
+    job.renderer->render(&painter, pageArea);
+    painter.end();
+    return picture;
+}
+
+QRectF VectorExporter::pageArea(const Job &job, const QSize &grid, int page)
+{
+    const QRectF paint = job.pageLayout.paintRect(QPageLayout::Point);
+    const QSizeF span(paint.width() / job.scale, paint.height() / job.scale);
+    const int column = page % grid.width();
+    const int row = page / grid.width();
+    return QRectF(job.sceneArea.topLeft() + QPointF(column * span.width(), row * span.height()), span);
+}
+
+void VectorExporter::report(int done, int total)
+{
+    QMetaObject::invokeMethod(this, [this, done, total]() {
+        emit progress(done, total);
+    }, Qt::QueuedConnection);
+}
@@ -0,0 +1,110 @@
+#ifndef VECTOREXPORTER_H
+#define VECTOREXPORTER_H
+
+#include <QObject>
+#include <QString>
+#include <QRectF>
+#include <QSize>
+#include <QPicture>
+#include <QPageLayout>
+#include <QSharedPointer>
+#include <QThreadPool>
+#include <QFuture>
+#include <QtConcurrent>
+
+#include <atomic>
+
+#include "persistentnodestore.h"
+#include "snapshotrenderer.h"
+
+class QXmlStreamWriter;
+
+// Exports a map snapshot as SVG or multi-page PDF on background threads.
+//
+// SVG is written element by element through QXmlStreamWriter straight to
+// the file, so no document is ever built in memory. PDF splits the area
+// into a grid of pages (poster style); each page's drawing is recorded
+// into a QPicture on a worker pool, culled to that page, and the pictures
+// are replayed onto the QPdfWriter in page order. A bounded window of
+// pages in flight keeps memory flat however many pages there are.
+class VectorExporter : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit VectorExporter(QObject *parent = nullptr);
+    ~VectorExporter();
+
+    // Both return false if an export is already running or the area is empty.
+    bool exportSvg(const PersistentNodeStore &snapshot, const QRectF &sceneArea, const QString &filePath,
+                   SnapshotRenderer::Detail detail = SnapshotRenderer::FullDetail);
+    // scale is PDF points per scene unit
+    bool exportPdf(const PersistentNodeStore &snapshot, const QRectF &sceneArea, const QString &filePath,
+                   const QPageLayout &pageLayout, qreal scale,
+                   SnapshotRenderer::Detail detail = SnapshotRenderer::FullDetail);
+    void cancel();
+    void waitForFinished();
+
+    // Blocking variants for callers without an event loop (command-line
+    // mode). PDF pages still record on the worker pool; finished is not emitted.
+    bool writeSvgFile(const PersistentNodeStore &snapshot, const QRectF &sceneArea, const QString &filePath,
+                      SnapshotRenderer::Detail detail, QString *message);
+    bool writePdfFile(const PersistentNodeStore &snapshot, const QRectF &sceneArea, const QString &filePath,
+                      const QPageLayout &pageLayout, qreal scale, SnapshotRenderer::Detail detail, QString *message);
+    bool isRunning() const { return m_running.load(); }
+
+    // PDF page recording threads; one per core by default, as for
+    // TiledImageExporter::setWorkerCount
+    void setWorkerCount(int count) { m_workerPool.setMaxThreadCount(qMax(1, count)); }
+
+    // Page layout helpers
+    static qreal scaleForPagesAcross(const QRectF &sceneArea, const QPageLayout &pageLayout, int pagesAcross);
+    static QSize pageGrid(const QRectF &sceneArea, const QPageLayout &pageLayout, qreal scale);
+    static QPageLayout posterLayout(const QRectF &sceneArea); // A4, oriented to the area, half-inch margins
+
+signals:
+    void progress(int done, int total);
+    void finished(bool success, const QString &message);
+
+private:
+    enum Format {
+        Svg,
+        Pdf
+    };
+
+    struct Job {
+        Format format = Svg;
+        QSharedPointer<const SnapshotRenderer> renderer;
+        QRectF sceneArea;
+        QString filePath;
+        QPageLayout pageLayout;
+        qreal scale = 1.0;
+    };
+
+    // Threads
+    QThreadPool m_driverPool;
+    QThreadPool m_workerPool;
+    QFuture<void> m_future;
+    std::atomic<bool> m_running;
+    std::atomic<bool> m_cancelRequested;
+
+    // Methods
+    bool start(const Job &job, const PersistentNodeStore &snapshot, SnapshotRenderer::Detail detail);
+    bool runNow(Job job, const PersistentNodeStore &snapshot, SnapshotRenderer::Detail detail, QString *message);
+    void run(const Job &job);
+    bool execute(const Job &job, QString *message);
+    bool writeSvg(const Job &job, QString *error, QString *summary);
+    bool writePdf(const Job &job, QString *error, QString *summary);
+    static void writeSvgNode(QXmlStreamWriter &xml, const SnapshotRenderer &renderer, const NodeRecord &node);
+    static QPicture recordPage(const Job &job, const QRectF &pageArea);
+    static QRectF pageArea(const Job &job, const QSize &grid, int page);
+    void report(int done, int total);
+
+    // Constants
+    static const int PAGES_IN_FLIGHT_PER_THREAD = 2;
+    static const int SVG_PROGRESS_STEP = 1000;   // nodes between progress reports
+    static const int MAX_PAGES = 10000;
+    static const int POINTS_PER_INCH = 72;
+};
+
+#endif // VECTOREXPORTER_H
@@ -0,0 +1,12 @@
+#include "mindmapview.h"
+
+// The view's per-frame notifier. Kept apart from mindmapview.cpp so the
+// coalescer's wiring to the update tick is in one place.
+
+void MindMapView::setupNotifier()
+{
+    m_notifier = new NotificationCoalescer(UPDATE_INTERVAL, this);
+
+    // Listeners run on the same tick as the repaint they feed into
+    connect(m_updateTimer, &QTimer::timeout, m_notifier, &NotificationCoalescer::flush);
+}